@@ -102,6 +102,7 @@ namespace BE
 	{
 		if (initialized)
 		{
+			resourceWatcher.Close();
 			gameInstance.TryFree();
 			
 			threadPool.TryFree(); //must free manually or else these smart pointers get freed on destruction, which is after the allocators (which this classes depend on) are destroyed.
@@ -143,12 +144,51 @@ namespace BE
 		PROFILE;
 		
 		inputManagerInstance->Update();
+		updateResourceReloads();
 		gameInstance->OnUpdate(this);
 	}
 
+	void Application::updateResourceReloads()
+	{
+		const auto now = clockInstance.GetElapsedTime();
+		
+		GTSL::StaticString<FileWatcher::MAX_FILE_NAME_LENGTH> fileName;
+		while (resourceWatcher.GetChange(fileName))
+		{
+			const auto hash = GTSL::Id64(fileName);
+			
+			bool found = false;
+			for (auto& e : pendingReloads) { if (e.Hash == hash) { e.LastChange = now; found = true; break; } }
+
+			if (!found && pendingReloads.GetLength() < MAX_PENDING_RELOADS) { pendingReloads.EmplaceBack(PendingReload{ fileName, hash, now }); }
+		}
+
+		for (uint32 i = 0; i < pendingReloads.GetLength();)
+		{
+			if ((now - pendingReloads[i].LastChange).As<float32, GTSL::Seconds>() < RELOAD_DELAY) { ++i; continue; }
+
+			//files no manager imports, like the packages managers write to while reloading, are ignored
+			bool handled = false;
+			auto reload = [&](GTSL::SmartPointer<ResourceManager, SystemAllocatorReference>& resourceManager)
+			{
+				if (!handled) { handled = resourceManager->ReloadResource(gameInstance, pendingReloads[i].FileName.begin()); }
+			};
+			GTSL::ForEach(resourceManagers, reload);
+
+			if (handled) { BE_LOG_MESSAGE("Reloading ", pendingReloads[i].FileName.begin()); }
+
+			pendingReloads[i] = pendingReloads[pendingReloads.GetLength() - 1]; pendingReloads.PopBack();
+		}
+	}
+
 	int Application::Run(int argc, char** argv)
 	{
 		gameInstance->AddEvent("Application", EventHandle<>("OnPromptClose"));
+
+		if (GetOption("hotReload", 1)) {
+			auto resourcesPath = GetPathToApplication(); resourcesPath += "/resources/";
+			if (!resourceWatcher.Watch(resourcesPath)) { BE_LOG_WARNING("Couldn't watch resources directory, resources won't be reloaded when their files change."); }
+		}
 		
 		while (!flaggedForClose)
 		{
@@ -4,11 +4,13 @@
 
 #include <GTSL/Application.h>
 #include <GTSL/Allocator.h>
+#include <GTSL/Array.hpp>
 #include <GTSL/FlatHashMap.h>
 #include <GTSL/String.hpp>
 
 
 #include "Clock.h"
+#include "FileWatcher.h"
 #include "PoolAllocator.h"
 #include "StackAllocator.h"
 #include "SystemAllocator.h"
@@ -100,6 +102,15 @@ namespace BE
 		
 		template<class T>
 		T* GetResourceManager(const Id name) { return static_cast<T*>(resourceManagers.At(name).GetData()); }
+
+		/**
+		 * \brief Calls function(ResourceManager*) for every resource manager.
+		 */
+		template<typename F>
+		void ForEachResourceManager(F&& function)
+		{
+			GTSL::ForEach(resourceManagers, [&](GTSL::SmartPointer<ResourceManager, SystemAllocatorReference>& resourceManager) { function(resourceManager.GetData()); });
+		}
 		
 		[[nodiscard]] ThreadPool* GetThreadPool() const { return threadPool; }
 		
@@ -111,6 +122,14 @@ namespace BE
 		{
 			return settings.At(name);
 		}
+
+		/**
+		 * \brief Returns the value of an option or defaultValue if the option was not specified in the settings file.
+		 */
+		uint32 GetOption(const Id name, const uint32 defaultValue) const
+		{
+			return settings.Find(name) ? settings.At(name) : defaultValue;
+		}
 		
 	protected:
 		GTSL::SmartPointer<Logger, SystemAllocatorReference> logger;
@@ -139,6 +158,31 @@ namespace BE
 
 		uint64 applicationTicks{ 0 };
 
+		/**
+		 * \brief Watches the resources directory for source files changed while the application runs. Enabled by the "hotReload" option.
+		 */
+		FileWatcher resourceWatcher;
+
+		/**
+		 * \brief Seconds a changed file has to go without further changes before it's reloaded, as editors usually write a file in more than one step.
+		 */
+		static constexpr float32 RELOAD_DELAY = 0.1f;
+
+		static constexpr uint32 MAX_PENDING_RELOADS = 32;
+
+		struct PendingReload
+		{
+			GTSL::StaticString<FileWatcher::MAX_FILE_NAME_LENGTH> FileName;
+			GTSL::Id64 Hash;
+			GTSL::Microseconds LastChange;
+		};
+		GTSL::Array<PendingReload, MAX_PENDING_RELOADS> pendingReloads;
+
+		/**
+		 * \brief Collects changes reported by resourceWatcher and hands files that have settled to the resource manager that imports them.
+		 */
+		void updateResourceReloads();
+		
 		bool parseConfig();
 		/**
 		 * \brief Checks if the platform (OS, CPU, RAM) satisfies certain requirements specified for the program.
@@ -0,0 +1,139 @@
+#include "FileWatcher.h"
+
+#include <GTSL/Memory.h>
+
+#ifdef BE_PLATFORM_WIN
+#include <new>
+#include <Windows.h>
+#else
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+FileWatcher::~FileWatcher()
+{
+	Close();
+}
+
+#ifdef BE_PLATFORM_WIN
+static_assert(sizeof(OVERLAPPED) <= 32, "OVERLAPPED doesn't fit in storage!");
+
+bool FileWatcher::Watch(const GTSL::Range<const utf8*> directory)
+{
+	Close();
+
+	GTSL::StaticString<512> terminatedPath(directory); //range may not be null terminated
+
+	const HANDLE handle = CreateFileA(terminatedPath.begin(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+		FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+	if (handle == INVALID_HANDLE_VALUE) { return false; }
+
+	auto* overlappedData = new(overlapped) OVERLAPPED{};
+	overlappedData->hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+
+	directoryHandle = handle;
+
+	if (!issueRead()) { Close(); return false; }
+
+	return true;
+}
+
+void FileWatcher::Close()
+{
+	if (!directoryHandle) { return; }
+
+	auto* overlappedData = reinterpret_cast<OVERLAPPED*>(overlapped);
+	CancelIo(directoryHandle);
+	CloseHandle(overlappedData->hEvent);
+	CloseHandle(directoryHandle);
+
+	directoryHandle = nullptr; eventsLength = 0; eventsPosition = 0;
+}
+
+bool FileWatcher::issueRead()
+{
+	return ReadDirectoryChangesW(directoryHandle, pendingEvents, EVENTS_BUFFER_SIZE, FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME,
+		nullptr, reinterpret_cast<OVERLAPPED*>(overlapped), nullptr);
+}
+
+bool FileWatcher::GetChange(GTSL::StaticString<MAX_FILE_NAME_LENGTH>& fileName)
+{
+	while (true)
+	{
+		if (eventsPosition == eventsLength)
+		{
+			if (!directoryHandle) { return false; }
+
+			DWORD bytes = 0;
+			if (!GetOverlappedResult(directoryHandle, reinterpret_cast<OVERLAPPED*>(overlapped), &bytes, FALSE)) { return false; } //read still pending, nothing changed
+
+			GTSL::MemCopy(bytes, pendingEvents, events); //0 bytes means the OS buffer overflowed and events were lost
+			eventsLength = bytes; eventsPosition = 0;
+
+			ResetEvent(reinterpret_cast<OVERLAPPED*>(overlapped)->hEvent);
+			if (!issueRead()) { Close(); }
+
+			if (!eventsLength) { return false; }
+		}
+
+		const auto* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(events + eventsPosition);
+		eventsPosition = info->NextEntryOffset ? eventsPosition + info->NextEntryOffset : eventsLength;
+
+		if (info->Action != FILE_ACTION_ADDED && info->Action != FILE_ACTION_MODIFIED && info->Action != FILE_ACTION_RENAMED_NEW_NAME) { continue; }
+
+		char name[MAX_FILE_NAME_LENGTH];
+		const int32 length = WideCharToMultiByte(CP_UTF8, 0, info->FileName, info->FileNameLength / sizeof(WCHAR), name, MAX_FILE_NAME_LENGTH - 1, nullptr, nullptr);
+		if (!length) { continue; }
+		name[length] = '\0';
+
+		fileName.Resize(0); fileName += name;
+		return true;
+	}
+}
+#else
+bool FileWatcher::Watch(const GTSL::Range<const utf8*> directory)
+{
+	Close();
+
+	GTSL::StaticString<512> terminatedPath(directory); //range may not be null terminated
+
+	watcher = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (watcher < 0) { return false; }
+
+	//editors either write in place or write a temporary and rename it over the original, report both once the file is complete
+	if (inotify_add_watch(watcher, terminatedPath.begin(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) { Close(); return false; }
+
+	return true;
+}
+
+void FileWatcher::Close()
+{
+	if (watcher < 0) { return; }
+	close(watcher);
+	watcher = -1; eventsLength = 0; eventsPosition = 0;
+}
+
+bool FileWatcher::GetChange(GTSL::StaticString<MAX_FILE_NAME_LENGTH>& fileName)
+{
+	while (true)
+	{
+		if (eventsPosition == eventsLength)
+		{
+			if (watcher < 0) { return false; }
+
+			const auto bytes = read(watcher, events, EVENTS_BUFFER_SIZE);
+			if (bytes <= 0) { eventsLength = 0; eventsPosition = 0; return false; } //EAGAIN, nothing changed
+
+			eventsLength = static_cast<uint32>(bytes); eventsPosition = 0;
+		}
+
+		const auto* event = reinterpret_cast<const inotify_event*>(events + eventsPosition);
+		eventsPosition += sizeof(inotify_event) + event->len;
+
+		if (!event->len || event->mask & (IN_ISDIR | IN_Q_OVERFLOW)) { continue; }
+
+		fileName.Resize(0); fileName += event->name;
+		return true;
+	}
+}
+#endif
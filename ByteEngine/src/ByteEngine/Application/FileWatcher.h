@@ -0,0 +1,56 @@
+#pragma once
+
+#include <GTSL/Range.h>
+#include <GTSL/StaticString.hpp>
+
+#include "ByteEngine/Core.h"
+
+/**
+ * \brief Reports files written to or moved into a directory, without blocking. Uses inotify on Linux and ReadDirectoryChangesW on Windows.
+ * Subdirectories are not watched. A single save can be reported more than once, callers should coalesce changes.
+ */
+class FileWatcher
+{
+public:
+	static constexpr uint32 MAX_FILE_NAME_LENGTH = 256;
+
+	FileWatcher() = default;
+	~FileWatcher();
+
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	/**
+	 * \return Whether the directory exists and could be watched.
+	 */
+	bool Watch(GTSL::Range<const utf8*> directory);
+	void Close();
+
+	/**
+	 * \brief Returns the name, with extension, of the next changed file in the watched directory.
+	 * \return False when no change is left to report.
+	 */
+	bool GetChange(GTSL::StaticString<MAX_FILE_NAME_LENGTH>& fileName);
+
+private:
+	static constexpr uint32 EVENTS_BUFFER_SIZE = 4096;
+
+	/**
+	 * \brief Events read from the OS and not yet reported.
+	 */
+	alignas(8) byte events[EVENTS_BUFFER_SIZE];
+	uint32 eventsLength = 0, eventsPosition = 0;
+
+#ifdef BE_PLATFORM_WIN
+	/**
+	 * \brief Buffer the OS writes events to while a read is pending. Copied to events once it completes so the next read can be issued right away.
+	 */
+	alignas(8) byte pendingEvents[EVENTS_BUFFER_SIZE];
+	alignas(8) byte overlapped[32];
+	void* directoryHandle = nullptr;
+
+	bool issueRead();
+#else
+	int32 watcher = -1;
+#endif
+};
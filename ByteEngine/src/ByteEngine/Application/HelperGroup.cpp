@@ -0,0 +1,36 @@
+#include "HelperGroup.h"
+
+#include <GTSL/Delegate.hpp>
+
+#include "Application.h"
+#include "ThreadPool.h"
+
+void HelperGroup::run(void(*newWork)(void*), void* newWorkObject, const uint32 helpers)
+{
+	work = newWork; workObject = newWorkObject;
+	state.store(0, std::memory_order_release); //opens the group, what work reads was written before
+
+	auto* threadPool = BE::Application::Get()->GetThreadPool();
+	queuedHelpers.fetch_add(helpers, std::memory_order_relaxed);
+	for (uint32 h = 0; h < helpers; ++h) { threadPool->EnqueueTask(GTSL::Delegate<void(HelperGroup*)>::Create([](HelperGroup* group) { group->help(); }), this); }
+
+	work(workObject); //this thread takes jobs too instead of just waiting
+
+	//helpers which joined are finishing their last job, the ones still queued will find the group closed
+	state.fetch_or(CLOSED, std::memory_order_relaxed);
+	while (state.load(std::memory_order_acquire) != CLOSED) { std::this_thread::yield(); }
+}
+
+void HelperGroup::help()
+{
+	uint32 current = state.load(std::memory_order_relaxed);
+	while (!(current & CLOSED)) {
+		if (state.compare_exchange_weak(current, current + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+			work(workObject);
+			state.fetch_sub(1, std::memory_order_release);
+			break;
+		}
+	}
+
+	queuedHelpers.fetch_sub(1, std::memory_order_release);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+#include "ByteEngine/Core.h"
+
+/**
+ * \brief Lets code running on a thread pool worker share a job list with idle workers without blocking on them. Helpers are queued like
+ * any task but only the ones that start before the caller runs out of work join it, the caller waits for those to finish their last job
+ * and the rest leave as soon as they start. A helper queued on the caller's own worker can't stall it that way.
+ * Must outlive the helpers it queued, destroying it waits for all of them to have started so it mustn't be destroyed from a pool task.
+ */
+class HelperGroup
+{
+public:
+	HelperGroup() = default;
+	HelperGroup(const HelperGroup&) = delete;
+	~HelperGroup() { while (queuedHelpers.load(std::memory_order_acquire)) { std::this_thread::yield(); } }
+
+	/**
+	 * \brief Calls object's WORK from up to helpers pool workers and this thread, and returns once every call has returned. WORK must take
+	 * jobs from a shared list until it's empty.
+	 */
+	template<class T, void(T::*WORK)()>
+	void Run(T* object, const uint32 helpers)
+	{
+		run([](void* o) { (static_cast<T*>(o)->*WORK)(); }, object, helpers);
+	}
+
+private:
+	static constexpr uint32 CLOSED = 1u << 31;
+
+	/**
+	 * \brief Helpers taking part in the current Run, or'd with CLOSED when none can join. Starts closed so late helpers never join a later
+	 * caller that runs it's work alone.
+	 */
+	std::atomic<uint32> state{ CLOSED };
+	std::atomic<uint32> queuedHelpers{ 0 };
+
+	void(*work)(void*) = nullptr; void* workObject = nullptr;
+
+	void run(void(*newWork)(void*), void* newWorkObject, uint32 helpers);
+	void help();
+};
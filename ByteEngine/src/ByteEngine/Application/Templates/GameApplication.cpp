@@ -83,6 +83,11 @@ void GameApplication::PostInitialize()
 	
 	//FRAME ENDS
 	gameInstance->AddStage("FrameEnd");
+
+	//systems subscribe to these when added
+	gameInstance->AddEvent("TextureResourceManager", TextureResourceManager::GetOnTextureReloadEventHandle());
+	gameInstance->AddEvent("StaticMeshResourceManager", StaticMeshResourceManager::GetOnStaticMeshReloadEventHandle());
+	gameInstance->AddEvent("MaterialResourceManager", MaterialResourceManager::GetOnMaterialReloadEventHandle());
 	
 	auto* renderSystem = gameInstance->AddSystem<RenderSystem>("RenderSystem");
 
@@ -1,19 +1,63 @@
 #include "World.h"
 
-World::World()
+#include <GTSL/Vector.hpp>
+
+#include "ByteEngine/Application/Application.h"
+#include "ByteEngine/Debug/Assert.h"
+#include "ByteEngine/Resources/ResourceManager.h"
+
+World::World() : World("World")
+{
+}
+
+World::World(const utf8* name) : Object(name), resourceManifest(GetPersistentAllocator())
 {
 }
 
 void World::InitializeWorld(const InitializeInfo& initializeInfo)
 {
-	
+	auto* application = BE::Application::Get();
+	initializeTime = application->GetClock()->GetCurrentMicroseconds();
+
+	const auto manifestPath = getManifestPath();
+	recordingManifest = application->GetOption(Id("recordResourceManifests"), 0) || !resourceManifest.Load(manifestPath, GetTransientAllocator());
+
+	resourceManifest.SetRecording(recordingManifest);
+	application->ForEachResourceManager([&](ResourceManager* resourceManager) { resourceManager->SetManifest(&resourceManifest); });
+
+	if (!recordingManifest) //resources loaded by others are prefetched as soon as the ones loading them are requested
+	{
+		GTSL::Vector<ResourceManifest::Entry, BE::TAR> roots(resourceManifest.GetLength(), GetTransientAllocator());
+		resourceManifest.TakeRoots(roots);
+		if (roots.GetLength()) { ResourceManager::PrefetchManifestEntries(initializeInfo.GameInstance, roots.GetRange()); }
+	}
+
+	if (recordingManifest) { BE_LOG_MESSAGE("No resource manifest for world ", GetName(), ", recording one"); }
 }
 
 void World::DestroyWorld(const DestroyInfo& destroyInfo)
 {
+	auto* application = BE::Application::Get();
+	application->ForEachResourceManager([](ResourceManager* resourceManager) { resourceManager->SetManifest(nullptr); });
+
+	if (recordingManifest) { resourceManifest.Write(getManifestPath(), GetTransientAllocator()); }
+
+	if (resourceManifest.GetLastReadTime().As<float32, GTSL::Seconds>() > 0.0f) //nothing was read while the world was loaded
+	{
+		const auto timeToInteractive = (resourceManifest.GetLastReadTime() - initializeTime).As<float32, GTSL::Seconds>() * 1000.0f;
+		BE_LOG_MESSAGE("World ", GetName(), " loaded it's resources in ", timeToInteractive, " ms", recordingManifest ? "" : " with prefetching");
+	}
 }
 
 void World::Pause()
 {
 	worldTimeMultiplier = 0;
 }
+
+GTSL::StaticString<512> World::getManifestPath() const
+{
+	GTSL::StaticString<512> path;
+	path += BE::Application::Get()->GetPathToApplication();
+	path += "/resources/"; path += GetName(); path += ".bemanifest";
+	return path;
+}
@@ -1,17 +1,29 @@
 #pragma once
 
+#include <GTSL/Time.h>
+
 #include "ByteEngine/Object.h"
+#include "ByteEngine/Resources/ResourceManifest.h"
 
 class World : public Object
 {
 public:
 	World();
+	/**
+	 * \param name Name of the world, also names the manifest of the resources it loads.
+	 */
+	World(const utf8* name);
 	~World() = default;
 
 	struct InitializeInfo
 	{
 		class GameInstance* GameInstance{ nullptr };
 	};
+	/**
+	 * \brief Prefetches the resources the world loaded the last time it ran, if it has a manifest, otherwise starts recording one. Only resources
+	 * no other resource loads are prefetched here, the rest are prefetched when the resources loading them are requested.
+	 * Setting the "recordResourceManifests" option rebuilds the manifest.
+	 */
 	virtual void InitializeWorld(const InitializeInfo& initializeInfo);
 
 	struct DestroyInfo
@@ -27,4 +39,13 @@ public:
 protected:
 	float worldTimeMultiplier = 1;
 
+private:
+	ResourceManifest resourceManifest;
+	bool recordingManifest = false;
+	/**
+	 * \brief Time the world started loading, time to interactive is measured from here to the last resource read.
+	 */
+	GTSL::Microseconds initializeTime;
+
+	GTSL::StaticString<512> getManifestPath() const;
 };
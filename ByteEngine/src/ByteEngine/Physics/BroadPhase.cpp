@@ -0,0 +1,300 @@
+#include "BroadPhase.h"
+
+#include <algorithm>
+
+namespace
+{
+	AABB fatten(const AABB& aabb, const float32 margin)
+	{
+		AABB result;
+		for (uint8 i = 0; i < 3; ++i) { result.Min[i] = aabb.Min[i] - margin; result.Max[i] = aabb.Max[i] + margin; }
+		return result;
+	}
+
+	int32 maxHeight(const int32 a, const int32 b) { return a > b ? a : b; }
+
+	bool operator<(const BroadPhase::Pair& a, const BroadPhase::Pair& b) { return a.A < b.A || (a.A == b.A && a.B < b.B); }
+	bool operator==(const BroadPhase::Pair& a, const BroadPhase::Pair& b) { return a.A == b.A && a.B == b.B; }
+}
+
+void DynamicAABBTree::Initialize(const uint32 capacity, const BE::PAR& allocator)
+{
+	nodes.Initialize(capacity * 2, allocator); //a tree of n leaves has n - 1 branches
+}
+
+uint32 DynamicAABBTree::CreateProxy(const AABB& aabb, const uint32 userData)
+{
+	const uint32 proxy = allocateNode();
+	nodes[proxy].Box = fatten(aabb, AABB_MARGIN); nodes[proxy].UserData = userData;
+	insertLeaf(proxy);
+	return proxy;
+}
+
+void DynamicAABBTree::DestroyProxy(const uint32 proxy)
+{
+	removeLeaf(proxy);
+	freeNode(proxy);
+}
+
+bool DynamicAABBTree::MoveProxy(const uint32 proxy, const AABB& aabb, const float32 displacement[3])
+{
+	AABB fatAABB = fatten(aabb, AABB_MARGIN);
+
+	//predict where the proxy is going so it stays inside it's box for a few more steps
+	for (uint8 i = 0; i < 3; ++i) {
+		const float32 d = displacement[i] * DISPLACEMENT_MULTIPLIER;
+		if (d < 0.0f) { fatAABB.Min[i] += d; } else { fatAABB.Max[i] += d; }
+	}
+
+	const AABB& treeAABB = nodes[proxy].Box;
+	if (treeAABB.Contains(aabb)) {
+		//a box left large by a fast movement that stopped would pair with everything around it, shrink it
+		if (fatten(fatAABB, AABB_MARGIN * 4.0f).Contains(treeAABB)) { return false; }
+	}
+
+	removeLeaf(proxy);
+	nodes[proxy].Box = fatAABB;
+	insertLeaf(proxy);
+	return true;
+}
+
+uint32 DynamicAABBTree::allocateNode()
+{
+	uint32 node;
+
+	if (freeList == NULL_NODE) { node = nodes.GetLength(); nodes.EmplaceBack(); }
+	else { node = freeList; freeList = nodes[node].Parent; }
+
+	nodes[node].Parent = NULL_NODE; nodes[node].Children[0] = NULL_NODE; nodes[node].Children[1] = NULL_NODE;
+	nodes[node].Height = 0; nodes[node].UserData = 0;
+	return node;
+}
+
+void DynamicAABBTree::freeNode(const uint32 node)
+{
+	nodes[node].Parent = freeList; nodes[node].Height = -1;
+	freeList = node;
+}
+
+void DynamicAABBTree::insertLeaf(const uint32 leaf)
+{
+	if (root == NULL_NODE) { root = leaf; nodes[root].Parent = NULL_NODE; return; }
+
+	const AABB leafAABB = nodes[leaf].Box;
+
+	//best first branch and bound search for the sibling which grows the tree's surface area the least. Pairing the leaf with a node costs the area of
+	//their new parent plus how much every ancestor of the node grows, which is also a lower bound for the cost of every node under it
+	const float32 leafArea = leafAABB.GetArea();
+	uint32 sibling = root; float32 bestCost = AABB::Union(leafAABB, nodes[root].Box).GetArea();
+
+	struct Candidate { uint32 Node; float32 InheritedCost; };
+	auto isWorse = [](const Candidate& a, const Candidate& b) { return a.InheritedCost > b.InheritedCost; };
+	Candidate heap[MAX_DEPTH]; uint32 count = 0;
+	heap[count++] = { root, 0.0f };
+
+	while (count && heap[0].InheritedCost + leafArea < bestCost)
+	{
+		std::pop_heap(heap, heap + count, isWorse);
+		const Candidate candidate = heap[--count];
+		const Node& node = nodes[candidate.Node];
+
+		const float32 directCost = AABB::Union(leafAABB, node.Box).GetArea();
+		const float32 cost = directCost + candidate.InheritedCost;
+		if (cost < bestCost) { bestCost = cost; sibling = candidate.Node; }
+
+		if (node.IsLeaf()) { continue; }
+
+		const float32 inheritedCost = candidate.InheritedCost + directCost - node.Box.GetArea();
+		if (inheritedCost + leafArea < bestCost && count + 2 <= MAX_DEPTH) {
+			heap[count++] = { node.Children[0], inheritedCost }; std::push_heap(heap, heap + count, isWorse);
+			heap[count++] = { node.Children[1], inheritedCost }; std::push_heap(heap, heap + count, isWorse);
+		}
+	}
+
+	const uint32 oldParent = nodes[sibling].Parent;
+	const uint32 newParent = allocateNode(); //can grow nodes, no references are held across it
+
+	nodes[newParent].Parent = oldParent;
+	nodes[newParent].Box = AABB::Union(leafAABB, nodes[sibling].Box);
+	nodes[newParent].Height = nodes[sibling].Height + 1;
+	nodes[newParent].Children[0] = sibling; nodes[newParent].Children[1] = leaf;
+	nodes[sibling].Parent = newParent; nodes[leaf].Parent = newParent;
+
+	if (oldParent != NULL_NODE) {
+		if (nodes[oldParent].Children[0] == sibling) { nodes[oldParent].Children[0] = newParent; } else { nodes[oldParent].Children[1] = newParent; }
+	} else {
+		root = newParent;
+	}
+
+	//refit and rebalance the ancestors
+	for (uint32 index = nodes[leaf].Parent; index != NULL_NODE; index = nodes[index].Parent)
+	{
+		index = balance(index);
+
+		Node& node = nodes[index];
+		const Node& a = nodes[node.Children[0]]; const Node& b = nodes[node.Children[1]];
+		node.Height = 1 + maxHeight(a.Height, b.Height);
+		node.Box = AABB::Union(a.Box, b.Box);
+	}
+}
+
+void DynamicAABBTree::removeLeaf(const uint32 leaf)
+{
+	if (leaf == root) { root = NULL_NODE; return; }
+
+	const uint32 parent = nodes[leaf].Parent;
+	const uint32 grandParent = nodes[parent].Parent;
+	const uint32 sibling = nodes[parent].Children[0] == leaf ? nodes[parent].Children[1] : nodes[parent].Children[0];
+
+	freeNode(parent);
+
+	if (grandParent == NULL_NODE) { root = sibling; nodes[sibling].Parent = NULL_NODE; return; }
+
+	//the sibling takes the parent's place
+	if (nodes[grandParent].Children[0] == parent) { nodes[grandParent].Children[0] = sibling; } else { nodes[grandParent].Children[1] = sibling; }
+	nodes[sibling].Parent = grandParent;
+
+	for (uint32 index = grandParent; index != NULL_NODE; index = nodes[index].Parent)
+	{
+		index = balance(index);
+
+		Node& node = nodes[index];
+		const Node& a = nodes[node.Children[0]]; const Node& b = nodes[node.Children[1]];
+		node.Height = 1 + maxHeight(a.Height, b.Height);
+		node.Box = AABB::Union(a.Box, b.Box);
+	}
+}
+
+uint32 DynamicAABBTree::balance(const uint32 iA)
+{
+	Node& a = nodes[iA];
+	if (a.IsLeaf() || a.Height < 2) { return iA; }
+
+	const uint32 iB = a.Children[0], iC = a.Children[1];
+	Node& b = nodes[iB]; Node& c = nodes[iC];
+
+	const int32 difference = c.Height - b.Height;
+
+	//rotates up the taller child, up, which takes a's place and gives a it's shorter child
+	auto rotate = [&](const uint32 iUp, Node& up, const uint8 upSlot, const Node& other)
+	{
+		const uint32 iF = up.Children[0], iG = up.Children[1];
+		Node& f = nodes[iF]; Node& g = nodes[iG];
+
+		up.Children[0] = iA; up.Parent = a.Parent; a.Parent = iUp;
+
+		if (up.Parent != NULL_NODE) {
+			if (nodes[up.Parent].Children[0] == iA) { nodes[up.Parent].Children[0] = iUp; } else { nodes[up.Parent].Children[1] = iUp; }
+		} else {
+			root = iUp;
+		}
+
+		//up keeps it's taller child, a takes the shorter one in up's old slot
+		const bool keepF = f.Height > g.Height;
+		const uint32 iKept = keepF ? iF : iG, iGiven = keepF ? iG : iF;
+		Node& kept = nodes[iKept]; Node& given = nodes[iGiven];
+
+		up.Children[1] = iKept; a.Children[upSlot] = iGiven; given.Parent = iA;
+		a.Box = AABB::Union(other.Box, given.Box); up.Box = AABB::Union(a.Box, kept.Box);
+		a.Height = 1 + maxHeight(other.Height, given.Height); up.Height = 1 + maxHeight(a.Height, kept.Height);
+	};
+
+	if (difference > 1) { rotate(iC, c, 1, b); return iC; }
+	if (difference < -1) { rotate(iB, b, 0, c); return iB; }
+
+	return iA;
+}
+
+void BroadPhase::Initialize(const uint32 capacity, const BE::PAR& allocator)
+{
+	tree.Initialize(capacity, allocator);
+	moveBuffer.Initialize(capacity, allocator); moved.Initialize(capacity * 2, allocator);
+	pairs[0].Initialize(capacity, allocator); pairs[1].Initialize(capacity, allocator); newPairs.Initialize(capacity, allocator);
+}
+
+uint32 BroadPhase::CreateProxy(const AABB& aabb, const uint32 userData)
+{
+	const uint32 proxy = tree.CreateProxy(aabb, userData);
+	while (moved.GetLength() <= proxy) { moved.EmplaceBack(false); } //proxies are node indices, sparse but bounded by the tree's size
+	moved[proxy] = false;
+	bufferMove(proxy);
+	return proxy;
+}
+
+void BroadPhase::DestroyProxy(const uint32 proxy)
+{
+	if (moved[proxy]) {
+		for (auto& e : moveBuffer) { if (e == proxy) { e = DynamicAABBTree::NULL_NODE; } }
+		moved[proxy] = false;
+	}
+
+	auto& currentPairs = pairs[current];
+	uint32 kept = 0;
+	for (uint32 i = 0; i < currentPairs.GetLength(); ++i) {
+		if (currentPairs[i].ProxyA != proxy && currentPairs[i].ProxyB != proxy) { currentPairs[kept++] = currentPairs[i]; }
+	}
+	currentPairs.ResizeDown(kept);
+
+	tree.DestroyProxy(proxy);
+}
+
+void BroadPhase::MoveProxy(const uint32 proxy, const AABB& aabb, const float32 displacement[3])
+{
+	if (tree.MoveProxy(proxy, aabb, displacement)) { bufferMove(proxy); }
+}
+
+void BroadPhase::UpdatePairs()
+{
+	newPairs.ResizeDown(0);
+
+	//only reinserted proxies can overlap something they didn't overlap before
+	for (const auto queryProxy : moveBuffer)
+	{
+		if (queryProxy == DynamicAABBTree::NULL_NODE) { continue; }
+
+		const uint32 queryData = tree.GetUserData(queryProxy);
+
+		tree.Query(tree.GetFatAABB(queryProxy), [&](const uint32 proxy)
+		{
+			if (proxy == queryProxy) { return true; }
+			if (moved[proxy] && proxy > queryProxy) { return true; } //when both moved the pair is found by the query of the greater proxy
+
+			const uint32 data = tree.GetUserData(proxy);
+			if (data < queryData) { newPairs.EmplaceBack(Pair{ data, queryData, proxy, queryProxy }); }
+			else { newPairs.EmplaceBack(Pair{ queryData, data, queryProxy, proxy }); }
+			return true;
+		});
+	}
+
+	for (const auto proxy : moveBuffer) { if (proxy != DynamicAABBTree::NULL_NODE) { moved[proxy] = false; } }
+	moveBuffer.ResizeDown(0);
+
+	std::sort(newPairs.begin(), newPairs.end(), [](const Pair& a, const Pair& b) { return a < b; });
+
+	//merge the found pairs with the ones that still overlap, both are sorted so the result is too
+	const auto& oldPairs = pairs[current];
+	auto& mergedPairs = pairs[current ^ 1];
+	mergedPairs.ResizeDown(0);
+
+	uint32 o = 0, n = 0;
+	while (o < oldPairs.GetLength() || n < newPairs.GetLength())
+	{
+		if (n == newPairs.GetLength() || (o < oldPairs.GetLength() && oldPairs[o] < newPairs[n])) {
+			const Pair& pair = oldPairs[o++];
+			if (tree.GetFatAABB(pair.ProxyA).Overlaps(tree.GetFatAABB(pair.ProxyB))) { mergedPairs.EmplaceBack(pair); }
+			continue;
+		}
+
+		if (o < oldPairs.GetLength() && oldPairs[o] == newPairs[n]) { ++o; }
+		mergedPairs.EmplaceBack(newPairs[n++]);
+	}
+
+	current ^= 1;
+}
+
+void BroadPhase::bufferMove(const uint32 proxy)
+{
+	if (moved[proxy]) { return; }
+	moved[proxy] = true;
+	moveBuffer.EmplaceBack(proxy);
+}
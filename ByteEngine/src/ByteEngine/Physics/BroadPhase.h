@@ -0,0 +1,235 @@
+#pragma once
+
+#include <GTSL/Range.h>
+#include <GTSL/Vector.hpp>
+
+#include "ByteEngine/Core.h"
+#include "ByteEngine/Application/AllocatorReferences.h"
+
+/**
+ * \brief Axis aligned bounding box.
+ */
+struct AABB
+{
+	float32 Min[3], Max[3];
+
+	[[nodiscard]] bool Overlaps(const AABB& other) const
+	{
+		return (Min[0] <= other.Max[0]) & (other.Min[0] <= Max[0]) & (Min[1] <= other.Max[1]) & (other.Min[1] <= Max[1]) & (Min[2] <= other.Max[2]) & (other.Min[2] <= Max[2]);
+	}
+
+	[[nodiscard]] bool Contains(const AABB& other) const
+	{
+		return Min[0] <= other.Min[0] && Min[1] <= other.Min[1] && Min[2] <= other.Min[2] && other.Max[0] <= Max[0] && other.Max[1] <= Max[1] && other.Max[2] <= Max[2];
+	}
+
+	/**
+	 * \brief Returns the box's surface area, the cost measure of the tree's surface area heuristic.
+	 */
+	[[nodiscard]] float32 GetArea() const
+	{
+		const float32 x = Max[0] - Min[0], y = Max[1] - Min[1], z = Max[2] - Min[2];
+		return 2.0f * (x * y + y * z + z * x);
+	}
+
+	[[nodiscard]] static AABB Union(const AABB& a, const AABB& b)
+	{
+		AABB result;
+		for (uint8 i = 0; i < 3; ++i) { result.Min[i] = a.Min[i] < b.Min[i] ? a.Min[i] : b.Min[i]; result.Max[i] = a.Max[i] > b.Max[i] ? a.Max[i] : b.Max[i]; }
+		return result;
+	}
+};
+
+/**
+ * \brief Bounding volume hierarchy of boxes which can be inserted, removed and moved at any time. Leaves are inserted next to the node that
+ * adds the least surface area to the tree and the tree is kept balanced with AVL rotations.
+ * Leaves store fat boxes, enlarged by AABB_MARGIN and by the direction the proxy is moving in, so small movements don't touch the tree.
+ * Proxies are leaf indices and stay valid until destroyed.
+ */
+class DynamicAABBTree
+{
+public:
+	static constexpr uint32 NULL_NODE = 0xFFFFFFFF;
+
+	/**
+	 * \brief Distance fat boxes extend past the box they were made from.
+	 */
+	static constexpr float32 AABB_MARGIN = 0.1f;
+
+	/**
+	 * \brief How many steps of displacement fat boxes are extended by, in the direction of movement.
+	 */
+	static constexpr float32 DISPLACEMENT_MULTIPLIER = 4.0f;
+
+	void Initialize(uint32 capacity, const BE::PAR& allocator);
+
+	uint32 CreateProxy(const AABB& aabb, uint32 userData);
+	void DestroyProxy(uint32 proxy);
+
+	/**
+	 * \brief Updates a proxy that moved by displacement this step to aabb.
+	 * \return Whether aabb left the proxy's fat box and the proxy was reinserted, which is when it can overlap new proxies.
+	 */
+	bool MoveProxy(uint32 proxy, const AABB& aabb, const float32 displacement[3]);
+
+	[[nodiscard]] const AABB& GetFatAABB(const uint32 proxy) const { return nodes[proxy].Box; }
+	[[nodiscard]] uint32 GetUserData(const uint32 proxy) const { return nodes[proxy].UserData; }
+
+	/**
+	 * \brief Returns the tree's height, 0 for an empty tree or one with a single proxy.
+	 */
+	[[nodiscard]] uint32 GetHeight() const { return root == NULL_NODE ? 0 : static_cast<uint32>(nodes[root].Height); }
+
+	/**
+	 * \brief Calls callback(proxy) for every proxy whose fat box overlaps aabb until it returns false.
+	 */
+	template<typename F>
+	void Query(const AABB& aabb, F&& callback) const
+	{
+		uint32 stack[MAX_DEPTH]; uint32 count = 0;
+		if (root != NULL_NODE && nodes[root].Box.Overlaps(aabb)) { stack[count++] = root; }
+
+		//children are tested before being pushed and without branching, whether they overlap is as good as random
+		while (count)
+		{
+			const uint32 index = stack[--count];
+			const Node& node = nodes[index];
+
+			if (node.IsLeaf()) { if (!callback(index)) { return; } continue; }
+
+			const uint32 a = node.Children[0], b = node.Children[1];
+			const bool overlapsA = nodes[a].Box.Overlaps(aabb), overlapsB = nodes[b].Box.Overlaps(aabb);
+			stack[count] = a; count += overlapsA;
+			stack[count] = b; count += overlapsB;
+		}
+	}
+
+	/**
+	 * \brief Calls callback(proxy) for every proxy whose fat box grown by radius the segment from start to end crosses, closest boxes aren't
+	 * necessarily first. callback returns how far along the segment, 0 at start and 1 at end, later boxes stop mattering, the T of the
+	 * closest hit found so far, 0 stops the cast. maxT is the T boxes start mattering under.
+	 */
+	template<typename F>
+	void RayCast(const float32 start[3], const float32 end[3], const float32 radius, float32 maxT, F&& callback) const
+	{
+		float32 inverse[3];
+		for (uint8 i = 0; i < 3; ++i) { const float32 d = end[i] - start[i]; inverse[i] = 1.0f / (d > 1e-20f || d < -1e-20f ? d : (d < 0.0f ? -1e-20f : 1e-20f)); }
+
+		auto crosses = [&](const AABB& box) {
+			float32 tNear = 0.0f, tFar = maxT;
+			for (uint8 i = 0; i < 3; ++i) {
+				float32 t0 = (box.Min[i] - radius - start[i]) * inverse[i], t1 = (box.Max[i] + radius - start[i]) * inverse[i];
+				if (t0 > t1) { const float32 t = t0; t0 = t1; t1 = t; }
+				tNear = t0 > tNear ? t0 : tNear; tFar = t1 < tFar ? t1 : tFar;
+			}
+			return tNear <= tFar;
+		};
+
+		uint32 stack[MAX_DEPTH]; uint32 count = 0;
+		if (root != NULL_NODE) { stack[count++] = root; }
+
+		while (count)
+		{
+			const uint32 index = stack[--count];
+			const Node& node = nodes[index];
+			if (!crosses(node.Box)) { continue; }
+
+			if (node.IsLeaf()) { maxT = callback(index); if (maxT <= 0.0f) { return; } continue; }
+
+			stack[count++] = node.Children[0]; stack[count++] = node.Children[1];
+		}
+	}
+
+private:
+	/**
+	 * \brief Nodes a traversal or an insertion's search can have pending. Balanced trees of billions of proxies don't reach it,
+	 * an insertion that does stops looking deeper and keeps the best sibling found so far.
+	 */
+	static constexpr uint32 MAX_DEPTH = 256;
+
+	/**
+	 * \brief Nodes are cache line aligned so that queries, which are bound by memory latency, never read two lines for a node.
+	 */
+	struct alignas(64) Node
+	{
+		AABB Box;
+		/**
+		 * \brief Parent while the node is in the tree, next free node while it's in the free list.
+		 */
+		uint32 Parent = NULL_NODE;
+		uint32 Children[2] = { NULL_NODE, NULL_NODE };
+		/**
+		 * \brief 0 for leaves, -1 for free nodes.
+		 */
+		int32 Height = -1;
+		uint32 UserData = 0;
+
+		[[nodiscard]] bool IsLeaf() const { return Children[0] == NULL_NODE; }
+	};
+	GTSL::Vector<Node, BE::PAR> nodes;
+	uint32 root = NULL_NODE, freeList = NULL_NODE;
+
+	uint32 allocateNode();
+	void freeNode(uint32 node);
+	void insertLeaf(uint32 leaf);
+	void removeLeaf(uint32 leaf);
+
+	/**
+	 * \brief Rotates the tree at node if it's children's heights differ by more than 1.
+	 * \return Node that took node's place.
+	 */
+	uint32 balance(uint32 node);
+};
+
+/**
+ * \brief Finds pairs of proxies whose fat boxes overlap. Pairs persist while their boxes overlap, only proxies reinserted into the tree
+ * since the last update are queried for new ones, which is what makes still and slow moving scenes cheap.
+ */
+class BroadPhase
+{
+public:
+	/**
+	 * \brief Pair of overlapping proxies, A and B are their user data and A is always less than B.
+	 */
+	struct Pair
+	{
+		uint32 A, B;
+		uint32 ProxyA, ProxyB;
+	};
+
+	void Initialize(uint32 capacity, const BE::PAR& allocator);
+
+	uint32 CreateProxy(const AABB& aabb, uint32 userData);
+	void DestroyProxy(uint32 proxy);
+	void MoveProxy(uint32 proxy, const AABB& aabb, const float32 displacement[3]);
+
+	/**
+	 * \brief Adds pairs for proxies that moved since the last update and removes pairs which stopped overlapping.
+	 */
+	void UpdatePairs();
+
+	/**
+	 * \brief Returns the current pairs, sorted by A then B.
+	 */
+	[[nodiscard]] GTSL::Range<const Pair*> GetPairs() const { return GTSL::Range<const Pair*>(pairs[current].GetLength(), pairs[current].begin()); }
+
+	[[nodiscard]] const DynamicAABBTree& GetTree() const { return tree; }
+
+private:
+	DynamicAABBTree tree;
+
+	/**
+	 * \brief Proxies reinserted since the last update, and whether each proxy is in it.
+	 */
+	GTSL::Vector<uint32, BE::PAR> moveBuffer;
+	GTSL::Vector<bool, BE::PAR> moved;
+
+	/**
+	 * \brief Current pairs and the ones being built by an update, swapped after every update.
+	 */
+	GTSL::Vector<Pair, BE::PAR> pairs[2];
+	uint8 current = 0;
+	GTSL::Vector<Pair, BE::PAR> newPairs;
+
+	void bufferMove(uint32 proxy);
+};
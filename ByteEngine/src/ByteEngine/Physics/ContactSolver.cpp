@@ -0,0 +1,389 @@
+#include "ContactSolver.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <GTSL/Math/Math.hpp>
+
+#include "PhysicsMath.h"
+#include "ByteEngine/Application/Application.h"
+#include "ByteEngine/Application/ThreadPool.h"
+
+namespace
+{
+	constexpr uint32 NULL_INDEX = 0xFFFFFFFF;
+
+	/**
+	 * \brief Distance under which a contact point is considered the same as last step's.
+	 */
+	constexpr float32 MATCH_DISTANCE = 0.05f;
+
+	/**
+	 * \brief Bodies plus constraints under which a step isn't worth sending to other threads.
+	 */
+	constexpr uint32 PARALLEL_THRESHOLD = 256;
+
+	/**
+	 * \brief Speed penetration is corrected at most with, deep penetrations would otherwise throw bodies apart.
+	 */
+	constexpr float32 MAX_CORRECTION_SPEED = 4.0f;
+
+	Float3 multiply(const float32 matrix[3][3], const Float3 v)
+	{
+		return { matrix[0][0] * v.X + matrix[0][1] * v.Y + matrix[0][2] * v.Z, matrix[1][0] * v.X + matrix[1][1] * v.Y + matrix[1][2] * v.Z, matrix[2][0] * v.X + matrix[2][1] * v.Y + matrix[2][2] * v.Z };
+	}
+
+	/**
+	 * \brief Velocity of B relative to A at the contact point, rA and rB away from each body's center.
+	 */
+	Float3 getRelativeVelocity(const SolverBody& a, const SolverBody& b, const Float3 rA, const Float3 rB)
+	{
+		return LoadFloat3(b.LinearVelocity) + Cross(LoadFloat3(b.AngularVelocity), rB) - LoadFloat3(a.LinearVelocity) - Cross(LoadFloat3(a.AngularVelocity), rA);
+	}
+
+	/**
+	 * \brief Adds impulse to body at r from it's center. Static bodies are shared by islands solving in parallel and are never written.
+	 */
+	void applyImpulse(SolverBody& body, const float32 inverseInertia[3][3], const Float3 r, const Float3 impulse)
+	{
+		if (!body.IsDynamic()) { return; }
+		StoreFloat3(LoadFloat3(body.LinearVelocity) + impulse * body.Body.GetInverseMass(), body.LinearVelocity);
+		StoreFloat3(LoadFloat3(body.AngularVelocity) + multiply(inverseInertia, Cross(r, impulse)), body.AngularVelocity);
+	}
+
+	/**
+	 * \brief Returns the inverse mass of a and b along direction at rA and rB, 0 if neither can move.
+	 */
+	float32 getEffectiveMass(const SolverBody& a, const float32 inertiaA[3][3], const SolverBody& b, const float32 inertiaB[3][3], const Float3 rA, const Float3 rB, const Float3 direction)
+	{
+		const float32 k = a.Body.GetInverseMass() + b.Body.GetInverseMass() + Dot(Cross(multiply(inertiaA, Cross(rA, direction)), rA), direction) + Dot(Cross(multiply(inertiaB, Cross(rB, direction)), rB), direction);
+		return k > 0.0f ? 1.0f / k : 0.0f;
+	}
+}
+
+void ContactSolver::Initialize(const uint32 capacity, const BE::PAR& allocator)
+{
+	constraints.Initialize(capacity, allocator); caches[0].Initialize(capacity, allocator); caches[1].Initialize(capacity, allocator);
+	frames.Initialize(capacity, allocator); parents.Initialize(capacity, allocator); rootIslands.Initialize(capacity, allocator);
+	islands.Initialize(capacity, allocator); islandBodies.Initialize(capacity, allocator); islandConstraints.Initialize(capacity, allocator); awakeIslands.Initialize(capacity, allocator);
+}
+
+void ContactSolver::Step(GTSL::Range<SolverBody*> bodies, GTSL::Range<const ContactManifold*> contacts, const float32 newGravity[3], const float32 newDamping, const float32 newDeltaSeconds)
+{
+	solverBodies = bodies.begin(); manifolds = contacts.begin();
+	for (uint8 i = 0; i < 3; ++i) { gravity[i] = newGravity[i]; }
+	damping = newDamping; deltaSeconds = newDeltaSeconds;
+
+	const uint32 bodyCount = static_cast<uint32>(bodies.ElementCount()), contactCount = static_cast<uint32>(contacts.ElementCount());
+
+	frames.ResizeDown(0);
+	for (uint32 i = 0; i < bodyCount; ++i)
+	{
+		auto& frame = frames.EmplaceBack(); const auto& body = solverBodies[i];
+		QuaternionToAxes(body.Orientation, frame.Axes);
+
+		//R * I^-1 * R^T, R's columns being the body's axes
+		const float32* inverseInertia = body.Body.GetInverseInertia();
+		for (uint8 r = 0; r < 3; ++r) {
+			for (uint8 c = 0; c < 3; ++c) { frame.InverseInertia[r][c] = frame.Axes[0][r] * inverseInertia[0] * frame.Axes[0][c] + frame.Axes[1][r] * inverseInertia[1] * frame.Axes[1][c] + frame.Axes[2][r] * inverseInertia[2] * frame.Axes[2][c]; }
+		}
+	}
+
+	buildIslands(bodyCount, contactCount);
+
+	uint32 work = 0;
+	for (const auto island : awakeIslands) { work += islands[island].BodyCount + islands[island].ConstraintCount; }
+
+	nextIsland.store(0, std::memory_order_relaxed);
+
+	if (awakeIslands.GetLength() > 1 && work > PARALLEL_THRESHOLD)
+	{
+		//only waits for helpers that started while islands were left, one queued behind this task can't stall it
+		helpers.Run<ContactSolver, &ContactSolver::solveIslands>(this, GTSL::Math::Min(static_cast<uint32>(BE::Application::Get()->GetThreadPool()->GetNumberOfThreads()), awakeIslands.GetLength() - 1));
+	}
+	else
+	{
+		solveIslands();
+	}
+
+	updateCache(bodyCount, contactCount);
+}
+
+uint32 ContactSolver::find(uint32 body)
+{
+	while (parents[body] != body) { parents[body] = parents[parents[body]]; body = parents[body]; }
+	return body;
+}
+
+void ContactSolver::unite(const uint32 a, const uint32 b)
+{
+	const uint32 rootA = find(a), rootB = find(b);
+	if (rootA != rootB) { parents[rootA] = rootB; }
+}
+
+void ContactSolver::buildIslands(const uint32 bodyCount, const uint32 contactCount)
+{
+	parents.ResizeDown(0); rootIslands.ResizeDown(0);
+	for (uint32 i = 0; i < bodyCount; ++i) { parents.EmplaceBack(i); rootIslands.EmplaceBack(NULL_INDEX); }
+
+	//static bodies don't join islands, a floor would make the whole level one island
+	for (uint32 c = 0; c < contactCount; ++c) {
+		const auto& manifold = manifolds[c];
+		if (solverBodies[manifold.A].IsDynamic() && solverBodies[manifold.B].IsDynamic()) { unite(manifold.A, manifold.B); }
+	}
+
+	for (const auto& cached : caches[currentCache]) {
+		const uint32 a = static_cast<uint32>(cached.Key >> 32), b = static_cast<uint32>(cached.Key);
+		const auto &bodyA = solverBodies[a], &bodyB = solverBodies[b];
+		if (bodyA.IsDynamic() && bodyB.IsDynamic() && !bodyA.Awake && !bodyB.Awake) { unite(a, b); }
+	}
+
+	islands.ResizeDown(0);
+
+	for (uint32 i = 0; i < bodyCount; ++i)
+	{
+		if (!solverBodies[i].IsDynamic()) { continue; }
+
+		const uint32 root = find(i);
+		if (rootIslands[root] == NULL_INDEX) { rootIslands[root] = islands.GetLength(); islands.EmplaceBack(Island{ 0, 0, 0, 0, false }); }
+
+		auto& island = islands[rootIslands[root]];
+		++island.BodyCount; island.Awake |= solverBodies[i].Awake;
+	}
+
+	auto getIsland = [&](const ContactManifold& manifold) -> Island& { return islands[rootIslands[find(solverBodies[manifold.A].IsDynamic() ? manifold.A : manifold.B)]]; };
+	for (uint32 c = 0; c < contactCount; ++c) { ++getIsland(manifolds[c]).ConstraintCount; }
+
+	//bodies and constraints are laid out island after island
+	uint32 bodyStart = 0, constraintStart = 0;
+	for (auto& island : islands) {
+		island.BodyStart = bodyStart; bodyStart += island.BodyCount; island.BodyCount = 0;
+		island.ConstraintStart = constraintStart; constraintStart += island.ConstraintCount; island.ConstraintCount = 0;
+	}
+
+	islandBodies.ResizeDown(0); islandConstraints.ResizeDown(0); constraints.ResizeDown(0);
+	for (uint32 i = 0; i < bodyStart; ++i) { islandBodies.EmplaceBack(0); }
+	for (uint32 c = 0; c < contactCount; ++c) { islandConstraints.EmplaceBack(0); constraints.EmplaceBack(); }
+
+	for (uint32 i = 0; i < bodyCount; ++i) {
+		if (!solverBodies[i].IsDynamic()) { continue; }
+		auto& island = islands[rootIslands[find(i)]];
+		islandBodies[island.BodyStart + island.BodyCount++] = i;
+	}
+
+	for (uint32 c = 0; c < contactCount; ++c) { auto& island = getIsland(manifolds[c]); islandConstraints[island.ConstraintStart + island.ConstraintCount++] = c; }
+
+	awakeIslands.ResizeDown(0);
+	for (uint32 i = 0; i < islands.GetLength(); ++i)
+	{
+		const auto& island = islands[i];
+		if (!island.Awake) { continue; }
+
+		//an awake body touching a sleeping one wakes it's whole island
+		for (uint32 b = 0; b < island.BodyCount; ++b) { solverBodies[islandBodies[island.BodyStart + b]].Awake = true; }
+		awakeIslands.EmplaceBack(i);
+	}
+
+	//biggest islands first so the last ones to finish are small
+	std::sort(awakeIslands.begin(), awakeIslands.end(), [&](const uint32 a, const uint32 b) { return islands[a].BodyCount + islands[a].ConstraintCount > islands[b].BodyCount + islands[b].ConstraintCount; });
+}
+
+void ContactSolver::solveIslands()
+{
+	for (uint32 i; (i = nextIsland.fetch_add(1, std::memory_order_relaxed)) < awakeIslands.GetLength();) { solveIsland(islands[awakeIslands[i]]); }
+}
+
+void ContactSolver::solveIsland(const Island& island)
+{
+	const float32 dt = deltaSeconds;
+
+	for (uint32 b = 0; b < island.BodyCount; ++b)
+	{
+		auto& body = solverBodies[islandBodies[island.BodyStart + b]];
+		for (uint8 i = 0; i < 3; ++i) {
+			body.LinearVelocity[i] = (body.LinearVelocity[i] + (gravity[i] + body.Acceleration[i]) * dt) * damping;
+			body.AngularVelocity[i] *= damping;
+		}
+	}
+
+	for (uint32 c = 0; c < island.ConstraintCount; ++c) {
+		auto& constraint = constraints[island.ConstraintStart + c];
+		prepareConstraint(constraint, manifolds[islandConstraints[island.ConstraintStart + c]]);
+		warmStart(constraint);
+	}
+
+	//sweeping back and forth keeps the order constraints are solved in from favoring one end of a stack, which otherwise slowly starts to sway
+	for (uint8 iteration = 0; iteration < VELOCITY_ITERATIONS; ++iteration) {
+		for (uint32 c = 0; c < island.ConstraintCount; ++c) { solveConstraint(constraints[island.ConstraintStart + (iteration & 1 ? island.ConstraintCount - 1 - c : c)]); }
+	}
+
+	float32 minSleepTime = TIME_TO_SLEEP;
+
+	for (uint32 b = 0; b < island.BodyCount; ++b)
+	{
+		auto& body = solverBodies[islandBodies[island.BodyStart + b]];
+		const Float3 linear = LoadFloat3(body.LinearVelocity), angular = LoadFloat3(body.AngularVelocity);
+
+		StoreFloat3(LoadFloat3(body.Position) + linear * dt, body.Position);
+
+		//q' = q + dt / 2 * (w, 0) * q
+		float32* q = body.Orientation;
+		const float32 h = dt * 0.5f;
+		const float32 x = q[0] + h * (angular.X * q[3] + angular.Y * q[2] - angular.Z * q[1]);
+		const float32 y = q[1] + h * (angular.Y * q[3] + angular.Z * q[0] - angular.X * q[2]);
+		const float32 z = q[2] + h * (angular.Z * q[3] + angular.X * q[1] - angular.Y * q[0]);
+		const float32 w = q[3] - h * (angular.X * q[0] + angular.Y * q[1] + angular.Z * q[2]);
+		const float32 inverseLength = 1.0f / std::sqrt(x * x + y * y + z * z + w * w);
+		q[0] = x * inverseLength; q[1] = y * inverseLength; q[2] = z * inverseLength; q[3] = w * inverseLength;
+
+		if (LengthSquared(linear) > LINEAR_SLEEP_TOLERANCE * LINEAR_SLEEP_TOLERANCE || LengthSquared(angular) > ANGULAR_SLEEP_TOLERANCE * ANGULAR_SLEEP_TOLERANCE) { body.SleepTime = 0.0f; }
+		else { body.SleepTime += dt; }
+
+		minSleepTime = GTSL::Math::Min(minSleepTime, body.SleepTime);
+	}
+
+	if (minSleepTime >= TIME_TO_SLEEP)
+	{
+		for (uint32 b = 0; b < island.BodyCount; ++b) {
+			auto& body = solverBodies[islandBodies[island.BodyStart + b]];
+			body.Awake = false;
+			for (uint8 i = 0; i < 3; ++i) { body.LinearVelocity[i] = 0.0f; body.AngularVelocity[i] = 0.0f; }
+		}
+	}
+}
+
+void ContactSolver::prepareConstraint(Constraint& constraint, const ContactManifold& manifold)
+{
+	constraint.A = manifold.A; constraint.B = manifold.B; constraint.PointCount = manifold.PointCount;
+
+	const auto &a = solverBodies[manifold.A], &b = solverBodies[manifold.B];
+	const auto &frameA = frames[manifold.A], &frameB = frames[manifold.B];
+
+	const Float3 normal{ manifold.Points[0].HitNormal.X(), manifold.Points[0].HitNormal.Y(), manifold.Points[0].HitNormal.Z() };
+	const Float3 tangents[2] = { GetPerpendicular(normal), Cross(normal, GetPerpendicular(normal)) };
+	StoreFloat3(normal, constraint.Normal); StoreFloat3(tangents[0], constraint.Tangents[0]); StoreFloat3(tangents[1], constraint.Tangents[1]);
+
+	constraint.Friction = std::sqrt(a.Body.GetFriction() * b.Body.GetFriction());
+	const float32 restitution = GTSL::Math::Max(a.Body.GetRestitution(), b.Body.GetRestitution());
+
+	const auto& cache = caches[currentCache];
+	const uint64 key = makeKey(manifold.A, manifold.B);
+	const CachedManifold* cached = std::lower_bound(cache.begin(), cache.end(), key, [](const CachedManifold& entry, const uint64 k) { return entry.Key < k; });
+	if (cached == cache.end() || cached->Key != key) { cached = nullptr; }
+
+	for (uint8 p = 0; p < manifold.PointCount; ++p)
+	{
+		auto& point = constraint.Points[p];
+		const auto& hit = manifold.Points[p];
+
+		const Float3 position{ hit.HitPosition.X(), hit.HitPosition.Y(), hit.HitPosition.Z() };
+		const Float3 rA = position - LoadFloat3(a.Position), rB = position - LoadFloat3(b.Position);
+		StoreFloat3(rA, point.RA); StoreFloat3(rB, point.RB);
+		for (uint8 i = 0; i < 3; ++i) { point.LocalPoint[i] = Dot(LoadFloat3(frameA.Axes[i]), rA); }
+
+		point.NormalMass = getEffectiveMass(a, frameA.InverseInertia, b, frameB.InverseInertia, rA, rB, normal);
+		point.TangentMass[0] = getEffectiveMass(a, frameA.InverseInertia, b, frameB.InverseInertia, rA, rB, tangents[0]);
+		point.TangentMass[1] = getEffectiveMass(a, frameA.InverseInertia, b, frameB.InverseInertia, rA, rB, tangents[1]);
+
+		//push apart at a speed proportional to the penetration, or bounce when hitting fast. Points still apart let the bodies close the gap this step
+		const float32 approachSpeed = -Dot(getRelativeVelocity(a, b, rA, rB), normal);
+		if (hit.T < 0.0f) {
+			point.Bias = hit.T / deltaSeconds;
+		} else {
+			point.Bias = GTSL::Math::Min(BAUMGARTE / deltaSeconds * GTSL::Math::Max(hit.T - PENETRATION_SLOP, 0.0f), MAX_CORRECTION_SPEED);
+			if (approachSpeed > RESTITUTION_THRESHOLD) { point.Bias = GTSL::Math::Max(point.Bias, restitution * approachSpeed); }
+		}
+
+		point.NormalImpulse = 0.0f; point.TangentImpulse[0] = 0.0f; point.TangentImpulse[1] = 0.0f;
+
+		if (cached)
+		{
+			uint8 closest = MAX_CONTACT_POINTS; float32 closestDistance = MATCH_DISTANCE * MATCH_DISTANCE;
+			for (uint8 c = 0; c < cached->PointCount; ++c) {
+				const float32 distance = LengthSquared(LoadFloat3(cached->LocalPoints[c]) - LoadFloat3(point.LocalPoint));
+				if (distance < closestDistance) { closestDistance = distance; closest = c; }
+			}
+
+			if (closest != MAX_CONTACT_POINTS) {
+				point.NormalImpulse = cached->NormalImpulses[closest];
+				point.TangentImpulse[0] = Dot(LoadFloat3(cached->FrictionImpulses[closest]), tangents[0]); point.TangentImpulse[1] = Dot(LoadFloat3(cached->FrictionImpulses[closest]), tangents[1]);
+			}
+		}
+	}
+}
+
+void ContactSolver::warmStart(const Constraint& constraint)
+{
+	auto &a = solverBodies[constraint.A], &b = solverBodies[constraint.B];
+
+	for (uint8 p = 0; p < constraint.PointCount; ++p)
+	{
+		const auto& point = constraint.Points[p];
+		const Float3 impulse = LoadFloat3(constraint.Normal) * point.NormalImpulse + LoadFloat3(constraint.Tangents[0]) * point.TangentImpulse[0] + LoadFloat3(constraint.Tangents[1]) * point.TangentImpulse[1];
+		applyImpulse(a, frames[constraint.A].InverseInertia, LoadFloat3(point.RA), -impulse); applyImpulse(b, frames[constraint.B].InverseInertia, LoadFloat3(point.RB), impulse);
+	}
+}
+
+void ContactSolver::solveConstraint(Constraint& constraint)
+{
+	auto &a = solverBodies[constraint.A], &b = solverBodies[constraint.B];
+	const auto &inertiaA = frames[constraint.A].InverseInertia, &inertiaB = frames[constraint.B].InverseInertia;
+	const Float3 normal = LoadFloat3(constraint.Normal);
+
+	for (uint8 p = 0; p < constraint.PointCount; ++p)
+	{
+		auto& point = constraint.Points[p];
+		const Float3 rA = LoadFloat3(point.RA), rB = LoadFloat3(point.RB);
+
+		//friction first, the normal impulse matters more and is solved last
+		const float32 maxFriction = constraint.Friction * point.NormalImpulse;
+		for (uint8 t = 0; t < 2; ++t) {
+			const Float3 tangent = LoadFloat3(constraint.Tangents[t]);
+			const float32 lambda = -point.TangentMass[t] * Dot(getRelativeVelocity(a, b, rA, rB), tangent);
+			const float32 accumulated = GTSL::Math::Clamp(point.TangentImpulse[t] + lambda, -maxFriction, maxFriction);
+			const Float3 impulse = tangent * (accumulated - point.TangentImpulse[t]); point.TangentImpulse[t] = accumulated;
+			applyImpulse(a, inertiaA, rA, -impulse); applyImpulse(b, inertiaB, rB, impulse);
+		}
+
+		const float32 lambda = -point.NormalMass * (Dot(getRelativeVelocity(a, b, rA, rB), normal) - point.Bias);
+		const float32 accumulated = GTSL::Math::Max(point.NormalImpulse + lambda, 0.0f);
+		const Float3 impulse = normal * (accumulated - point.NormalImpulse); point.NormalImpulse = accumulated;
+		applyImpulse(a, inertiaA, rA, -impulse); applyImpulse(b, inertiaB, rB, impulse);
+	}
+}
+
+void ContactSolver::updateCache(const uint32 bodyCount, const uint32 contactCount)
+{
+	auto& previous = caches[currentCache]; auto& next = caches[!currentCache];
+	next.ResizeDown(0);
+
+	for (uint32 c = 0; c < contactCount; ++c)
+	{
+		const auto& constraint = constraints[c];
+		auto& cached = next.EmplaceBack();
+		cached.Key = makeKey(constraint.A, constraint.B); cached.PointCount = constraint.PointCount;
+
+		for (uint8 p = 0; p < constraint.PointCount; ++p) {
+			const auto& point = constraint.Points[p];
+			for (uint8 i = 0; i < 3; ++i) { cached.LocalPoints[p][i] = point.LocalPoint[i]; }
+			cached.NormalImpulses[p] = point.NormalImpulse;
+			StoreFloat3(LoadFloat3(constraint.Tangents[0]) * point.TangentImpulse[0] + LoadFloat3(constraint.Tangents[1]) * point.TangentImpulse[1], cached.FrictionImpulses[p]);
+		}
+	}
+
+	auto keyLess = [](const CachedManifold& a, const CachedManifold& b) { return a.Key < b.Key; };
+	std::sort(next.begin(), next.end(), keyLess);
+	const uint32 freshCount = next.GetLength();
+
+	//pairs which only involve sleeping and static bodies weren't collided, their last impulses wait for them to wake up
+	for (const auto& cached : previous)
+	{
+		const uint32 a = static_cast<uint32>(cached.Key >> 32), b = static_cast<uint32>(cached.Key);
+		if (a >= bodyCount || b >= bodyCount || solverBodies[a].IsSimulated() || solverBodies[b].IsSimulated()) { continue; }
+		if (std::binary_search(next.begin(), next.begin() + freshCount, cached, keyLess)) { continue; }
+		next.EmplaceBack(cached);
+	}
+
+	std::inplace_merge(next.begin(), next.begin() + freshCount, next.end(), keyLess);
+	currentCache = !currentCache;
+}
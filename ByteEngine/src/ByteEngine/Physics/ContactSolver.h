@@ -0,0 +1,158 @@
+#pragma once
+
+#include <atomic>
+
+#include <GTSL/Range.h>
+#include <GTSL/Vector.hpp>
+
+#include "NarrowPhase.h"
+#include "RigidBody.h"
+#include "ByteEngine/Core.h"
+#include "ByteEngine/Application/AllocatorReferences.h"
+#include "ByteEngine/Application/HelperGroup.h"
+
+/**
+ * \brief Pose and velocities of a body, what the solver reads and writes. Orientation is a unit quaternion as x, y, z, w.
+ */
+struct SolverBody
+{
+	float32 Position[3] = { 0, 0, 0 }, Orientation[4] = { 0, 0, 0, 1 };
+	float32 LinearVelocity[3] = { 0, 0, 0 }, AngularVelocity[3] = { 0, 0, 0 };
+	float32 Acceleration[3] = { 0, 0, 0 };
+	RigidBody Body;
+
+	/**
+	 * \brief How long the body has been moving slower than the sleep tolerances.
+	 */
+	float32 SleepTime = 0.0f;
+	bool Awake = true;
+
+	[[nodiscard]] bool IsDynamic() const { return Body.GetInverseMass() > 0.0f; }
+
+	/**
+	 * \brief Whether the body moves this step, sleeping and static bodies don't.
+	 */
+	[[nodiscard]] bool IsSimulated() const { return Awake && IsDynamic(); }
+
+	void WakeUp() { Awake = true; SleepTime = 0.0f; }
+};
+
+/**
+ * \brief Projected Gauss-Seidel contact solver with friction, restitution and warm starting.
+ * Every step dynamic bodies are grouped into islands of bodies touching each other with union-find, static bodies don't join islands.
+ * Islands are independent so they are solved in parallel on the thread pool, biggest first. An island whose bodies have all been
+ * still for TIME_TO_SLEEP goes to sleep and isn't simulated until an awake body touches it or it's woken up.
+ */
+class ContactSolver
+{
+public:
+	static constexpr uint8 VELOCITY_ITERATIONS = 10;
+
+	/**
+	 * \brief Fraction of the penetration corrected every step, and the penetration left uncorrected so contacts don't flicker.
+	 */
+	static constexpr float32 BAUMGARTE = 0.2f, PENETRATION_SLOP = 0.005f;
+
+	/**
+	 * \brief Approach speed under which contacts don't bounce, so resting bodies don't jitter.
+	 */
+	static constexpr float32 RESTITUTION_THRESHOLD = 1.0f;
+
+	static constexpr float32 TIME_TO_SLEEP = 0.5f, LINEAR_SLEEP_TOLERANCE = 0.05f, ANGULAR_SLEEP_TOLERANCE = 0.035f;
+
+	void Initialize(uint32 capacity, const BE::PAR& allocator);
+
+	/**
+	 * \brief Advances bodies by deltaSeconds, resolving contacts. contacts must be the manifolds of the bodies at their current pose,
+	 * A and B are indices into bodies.
+	 * \param damping Factor velocities are multiplied by every step.
+	 */
+	void Step(GTSL::Range<SolverBody*> bodies, GTSL::Range<const ContactManifold*> contacts, const float32 gravity[3], float32 damping, float32 deltaSeconds);
+
+	[[nodiscard]] uint32 GetIslandCount() const { return islands.GetLength(); }
+	[[nodiscard]] uint32 GetAwakeIslandCount() const { return awakeIslands.GetLength(); }
+
+private:
+	struct ConstraintPoint
+	{
+		/**
+		 * \brief Contact point in A's space, to match it to next step's points.
+		 */
+		float32 LocalPoint[3];
+		float32 RA[3], RB[3];
+		float32 NormalMass, TangentMass[2];
+		float32 NormalImpulse, TangentImpulse[2];
+		float32 Bias;
+	};
+
+	struct Constraint
+	{
+		uint32 A, B; uint8 PointCount;
+		float32 Normal[3], Tangents[2][3];
+		float32 Friction;
+		ConstraintPoint Points[MAX_CONTACT_POINTS];
+	};
+	GTSL::Vector<Constraint, BE::PAR> constraints;
+
+	/**
+	 * \brief Impulses a pair's contact points ended a step with, which are the starting guess next step.
+	 * FrictionImpulses are world vectors as tangents change every step.
+	 */
+	struct CachedManifold
+	{
+		uint64 Key; uint8 PointCount;
+		float32 LocalPoints[MAX_CONTACT_POINTS][3];
+		float32 NormalImpulses[MAX_CONTACT_POINTS], FrictionImpulses[MAX_CONTACT_POINTS][3];
+	};
+
+	/**
+	 * \brief Current cache sorted by key and the one being built by a step, swapped after every step.
+	 * Pairs of sleeping bodies aren't collided so their entries are carried over, they keep islands of sleeping bodies together.
+	 */
+	GTSL::Vector<CachedManifold, BE::PAR> caches[2];
+	uint8 currentCache = 0;
+
+	/**
+	 * \brief Rotation and world space inverse inertia of every body, for this step.
+	 */
+	struct BodyFrame { float32 Axes[3][3], InverseInertia[3][3]; };
+	GTSL::Vector<BodyFrame, BE::PAR> frames;
+
+	/**
+	 * \brief Union-find forest over bodies, and the island of every root.
+	 */
+	GTSL::Vector<uint32, BE::PAR> parents, rootIslands;
+
+	struct Island { uint32 BodyStart, BodyCount, ConstraintStart, ConstraintCount; bool Awake; };
+	GTSL::Vector<Island, BE::PAR> islands;
+	GTSL::Vector<uint32, BE::PAR> islandBodies, islandConstraints, awakeIslands;
+
+	SolverBody* solverBodies = nullptr;
+	const ContactManifold* manifolds = nullptr;
+	float32 gravity[3], damping, deltaSeconds;
+
+	std::atomic<uint32> nextIsland{ 0 };
+	/**
+	 * \brief Pool workers helping solve big steps. Owned by the solver so helpers that start late find it closed instead of a dead stack frame.
+	 */
+	HelperGroup helpers;
+
+	uint32 find(uint32 body);
+	void unite(uint32 a, uint32 b);
+
+	static uint64 makeKey(const uint32 a, const uint32 b) { return static_cast<uint64>(a) << 32 | b; }
+
+	void buildIslands(uint32 bodyCount, uint32 contactCount);
+
+	/**
+	 * \brief Solves awake islands until none are left, called by every thread taking part in a step.
+	 */
+	void solveIslands();
+	void solveIsland(const Island& island);
+
+	void prepareConstraint(Constraint& constraint, const ContactManifold& manifold);
+	void warmStart(const Constraint& constraint);
+	void solveConstraint(Constraint& constraint);
+
+	void updateCache(uint32 bodyCount, uint32 contactCount);
+};
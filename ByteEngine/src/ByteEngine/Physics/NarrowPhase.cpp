@@ -0,0 +1,955 @@
+#include "NarrowPhase.h"
+
+#include <cmath>
+#include <emmintrin.h>
+
+#include "PhysicsMath.h"
+
+namespace
+{
+	constexpr float32 FLOAT_MAX = 3.402823466e+38f;
+
+	float32 clamp(const float32 value, const float32 min, const float32 max) { return value < min ? min : (value > max ? max : value); }
+
+	Float3 getPosition(const Transform& transform) { return { transform.Position[0], transform.Position[1], transform.Position[2] }; }
+	Float3 getAxis(const Transform& transform, const uint8 axis) { return { transform.Axes[axis][0], transform.Axes[axis][1], transform.Axes[axis][2] }; }
+
+	Float3 toWorld(const Transform& transform, const Float3 local)
+	{
+		return getPosition(transform) + getAxis(transform, 0) * local.X + getAxis(transform, 1) * local.Y + getAxis(transform, 2) * local.Z;
+	}
+
+	Float3 toLocalDirection(const Transform& transform, const Float3 direction)
+	{
+		return { Dot(getAxis(transform, 0), direction), Dot(getAxis(transform, 1), direction), Dot(getAxis(transform, 2), direction) };
+	}
+
+	void addPoint(ContactManifold& manifold, const Float3 position, const Float3 normal, const float32 depth)
+	{
+		auto& point = manifold.Points[manifold.PointCount++];
+		point.WasHit = true; point.HitPosition = GTSL::Vector3(position.X, position.Y, position.Z); point.HitNormal = GTSL::Vector3(normal.X, normal.Y, normal.Z); point.T = depth;
+	}
+
+	ContactManifold& addManifold(GTSL::Vector<ContactManifold, BE::PAR>& contacts, const uint32 a, const uint32 b)
+	{
+		auto& manifold = contacts.EmplaceBack();
+		manifold.A = a; manifold.B = b; manifold.PointCount = 0;
+		return manifold;
+	}
+
+	/**
+	 * \brief Adds a contact between two spheres if they touch, fallbackNormal is used when their centers coincide.
+	 */
+	bool addSphereContact(ContactManifold& manifold, const Float3 centerA, const float32 radiusA, const Float3 centerB, const float32 radiusB, const Float3 fallbackNormal)
+	{
+		const Float3 difference = centerB - centerA;
+		const float32 distanceSquared = LengthSquared(difference), radii = radiusA + radiusB;
+		if (distanceSquared > radii * radii) { return false; }
+
+		const float32 distance = std::sqrt(distanceSquared);
+		const Float3 normal = distance > 1e-6f ? difference * (1.0f / distance) : fallbackNormal;
+		const float32 depth = radii - distance;
+		addPoint(manifold, centerA + normal * (radiusA - depth * 0.5f), normal, depth);
+		return true;
+	}
+
+	/**
+	 * \brief Finds the closest points between segments p0 q0 and p1 q1, as the parameters s and t along each.
+	 */
+	void closestSegmentPoints(const Float3 p0, const Float3 q0, const Float3 p1, const Float3 q1, float32& s, float32& t)
+	{
+		const Float3 d0 = q0 - p0, d1 = q1 - p1, r = p0 - p1;
+		const float32 a = LengthSquared(d0), e = LengthSquared(d1), f = Dot(d1, r);
+
+		if (a <= 1e-12f && e <= 1e-12f) { s = 0.0f; t = 0.0f; return; }
+		if (a <= 1e-12f) { s = 0.0f; t = clamp(f / e, 0.0f, 1.0f); return; }
+
+		const float32 c = Dot(d0, r);
+		if (e <= 1e-12f) { t = 0.0f; s = clamp(-c / a, 0.0f, 1.0f); return; }
+
+		const float32 b = Dot(d0, d1), denominator = a * e - b * b;
+		s = denominator > 1e-12f ? clamp((b * f - c * e) / denominator, 0.0f, 1.0f) : 0.0f; //parallel segments, any s works
+		t = (b * s + f) / e;
+
+		if (t < 0.0f) { t = 0.0f; s = clamp(-c / a, 0.0f, 1.0f); }
+		else if (t > 1.0f) { t = 1.0f; s = clamp((b - c) / a, 0.0f, 1.0f); }
+	}
+
+	void getCapsuleSegment(const Shape& shape, const Transform& transform, Float3& p, Float3& q)
+	{
+		const Float3 axis = getAxis(transform, 1) * shape.HalfExtents[1];
+		p = getPosition(transform) - axis; q = getPosition(transform) + axis;
+	}
+
+	bool collideSphereCapsule(const Shape& sphere, const Transform& sphereTransform, const Shape& capsule, const Transform& capsuleTransform, ContactManifold& manifold)
+	{
+		Float3 p, q; getCapsuleSegment(capsule, capsuleTransform, p, q);
+		const Float3 center = getPosition(sphereTransform), segment = q - p;
+		const float32 length = LengthSquared(segment);
+		const float32 t = length > 1e-12f ? clamp(Dot(center - p, segment) / length, 0.0f, 1.0f) : 0.0f;
+
+		return addSphereContact(manifold, center, sphere.Radius, p + segment * t, capsule.Radius, getAxis(capsuleTransform, 0));
+	}
+
+	bool collideCapsules(const Shape& shapeA, const Transform& transformA, const Shape& shapeB, const Transform& transformB, ContactManifold& manifold)
+	{
+		Float3 pA, qA, pB, qB; getCapsuleSegment(shapeA, transformA, pA, qA); getCapsuleSegment(shapeB, transformB, pB, qB);
+		const Float3 dA = qA - pA, dB = qB - pB;
+		const float32 lengthA = LengthSquared(dA);
+
+		//parallel capsules lying on each other touch along a segment, the ends of the overlap are the contacts so they don't roll
+		const Float3 crossed = Cross(dA, dB);
+		if (lengthA > 1e-12f && LengthSquared(crossed) <= 1e-6f * lengthA * LengthSquared(dB)) {
+			const float32 s0 = Dot(pB - pA, dA) / lengthA, s1 = Dot(qB - pA, dA) / lengthA;
+			const float32 start = clamp(s0 < s1 ? s0 : s1, 0.0f, 1.0f), end = clamp(s0 < s1 ? s1 : s0, 0.0f, 1.0f);
+
+			if (end - start > 1e-4f) {
+				const float32 lengthB = LengthSquared(dB);
+				const Float3 fallbackNormal = GetPerpendicular(dA * (1.0f / std::sqrt(lengthA)));
+
+				for (const float32 s : { start, end }) {
+					const Float3 pointA = pA + dA * s;
+					const float32 t = lengthB > 1e-12f ? clamp(Dot(pointA - pB, dB) / lengthB, 0.0f, 1.0f) : 0.0f;
+					addSphereContact(manifold, pointA, shapeA.Radius, pB + dB * t, shapeB.Radius, fallbackNormal);
+				}
+
+				return manifold.PointCount;
+			}
+		}
+
+		float32 s, t; closestSegmentPoints(pA, qA, pB, qB, s, t);
+		const Float3 fallbackNormal = LengthSquared(crossed) > 1e-12f ? crossed * (1.0f / std::sqrt(LengthSquared(crossed))) : getAxis(transformA, 0);
+		return addSphereContact(manifold, pA + dA * s, shapeA.Radius, pB + dB * t, shapeB.Radius, fallbackNormal);
+	}
+
+	/**
+	 * \brief Shapes are handled by GJK and EPA as their core, a point for spheres and a segment for capsules, inflated by the radius.
+	 */
+	float32 getCoreRadius(const Shape& shape) { return shape.Type == ShapeType::SPHERE || shape.Type == ShapeType::CAPSULE ? shape.Radius : 0.0f; }
+
+	Float3 getCoreSupport(const Shape& shape, const Transform& transform, const Float3 direction)
+	{
+		const Float3 local = toLocalDirection(transform, direction);
+		Float3 point{ 0.0f, 0.0f, 0.0f };
+
+		switch (shape.Type)
+		{
+		case ShapeType::SPHERE: break;
+		case ShapeType::CAPSULE: point.Y = local.Y < 0.0f ? -shape.HalfExtents[1] : shape.HalfExtents[1]; break;
+		case ShapeType::BOX:
+			point = { local.X < 0.0f ? -shape.HalfExtents[0] : shape.HalfExtents[0], local.Y < 0.0f ? -shape.HalfExtents[1] : shape.HalfExtents[1], local.Z < 0.0f ? -shape.HalfExtents[2] : shape.HalfExtents[2] };
+			break;
+		case ShapeType::CONVEX_HULL:
+		{
+			float32 best = -FLOAT_MAX;
+			for (uint32 v = 0; v < shape.Hull->VertexCount; ++v) {
+				const Float3 vertex{ shape.Hull->Vertices[v * 3], shape.Hull->Vertices[v * 3 + 1], shape.Hull->Vertices[v * 3 + 2] };
+				const float32 projection = Dot(vertex, local);
+				if (projection > best) { best = projection; point = vertex; }
+			}
+			break;
+		}
+		}
+
+		return toWorld(transform, point);
+	}
+
+	/**
+	 * \brief Point of the Minkowski difference of A and B, W = A - B, with the points of each shape it comes from.
+	 */
+	struct SupportPoint { Float3 A, B, W; };
+
+	struct Simplex
+	{
+		SupportPoint Points[4];
+		float32 Weights[4];
+		uint8 Count = 0;
+	};
+
+	struct ConvexPairInfo
+	{
+		const Shape& ShapeA; const Transform& TransformA;
+		const Shape& ShapeB; const Transform& TransformB;
+
+		[[nodiscard]] SupportPoint GetSupport(const Float3 direction) const
+		{
+			SupportPoint point;
+			point.A = getCoreSupport(ShapeA, TransformA, direction); point.B = getCoreSupport(ShapeB, TransformB, -direction);
+			point.W = point.A - point.B;
+			return point;
+		}
+	};
+
+	/**
+	 * \brief Reduces the simplex to the vertices of the feature closest to the origin, with their barycentric weights.
+	 * \return Whether the origin is inside the simplex, only possible for tetrahedra.
+	 */
+	bool solveSimplex(Simplex& simplex);
+
+	void keep(Simplex& simplex, const uint8 i, const float32 wi) { simplex.Points[0] = simplex.Points[i]; simplex.Weights[0] = wi; simplex.Count = 1; }
+
+	void keep(Simplex& simplex, const uint8 i, const float32 wi, const uint8 j, const float32 wj)
+	{
+		const SupportPoint a = simplex.Points[i], b = simplex.Points[j];
+		simplex.Points[0] = a; simplex.Points[1] = b; simplex.Weights[0] = wi; simplex.Weights[1] = wj; simplex.Count = 2;
+	}
+
+	void solveSegment(Simplex& simplex)
+	{
+		const Float3 a = simplex.Points[0].W, ab = simplex.Points[1].W - a;
+		const float32 t = -Dot(a, ab), length = LengthSquared(ab);
+
+		if (t <= 0.0f || length <= 1e-12f) { keep(simplex, 0, 1.0f); return; }
+		if (t >= length) { keep(simplex, 1, 1.0f); return; }
+		keep(simplex, 0, 1.0f - t / length, 1, t / length);
+	}
+
+	/**
+	 * \brief Closest point of triangle abc to the origin by Voronoi regions, from Real-Time Collision Detection 5.1.5.
+	 */
+	void solveTriangle(Simplex& simplex)
+	{
+		const Float3 a = simplex.Points[0].W, b = simplex.Points[1].W, c = simplex.Points[2].W;
+		const Float3 ab = b - a, ac = c - a;
+
+		const float32 d1 = -Dot(ab, a), d2 = -Dot(ac, a);
+		if (d1 <= 0.0f && d2 <= 0.0f) { keep(simplex, 0, 1.0f); return; }
+
+		const float32 d3 = -Dot(ab, b), d4 = -Dot(ac, b);
+		if (d3 >= 0.0f && d4 <= d3) { keep(simplex, 1, 1.0f); return; }
+
+		const float32 vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) { const float32 v = d1 / (d1 - d3); keep(simplex, 0, 1.0f - v, 1, v); return; }
+
+		const float32 d5 = -Dot(ab, c), d6 = -Dot(ac, c);
+		if (d6 >= 0.0f && d5 <= d6) { keep(simplex, 2, 1.0f); return; }
+
+		const float32 vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) { const float32 w = d2 / (d2 - d6); keep(simplex, 0, 1.0f - w, 2, w); return; }
+
+		const float32 va = d3 * d6 - d5 * d4;
+		if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f) { const float32 w = (d4 - d3) / ((d4 - d3) + (d5 - d6)); keep(simplex, 1, 1.0f - w, 2, w); return; }
+
+		const float32 denominator = 1.0f / (va + vb + vc);
+		simplex.Weights[1] = vb * denominator; simplex.Weights[2] = vc * denominator; simplex.Weights[0] = 1.0f - simplex.Weights[1] - simplex.Weights[2];
+		simplex.Count = 3;
+	}
+
+	bool solveTetrahedron(Simplex& simplex)
+	{
+		constexpr uint8 FACES[4][4] = { { 0, 1, 2, 3 }, { 0, 2, 3, 1 }, { 0, 3, 1, 2 }, { 1, 3, 2, 0 } }; //three vertices and the opposite one
+
+		Simplex best; float32 bestDistance = FLOAT_MAX; bool outside = false;
+
+		//support points from the same face of a box or a hull make a flat tetrahedron, which encloses nothing, every face is a candidate then
+		const Float3 baseNormal = Cross(simplex.Points[1].W - simplex.Points[0].W, simplex.Points[2].W - simplex.Points[0].W), apex = simplex.Points[3].W - simplex.Points[0].W;
+		const float32 volume = Dot(baseNormal, apex);
+		const bool flat = volume * volume <= 1e-10f * LengthSquared(baseNormal) * LengthSquared(apex);
+
+		for (const auto& face : FACES)
+		{
+			const Float3 a = simplex.Points[face[0]].W, b = simplex.Points[face[1]].W, c = simplex.Points[face[2]].W, d = simplex.Points[face[3]].W;
+			const Float3 normal = Cross(b - a, c - a);
+
+			//the origin is outside this face if it's on the other side from the opposite vertex
+			const float32 originSide = -Dot(normal, a), vertexSide = Dot(normal, d - a);
+			if (!flat && originSide * vertexSide >= 0.0f) { continue; }
+			outside = true;
+
+			Simplex faceSimplex; faceSimplex.Count = 3;
+			faceSimplex.Points[0] = simplex.Points[face[0]]; faceSimplex.Points[1] = simplex.Points[face[1]]; faceSimplex.Points[2] = simplex.Points[face[2]];
+			solveTriangle(faceSimplex);
+
+			Float3 closest{ 0.0f, 0.0f, 0.0f };
+			for (uint8 i = 0; i < faceSimplex.Count; ++i) { closest = closest + faceSimplex.Points[i].W * faceSimplex.Weights[i]; }
+
+			if (LengthSquared(closest) < bestDistance) { bestDistance = LengthSquared(closest); best = faceSimplex; }
+		}
+
+		if (!outside) { return true; }
+
+		simplex = best;
+		return false;
+	}
+
+	bool solveSimplex(Simplex& simplex)
+	{
+		switch (simplex.Count)
+		{
+		case 1: simplex.Weights[0] = 1.0f; return false;
+		case 2: solveSegment(simplex); return false;
+		case 3: solveTriangle(simplex); return false;
+		default: return solveTetrahedron(simplex);
+		}
+	}
+
+	/**
+	 * \brief Finds the closest points between both shapes' cores.
+	 * \return Whether the cores overlap, then simplex is left ready for EPA.
+	 */
+	bool runGJK(const ConvexPairInfo& pair, Simplex& simplex, Float3& pointA, Float3& pointB)
+	{
+		constexpr uint8 MAX_ITERATIONS = 32;
+
+		Float3 v = getPosition(pair.TransformA) - getPosition(pair.TransformB); //a point somewhere inside the difference
+		if (LengthSquared(v) < 1e-12f) { v = { 1.0f, 0.0f, 0.0f }; }
+
+		simplex.Count = 0;
+
+		for (uint8 i = 0; i < MAX_ITERATIONS; ++i)
+		{
+			const SupportPoint w = pair.GetSupport(-v);
+
+			if (simplex.Count) {
+				const float32 vv = LengthSquared(v);
+				if (vv - Dot(v, w.W) <= 1e-5f * vv + 1e-7f) { break; } //no vertex brings the simplex meaningfully closer
+
+				bool repeated = false;
+				for (uint8 p = 0; p < simplex.Count; ++p) { repeated |= LengthSquared(simplex.Points[p].W - w.W) < 1e-12f; }
+				if (repeated) { break; }
+			}
+
+			const Simplex previous = simplex;
+			simplex.Points[simplex.Count++] = w;
+			if (solveSimplex(simplex)) { return true; }
+
+			Float3 closest{ 0.0f, 0.0f, 0.0f };
+			for (uint8 p = 0; p < simplex.Count; ++p) { closest = closest + simplex.Points[p].W * simplex.Weights[p]; }
+
+			if (LengthSquared(closest) < 1e-10f) { return true; } //touching, depth is left to EPA
+
+			//nearly flat simplices can round the wrong way, the distance must shrink every iteration
+			if (previous.Count && LengthSquared(closest) >= LengthSquared(v)) { simplex = previous; break; }
+			v = closest;
+		}
+
+		pointA = { 0.0f, 0.0f, 0.0f }; pointB = { 0.0f, 0.0f, 0.0f };
+		for (uint8 p = 0; p < simplex.Count; ++p) { pointA = pointA + simplex.Points[p].A * simplex.Weights[p]; pointB = pointB + simplex.Points[p].B * simplex.Weights[p]; }
+
+		return false;
+	}
+
+	/**
+	 * \brief Grows a simplex GJK ended with into a tetrahedron, GJK stops early when the origin lies on a face, an edge or a vertex.
+	 */
+	bool completeTetrahedron(const ConvexPairInfo& pair, Simplex& simplex)
+	{
+		const Float3 axes[6] = { { 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f } };
+
+		auto tryAdd = [&](const Float3 direction, auto&& isNew) {
+			const SupportPoint w = pair.GetSupport(direction);
+			if (!isNew(w.W)) { return false; }
+			simplex.Points[simplex.Count++] = w;
+			return true;
+		};
+
+		if (simplex.Count == 1) {
+			bool added = false;
+			for (uint8 i = 0; i < 6 && !added; ++i) { added = tryAdd(axes[i], [&](const Float3 w) { return LengthSquared(w - simplex.Points[0].W) > 1e-10f; }); }
+			if (!added) { return false; }
+		}
+
+		if (simplex.Count == 2) {
+			const Float3 a = simplex.Points[0].W, line = simplex.Points[1].W - a;
+			auto offLine = [&](const Float3 w) { return LengthSquared(Cross(w - a, line)) > 1e-10f * LengthSquared(line); };
+
+			bool added = false;
+			for (uint8 i = 0; i < 6 && !added; i += 2) {
+				const Float3 perpendicular = Cross(line, axes[i]);
+				if (LengthSquared(perpendicular) < 1e-12f) { continue; }
+				added = tryAdd(perpendicular, offLine) || tryAdd(-perpendicular, offLine);
+			}
+			if (!added) { return false; }
+		}
+
+		if (simplex.Count == 3) {
+			const Float3 a = simplex.Points[0].W, normal = Cross(simplex.Points[1].W - a, simplex.Points[2].W - a);
+			auto offPlane = [&](const Float3 w) { const float32 d = Dot(w - a, normal); return d * d > 1e-10f * LengthSquared(normal); };
+			if (!tryAdd(normal, offPlane) && !tryAdd(-normal, offPlane)) { return false; }
+		}
+
+		return true;
+	}
+
+	/**
+	 * \brief Barycentric coordinates of p, which lies on triangle abc.
+	 */
+	void getBarycentric(const Float3 p, const Float3 a, const Float3 b, const Float3 c, float32& u, float32& v, float32& w)
+	{
+		const Float3 v0 = b - a, v1 = c - a, v2 = p - a;
+		const float32 d00 = Dot(v0, v0), d01 = Dot(v0, v1), d11 = Dot(v1, v1), d20 = Dot(v2, v0), d21 = Dot(v2, v1);
+		const float32 denominator = d00 * d11 - d01 * d01;
+		if (std::abs(denominator) < 1e-20f) { u = 1.0f; v = 0.0f; w = 0.0f; return; }
+		v = (d11 * d20 - d01 * d21) / denominator; w = (d00 * d21 - d01 * d20) / denominator; u = 1.0f - v - w;
+	}
+
+	/**
+	 * \brief Expands the polytope GJK found around the origin until it's closest face is on the difference's surface.
+	 * \param normal Direction B has to move in to stop overlapping A, by depth.
+	 */
+	bool runEPA(const ConvexPairInfo& pair, Simplex& simplex, Float3& normal, float32& depth, Float3& pointA, Float3& pointB)
+	{
+		constexpr uint8 MAX_VERTICES = 64, MAX_FACES = 128, MAX_ITERATIONS = 48;
+
+		if (simplex.Count < 4 && !completeTetrahedron(pair, simplex)) { return false; }
+
+		SupportPoint vertices[MAX_VERTICES]; uint8 vertexCount = 4;
+		for (uint8 i = 0; i < 4; ++i) { vertices[i] = simplex.Points[i]; }
+
+		//the origin can be on the polytope's surface, faces are oriented away from a point that's always inside instead
+		const Float3 interior = (vertices[0].W + vertices[1].W + vertices[2].W + vertices[3].W) * 0.25f;
+
+		struct Face { uint8 V[3]; Float3 Normal; float32 Distance; };
+		Face faces[MAX_FACES]; uint8 faceCount = 0;
+
+		auto addFace = [&](uint8 a, uint8 b, uint8 c) {
+			Float3 faceNormal = Cross(vertices[b].W - vertices[a].W, vertices[c].W - vertices[a].W);
+			const float32 length = std::sqrt(LengthSquared(faceNormal));
+			if (length < 1e-12f || faceCount == MAX_FACES) { return false; }
+
+			faceNormal = faceNormal * (1.0f / length);
+			if (Dot(faceNormal, vertices[a].W - interior) < 0.0f) { faceNormal = -faceNormal; const uint8 t = b; b = c; c = t; }
+
+			faces[faceCount++] = { { a, b, c }, faceNormal, Dot(faceNormal, vertices[a].W) };
+			return true;
+		};
+
+		if (!addFace(0, 1, 2) || !addFace(0, 3, 1) || !addFace(0, 2, 3) || !addFace(1, 3, 2)) { return false; }
+
+		uint8 closest = 0;
+
+		for (uint8 iteration = 0; iteration < MAX_ITERATIONS; ++iteration)
+		{
+			closest = 0;
+			for (uint8 f = 1; f < faceCount; ++f) { if (faces[f].Distance < faces[closest].Distance) { closest = f; } }
+
+			const Face face = faces[closest];
+			const SupportPoint w = pair.GetSupport(face.Normal);
+			if (Dot(w.W, face.Normal) - face.Distance < 1e-4f || vertexCount == MAX_VERTICES) { break; }
+
+			const uint8 newVertex = vertexCount; vertices[vertexCount++] = w;
+
+			//remove every face the new vertex sees, the edges they don't share form the hole's border
+			uint8 edges[MAX_FACES * 3][2]; uint16 edgeCount = 0;
+
+			for (uint8 f = 0; f < faceCount;)
+			{
+				if (Dot(faces[f].Normal, w.W - vertices[faces[f].V[0]].W) <= 0.0f) { ++f; continue; }
+
+				for (uint8 e = 0; e < 3; ++e)
+				{
+					const uint8 a = faces[f].V[e], b = faces[f].V[(e + 1) % 3];
+
+					bool shared = false;
+					for (uint16 i = 0; i < edgeCount; ++i) {
+						if (edges[i][0] == b && edges[i][1] == a) { edges[i][0] = edges[edgeCount - 1][0]; edges[i][1] = edges[edgeCount - 1][1]; --edgeCount; shared = true; break; }
+					}
+
+					if (!shared) { edges[edgeCount][0] = a; edges[edgeCount][1] = b; ++edgeCount; }
+				}
+
+				faces[f] = faces[--faceCount];
+			}
+
+			for (uint16 i = 0; i < edgeCount; ++i) { addFace(edges[i][0], edges[i][1], newVertex); }
+
+			if (!faceCount) { return false; }
+		}
+
+		const Face& face = faces[closest];
+		normal = face.Normal; depth = face.Distance;
+
+		float32 u, v, t; getBarycentric(normal * depth, vertices[face.V[0]].W, vertices[face.V[1]].W, vertices[face.V[2]].W, u, v, t);
+		pointA = vertices[face.V[0]].A * u + vertices[face.V[1]].A * v + vertices[face.V[2]].A * t;
+		pointB = vertices[face.V[0]].B * u + vertices[face.V[1]].B * v + vertices[face.V[2]].B * t;
+		return true;
+	}
+
+	struct Box
+	{
+		Float3 Position; Float3 Axes[3]; float32 HalfExtents[3];
+	};
+
+	/**
+	 * \brief Keeps the part of polygon behind the plane Dot(normal, p) = offset.
+	 */
+	uint8 clipPolygon(const Float3* polygon, const uint8 count, const Float3 normal, const float32 offset, Float3* result)
+	{
+		uint8 resultCount = 0;
+
+		for (uint8 i = 0; i < count; ++i)
+		{
+			const Float3 a = polygon[i], b = polygon[(i + 1) % count];
+			const float32 da = Dot(normal, a) - offset, db = Dot(normal, b) - offset;
+
+			if (da <= 0.0f) { result[resultCount++] = a; }
+			if ((da < 0.0f && db > 0.0f) || (da > 0.0f && db < 0.0f)) { result[resultCount++] = a + (b - a) * (da / (da - db)); }
+		}
+
+		return resultCount;
+	}
+
+	/**
+	 * \brief Contacts of the incident box's face most opposed to reference's face along axis, clipped to the reference face.
+	 */
+	void addFaceContacts(const Box& reference, const Box& incident, const uint8 axis, const bool referenceIsA, ContactManifold& manifold)
+	{
+		Float3 normal = reference.Axes[axis];
+		if (Dot(normal, incident.Position - reference.Position) < 0.0f) { normal = -normal; }
+
+		uint8 incidentAxis = 0; float32 alignment = 0.0f;
+		for (uint8 i = 0; i < 3; ++i) { const float32 d = std::abs(Dot(normal, incident.Axes[i])); if (d > alignment) { alignment = d; incidentAxis = i; } }
+
+		const Float3 incidentNormal = Dot(normal, incident.Axes[incidentAxis]) > 0.0f ? -incident.Axes[incidentAxis] : incident.Axes[incidentAxis];
+		const Float3 incidentCenter = incident.Position + incidentNormal * incident.HalfExtents[incidentAxis];
+		const uint8 u = (incidentAxis + 1) % 3, v = (incidentAxis + 2) % 3;
+		const Float3 du = incident.Axes[u] * incident.HalfExtents[u], dv = incident.Axes[v] * incident.HalfExtents[v];
+
+		Float3 polygon[8] = { incidentCenter + du + dv, incidentCenter - du + dv, incidentCenter - du - dv, incidentCenter + du - dv };
+		Float3 clipped[8]; uint8 count = 4;
+
+		for (uint8 side = 1; side < 3 && count; ++side)
+		{
+			const uint8 sideAxis = (axis + side) % 3;
+			const Float3 sideNormal = reference.Axes[sideAxis];
+			const float32 center = Dot(sideNormal, reference.Position);
+
+			count = clipPolygon(polygon, count, sideNormal, center + reference.HalfExtents[sideAxis], clipped);
+			count = clipPolygon(clipped, count, -sideNormal, -center + reference.HalfExtents[sideAxis], polygon);
+		}
+
+		const float32 faceOffset = Dot(normal, reference.Position) + reference.HalfExtents[axis];
+		float32 depths[8]; uint8 kept = 0;
+
+		for (uint8 i = 0; i < count; ++i) {
+			const float32 depth = faceOffset - Dot(normal, polygon[i]);
+			if (depth >= -CONTACT_MARGIN) { polygon[kept] = polygon[i]; depths[kept] = depth; ++kept; }
+		}
+
+		//more than 4 points don't make stacking any more stable, keep the deepest, the farthest from it and the two which span the largest area with them
+		uint8 selected[MAX_CONTACT_POINTS]; uint8 selectedCount = 0;
+
+		if (kept <= MAX_CONTACT_POINTS) {
+			for (uint8 i = 0; i < kept; ++i) { selected[selectedCount++] = i; }
+		} else {
+			uint8 deepest = 0;
+			for (uint8 i = 1; i < kept; ++i) { if (depths[i] > depths[deepest]) { deepest = i; } }
+
+			uint8 farthest = deepest; float32 farthestDistance = -1.0f;
+			for (uint8 i = 0; i < kept; ++i) { const float32 d = LengthSquared(polygon[i] - polygon[deepest]); if (d > farthestDistance) { farthestDistance = d; farthest = i; } }
+
+			uint8 positive = deepest, negative = deepest; float32 maxArea = 0.0f, minArea = 0.0f;
+			for (uint8 i = 0; i < kept; ++i) {
+				const float32 area = Dot(Cross(polygon[farthest] - polygon[deepest], polygon[i] - polygon[deepest]), normal);
+				if (area > maxArea) { maxArea = area; positive = i; }
+				if (area < minArea) { minArea = area; negative = i; }
+			}
+
+			selected[selectedCount++] = deepest; selected[selectedCount++] = farthest;
+			if (positive != deepest) { selected[selectedCount++] = positive; }
+			if (negative != deepest) { selected[selectedCount++] = negative; }
+		}
+
+		const Float3 normalAB = referenceIsA ? normal : -normal;
+		for (uint8 i = 0; i < selectedCount; ++i) { addPoint(manifold, polygon[selected[i]] + normal * (depths[selected[i]] * 0.5f), normalAB, depths[selected[i]]); }
+	}
+
+	/**
+	 * \brief Contact between edge axisA of a and edge axisB of b, the edges closest to each other along their cross product.
+	 */
+	void addEdgeContact(const Box& a, const Box& b, const uint8 axisA, const uint8 axisB, const float32 separation, ContactManifold& manifold)
+	{
+		Float3 normal = Cross(a.Axes[axisA], b.Axes[axisB]);
+		normal = normal * (1.0f / std::sqrt(LengthSquared(normal)));
+		if (Dot(normal, b.Position - a.Position) < 0.0f) { normal = -normal; }
+
+		Float3 edgeA = a.Position, edgeB = b.Position;
+		for (uint8 i = 0; i < 3; ++i) {
+			if (i != axisA) { edgeA = edgeA + a.Axes[i] * (Dot(normal, a.Axes[i]) > 0.0f ? a.HalfExtents[i] : -a.HalfExtents[i]); }
+			if (i != axisB) { edgeB = edgeB + b.Axes[i] * (Dot(normal, b.Axes[i]) > 0.0f ? -b.HalfExtents[i] : b.HalfExtents[i]); }
+		}
+
+		const Float3 halfA = a.Axes[axisA] * a.HalfExtents[axisA], halfB = b.Axes[axisB] * b.HalfExtents[axisB];
+		float32 s, t; closestSegmentPoints(edgeA - halfA, edgeA + halfA, edgeB - halfB, edgeB + halfB, s, t);
+
+		const Float3 pointA = edgeA - halfA + halfA * (2.0f * s), pointB = edgeB - halfB + halfB * (2.0f * t);
+		addPoint(manifold, (pointA + pointB) * 0.5f, normal, -separation);
+	}
+
+	__m128 absolute(const __m128 value) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), value); }
+	__m128 select(const __m128 mask, const __m128 a, const __m128 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+
+	uint32 getLaneMask(const uint32 count) { return (1u << count) - 1; }
+}
+
+AABB GetShapeAABB(const Shape& shape, const Transform& transform)
+{
+	float32 extents[3];
+
+	switch (shape.Type)
+	{
+	case ShapeType::SPHERE: for (auto& e : extents) { e = shape.Radius; } break;
+	case ShapeType::BOX: for (uint8 i = 0; i < 3; ++i) { extents[i] = std::abs(transform.Axes[0][i]) * shape.HalfExtents[0] + std::abs(transform.Axes[1][i]) * shape.HalfExtents[1] + std::abs(transform.Axes[2][i]) * shape.HalfExtents[2]; } break;
+	case ShapeType::CAPSULE: for (uint8 i = 0; i < 3; ++i) { extents[i] = std::abs(transform.Axes[1][i]) * shape.HalfExtents[1] + shape.Radius; } break;
+	case ShapeType::CONVEX_HULL:
+	{
+		AABB aabb{ { FLOAT_MAX, FLOAT_MAX, FLOAT_MAX }, { -FLOAT_MAX, -FLOAT_MAX, -FLOAT_MAX } };
+		for (uint32 v = 0; v < shape.Hull->VertexCount; ++v) {
+			const Float3 vertex = toWorld(transform, { shape.Hull->Vertices[v * 3], shape.Hull->Vertices[v * 3 + 1], shape.Hull->Vertices[v * 3 + 2] });
+			const float32 coordinates[3] = { vertex.X, vertex.Y, vertex.Z };
+			for (uint8 i = 0; i < 3; ++i) { aabb.Min[i] = coordinates[i] < aabb.Min[i] ? coordinates[i] : aabb.Min[i]; aabb.Max[i] = coordinates[i] > aabb.Max[i] ? coordinates[i] : aabb.Max[i]; }
+		}
+		return aabb;
+	}
+	}
+
+	AABB aabb;
+	for (uint8 i = 0; i < 3; ++i) { aabb.Min[i] = transform.Position[i] - extents[i]; aabb.Max[i] = transform.Position[i] + extents[i]; }
+	return aabb;
+}
+
+bool CollideConvex(const Shape& shapeA, const Transform& transformA, const Shape& shapeB, const Transform& transformB, ContactManifold& manifold)
+{
+	const ConvexPairInfo pair{ shapeA, transformA, shapeB, transformB };
+	const float32 radiusA = getCoreRadius(shapeA), radiusB = getCoreRadius(shapeB);
+
+	Simplex simplex; Float3 pointA, pointB, normal; float32 depth;
+
+	if (!runGJK(pair, simplex, pointA, pointB)) {
+		const Float3 difference = pointB - pointA;
+		const float32 distance = std::sqrt(LengthSquared(difference));
+		if (distance > radiusA + radiusB) { return false; }
+
+		normal = difference * (1.0f / distance); depth = radiusA + radiusB - distance;
+	} else {
+		if (!runEPA(pair, simplex, normal, depth, pointA, pointB)) { return false; }
+		depth += radiusA + radiusB;
+	}
+
+	const Float3 surfaceA = pointA + normal * radiusA, surfaceB = pointB - normal * radiusB;
+	addPoint(manifold, (surfaceA + surfaceB) * 0.5f, normal, depth);
+	return true;
+}
+
+bool CastSphere(const float32 start[3], const float32 end[3], const float32 radius, const Shape& shape, const Transform& transform, HitResult& hit)
+{
+	constexpr uint8 MAX_ITERATIONS = 32, BISECTIONS = 16;
+	constexpr float32 TOLERANCE = 1e-4f; //gap at which the sphere is considered touching
+
+	Shape sphere; sphere.Type = ShapeType::SPHERE; sphere.Radius = radius;
+	Transform sphereTransform{ { start[0], start[1], start[2] }, { { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } } };
+	const ConvexPairInfo pair{ sphere, sphereTransform, shape, transform };
+
+	const Float3 origin = LoadFloat3(start), direction = LoadFloat3(end) - origin;
+	const float32 radii = radius + getCoreRadius(shape), length = std::sqrt(LengthSquared(direction));
+
+	//gap between the sphere at t and the shape, -FLOAT_MAX if their cores overlap, with the shape's closest point and normal there
+	auto getGap = [&](const float32 t, Float3& normal, Float3& point) {
+		StoreFloat3(origin + direction * t, sphereTransform.Position);
+		Simplex simplex; Float3 pointA, pointB;
+		if (runGJK(pair, simplex, pointA, pointB)) { return -FLOAT_MAX; }
+
+		const Float3 difference = pointA - pointB;
+		const float32 distance = std::sqrt(LengthSquared(difference));
+		normal = difference * (1.0f / distance); point = pointB + normal * getCoreRadius(shape);
+		return distance - radii;
+	};
+
+	float32 t = 0.0f, apartT = 0.0f;
+	Float3 normal = length > 0.0f ? direction * (-1.0f / length) : Float3{ 0.0f, 1.0f, 0.0f }, point = origin, apartNormal = normal, apartPoint = point;
+
+	for (uint8 i = 0; i < MAX_ITERATIONS; ++i)
+	{
+		const float32 gap = getGap(t, normal, point);
+
+		if (gap > TOLERANCE)
+		{
+			//the sphere can't touch the shape before closing the gap along the normal, and a convex shape it's moving away from can't be reached at all
+			const float32 approach = -Dot(direction, normal);
+			if (approach <= 0.0f) { return false; }
+
+			apartT = t; apartNormal = normal; apartPoint = point;
+			t += gap / approach;
+			if (t > 1.0f) { return false; }
+			continue;
+		}
+
+		if (gap < -TOLERANCE)
+		{
+			if (t == 0.0f) { //started inside
+				normal = length > 0.0f ? direction * (-1.0f / length) : Float3{ 0.0f, 1.0f, 0.0f }; point = origin;
+			} else { //went past the surface, GJK distances can come out a little long, find it again between the last point known to be apart and here
+				float32 inside = t; t = apartT; normal = apartNormal; point = apartPoint;
+				for (uint8 j = 0; j < BISECTIONS; ++j) {
+					const float32 middle = (t + inside) * 0.5f; Float3 middleNormal, middlePoint;
+					if (getGap(middle, middleNormal, middlePoint) >= 0.0f) { t = middle; normal = middleNormal; point = middlePoint; } else { inside = middle; }
+				}
+			}
+		}
+
+		hit.WasHit = true; hit.T = t;
+		hit.HitPosition = GTSL::Vector3(point.X, point.Y, point.Z); hit.HitNormal = GTSL::Vector3(normal.X, normal.Y, normal.Z);
+		return true;
+	}
+
+	return false;
+}
+
+void NarrowPhase::Initialize(const uint32 capacity, const BE::PAR& allocator)
+{
+	sphereSpheres.Initialize(capacity / LANES + 1, allocator); sphereBoxes.Initialize(capacity / LANES + 1, allocator); boxBoxes.Initialize(capacity / LANES + 1, allocator);
+	convexPairs.Initialize(capacity, allocator);
+}
+
+void NarrowPhase::AddPair(uint32 a, const Shape& shapeA, const Transform& transformA, uint32 b, const Shape& shapeB, const Transform& transformB)
+{
+	//kernels expect shapes in ShapeType order
+	if (shapeA.Type > shapeB.Type) { AddPair(b, shapeB, transformB, a, shapeA, transformA); return; }
+
+	//unused lanes of the last packet hold copies of it's first pair so every lane computes valid numbers
+	auto addToPacket = [](auto& packets, auto&& write) {
+		if (!packets.GetLength() || packets[packets.GetLength() - 1].Count == LANES) {
+			auto& packet = packets.EmplaceBack();
+			for (uint32 l = 0; l < LANES; ++l) { write(packet, l); }
+			packet.Count = 1; return;
+		}
+
+		auto& packet = packets[packets.GetLength() - 1];
+		write(packet, packet.Count++);
+	};
+
+	auto writeBox = [](float32 (&position)[3][LANES], float32 (&axes)[3][3][LANES], float32 (&halfExtents)[3][LANES], const Shape& shape, const Transform& transform, const uint32 l) {
+		for (uint8 i = 0; i < 3; ++i) {
+			position[i][l] = transform.Position[i]; halfExtents[i][l] = shape.HalfExtents[i];
+			for (uint8 j = 0; j < 3; ++j) { axes[i][j][l] = transform.Axes[i][j]; }
+		}
+	};
+
+	if (shapeA.Type == ShapeType::SPHERE && shapeB.Type == ShapeType::SPHERE) {
+		addToPacket(sphereSpheres, [&](SphereSpherePacket& packet, const uint32 l) {
+			for (uint8 i = 0; i < 3; ++i) { packet.CenterA[i][l] = transformA.Position[i]; packet.CenterB[i][l] = transformB.Position[i]; }
+			packet.RadiusA[l] = shapeA.Radius; packet.RadiusB[l] = shapeB.Radius; packet.A[l] = a; packet.B[l] = b;
+		});
+	} else if (shapeA.Type == ShapeType::SPHERE && shapeB.Type == ShapeType::BOX) {
+		addToPacket(sphereBoxes, [&](SphereBoxPacket& packet, const uint32 l) {
+			for (uint8 i = 0; i < 3; ++i) { packet.Center[i][l] = transformA.Position[i]; }
+			packet.Radius[l] = shapeA.Radius;
+			writeBox(packet.Position, packet.Axes, packet.HalfExtents, shapeB, transformB, l);
+			packet.A[l] = a; packet.B[l] = b;
+		});
+	} else if (shapeA.Type == ShapeType::BOX && shapeB.Type == ShapeType::BOX) {
+		addToPacket(boxBoxes, [&](BoxBoxPacket& packet, const uint32 l) {
+			writeBox(packet.PositionA, packet.AxesA, packet.HalfExtentsA, shapeA, transformA, l);
+			writeBox(packet.PositionB, packet.AxesB, packet.HalfExtentsB, shapeB, transformB, l);
+			packet.A[l] = a; packet.B[l] = b;
+		});
+	} else {
+		convexPairs.EmplaceBack(ConvexPair{ a, b, shapeA, shapeB, transformA, transformB });
+	}
+}
+
+void NarrowPhase::Collide(GTSL::Vector<ContactManifold, BE::PAR>& contacts)
+{
+	collideSphereSpheres(contacts); collideSphereBoxes(contacts); collideBoxBoxes(contacts); collideConvexPairs(contacts);
+	sphereSpheres.ResizeDown(0); sphereBoxes.ResizeDown(0); boxBoxes.ResizeDown(0); convexPairs.ResizeDown(0);
+}
+
+void NarrowPhase::collideSphereSpheres(GTSL::Vector<ContactManifold, BE::PAR>& contacts)
+{
+	const __m128 one = _mm_set1_ps(1.0f), half = _mm_set1_ps(0.5f), epsilon = _mm_set1_ps(1e-6f);
+
+	for (const auto& packet : sphereSpheres)
+	{
+		const __m128 dx = _mm_sub_ps(_mm_load_ps(packet.CenterB[0]), _mm_load_ps(packet.CenterA[0]));
+		const __m128 dy = _mm_sub_ps(_mm_load_ps(packet.CenterB[1]), _mm_load_ps(packet.CenterA[1]));
+		const __m128 dz = _mm_sub_ps(_mm_load_ps(packet.CenterB[2]), _mm_load_ps(packet.CenterA[2]));
+		const __m128 distanceSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		const __m128 radiusA = _mm_load_ps(packet.RadiusA), radii = _mm_add_ps(radiusA, _mm_load_ps(packet.RadiusB));
+
+		const uint32 hits = _mm_movemask_ps(_mm_cmple_ps(distanceSquared, _mm_mul_ps(radii, radii))) & getLaneMask(packet.Count);
+		if (!hits) { continue; }
+
+		//coincident centers push apart along Y
+		const __m128 distance = _mm_sqrt_ps(distanceSquared), apart = _mm_cmpgt_ps(distance, epsilon);
+		const __m128 inverse = _mm_and_ps(apart, _mm_div_ps(one, distance));
+		const __m128 nx = _mm_mul_ps(dx, inverse), ny = select(apart, _mm_mul_ps(dy, inverse), one), nz = _mm_mul_ps(dz, inverse);
+
+		const __m128 depth = _mm_sub_ps(radii, distance), offset = _mm_sub_ps(radiusA, _mm_mul_ps(depth, half));
+
+		alignas(16) float32 normal[3][LANES], position[3][LANES], depths[LANES];
+		_mm_store_ps(normal[0], nx); _mm_store_ps(normal[1], ny); _mm_store_ps(normal[2], nz);
+		_mm_store_ps(position[0], _mm_add_ps(_mm_load_ps(packet.CenterA[0]), _mm_mul_ps(nx, offset)));
+		_mm_store_ps(position[1], _mm_add_ps(_mm_load_ps(packet.CenterA[1]), _mm_mul_ps(ny, offset)));
+		_mm_store_ps(position[2], _mm_add_ps(_mm_load_ps(packet.CenterA[2]), _mm_mul_ps(nz, offset)));
+		_mm_store_ps(depths, depth);
+
+		for (uint32 l = 0; l < LANES; ++l) {
+			if (!(hits & 1u << l)) { continue; }
+			addPoint(addManifold(contacts, packet.A[l], packet.B[l]), { position[0][l], position[1][l], position[2][l] }, { normal[0][l], normal[1][l], normal[2][l] }, depths[l]);
+		}
+	}
+}
+
+void NarrowPhase::collideSphereBoxes(GTSL::Vector<ContactManifold, BE::PAR>& contacts)
+{
+	const __m128 one = _mm_set1_ps(1.0f), half = _mm_set1_ps(0.5f), signMask = _mm_set1_ps(-0.0f), epsilon = _mm_set1_ps(1e-12f);
+
+	for (const auto& packet : sphereBoxes)
+	{
+		__m128 local[3], closest[3], gap[3];
+		const __m128 dx = _mm_sub_ps(_mm_load_ps(packet.Center[0]), _mm_load_ps(packet.Position[0]));
+		const __m128 dy = _mm_sub_ps(_mm_load_ps(packet.Center[1]), _mm_load_ps(packet.Position[1]));
+		const __m128 dz = _mm_sub_ps(_mm_load_ps(packet.Center[2]), _mm_load_ps(packet.Position[2]));
+
+		//sphere center in box space, and the closest point of the box to it
+		__m128 distanceSquared = _mm_setzero_ps();
+		for (uint8 i = 0; i < 3; ++i) {
+			local[i] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(packet.Axes[i][0]), dx), _mm_mul_ps(_mm_load_ps(packet.Axes[i][1]), dy)), _mm_mul_ps(_mm_load_ps(packet.Axes[i][2]), dz));
+			const __m128 halfExtent = _mm_load_ps(packet.HalfExtents[i]);
+			closest[i] = _mm_min_ps(_mm_max_ps(local[i], _mm_sub_ps(_mm_setzero_ps(), halfExtent)), halfExtent);
+			const __m128 outside = _mm_sub_ps(local[i], closest[i]);
+			distanceSquared = _mm_add_ps(distanceSquared, _mm_mul_ps(outside, outside));
+			gap[i] = _mm_sub_ps(halfExtent, absolute(local[i]));
+		}
+
+		const __m128 radius = _mm_load_ps(packet.Radius);
+		const uint32 hits = _mm_movemask_ps(_mm_cmple_ps(distanceSquared, _mm_mul_ps(radius, radius))) & getLaneMask(packet.Count);
+		if (!hits) { continue; }
+
+		//outside the box the normal goes from the closest point to the center, inside it goes out the nearest face
+		const __m128 isOutside = _mm_cmpgt_ps(distanceSquared, epsilon);
+		const __m128 distance = _mm_sqrt_ps(distanceSquared), inverse = _mm_and_ps(isOutside, _mm_div_ps(one, distance));
+
+		const __m128 nearest0 = _mm_and_ps(_mm_cmple_ps(gap[0], gap[1]), _mm_cmple_ps(gap[0], gap[2]));
+		const __m128 nearest1 = _mm_andnot_ps(nearest0, _mm_cmple_ps(gap[1], gap[2]));
+		const __m128 nearest[3] = { nearest0, nearest1, _mm_andnot_ps(_mm_or_ps(nearest0, nearest1), _mm_castsi128_ps(_mm_set1_epi32(-1))) };
+		const __m128 minimumGap = _mm_min_ps(_mm_min_ps(gap[0], gap[1]), gap[2]);
+
+		__m128 outward[3];
+		for (uint8 i = 0; i < 3; ++i) {
+			const __m128 faceNormal = _mm_and_ps(nearest[i], _mm_or_ps(_mm_and_ps(local[i], signMask), one));
+			outward[i] = select(isOutside, _mm_mul_ps(_mm_sub_ps(local[i], closest[i]), inverse), faceNormal);
+		}
+
+		const __m128 depth = select(isOutside, _mm_sub_ps(radius, distance), _mm_add_ps(radius, minimumGap));
+		const __m128 offset = _mm_sub_ps(radius, _mm_mul_ps(depth, half));
+
+		alignas(16) float32 normal[3][LANES], position[3][LANES], depths[LANES];
+		for (uint8 k = 0; k < 3; ++k) {
+			//normal goes from the sphere to the box, opposite to the box's outward normal
+			const __m128 world = _mm_add_ps(_mm_add_ps(_mm_mul_ps(outward[0], _mm_load_ps(packet.Axes[0][k])), _mm_mul_ps(outward[1], _mm_load_ps(packet.Axes[1][k]))), _mm_mul_ps(outward[2], _mm_load_ps(packet.Axes[2][k])));
+			const __m128 n = _mm_xor_ps(world, signMask);
+			_mm_store_ps(normal[k], n);
+			_mm_store_ps(position[k], _mm_add_ps(_mm_load_ps(packet.Center[k]), _mm_mul_ps(n, offset)));
+		}
+		_mm_store_ps(depths, depth);
+
+		for (uint32 l = 0; l < LANES; ++l) {
+			if (!(hits & 1u << l)) { continue; }
+			addPoint(addManifold(contacts, packet.A[l], packet.B[l]), { position[0][l], position[1][l], position[2][l] }, { normal[0][l], normal[1][l], normal[2][l] }, depths[l]);
+		}
+	}
+}
+
+void NarrowPhase::collideBoxBoxes(GTSL::Vector<ContactManifold, BE::PAR>& contacts)
+{
+	const __m128 epsilon = _mm_set1_ps(1e-6f), one = _mm_set1_ps(1.0f), parallel = _mm_set1_ps(1e-8f), never = _mm_set1_ps(-FLOAT_MAX);
+
+	for (const auto& packet : boxBoxes)
+	{
+		//separating axis test on the 15 axes, 6 face normals and 9 edge cross products, in A's space. Separations along edge axes are
+		//normalized so every axis' penetration can be compared, parallel edges are skipped as they repeat a face axis
+		__m128 r[3][3], absoluteR[3][3], t[3], halfA[3], halfB[3];
+
+		const __m128 dx = _mm_sub_ps(_mm_load_ps(packet.PositionB[0]), _mm_load_ps(packet.PositionA[0]));
+		const __m128 dy = _mm_sub_ps(_mm_load_ps(packet.PositionB[1]), _mm_load_ps(packet.PositionA[1]));
+		const __m128 dz = _mm_sub_ps(_mm_load_ps(packet.PositionB[2]), _mm_load_ps(packet.PositionA[2]));
+
+		for (uint8 i = 0; i < 3; ++i)
+		{
+			const __m128 ax = _mm_load_ps(packet.AxesA[i][0]), ay = _mm_load_ps(packet.AxesA[i][1]), az = _mm_load_ps(packet.AxesA[i][2]);
+			t[i] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, dx), _mm_mul_ps(ay, dy)), _mm_mul_ps(az, dz));
+			halfA[i] = _mm_load_ps(packet.HalfExtentsA[i]); halfB[i] = _mm_load_ps(packet.HalfExtentsB[i]);
+
+			for (uint8 j = 0; j < 3; ++j) {
+				r[i][j] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, _mm_load_ps(packet.AxesB[j][0])), _mm_mul_ps(ay, _mm_load_ps(packet.AxesB[j][1]))), _mm_mul_ps(az, _mm_load_ps(packet.AxesB[j][2])));
+				absoluteR[i][j] = _mm_add_ps(absolute(r[i][j]), epsilon);
+			}
+		}
+
+		alignas(16) float32 separations[15][LANES];
+		__m128 maximum = never;
+
+		for (uint8 i = 0; i < 3; ++i) {
+			const __m128 rb = _mm_add_ps(_mm_add_ps(_mm_mul_ps(halfB[0], absoluteR[i][0]), _mm_mul_ps(halfB[1], absoluteR[i][1])), _mm_mul_ps(halfB[2], absoluteR[i][2]));
+			const __m128 separation = _mm_sub_ps(absolute(t[i]), _mm_add_ps(halfA[i], rb));
+			_mm_store_ps(separations[i], separation); maximum = _mm_max_ps(maximum, separation);
+		}
+
+		for (uint8 j = 0; j < 3; ++j) {
+			const __m128 ra = _mm_add_ps(_mm_add_ps(_mm_mul_ps(halfA[0], absoluteR[0][j]), _mm_mul_ps(halfA[1], absoluteR[1][j])), _mm_mul_ps(halfA[2], absoluteR[2][j]));
+			const __m128 tb = _mm_add_ps(_mm_add_ps(_mm_mul_ps(t[0], r[0][j]), _mm_mul_ps(t[1], r[1][j])), _mm_mul_ps(t[2], r[2][j]));
+			const __m128 separation = _mm_sub_ps(absolute(tb), _mm_add_ps(ra, halfB[j]));
+			_mm_store_ps(separations[3 + j], separation); maximum = _mm_max_ps(maximum, separation);
+		}
+
+		for (uint8 i = 0; i < 3; ++i) {
+			const uint8 i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+
+			for (uint8 j = 0; j < 3; ++j) {
+				const uint8 j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+
+				const __m128 ra = _mm_add_ps(_mm_mul_ps(halfA[i1], absoluteR[i2][j]), _mm_mul_ps(halfA[i2], absoluteR[i1][j]));
+				const __m128 rb = _mm_add_ps(_mm_mul_ps(halfB[j1], absoluteR[i][j2]), _mm_mul_ps(halfB[j2], absoluteR[i][j1]));
+				const __m128 tl = _mm_sub_ps(_mm_mul_ps(t[i2], r[i1][j]), _mm_mul_ps(t[i1], r[i2][j]));
+
+				const __m128 lengthSquared = _mm_sub_ps(one, _mm_mul_ps(r[i][j], r[i][j]));
+				const __m128 valid = _mm_cmpgt_ps(lengthSquared, parallel);
+				const __m128 separation = select(valid, _mm_div_ps(_mm_sub_ps(absolute(tl), _mm_add_ps(ra, rb)), _mm_sqrt_ps(_mm_max_ps(lengthSquared, parallel))), never);
+				_mm_store_ps(separations[6 + i * 3 + j], separation); maximum = _mm_max_ps(maximum, separation);
+			}
+		}
+
+		const uint32 hits = _mm_movemask_ps(_mm_cmple_ps(maximum, _mm_setzero_ps())) & getLaneMask(packet.Count);
+
+		for (uint32 l = 0; l < LANES; ++l)
+		{
+			if (!(hits & 1u << l)) { continue; }
+
+			Box a, b;
+			for (uint8 i = 0; i < 3; ++i) {
+				a.Axes[i] = { packet.AxesA[i][0][l], packet.AxesA[i][1][l], packet.AxesA[i][2][l] }; a.HalfExtents[i] = packet.HalfExtentsA[i][l];
+				b.Axes[i] = { packet.AxesB[i][0][l], packet.AxesB[i][1][l], packet.AxesB[i][2][l] }; b.HalfExtents[i] = packet.HalfExtentsB[i][l];
+			}
+			a.Position = { packet.PositionA[0][l], packet.PositionA[1][l], packet.PositionA[2][l] }; b.Position = { packet.PositionB[0][l], packet.PositionB[1][l], packet.PositionB[2][l] };
+
+			uint8 face = 0, edge = 6;
+			for (uint8 k = 1; k < 6; ++k) { if (separations[k][l] > separations[face][l]) { face = k; } }
+			for (uint8 k = 7; k < 15; ++k) { if (separations[k][l] > separations[edge][l]) { edge = k; } }
+
+			auto& manifold = addManifold(contacts, packet.A[l], packet.B[l]);
+
+			//face contacts are preferred unless an edge axis is clearly shallower, they give more points and flicker less
+			if (separations[edge][l] > 0.95f * separations[face][l] + 0.01f) { addEdgeContact(a, b, (edge - 6) / 3, (edge - 6) % 3, separations[edge][l], manifold); }
+			else if (face < 3) { addFaceContacts(a, b, face, true, manifold); }
+			else { addFaceContacts(b, a, face - 3, false, manifold); }
+
+			if (!manifold.PointCount) { contacts.ResizeDown(contacts.GetLength() - 1); } //only touching
+		}
+	}
+}
+
+void NarrowPhase::collideConvexPairs(GTSL::Vector<ContactManifold, BE::PAR>& contacts)
+{
+	for (const auto& pair : convexPairs)
+	{
+		auto& manifold = addManifold(contacts, pair.A, pair.B);
+		bool touching;
+
+		if (pair.ShapeA.Type == ShapeType::SPHERE && pair.ShapeB.Type == ShapeType::CAPSULE) { touching = collideSphereCapsule(pair.ShapeA, pair.TransformA, pair.ShapeB, pair.TransformB, manifold); }
+		else if (pair.ShapeA.Type == ShapeType::CAPSULE && pair.ShapeB.Type == ShapeType::CAPSULE) { touching = collideCapsules(pair.ShapeA, pair.TransformA, pair.ShapeB, pair.TransformB, manifold); }
+		else { touching = CollideConvex(pair.ShapeA, pair.TransformA, pair.ShapeB, pair.TransformB, manifold); }
+
+		if (!touching) { contacts.ResizeDown(contacts.GetLength() - 1); }
+	}
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <GTSL/Vector.hpp>
+
+#include "BroadPhase.h"
+#include "HitResult.h"
+#include "ByteEngine/Core.h"
+#include "ByteEngine/Application/AllocatorReferences.h"
+
+/**
+ * \brief Position and rotation of a body. The rotation is stored as the body's axes in world space, Axes[0] is the body's X axis.
+ */
+struct Transform
+{
+	float32 Position[3];
+	float32 Axes[3][3];
+};
+
+enum class ShapeType : uint8
+{
+	SPHERE, BOX, CAPSULE, CONVEX_HULL
+};
+
+/**
+ * \brief Vertices of a convex hull in body space, as consecutive x, y, z. Hulls must enclose a volume, a flat hull can't be penetrated.
+ */
+struct ConvexHull
+{
+	const float32* Vertices = nullptr;
+	uint32 VertexCount = 0;
+};
+
+/**
+ * \brief Collision shape, centered on it's body.
+ */
+struct Shape
+{
+	ShapeType Type = ShapeType::BOX;
+
+	/**
+	 * \brief Box half extents. Capsules are a segment along the body's Y axis from -HalfExtents[1] to HalfExtents[1].
+	 */
+	float32 HalfExtents[3] = { 0.0f, 0.0f, 0.0f };
+
+	/**
+	 * \brief Sphere and capsule radius.
+	 */
+	float32 Radius = 0.0f;
+
+	const ConvexHull* Hull = nullptr;
+};
+
+/**
+ * \brief Returns the smallest box around shape when it's body is at transform.
+ */
+[[nodiscard]] AABB GetShapeAABB(const Shape& shape, const Transform& transform);
+
+static constexpr uint8 MAX_CONTACT_POINTS = 4;
+
+/**
+ * \brief Distance a face contact's point may be apart and still be kept. A resting box rocks a little and it's corners would otherwise
+ * come and go every step.
+ */
+static constexpr float32 CONTACT_MARGIN = 0.02f;
+
+/**
+ * \brief Contact points between two bodies. Every point's HitNormal points from A to B, HitPosition is halfway between both surfaces
+ * and T is how deep they penetrate along the normal, negative down to -CONTACT_MARGIN for points which are still apart.
+ */
+struct ContactManifold
+{
+	uint32 A, B;
+	uint8 PointCount = 0;
+	HitResult Points[MAX_CONTACT_POINTS];
+};
+
+/**
+ * \brief Finds a single contact between any two shapes, with GJK when they are apart and EPA when they penetrate.
+ * \return Whether the shapes touch.
+ */
+bool CollideConvex(const Shape& shapeA, const Transform& transformA, const Shape& shapeB, const Transform& transformB, ContactManifold& manifold);
+
+/**
+ * \brief Moves a sphere of radius from start to end and finds where it first touches shape by conservative advancement over GJK distances,
+ * a radius of 0 casts a ray. T is how far along, 0 at start and 1 at end, HitNormal points from the shape towards the sphere.
+ * \return Whether the sphere touches shape before reaching end, a sphere starting on it touches it at 0.
+ */
+bool CastSphere(const float32 start[3], const float32 end[3], float32 radius, const Shape& shape, const Transform& transform, HitResult& hit);
+
+/**
+ * \brief Generates contacts for pairs of bodies. Pairs are sorted by the shapes involved, sphere-sphere, sphere-box and box-box pairs are
+ * stored 4 to a packet as structures of arrays and tested 4 at a time with SSE, the rest go one by one through dedicated capsule tests or GJK and EPA.
+ */
+class NarrowPhase
+{
+public:
+	void Initialize(uint32 capacity, const BE::PAR& allocator);
+
+	/**
+	 * \brief Queues bodies a and b to be tested by the next Collide.
+	 */
+	void AddPair(uint32 a, const Shape& shapeA, const Transform& transformA, uint32 b, const Shape& shapeB, const Transform& transformB);
+
+	/**
+	 * \brief Tests every queued pair, appends a manifold to contacts for each one that touches and clears the queue.
+	 */
+	void Collide(GTSL::Vector<ContactManifold, BE::PAR>& contacts);
+
+private:
+	static constexpr uint32 LANES = 4;
+
+	struct SphereSpherePacket
+	{
+		alignas(16) float32 CenterA[3][LANES]; float32 RadiusA[LANES];
+		float32 CenterB[3][LANES]; float32 RadiusB[LANES];
+		uint32 A[LANES], B[LANES]; uint32 Count;
+	};
+	GTSL::Vector<SphereSpherePacket, BE::PAR> sphereSpheres;
+
+	struct SphereBoxPacket
+	{
+		alignas(16) float32 Center[3][LANES]; float32 Radius[LANES];
+		float32 Position[3][LANES]; float32 Axes[3][3][LANES]; float32 HalfExtents[3][LANES];
+		uint32 A[LANES], B[LANES]; uint32 Count;
+	};
+	GTSL::Vector<SphereBoxPacket, BE::PAR> sphereBoxes;
+
+	struct BoxBoxPacket
+	{
+		alignas(16) float32 PositionA[3][LANES]; float32 AxesA[3][3][LANES]; float32 HalfExtentsA[3][LANES];
+		float32 PositionB[3][LANES]; float32 AxesB[3][3][LANES]; float32 HalfExtentsB[3][LANES];
+		uint32 A[LANES], B[LANES]; uint32 Count;
+	};
+	GTSL::Vector<BoxBoxPacket, BE::PAR> boxBoxes;
+
+	/**
+	 * \brief Pairs that involve capsules or convex hulls. ShapeA's type is never greater than ShapeB's.
+	 */
+	struct ConvexPair
+	{
+		uint32 A, B;
+		Shape ShapeA, ShapeB;
+		Transform TransformA, TransformB;
+	};
+	GTSL::Vector<ConvexPair, BE::PAR> convexPairs;
+
+	void collideSphereSpheres(GTSL::Vector<ContactManifold, BE::PAR>& contacts);
+	void collideSphereBoxes(GTSL::Vector<ContactManifold, BE::PAR>& contacts);
+	void collideBoxBoxes(GTSL::Vector<ContactManifold, BE::PAR>& contacts);
+	void collideConvexPairs(GTSL::Vector<ContactManifold, BE::PAR>& contacts);
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cmath>
+
+#include "ByteEngine/Core.h"
+
+/**
+ * \brief Three floats with the few operations the physics routines' inner loops need, which work on plain float arrays.
+ */
+struct Float3 { float32 X, Y, Z; };
+
+inline Float3 operator+(const Float3 a, const Float3 b) { return { a.X + b.X, a.Y + b.Y, a.Z + b.Z }; }
+inline Float3 operator-(const Float3 a, const Float3 b) { return { a.X - b.X, a.Y - b.Y, a.Z - b.Z }; }
+inline Float3 operator-(const Float3 a) { return { -a.X, -a.Y, -a.Z }; }
+inline Float3 operator*(const Float3 a, const float32 s) { return { a.X * s, a.Y * s, a.Z * s }; }
+
+inline float32 Dot(const Float3 a, const Float3 b) { return a.X * b.X + a.Y * b.Y + a.Z * b.Z; }
+inline Float3 Cross(const Float3 a, const Float3 b) { return { a.Y * b.Z - a.Z * b.Y, a.Z * b.X - a.X * b.Z, a.X * b.Y - a.Y * b.X }; }
+inline float32 LengthSquared(const Float3 a) { return Dot(a, a); }
+
+/**
+ * \brief Returns a unit vector perpendicular to the unit vector direction.
+ */
+inline Float3 GetPerpendicular(const Float3 direction)
+{
+	const Float3 perpendicular = std::abs(direction.X) < 0.57f ? Cross(direction, Float3{ 1.0f, 0.0f, 0.0f }) : Cross(direction, Float3{ 0.0f, 1.0f, 0.0f });
+	return perpendicular * (1.0f / std::sqrt(LengthSquared(perpendicular)));
+}
+
+inline Float3 LoadFloat3(const float32 v[3]) { return { v[0], v[1], v[2] }; }
+inline void StoreFloat3(const Float3 a, float32 v[3]) { v[0] = a.X; v[1] = a.Y; v[2] = a.Z; }
+
+/**
+ * \brief Writes the axes of a body rotated by the unit quaternion x, y, z, w, axes[0] is the body's X axis in world space.
+ */
+inline void QuaternionToAxes(const float32 q[4], float32 axes[3][3])
+{
+	const float32 x = q[0], y = q[1], z = q[2], w = q[3];
+	axes[0][0] = 1.0f - 2.0f * (y * y + z * z); axes[0][1] = 2.0f * (x * y + w * z); axes[0][2] = 2.0f * (x * z - w * y);
+	axes[1][0] = 2.0f * (x * y - w * z); axes[1][1] = 1.0f - 2.0f * (x * x + z * z); axes[1][2] = 2.0f * (y * z + w * x);
+	axes[2][0] = 2.0f * (x * z + w * y); axes[2][1] = 2.0f * (y * z - w * x); axes[2][2] = 1.0f - 2.0f * (x * x + y * y);
+}
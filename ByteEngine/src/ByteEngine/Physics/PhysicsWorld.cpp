@@ -1,31 +1,742 @@
 #include "PhysicsWorld.h"
 
+#include <cmath>
 
+#include <GTSL/Math/Math.hpp>
+
+#include "PhysicsMath.h"
 #include "ByteEngine/Application/Application.h"
 #include "ByteEngine/Resources/StaticMeshResourceManager.h"
 
+void PhysicsWorld::Initialize(const InitializeInfo& initializeInfo)
+{
+	physicsObjects.Initialize(32, GetPersistentAllocator()); updatedObjects.Initialize(32, GetPersistentAllocator()); bodies.Initialize(32, GetPersistentAllocator());
+	broadPhase.Initialize(32, GetPersistentAllocator()); narrowPhase.Initialize(32, GetPersistentAllocator()); contacts.Initialize(32, GetPersistentAllocator());
+	contactSolver.Initialize(32, GetPersistentAllocator());
+	meshVertices.Initialize(1024, GetPersistentAllocator()); meshIndices.Initialize(1024, GetPersistentAllocator());
+	staticVertices.Initialize(1024, GetPersistentAllocator()); staticIndices.Initialize(1024, GetPersistentAllocator()); staticGeometry.Initialize(1024, GetPersistentAllocator());
+	staticTriangleObjects.Initialize(1024, GetPersistentAllocator()); queryObjects.Initialize(32, GetPersistentAllocator()); queries.Initialize(GetPersistentAllocator());
+
+	initializeInfo.GameInstance->AddTask("onUpdate", Task<>::Create<PhysicsWorld, &PhysicsWorld::onUpdate>(this), GTSL::Array<TaskDependency, 1>{ { "PhysicsWorld", AccessTypes::READ_WRITE } }, "GameplayStart", "GameplayEnd"); //steps before queries are executed
+	initializeInfo.GameInstance->AddTask("executeQueries", Task<>::Create<PhysicsWorld, &PhysicsWorld::executeQueries>(this), GTSL::Array<TaskDependency, 1>{ { "PhysicsWorld", AccessTypes::READ_WRITE } }, "GameplayEnd", "RenderStart");
+
+	{
+		auto acts_on = GTSL::Array<TaskDependency, 4>{ { "PhysicsWorld", AccessTypes::READ_WRITE } };
+		onStaticMeshInfoLoadHandle = initializeInfo.GameInstance->StoreDynamicTask("onPhysicsStaticMeshInfoLoad", Task<StaticMeshResourceManager*, StaticMeshResourceManager::StaticMeshInfo, PhysicsObjectHandle>::Create<PhysicsWorld, &PhysicsWorld::onStaticMeshInfoLoaded>(this), acts_on);
+		onStaticMeshLoadHandle = initializeInfo.GameInstance->StoreDynamicTask("onPhysicsStaticMeshLoad", Task<StaticMeshResourceManager*, StaticMeshResourceManager::StaticMeshInfo, CollisionMeshLoad>::Create<PhysicsWorld, &PhysicsWorld::onStaticMeshLoaded>(this), acts_on);
+	}
+
+	if (BE::Application::Get()->GetOption(Id("broadPhaseBenchmark"), 0)) { benchmarkBroadPhase(); }
+	if (BE::Application::Get()->GetOption(Id("narrowPhaseBenchmark"), 0)) { benchmarkNarrowPhase(); }
+	if (BE::Application::Get()->GetOption(Id("rayTracingBenchmark"), 0)) { benchmarkRayTracing(); }
+	if (BE::Application::Get()->GetOption(Id("sceneQueryBenchmark"), 0)) { benchmarkSceneQueries(); }
+}
+
+void PhysicsWorld::Shutdown(const ShutdownInfo& shutdownInfo)
+{
+}
+
 PhysicsObjectHandle PhysicsWorld::AddPhysicsObject(GameInstance* gameInstance, Id meshName, StaticMeshResourceManager* staticMeshResourceManager)
 {
-	//staticMeshResourceManager->LoadStaticMesh()
-	return PhysicsObjectHandle(0);
+	const uint32 index = physicsObjects.Emplace();
+	bodies.EmplaceBack().Awake = false; //doesn't fall until it can collide
+	staticMeshResourceManager->LoadStaticMeshInfo(gameInstance, meshName, onStaticMeshInfoLoadHandle, PhysicsObjectHandle(index));
+	return PhysicsObjectHandle(index);
+}
+
+PhysicsObjectHandle PhysicsWorld::AddPhysicsObject(const GTSL::Vector3 position, const GTSL::Vector3 halfExtents)
+{
+	Shape shape; shape.Type = ShapeType::BOX;
+	shape.HalfExtents[0] = halfExtents.X(); shape.HalfExtents[1] = halfExtents.Y(); shape.HalfExtents[2] = halfExtents.Z();
+	return AddPhysicsObject(position, shape);
+}
+
+PhysicsObjectHandle PhysicsWorld::AddPhysicsObject(const GTSL::Vector3 position, const Shape& shape)
+{
+	const uint32 index = physicsObjects.Emplace();
+	auto& physicsObject = physicsObjects[index]; auto& body = bodies.EmplaceBack();
+	physicsObject.Collider = shape; body.Body.SetMass(1.0f, shape);
+	body.Position[0] = position.X(); body.Position[1] = position.Y(); body.Position[2] = position.Z();
+	for (uint8 i = 0; i < 3; ++i) { physicsObject.PreviousPosition[i] = body.Position[i]; }
+	physicsObject.Proxy = broadPhase.CreateProxy(getAABB(index), index);
+	return PhysicsObjectHandle(index);
+}
+
+void PhysicsWorld::SetPosition(const PhysicsObjectHandle physicsObject, const GTSL::Vector3 position)
+{
+	auto& body = bodies[physicsObject()];
+	body.Position[0] = position.X(); body.Position[1] = position.Y(); body.Position[2] = position.Z();
+	for (uint8 i = 0; i < 3; ++i) { physicsObjects[physicsObject()].PreviousPosition[i] = body.Position[i]; } //teleports aren't interpolated
+	staticGeometryDirty |= physicsObjects[physicsObject()].MeshIndexCount && !body.IsDynamic();
+	body.WakeUp(); updateProxy(physicsObject());
+}
+
+void PhysicsWorld::SetOrientation(const PhysicsObjectHandle physicsObject, const GTSL::Quaternion orientation)
+{
+	auto& body = bodies[physicsObject()];
+	body.Orientation[0] = orientation.X(); body.Orientation[1] = orientation.Y(); body.Orientation[2] = orientation.Z(); body.Orientation[3] = orientation.W();
+	for (uint8 i = 0; i < 4; ++i) { physicsObjects[physicsObject()].PreviousOrientation[i] = body.Orientation[i]; }
+	staticGeometryDirty |= physicsObjects[physicsObject()].MeshIndexCount && !body.IsDynamic();
+	body.WakeUp(); updateProxy(physicsObject());
+}
+
+void PhysicsWorld::SetVelocity(const PhysicsObjectHandle physicsObject, const GTSL::Vector3 velocity)
+{
+	auto& body = bodies[physicsObject()];
+	body.LinearVelocity[0] = velocity.X(); body.LinearVelocity[1] = velocity.Y(); body.LinearVelocity[2] = velocity.Z();
+	body.WakeUp();
+}
+
+void PhysicsWorld::SetAngularVelocity(const PhysicsObjectHandle physicsObject, const GTSL::Vector3 angularVelocity)
+{
+	auto& body = bodies[physicsObject()];
+	body.AngularVelocity[0] = angularVelocity.X(); body.AngularVelocity[1] = angularVelocity.Y(); body.AngularVelocity[2] = angularVelocity.Z();
+	body.WakeUp();
+}
+
+void PhysicsWorld::SetMass(const PhysicsObjectHandle physicsObject, const float32 mass)
+{
+	auto& body = bodies[physicsObject()];
+	staticGeometryDirty |= physicsObjects[physicsObject()].MeshIndexCount && body.IsDynamic() != (mass > 0.0f);
+	body.Body.SetMass(mass, physicsObjects[physicsObject()].Collider); body.WakeUp();
+	if (!body.IsDynamic()) { for (uint8 i = 0; i < 3; ++i) { body.LinearVelocity[i] = 0.0f; body.AngularVelocity[i] = 0.0f; } }
+}
+
+GTSL::Vector3 PhysicsWorld::GetPosition(const PhysicsObjectHandle physicsObject) const
+{
+	const auto& body = bodies[physicsObject()];
+	return GTSL::Vector3(body.Position[0], body.Position[1], body.Position[2]);
+}
+
+GTSL::Quaternion PhysicsWorld::GetOrientation(const PhysicsObjectHandle physicsObject) const
+{
+	const auto& body = bodies[physicsObject()];
+	return GTSL::Quaternion(body.Orientation[0], body.Orientation[1], body.Orientation[2], body.Orientation[3]);
+}
+
+GTSL::Vector3 PhysicsWorld::GetVelocity(const PhysicsObjectHandle physicsObject) const
+{
+	const auto& body = bodies[physicsObject()];
+	return GTSL::Vector3(body.LinearVelocity[0], body.LinearVelocity[1], body.LinearVelocity[2]);
+}
+
+GTSL::Vector3 PhysicsWorld::GetAngularVelocity(const PhysicsObjectHandle physicsObject) const
+{
+	const auto& body = bodies[physicsObject()];
+	return GTSL::Vector3(body.AngularVelocity[0], body.AngularVelocity[1], body.AngularVelocity[2]);
+}
+
+GTSL::Vector3 PhysicsWorld::GetInterpolatedPosition(const PhysicsObjectHandle physicsObject) const
+{
+	const auto& body = bodies[physicsObject()]; const auto& previous = physicsObjects[physicsObject()].PreviousPosition;
+	return GTSL::Vector3(previous[0] + (body.Position[0] - previous[0]) * interpolation, previous[1] + (body.Position[1] - previous[1]) * interpolation, previous[2] + (body.Position[2] - previous[2]) * interpolation);
+}
+
+GTSL::Quaternion PhysicsWorld::GetInterpolatedOrientation(const PhysicsObjectHandle physicsObject) const
+{
+	const auto& body = bodies[physicsObject()]; const auto& previous = physicsObjects[physicsObject()].PreviousOrientation;
+
+	//normalized lerp, steps are short enough for it to be as good as slerp. q and -q are the same rotation, take the short way
+	const float32 sign = previous[0] * body.Orientation[0] + previous[1] * body.Orientation[1] + previous[2] * body.Orientation[2] + previous[3] * body.Orientation[3] < 0.0f ? -1.0f : 1.0f;
+	float32 q[4]; float32 length = 0.0f;
+	for (uint8 i = 0; i < 4; ++i) { q[i] = previous[i] + (body.Orientation[i] * sign - previous[i]) * interpolation; length += q[i] * q[i]; }
+	length = std::sqrt(length);
+	return GTSL::Quaternion(q[0] / length, q[1] / length, q[2] / length, q[3] / length);
 }
 
 void PhysicsWorld::onUpdate(TaskInfo taskInfo)
 {
+	if (staticGeometryDirty) { buildStaticGeometry(); }
+
 	auto deltaMicroseconds = BE::Application::Get()->GetClock()->GetDeltaTime();
 
-	auto deltaSeconds = deltaMicroseconds.As<float32, GTSL::Seconds>();
-	
-	for(auto& e : physicsObjects)
+	accumulatedSeconds += deltaMicroseconds.As<float32, GTSL::Seconds>();
+
+	uint16 steps = 0;
+	for (; accumulatedSeconds >= fixedDeltaSeconds && steps < simSubSteps; ++steps) { step(fixedDeltaSeconds); accumulatedSeconds -= fixedDeltaSeconds; }
+
+	if (accumulatedSeconds >= fixedDeltaSeconds) { accumulatedSeconds = std::fmod(accumulatedSeconds, fixedDeltaSeconds); } //too far behind, drop whole steps
+
+	interpolation = accumulatedSeconds / fixedDeltaSeconds;
+
+	updatedObjects.ResizeDown(0);
+}
+
+void PhysicsWorld::step(const float32 deltaSeconds)
+{
+	for (uint32 i = 0; i < bodies.GetLength(); ++i)
 	{
-		e.Position = e.Velocity * deltaSeconds;
+		auto& object = physicsObjects[i]; const auto& body = bodies[i];
+		for (uint8 j = 0; j < 3; ++j) { object.PreviousPosition[j] = body.Position[j]; }
+		for (uint8 j = 0; j < 4; ++j) { object.PreviousOrientation[j] = body.Orientation[j]; }
 	}
 
-	updatedObjects.ResizeDown(0);
+	doBroadPhase(deltaSeconds);
+	doNarrowPhase();
+	solveDynamicObjects(deltaSeconds);
+}
+
+void PhysicsWorld::doBroadPhase(const float32 deltaSeconds)
+{
+	for (uint32 i = 0; i < bodies.GetLength(); ++i)
+	{
+		const auto& body = bodies[i];
+		if (physicsObjects[i].Proxy == DynamicAABBTree::NULL_NODE || !body.IsSimulated()) { continue; } //mesh info isn't loaded yet, or it didn't move
+
+		const float32 displacement[3] = { body.LinearVelocity[0] * deltaSeconds, body.LinearVelocity[1] * deltaSeconds, body.LinearVelocity[2] * deltaSeconds };
+		broadPhase.MoveProxy(physicsObjects[i].Proxy, getAABB(i), displacement);
+	}
+
+	broadPhase.UpdatePairs();
+}
+
+void PhysicsWorld::doNarrowPhase()
+{
+	for (const auto& pair : broadPhase.GetPairs())
+	{
+		const auto &bodyA = bodies[pair.A], &bodyB = bodies[pair.B];
+		if (!bodyA.IsSimulated() && !bodyB.IsSimulated()) { continue; } //neither moves, the solver remembers how they touched
+
+		narrowPhase.AddPair(pair.A, physicsObjects[pair.A].Collider, makeTransform(bodyA.Position, bodyA.Orientation), pair.B, physicsObjects[pair.B].Collider, makeTransform(bodyB.Position, bodyB.Orientation));
+	}
+
+	contacts.ResizeDown(0);
+	narrowPhase.Collide(contacts);
+}
+
+void PhysicsWorld::solveDynamicObjects(const float32 deltaSeconds)
+{
+	const float32 gravityAcceleration[3] = { gravity.X(), gravity.Y(), gravity.Z() };
+	const float32 damping = 1.0f / (1.0f + deltaSeconds * dampFactor);
+
+	//semi implicit euler, position is advanced with the solved velocity which keeps orbits and springs from gaining energy
+	contactSolver.Step(GTSL::Range<SolverBody*>(bodies.GetLength(), bodies.begin()), GetContacts(), gravityAcceleration, damping, deltaSeconds);
+}
+
+void PhysicsWorld::onStaticMeshInfoLoaded(TaskInfo taskInfo, StaticMeshResourceManager* staticMeshResourceManager, StaticMeshResourceManager::StaticMeshInfo staticMeshInfo, PhysicsObjectHandle physicsObject)
+{
+	auto& object = physicsObjects[physicsObject()];
+	//mesh bounding boxes are stored as the largest coordinate on every axis, which is the half extent of a box centered on the origin
+	object.Collider.Type = ShapeType::BOX;
+	object.Collider.HalfExtents[0] = staticMeshInfo.BoundingBox.X(); object.Collider.HalfExtents[1] = staticMeshInfo.BoundingBox.Y(); object.Collider.HalfExtents[2] = staticMeshInfo.BoundingBox.Z();
+	auto& body = bodies[physicsObject()];
+	body.Body.SetMass(body.IsDynamic() ? 1.0f / body.Body.GetInverseMass() : 0.0f, object.Collider); body.WakeUp();
+	object.Proxy = broadPhase.CreateProxy(getAABB(physicsObject()), physicsObject());
+
+	if (!staticMeshInfo.GetLODCount()) { return; }
+
+	//the full resolution LOD, what rays should hit. Meshlets aren't needed but have to be loaded somewhere
+	const uint32 meshSize = staticMeshInfo.GetVerticesSize(0) + INDEX_ALIGNMENT + staticMeshInfo.GetIndicesSize(0), meshletsSize = staticMeshInfo.GetMeshletsSize(0);
+	CollisionMeshLoad collisionMeshLoad; collisionMeshLoad.PhysicsObject = physicsObject;
+	collisionMeshLoad.Buffer.Allocate(meshSize + meshletsSize, 16, GetPersistentAllocator());
+
+	const auto buffer = GTSL::Range<byte*>(meshSize, collisionMeshLoad.Buffer.GetData()), meshletBuffer = GTSL::Range<byte*>(meshletsSize, collisionMeshLoad.Buffer.GetData() + meshSize);
+	staticMeshResourceManager->LoadStaticMesh(taskInfo.GameInstance, staticMeshInfo, 0, INDEX_ALIGNMENT, buffer, meshletBuffer, onStaticMeshLoadHandle, GTSL::MoveRef(collisionMeshLoad));
+}
+
+void PhysicsWorld::onStaticMeshLoaded(TaskInfo taskInfo, StaticMeshResourceManager* staticMeshResourceManager, StaticMeshResourceManager::StaticMeshInfo staticMeshInfo, CollisionMeshLoad collisionMeshLoad)
+{
+	auto& object = physicsObjects[collisionMeshLoad.PhysicsObject()];
+	const auto& lod = staticMeshInfo.LODs[0];
+
+	byte* vertices = collisionMeshLoad.Buffer.GetData();
+	byte* indices = GTSL::AlignPointer(INDEX_ALIGNMENT, vertices + staticMeshInfo.GetVerticesSize(0));
+
+	object.MeshVertexStart = meshVertices.GetLength() / 3; object.MeshVertexCount = lod.VertexCount;
+	object.MeshIndexStart = meshIndices.GetLength(); object.MeshIndexCount = lod.IndexCount;
+
+	//position is every vertex's first element, the rest is only for rendering
+	for (uint32 v = 0; v < lod.VertexCount; ++v) {
+		const auto* position = reinterpret_cast<const float32*>(vertices + v * staticMeshInfo.VertexSize);
+		meshVertices.EmplaceBack(position[0]); meshVertices.EmplaceBack(position[1]); meshVertices.EmplaceBack(position[2]);
+	}
+
+	for (uint32 i = 0; i < lod.IndexCount; ++i) {
+		meshIndices.EmplaceBack(lod.IndexSize == 2 ? reinterpret_cast<const uint16*>(indices)[i] : reinterpret_cast<const uint32*>(indices)[i]);
+	}
+
+	staticGeometryDirty |= !bodies[collisionMeshLoad.PhysicsObject()].IsDynamic();
+}
+
+void PhysicsWorld::buildStaticGeometry()
+{
+	staticVertices.ResizeDown(0); staticIndices.ResizeDown(0); staticTriangleObjects.ResizeDown(0);
+
+	for (uint32 i = 0; i < bodies.GetLength(); ++i)
+	{
+		const auto& object = physicsObjects[i]; const auto& body = bodies[i];
+		if (!object.MeshIndexCount || body.IsDynamic()) { continue; }
+
+		const Transform transform = makeTransform(body.Position, body.Orientation);
+		const uint32 firstVertex = staticVertices.GetLength() / 3;
+
+		for (uint32 v = object.MeshVertexStart; v < object.MeshVertexStart + object.MeshVertexCount; ++v)
+		{
+			const float32* position = &meshVertices[v * 3];
+			for (uint8 a = 0; a < 3; ++a) {
+				staticVertices.EmplaceBack(transform.Position[a] + transform.Axes[0][a] * position[0] + transform.Axes[1][a] * position[1] + transform.Axes[2][a] * position[2]);
+			}
+		}
+
+		for (uint32 t = object.MeshIndexStart; t < object.MeshIndexStart + object.MeshIndexCount; ++t) { staticIndices.EmplaceBack(firstVertex + meshIndices[t]); }
+		for (uint32 t = 0; t < object.MeshIndexCount / 3; ++t) { staticTriangleObjects.EmplaceBack(i); }
+	}
+
+	staticGeometry.Build(GTSL::Range<const float32*>(staticVertices.GetLength(), staticVertices.begin()), GTSL::Range<const uint32*>(staticIndices.GetLength(), staticIndices.begin()));
+	staticGeometryDirty = false;
+}
+
+namespace
+{
+	HitResult makeHitResult(const TriangleBVH::Hit& hit)
+	{
+		HitResult hitResult; hitResult.T = hit.T;
+		hitResult.WasHit = hit.Triangle != TriangleBVH::NULL_TRIANGLE;
+		hitResult.HitPosition = GTSL::Vector3(hit.Position[0], hit.Position[1], hit.Position[2]);
+		hitResult.HitNormal = GTSL::Vector3(hit.Normal[0], hit.Normal[1], hit.Normal[2]);
+		return hitResult;
+	}
+
+	Segment makeSegment(const GTSL::Vector3 start, const GTSL::Vector3 end) { return Segment{ { start.X(), start.Y(), start.Z() }, { end.X(), end.Y(), end.Z() } }; }
+}
+
+HitResult PhysicsWorld::TraceRay(const GTSL::Vector3 start, const GTSL::Vector3 end) const
+{
+	TriangleBVH::Hit hit;
+	if (!staticGeometry.Trace(makeSegment(start, end), hit)) { return HitResult(); }
+	return makeHitResult(hit);
 }
 
-void PhysicsWorld::onStaticMeshInfoLoaded(TaskInfo taskInfo, StaticMeshResourceManager* staticMeshResourceManager, StaticMeshResourceManager::StaticMeshInfo staticMeshInfo)
+HitResult PhysicsWorld::SweepSphere(const GTSL::Vector3 start, const GTSL::Vector3 end, const float32 radius) const
 {
-	staticMeshInfo.BoundingBox;
-	staticMeshInfo.BoundingRadius;
+	TriangleBVH::Hit hit;
+	if (!staticGeometry.SweepSphere(makeSegment(start, end), radius, hit)) { return HitResult(); }
+	return makeHitResult(hit);
+}
+
+void PhysicsWorld::SweepSpheres(const GTSL::Range<const Segment*> segments, const float32 radius, const GTSL::Range<TriangleBVH::Hit*> hits) const
+{
+	for (uint32 i = 0; i < segments.ElementCount(); ++i) { staticGeometry.SweepSphere(segments.begin()[i], radius, hits.begin()[i]); }
+}
+
+QueryHandle PhysicsWorld::QueueRaycast(const GTSL::Vector3 start, const GTSL::Vector3 end) { return queries.QueueRaycast(makeSegment(start, end)); }
+
+QueryHandle PhysicsWorld::QueueSweep(const GTSL::Vector3 start, const GTSL::Vector3 end, const float32 radius) { return queries.QueueSweep(makeSegment(start, end), radius); }
+
+QueryHandle PhysicsWorld::QueueOverlap(const Shape& shape, const GTSL::Vector3 position, const GTSL::Quaternion orientation)
+{
+	const float32 p[3] = { position.X(), position.Y(), position.Z() }, q[4] = { orientation.X(), orientation.Y(), orientation.Z(), orientation.W() };
+	return queries.QueueOverlap(shape, makeTransform(p, q));
+}
+
+void PhysicsWorld::executeQueries(TaskInfo taskInfo)
+{
+	if (!queries.GetQueuedCount()) { return; }
+
+	if (staticGeometryDirty) { buildStaticGeometry(); }
+
+	//objects without a proxy yet are never reached through the tree, their entry only keeps indices matching handles
+	queryObjects.ResizeDown(0);
+	for (uint32 i = 0; i < bodies.GetLength(); ++i)
+	{
+		const auto& object = physicsObjects[i]; const auto& body = bodies[i];
+		queryObjects.EmplaceBack(QueryObject{ object.Collider, makeTransform(body.Position, body.Orientation), object.MeshIndexCount && !body.IsDynamic() });
+	}
+
+	QueryScene scene;
+	scene.Tree = &broadPhase.GetTree(); scene.Objects = GTSL::Range<const QueryObject*>(queryObjects.GetLength(), queryObjects.begin());
+	scene.StaticGeometry = &staticGeometry; scene.StaticTriangleObjects = GTSL::Range<const uint32*>(staticTriangleObjects.GetLength(), staticTriangleObjects.begin());
+	queries.Execute(scene);
+}
+
+Transform PhysicsWorld::makeTransform(const float32 position[3], const float32 orientation[4])
+{
+	Transform transform{ { position[0], position[1], position[2] } };
+	QuaternionToAxes(orientation, transform.Axes);
+	return transform;
+}
+
+AABB PhysicsWorld::getAABB(const uint32 physicsObject) const
+{
+	const auto& body = bodies[physicsObject];
+	return GetShapeAABB(physicsObjects[physicsObject].Collider, makeTransform(body.Position, body.Orientation));
+}
+
+void PhysicsWorld::updateProxy(const uint32 physicsObject)
+{
+	if (physicsObjects[physicsObject].Proxy == DynamicAABBTree::NULL_NODE) { return; }
+	const float32 displacement[3] = { 0, 0, 0 };
+	broadPhase.MoveProxy(physicsObjects[physicsObject].Proxy, getAABB(physicsObject), displacement);
+}
+
+void PhysicsWorld::benchmarkBroadPhase()
+{
+	constexpr uint32 BODIES = 50000, STEPS = 60;
+	constexpr float32 DELTA_SECONDS = 1.0f / 60.0f, MAX_SPEED = 2.0f;
+	const float32 densities[] = { 0.001f, 0.01f, 0.1f }; //bodies per cubic meter
+
+	uint32 seed = 1;
+	auto random = [&seed]() { seed = seed * 1664525u + 1013904223u; return static_cast<float32>(seed >> 8) / 16777216.0f; };
+
+	struct Body { float32 Position[3], Velocity[3]; uint32 Proxy; };
+	GTSL::Vector<Body, BE::PAR> bodies; bodies.Initialize(BODIES, GetPersistentAllocator());
+
+	auto getBodyAABB = [](const Body& body) { AABB aabb; for (uint8 i = 0; i < 3; ++i) { aabb.Min[i] = body.Position[i] - 0.5f; aabb.Max[i] = body.Position[i] + 0.5f; } return aabb; };
+
+	for (const auto density : densities)
+	{
+		const float32 side = std::cbrt(static_cast<float32>(BODIES) / density);
+
+		BroadPhase benchmarkBroadPhase; benchmarkBroadPhase.Initialize(BODIES, GetPersistentAllocator());
+		bodies.ResizeDown(0);
+
+		for (uint32 b = 0; b < BODIES; ++b)
+		{
+			auto& body = bodies.EmplaceBack();
+			for (uint8 i = 0; i < 3; ++i) { body.Position[i] = random() * side; body.Velocity[i] = (random() * 2.0f - 1.0f) * MAX_SPEED; }
+			body.Proxy = benchmarkBroadPhase.CreateProxy(getBodyAABB(body), b);
+		}
+
+		benchmarkBroadPhase.UpdatePairs(); //building the pairs from scratch isn't what a frame costs
+
+		uint64 pairs = 0;
+		const auto start = BE::Application::Get()->GetClock()->GetCurrentMicroseconds();
+
+		for (uint32 s = 0; s < STEPS; ++s)
+		{
+			for (auto& body : bodies)
+			{
+				float32 displacement[3];
+				for (uint8 i = 0; i < 3; ++i) { displacement[i] = body.Velocity[i] * DELTA_SECONDS; body.Position[i] += displacement[i]; }
+				benchmarkBroadPhase.MoveProxy(body.Proxy, getBodyAABB(body), displacement);
+			}
+
+			benchmarkBroadPhase.UpdatePairs();
+			pairs += benchmarkBroadPhase.GetPairs().ElementCount();
+		}
+
+		const float32 milliseconds = (BE::Application::Get()->GetClock()->GetCurrentMicroseconds() - start).As<float32, GTSL::Seconds>() * 1000.0f;
+		BE_LOG_MESSAGE("Broad phase, ", BODIES, " moving bodies at ", density, " bodies per cubic meter: ", pairs / STEPS, " pairs per step, ", milliseconds / STEPS, " ms per step, ", static_cast<float32>(pairs) / milliseconds, " pairs per ms");
+	}
+}
+
+void PhysicsWorld::benchmarkNarrowPhase()
+{
+	constexpr uint32 PAIRS = 4096, REPETITIONS = 64;
+
+	uint32 seed = 1;
+	auto random = [&seed]() { seed = seed * 1664525u + 1013904223u; return static_cast<float32>(seed >> 8) / 16777216.0f; };
+	auto randomRange = [&](const float32 min, const float32 max) { return min + random() * (max - min); };
+
+	auto randomTransform = [&](const bool rotate) {
+		float32 q[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+		if (rotate) {
+			float32 length = 0.0f;
+			for (auto& e : q) { e = randomRange(-1.0f, 1.0f); length += e * e; }
+			length = std::sqrt(length); for (auto& e : q) { e /= length; }
+		}
+
+		const float32 position[3] = { randomRange(-1.5f, 1.5f), randomRange(-1.5f, 1.5f), randomRange(-1.5f, 1.5f) };
+		return makeTransform(position, q);
+	};
+
+	auto makeSphere = [&]() { Shape shape; shape.Type = ShapeType::SPHERE; shape.Radius = randomRange(0.2f, 1.0f); return shape; };
+	auto makeBox = [&]() { Shape shape; shape.Type = ShapeType::BOX; for (auto& e : shape.HalfExtents) { e = randomRange(0.2f, 1.0f); } return shape; };
+	auto makeCapsule = [&]() { Shape shape; shape.Type = ShapeType::CAPSULE; shape.HalfExtents[1] = randomRange(0.2f, 1.0f); shape.Radius = randomRange(0.1f, 0.5f); return shape; };
+
+	//box hull, to test the box kernel against GJK going through hull vertices
+	float32 hullVertices[8 * 3];
+	for (uint32 v = 0; v < 8; ++v) { hullVertices[v * 3] = v & 1 ? 0.5f : -0.5f; hullVertices[v * 3 + 1] = v & 2 ? 0.7f : -0.7f; hullVertices[v * 3 + 2] = v & 4 ? 0.3f : -0.3f; }
+	const ConvexHull hull{ hullVertices, 8 };
+	Shape hullBox; hullBox.Type = ShapeType::BOX; hullBox.HalfExtents[0] = 0.5f; hullBox.HalfExtents[1] = 0.7f; hullBox.HalfExtents[2] = 0.3f;
+	Shape hullShape; hullShape.Type = ShapeType::CONVEX_HULL; hullShape.Hull = &hull;
+
+	/**
+	 * \brief Pair as tested by the narrow phase, and ReferenceA, the shape GJK and EPA test instead of A.
+	 */
+	struct Case { Shape A, B, ReferenceA; Transform TransformA, TransformB; };
+	GTSL::Vector<Case, BE::PAR> cases; cases.Initialize(PAIRS, GetPersistentAllocator());
+	GTSL::Vector<ContactManifold, BE::PAR> benchmarkContacts; benchmarkContacts.Initialize(PAIRS, GetPersistentAllocator());
+	NarrowPhase benchmarkNarrowPhase; benchmarkNarrowPhase.Initialize(PAIRS, GetPersistentAllocator());
+
+	auto measure = [&](const char* name, auto&& makeCase) {
+		cases.ResizeDown(0);
+		for (uint32 i = 0; i < PAIRS; ++i) { auto& c = cases.EmplaceBack(); makeCase(c); }
+
+		//the deepest point of every manifold against the single contact GJK and EPA find
+		float32 maxDepthError = 0.0f, depthErrorSum = 0.0f; uint32 compared = 0, missed = 0, normalMismatches = 0;
+
+		for (const auto& c : cases)
+		{
+			benchmarkContacts.ResizeDown(0);
+			benchmarkNarrowPhase.AddPair(0, c.A, c.TransformA, 1, c.B, c.TransformB); benchmarkNarrowPhase.Collide(benchmarkContacts);
+
+			ContactManifold reference; reference.PointCount = 0;
+			if (!CollideConvex(c.ReferenceA, c.TransformA, c.B, c.TransformB, reference)) { continue; }
+
+			if (!benchmarkContacts.GetLength()) { missed += reference.Points[0].T > 1e-3f; continue; }
+
+			const auto& manifold = benchmarkContacts[0];
+			uint8 deepest = 0;
+			for (uint8 p = 1; p < manifold.PointCount; ++p) { if (manifold.Points[p].T > manifold.Points[deepest].T) { deepest = p; } }
+
+			const float32 depthError = GTSL::Math::Abs(manifold.Points[deepest].T - reference.Points[0].T);
+			maxDepthError = GTSL::Math::Max(maxDepthError, depthError); depthErrorSum += depthError; ++compared;
+			normalMismatches += GTSL::Math::DotProduct(manifold.Points[deepest].HitNormal, reference.Points[0].HitNormal) < 0.99f;
+		}
+
+		const auto start = BE::Application::Get()->GetClock()->GetCurrentMicroseconds();
+
+		for (uint32 r = 0; r < REPETITIONS; ++r)
+		{
+			benchmarkContacts.ResizeDown(0);
+			for (const auto& c : cases) { benchmarkNarrowPhase.AddPair(0, c.A, c.TransformA, 1, c.B, c.TransformB); }
+			benchmarkNarrowPhase.Collide(benchmarkContacts);
+		}
+
+		const float32 seconds = (BE::Application::Get()->GetClock()->GetCurrentMicroseconds() - start).As<float32, GTSL::Seconds>();
+
+		BE_LOG_MESSAGE("Narrow phase, ", name, ": ", compared, " contacts compared to GJK-EPA, max depth error ", maxDepthError, " m, mean depth error ", compared ? depthErrorSum / compared : 0.0f,
+			" m, ", normalMismatches, " normals off by more than 8 degrees, ", missed, " missed contacts. ", static_cast<float32>(PAIRS * REPETITIONS) / seconds, " pairs per second");
+	};
+
+	measure("sphere-sphere", [&](Case& c) { c.A = makeSphere(); c.B = makeSphere(); c.ReferenceA = c.A; c.TransformA = randomTransform(false); c.TransformB = randomTransform(false); });
+	measure("sphere-box", [&](Case& c) { c.A = makeSphere(); c.B = makeBox(); c.ReferenceA = c.A; c.TransformA = randomTransform(false); c.TransformB = randomTransform(true); });
+	measure("box-box", [&](Case& c) { c.A = makeBox(); c.B = makeBox(); c.ReferenceA = c.A; c.TransformA = randomTransform(true); c.TransformB = randomTransform(true); });
+	measure("box-box against hull", [&](Case& c) { c.A = hullBox; c.B = makeBox(); c.ReferenceA = hullShape; c.TransformA = randomTransform(true); c.TransformB = randomTransform(true); });
+	measure("sphere-capsule", [&](Case& c) { c.A = makeSphere(); c.B = makeCapsule(); c.ReferenceA = c.A; c.TransformA = randomTransform(false); c.TransformB = randomTransform(true); });
+	measure("capsule-capsule", [&](Case& c) { c.A = makeCapsule(); c.B = makeCapsule(); c.ReferenceA = c.A; c.TransformA = randomTransform(true); c.TransformB = randomTransform(true); });
+	measure("hull-box", [&](Case& c) { c.A = makeBox(); c.B = hullShape; c.ReferenceA = c.A; c.TransformA = randomTransform(true); c.TransformB = randomTransform(true); });
+}
+
+void PhysicsWorld::benchmarkRayTracing()
+{
+	constexpr uint32 TERRAIN_SIDE = 200, BOXES = 300, AGENTS = 2000, TARGETS = 4, RANDOM_RAYS = 8192, REPETITIONS = 8;
+	constexpr float32 SWEEP_RADIUS = 0.4f;
+
+	uint32 seed = 1;
+	auto random = [&seed]() { seed = seed * 1664525u + 1013904223u; return static_cast<float32>(seed >> 8) / 16777216.0f; };
+	auto randomRange = [&](const float32 min, const float32 max) { return min + random() * (max - min); };
+
+	GTSL::Vector<float32, BE::PAR> vertices; vertices.Initialize((TERRAIN_SIDE * TERRAIN_SIDE + BOXES * 6) * 4 * 3, GetPersistentAllocator());
+	GTSL::Vector<uint32, BE::PAR> indices; indices.Initialize((TERRAIN_SIDE * TERRAIN_SIDE + BOXES * 6) * 6, GetPersistentAllocator());
+
+	auto addQuad = [&](const Float3 a, const Float3 b, const Float3 c, const Float3 d) {
+		const uint32 first = vertices.GetLength() / 3;
+		for (const auto& p : { a, b, c, d }) { vertices.EmplaceBack(p.X); vertices.EmplaceBack(p.Y); vertices.EmplaceBack(p.Z); }
+		for (const uint32 i : { 0u, 1u, 2u, 0u, 2u, 3u }) { indices.EmplaceBack(first + i); }
+	};
+
+	//rolling terrain with boxes on it the crowd can hide behind
+	auto height = [](const float32 x, const float32 z) { return std::sin(x * 0.1f) * std::cos(z * 0.13f) * 2.0f; };
+	for (uint32 z = 0; z < TERRAIN_SIDE; ++z) {
+		for (uint32 x = 0; x < TERRAIN_SIDE; ++x) {
+			const float32 x0 = static_cast<float32>(x), z0 = static_cast<float32>(z), x1 = x0 + 1.0f, z1 = z0 + 1.0f;
+			addQuad({ x0, height(x0, z0), z0 }, { x0, height(x0, z1), z1 }, { x1, height(x1, z1), z1 }, { x1, height(x1, z0), z0 });
+		}
+	}
+
+	for (uint32 b = 0; b < BOXES; ++b)
+	{
+		const Float3 center{ randomRange(0.0f, TERRAIN_SIDE), randomRange(0.0f, 3.0f), randomRange(0.0f, TERRAIN_SIDE) }, half{ randomRange(0.3f, 3.0f), randomRange(0.5f, 4.0f), randomRange(0.3f, 3.0f) };
+		Float3 p[8];
+		for (uint32 i = 0; i < 8; ++i) { p[i] = { center.X + (i & 1 ? half.X : -half.X), center.Y + (i & 2 ? half.Y : -half.Y), center.Z + (i & 4 ? half.Z : -half.Z) }; }
+		addQuad(p[0], p[1], p[3], p[2]); addQuad(p[4], p[6], p[7], p[5]); addQuad(p[0], p[4], p[5], p[1]); addQuad(p[2], p[3], p[7], p[6]); addQuad(p[0], p[2], p[6], p[4]); addQuad(p[1], p[5], p[7], p[3]);
+	}
+
+	TriangleBVH bvh; bvh.Initialize(indices.GetLength() / 3, GetPersistentAllocator());
+
+	const auto buildStart = BE::Application::Get()->GetClock()->GetCurrentMicroseconds();
+	bvh.Build(GTSL::Range<const float32*>(vertices.GetLength(), vertices.begin()), GTSL::Range<const uint32*>(indices.GetLength(), indices.begin()));
+	const float32 buildMilliseconds = (BE::Application::Get()->GetClock()->GetCurrentMicroseconds() - buildStart).As<float32, GTSL::Seconds>() * 1000.0f;
+	BE_LOG_MESSAGE("Ray tracing, ", bvh.GetTriangleCount(), " triangles: ", bvh.GetNodeCount(), " nodes built in ", buildMilliseconds, " ms");
+
+	//every agent checks line of sight to every target, agents are in no particular order as gameplay code would submit them
+	GTSL::Vector<Segment, BE::PAR> lineOfSight; lineOfSight.Initialize(AGENTS * TARGETS, GetPersistentAllocator());
+	Float3 targets[TARGETS];
+	for (auto& target : targets) { target = { randomRange(0.0f, TERRAIN_SIDE), 4.0f, randomRange(0.0f, TERRAIN_SIDE) }; }
+	for (uint32 a = 0; a < AGENTS; ++a) {
+		const Float3 eye{ randomRange(0.0f, TERRAIN_SIDE), 3.5f, randomRange(0.0f, TERRAIN_SIDE) };
+		for (const auto& target : targets) { auto& segment = lineOfSight.EmplaceBack(); StoreFloat3(eye, segment.Start); StoreFloat3(target, segment.End); }
+	}
+
+	GTSL::Vector<Segment, BE::PAR> randomRays; randomRays.Initialize(RANDOM_RAYS, GetPersistentAllocator());
+	for (uint32 r = 0; r < RANDOM_RAYS; ++r) {
+		auto& segment = randomRays.EmplaceBack();
+		StoreFloat3({ randomRange(0.0f, TERRAIN_SIDE), randomRange(0.0f, 6.0f), randomRange(0.0f, TERRAIN_SIDE) }, segment.Start);
+		StoreFloat3({ randomRange(0.0f, TERRAIN_SIDE), randomRange(0.0f, 6.0f), randomRange(0.0f, TERRAIN_SIDE) }, segment.End);
+	}
+
+	GTSL::Vector<TriangleBVH::Hit, BE::PAR> hits; hits.Initialize(AGENTS * TARGETS + RANDOM_RAYS, GetPersistentAllocator());
+	GTSL::Vector<bool, BE::PAR> occluded; occluded.Initialize(AGENTS * TARGETS + RANDOM_RAYS, GetPersistentAllocator());
+
+	//closest hit by testing every triangle, what the tree must agree with
+	auto traceEveryTriangle = [&](const Segment& segment, float32& t) {
+		const Float3 origin = LoadFloat3(segment.Start), direction = LoadFloat3(segment.End) - origin;
+		t = 1.0f; bool hit = false;
+
+		for (uint32 i = 0; i < indices.GetLength(); i += 3)
+		{
+			const Float3 a = LoadFloat3(&vertices[indices[i] * 3]), edge1 = LoadFloat3(&vertices[indices[i + 1] * 3]) - a, edge2 = LoadFloat3(&vertices[indices[i + 2] * 3]) - a;
+			const Float3 p = Cross(direction, edge2); const float32 determinant = Dot(edge1, p);
+			if (std::abs(determinant) < 1e-20f) { continue; }
+
+			const Float3 s = origin - a, q = Cross(s, edge1);
+			const float32 u = Dot(s, p) / determinant, v = Dot(direction, q) / determinant, distance = Dot(edge2, q) / determinant;
+			if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && distance >= 0.0f && distance < t) { t = distance; hit = true; }
+		}
+
+		return hit;
+	};
+
+	auto measure = [&](const char* name, const GTSL::Vector<Segment, BE::PAR>& segments) {
+		const uint32 count = segments.GetLength();
+		const auto segmentRange = GTSL::Range<const Segment*>(count, segments.begin());
+		hits.Resize(count); occluded.Resize(count);
+		const auto hitRange = GTSL::Range<TriangleBVH::Hit*>(count, hits.begin()); const auto occludedRange = GTSL::Range<bool*>(count, occluded.begin());
+
+		bvh.Trace(segmentRange, hitRange); bvh.IsOccluded(segmentRange, occludedRange);
+
+		uint32 compared = 0, mismatches = 0, blocked = 0;
+		for (uint32 i = 0; i < count; i += 16, ++compared)
+		{
+			float32 t; const bool hit = traceEveryTriangle(segments[i], t);
+			TriangleBVH::Hit single; const bool singleHit = bvh.Trace(segments[i], single);
+			mismatches += hit != singleHit || (hit && GTSL::Math::Abs(single.T - t) > 1e-5f);
+			mismatches += hit != (hits[i].Triangle != TriangleBVH::NULL_TRIANGLE) || (hit && GTSL::Math::Abs(hits[i].T - t) > 1e-5f);
+			mismatches += hit != occluded[i] || hit != bvh.IsOccluded(segments[i]);
+			blocked += hit;
+		}
+
+		auto raysPerSecond = [&](auto&& trace) {
+			const auto start = BE::Application::Get()->GetClock()->GetCurrentMicroseconds();
+			for (uint32 r = 0; r < REPETITIONS; ++r) { trace(); }
+			return static_cast<float32>(count * REPETITIONS) / (BE::Application::Get()->GetClock()->GetCurrentMicroseconds() - start).As<float32, GTSL::Seconds>();
+		};
+
+		uint32 sweepHits = 0;
+		const float32 closestSingle = raysPerSecond([&]() { for (const auto& segment : segments) { TriangleBVH::Hit hit; bvh.Trace(segment, hit); } });
+		const float32 closestPackets = raysPerSecond([&]() { bvh.Trace(segmentRange, hitRange); });
+		const float32 anySingle = raysPerSecond([&]() { for (const auto& segment : segments) { occluded[0] = bvh.IsOccluded(segment); } });
+		const float32 anyPackets = raysPerSecond([&]() { bvh.IsOccluded(segmentRange, occludedRange); });
+		const float32 sweeps = raysPerSecond([&]() { sweepHits = 0; for (const auto& segment : segments) { TriangleBVH::Hit hit; sweepHits += bvh.SweepSphere(segment, SWEEP_RADIUS, hit); } });
+
+		BE_LOG_MESSAGE("Ray tracing, ", name, ": ", compared, " rays compared to testing every triangle, ", blocked, " blocked, ", mismatches, " mismatches. Rays per second, closest hit one by one ", closestSingle,
+			", in packets ", closestPackets, ", any hit one by one ", anySingle, ", in packets ", anyPackets, ". Sphere sweeps per second ", sweeps, ", ", sweepHits, " hit");
+	};
+
+	measure("crowd line of sight", lineOfSight);
+	measure("random rays", randomRays);
+}
+
+void PhysicsWorld::benchmarkSceneQueries()
+{
+	constexpr uint32 TERRAIN_SIDE = 200, OBJECTS = 5000, RAYCASTS = 16384, SWEEPS = 4096, OVERLAPS = 4096, ONE_BY_ONE_STRIDE = 8;
+
+	uint32 seed = 1;
+	auto random = [&seed]() { seed = seed * 1664525u + 1013904223u; return static_cast<float32>(seed >> 8) / 16777216.0f; };
+	auto randomRange = [&](const float32 min, const float32 max) { return min + random() * (max - min); };
+	auto randomPoint = [&](const float32 minHeight, const float32 maxHeight) { return Float3{ randomRange(0.0f, TERRAIN_SIDE), randomRange(minHeight, maxHeight), randomRange(0.0f, TERRAIN_SIDE) }; };
+	auto randomShape = [&]() {
+		Shape shape; shape.Type = static_cast<ShapeType>(static_cast<uint32>(random() * 3.0f) % 3); shape.Radius = randomRange(0.2f, 1.0f);
+		for (auto& e : shape.HalfExtents) { e = randomRange(0.2f, 1.5f); }
+		return shape;
+	};
+	auto randomTransform = [&]() {
+		float32 q[4] = { randomRange(-1.0f, 1.0f), randomRange(-1.0f, 1.0f), randomRange(-1.0f, 1.0f), randomRange(-1.0f, 1.0f) };
+		const float32 length = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]); for (auto& e : q) { e /= length; }
+		float32 p[3]; StoreFloat3(randomPoint(0.5f, 5.0f), p);
+		return makeTransform(p, q);
+	};
+
+	//objects scattered over flat ground, the ground is static geometry and it's object a thin box
+	GTSL::Vector<QueryObject, BE::PAR> objects; objects.Initialize(OBJECTS + 1, GetPersistentAllocator());
+	DynamicAABBTree tree; tree.Initialize(OBJECTS + 1, GetPersistentAllocator());
+	for (uint32 o = 0; o < OBJECTS; ++o) { auto& object = objects.EmplaceBack(QueryObject{ randomShape(), randomTransform(), false }); tree.CreateProxy(GetShapeAABB(object.Collider, object.Pose), o); }
+
+	{
+		constexpr float32 HALF_SIDE = TERRAIN_SIDE * 0.5f;
+		Shape ground; ground.Type = ShapeType::BOX; ground.HalfExtents[0] = HALF_SIDE; ground.HalfExtents[1] = 0.01f; ground.HalfExtents[2] = HALF_SIDE;
+		const float32 position[3] = { HALF_SIDE, -0.01f, HALF_SIDE }, orientation[4] = { 0, 0, 0, 1 };
+		auto& object = objects.EmplaceBack(QueryObject{ ground, makeTransform(position, orientation), true }); tree.CreateProxy(GetShapeAABB(object.Collider, object.Pose), OBJECTS);
+	}
+
+	const float32 groundVertices[] = { 0, 0, 0, 0, 0, TERRAIN_SIDE, TERRAIN_SIDE, 0, TERRAIN_SIDE, TERRAIN_SIDE, 0, 0 };
+	const uint32 groundIndices[] = { 0, 1, 2, 0, 2, 3 }, groundTriangleObjects[] = { OBJECTS, OBJECTS };
+	TriangleBVH ground; ground.Initialize(2, GetPersistentAllocator());
+	ground.Build(GTSL::Range<const float32*>(12, groundVertices), GTSL::Range<const uint32*>(6, groundIndices));
+
+	QueryScene scene;
+	scene.Tree = &tree; scene.Objects = GTSL::Range<const QueryObject*>(objects.GetLength(), objects.begin());
+	scene.StaticGeometry = &ground; scene.StaticTriangleObjects = GTSL::Range<const uint32*>(2, groundTriangleObjects);
+
+	//short rays and sweeps like gameplay casts, weapons and movement, and overlaps around random points
+	struct BenchmarkQuery { Segment Path; float32 Radius; Shape Collider; Transform Pose; QueryHandle Handle; };
+	GTSL::Vector<BenchmarkQuery, BE::PAR> benchmarkQueries; benchmarkQueries.Initialize(RAYCASTS + SWEEPS + OVERLAPS, GetPersistentAllocator());
+	for (uint32 q = 0; q < RAYCASTS + SWEEPS + OVERLAPS; ++q) {
+		auto& query = benchmarkQueries.EmplaceBack();
+		const Float3 start = randomPoint(0.0f, 6.0f);
+		StoreFloat3(start, query.Path.Start); StoreFloat3(start + Float3{ randomRange(-20.0f, 20.0f), randomRange(-6.0f, 2.0f), randomRange(-20.0f, 20.0f) }, query.Path.End);
+		query.Radius = q < RAYCASTS ? 0.0f : randomRange(0.1f, 0.6f);
+		query.Collider = randomShape(); query.Pose = randomTransform();
+	}
+
+	SceneQueries sceneQueries; sceneQueries.Initialize(GetPersistentAllocator());
+
+	auto queue = [&](BenchmarkQuery& query, const uint32 q) {
+		if (q < RAYCASTS) { query.Handle = sceneQueries.QueueRaycast(query.Path); }
+		else if (q < RAYCASTS + SWEEPS) { query.Handle = sceneQueries.QueueSweep(query.Path, query.Radius); }
+		else { query.Handle = sceneQueries.QueueOverlap(query.Collider, query.Pose); }
+	};
+
+	auto seconds = [](auto&& function) {
+		const auto start = BE::Application::Get()->GetClock()->GetCurrentMicroseconds(); function();
+		return (BE::Application::Get()->GetClock()->GetCurrentMicroseconds() - start).As<float32, GTSL::Seconds>();
+	};
+
+	//every eighth query executed on it's own, what running queries as soon as they are asked for would cost
+	const float32 oneByOneSeconds = seconds([&]() {
+		for (uint32 q = 0; q < benchmarkQueries.GetLength(); q += ONE_BY_ONE_STRIDE) { queue(benchmarkQueries[q], q); sceneQueries.Execute(scene); }
+	}) * ONE_BY_ONE_STRIDE;
+
+	const float32 queueSeconds = seconds([&]() { for (uint32 q = 0; q < benchmarkQueries.GetLength(); ++q) { queue(benchmarkQueries[q], q); } });
+	const float32 executeSeconds = seconds([&]() { sceneQueries.Execute(scene); });
+
+	//closest hit and touched objects by testing every object, what batched queries must agree with. Starting inside several objects ties at 0
+	uint32 compared = 0, mismatches = 0, hits = 0, touched = 0;
+	for (uint32 q = 0; q < benchmarkQueries.GetLength(); q += 16, ++compared)
+	{
+		const auto& query = benchmarkQueries[q];
+
+		if (q < RAYCASTS + SWEEPS)
+		{
+			QueryHit closest; TriangleBVH::Hit triangleHit;
+			if (q < RAYCASTS ? ground.Trace(query.Path, triangleHit) : ground.SweepSphere(query.Path, query.Radius, triangleHit)) { closest.Object = OBJECTS; closest.T = triangleHit.T; }
+			for (uint32 o = 0; o < OBJECTS; ++o) {
+				HitResult hitResult;
+				if (CastSphere(query.Path.Start, query.Path.End, query.Radius, objects[o].Collider, objects[o].Pose, hitResult) && hitResult.T < closest.T) { closest.Object = o; closest.T = hitResult.T; }
+			}
+
+			const auto& hit = sceneQueries.GetHit(query.Handle);
+			mismatches += hit.WasHit() != closest.WasHit() || GTSL::Math::Abs(hit.T - closest.T) > 1e-5f || (hit.Object != closest.Object && hit.T > 0.0f);
+			hits += hit.WasHit();
+		}
+		else
+		{
+			const auto overlaps = sceneQueries.GetOverlaps(query.Handle);
+			uint32 expected = 0;
+			for (uint32 o = 0; o < objects.GetLength(); ++o) {
+				ContactManifold manifold;
+				if (!CollideConvex(query.Collider, query.Pose, objects[o].Collider, objects[o].Pose, manifold)) { continue; }
+				++expected; bool found = false;
+				for (const uint32 object : overlaps) { found |= object == o; }
+				mismatches += !found;
+			}
+			mismatches += expected != overlaps.ElementCount(); touched += expected;
+		}
+	}
+
+	const float32 count = static_cast<float32>(benchmarkQueries.GetLength());
+	BE_LOG_MESSAGE("Scene queries, ", OBJECTS, " objects, ", RAYCASTS, " raycasts, ", SWEEPS, " sweeps, ", OVERLAPS, " overlaps: ", compared, " compared to testing every object, ", hits, " hit, ", touched, " objects touched, ",
+		mismatches, " mismatches. Queries per second one by one ", count / oneByOneSeconds, ", batched ", count / executeSeconds, ", queueing ", queueSeconds / count * 1e9f, " ns per query");
 }
@@ -1,12 +1,18 @@
 #pragma once
 
+#include <GTSL/Buffer.hpp>
 #include <GTSL/KeepVector.h>
 #include <GTSL/Math/Vector3.h>
-#include <GTSL/Math/Vector4.h>
+#include <GTSL/Math/Quaternion.h>
 
 
 
+#include "BroadPhase.h"
+#include "ContactSolver.h"
 #include "HitResult.h"
+#include "NarrowPhase.h"
+#include "Queries.h"
+#include "TriangleBVH.h"
 #include "ByteEngine/Game/System.h"
 #include "ByteEngine/Handle.hpp"
 #include "ByteEngine/Game/GameInstance.h"
@@ -18,23 +24,120 @@ MAKE_HANDLE(uint32, PhysicsObject);
 class PhysicsWorld : public System
 {
 public:
-	void Initialize(const InitializeInfo& initializeInfo) override
-	{
-		physicsObjects.Initialize(32, GetPersistentAllocator()); updatedObjects.Initialize(32, GetPersistentAllocator());
-		initializeInfo.GameInstance->AddTask("onUpdate", Task<>::Create<PhysicsWorld, &PhysicsWorld::onUpdate>(this), {}, "FrameUpdate", "RenderStart");
-	}
-	
+	void Initialize(const InitializeInfo& initializeInfo) override;
 	void Shutdown(const ShutdownInfo& shutdownInfo) override;
 
+	/**
+	 * \brief Adds an object shaped like the mesh's bounding box. It takes part in collision once the mesh's info is loaded.
+	 * The mesh's full resolution triangles are loaded too, while the object is static they are what ray and sweep queries hit.
+	 */
 	PhysicsObjectHandle AddPhysicsObject(GameInstance* gameInstance, Id meshName, StaticMeshResourceManager* staticMeshResourceManager);
 
+	/**
+	 * \brief Adds a box shaped object.
+	 */
+	PhysicsObjectHandle AddPhysicsObject(GTSL::Vector3 position, GTSL::Vector3 halfExtents);
+
+	/**
+	 * \brief Adds an object with any shape. Convex hulls are referenced, not copied, and must outlive the object.
+	 */
+	PhysicsObjectHandle AddPhysicsObject(GTSL::Vector3 position, const Shape& shape);
+
+	/**
+	 * \brief Teleports the object and wakes it up.
+	 */
+	void SetPosition(PhysicsObjectHandle physicsObject, GTSL::Vector3 position);
+	void SetOrientation(PhysicsObjectHandle physicsObject, GTSL::Quaternion orientation);
+	void SetVelocity(PhysicsObjectHandle physicsObject, GTSL::Vector3 velocity);
+	void SetAngularVelocity(PhysicsObjectHandle physicsObject, GTSL::Vector3 angularVelocity);
+
+	/**
+	 * \brief Sets the object's mass, inertia follows from it's shape. A mass of 0 makes the object static. Objects have a mass of 1 by default.
+	 */
+	void SetMass(PhysicsObjectHandle physicsObject, float32 mass);
+	void SetFriction(const PhysicsObjectHandle physicsObject, const float32 friction) { bodies[physicsObject()].Body.SetFriction(friction); }
+	void SetRestitution(const PhysicsObjectHandle physicsObject, const float32 restitution) { bodies[physicsObject()].Body.SetRestitution(restitution); }
+
+	[[nodiscard]] GTSL::Vector3 GetPosition(PhysicsObjectHandle physicsObject) const;
+	[[nodiscard]] GTSL::Quaternion GetOrientation(PhysicsObjectHandle physicsObject) const;
+	[[nodiscard]] GTSL::Vector3 GetVelocity(PhysicsObjectHandle physicsObject) const;
+	[[nodiscard]] GTSL::Vector3 GetAngularVelocity(PhysicsObjectHandle physicsObject) const;
+	[[nodiscard]] bool IsAwake(const PhysicsObjectHandle physicsObject) const { return bodies[physicsObject()].Awake; }
+
+	/**
+	 * \brief Returns where the object is between the last two steps at this frame's time, what it should be drawn at.
+	 */
+	[[nodiscard]] GTSL::Vector3 GetInterpolatedPosition(PhysicsObjectHandle physicsObject) const;
+	[[nodiscard]] GTSL::Quaternion GetInterpolatedOrientation(PhysicsObjectHandle physicsObject) const;
+
+	/**
+	 * \brief Returns the pairs of objects whose bounding boxes may overlap as of the last update, A and B are PhysicsObjectHandle values.
+	 */
+	[[nodiscard]] GTSL::Range<const BroadPhase::Pair*> GetOverlappingPairs() const { return broadPhase.GetPairs(); }
+
+	/**
+	 * \brief Returns the contacts between objects as of the last update, A and B are PhysicsObjectHandle values.
+	 */
+	[[nodiscard]] GTSL::Range<const ContactManifold*> GetContacts() const { return GTSL::Range<const ContactManifold*>(contacts.GetLength(), contacts.begin()); }
+
 	void SetGravity(const GTSL::Vector3 newGravity) { gravity = newGravity; }
 	void SetDampFactor(const float32 newDampFactor) { dampFactor = newDampFactor; }
+	void SetFixedDeltaTime(const float32 newFixedDeltaSeconds) { fixedDeltaSeconds = newFixedDeltaSeconds; }
+	void SetSimSubSteps(const uint16 newSimSubSteps) { simSubSteps = newSimSubSteps; }
 
 	[[nodiscard]] auto GetGravity() const { return gravity; }
 	[[nodiscard]] auto GetAirDensity() const { return dampFactor; }
 
-	HitResult TraceRay(const GTSL::Vector3 start, const GTSL::Vector3 end);
+	/**
+	 * \brief Finds the closest static mesh triangle between start and end. T is how far along, 0 at start and 1 at end.
+	 * Queries see static geometry as of the last update, mesh objects loaded, moved or made static since are traced against from the next one.
+	 */
+	[[nodiscard]] HitResult TraceRay(GTSL::Vector3 start, GTSL::Vector3 end) const;
+
+	/**
+	 * \brief Finds the first static mesh triangle a sphere of radius touches moving from start to end. A sphere starting on one hits it at 0.
+	 */
+	[[nodiscard]] HitResult SweepSphere(GTSL::Vector3 start, GTSL::Vector3 end, float32 radius) const;
+
+	/**
+	 * \brief Traces every segment against static geometry, hits[i] is segments[i]'s. Segments are traced in SIMD packets of close by
+	 * segments going the same way, which is several times faster than tracing them one by one when many are cast from and to the same places.
+	 */
+	void TraceRays(GTSL::Range<const Segment*> segments, GTSL::Range<TriangleBVH::Hit*> hits) const { staticGeometry.Trace(segments, hits); }
+
+	/**
+	 * \brief Sets occluded[i] to whether static geometry blocks segments[i], stopping at the first triangle found. What line of sight checks should use.
+	 */
+	void TestOcclusion(GTSL::Range<const Segment*> segments, GTSL::Range<bool*> occluded) const { staticGeometry.IsOccluded(segments, occluded); }
+
+	void SweepSpheres(GTSL::Range<const Segment*> segments, float32 radius, GTSL::Range<TriangleBVH::Hit*> hits) const;
+
+	/**
+	 * \brief Queues a raycast against every object, static mesh objects are hit by their triangles and the rest by their shape.
+	 * Queued queries run together at the end of gameplay, their results can be read with the handle from then until the next frame's
+	 * gameplay ends, reading it at any other time asserts. Queueing only touches the calling thread's buffer, tasks which queue queries only need read access to PhysicsWorld.
+	 */
+	QueryHandle QueueRaycast(GTSL::Vector3 start, GTSL::Vector3 end);
+
+	/**
+	 * \brief Queues a sweep of a sphere of radius against every object, like QueueRaycast. A sphere starting on an object hits it at 0.
+	 */
+	QueryHandle QueueSweep(GTSL::Vector3 start, GTSL::Vector3 end, float32 radius);
+
+	/**
+	 * \brief Queues a query for the objects shape touches at position and orientation. Static mesh objects are tested by their bounding box.
+	 */
+	QueryHandle QueueOverlap(const Shape& shape, GTSL::Vector3 position, GTSL::Quaternion orientation);
+
+	/**
+	 * \brief Returns what a queued raycast or sweep hit, Object is the PhysicsObjectHandle value of the object.
+	 */
+	[[nodiscard]] const QueryHit& GetQueryHit(const QueryHandle query) const { return queries.GetHit(query); }
+
+	/**
+	 * \brief Returns the PhysicsObjectHandle values of the objects a queued overlap touched.
+	 */
+	[[nodiscard]] GTSL::Range<const uint32*> GetQueryOverlaps(const QueryHandle query) const { return queries.GetOverlaps(query); }
 
 private:
 	/**
@@ -50,23 +153,147 @@ private:
 	float32 dampFactor = 0.001;
 
 	/**
-	 * \brief Defines the number of substeps used for simulation. Default is 0, which mean only one iteration will run each frame.
+	 * \brief Length of a simulation step. The simulation advances in steps of this length whatever the frame rate is, so it's cost per
+	 * simulated second and it's results don't depend on it.
+	 */
+	float32 fixedDeltaSeconds = 1.0f / 60.0f;
+
+	/**
+	 * \brief Defines the maximum number of steps run each frame. Time past it is dropped so a slow frame doesn't make the next ones slower.
 	 */
-	uint16 simSubSteps = 0;
+	uint16 simSubSteps = 4;
+
+	/**
+	 * \brief Frame time not simulated yet, always less than a step after an update, and how far between the last two steps it is.
+	 */
+	float32 accumulatedSeconds = 0.0f, interpolation = 0.0f;
 
 	GTSL::Vector<PhysicsObjectHandle, BE::PAR> updatedObjects;
+
+	BroadPhase broadPhase;
+	NarrowPhase narrowPhase;
+	GTSL::Vector<ContactManifold, BE::PAR> contacts;
 	
-	void doBroadPhase();
+	/**
+	 * \brief Moves every object's proxy to where it is now and updates the overlapping pairs.
+	 */
+	void doBroadPhase(float32 deltaSeconds);
+
+	/**
+	 * \brief Replaces the contacts with those of the broad phase's current pairs.
+	 */
 	void doNarrowPhase();
-	void solveDynamicObjects(double _UpdateTime);
+	void solveDynamicObjects(float32 deltaSeconds);
+
+	void step(float32 deltaSeconds);
 
 	void onUpdate(TaskInfo taskInfo);
 
-	void onStaticMeshInfoLoaded(TaskInfo taskInfo, StaticMeshResourceManager* staticMeshResourceManager, StaticMeshResourceManager::StaticMeshInfo staticMeshInfo);
+	void onStaticMeshInfoLoaded(TaskInfo taskInfo, StaticMeshResourceManager* staticMeshResourceManager, StaticMeshResourceManager::StaticMeshInfo staticMeshInfo, PhysicsObjectHandle physicsObject);
+	DynamicTaskHandle<StaticMeshResourceManager*, StaticMeshResourceManager::StaticMeshInfo, PhysicsObjectHandle> onStaticMeshInfoLoadHandle;
+
+	/**
+	 * \brief Alignment indices are loaded at after a mesh's vertices.
+	 */
+	static constexpr uint32 INDEX_ALIGNMENT = 4;
+
+	struct CollisionMeshLoad
+	{
+		CollisionMeshLoad() = default;
+		CollisionMeshLoad(CollisionMeshLoad&& other) noexcept : Buffer(GTSL::MoveRef(other.Buffer)), PhysicsObject(other.PhysicsObject) {}
+		GTSL::Buffer<BE::PAR> Buffer; PhysicsObjectHandle PhysicsObject;
+	};
+
+	void onStaticMeshLoaded(TaskInfo taskInfo, StaticMeshResourceManager* staticMeshResourceManager, StaticMeshResourceManager::StaticMeshInfo staticMeshInfo, CollisionMeshLoad collisionMeshLoad);
+	DynamicTaskHandle<StaticMeshResourceManager*, StaticMeshResourceManager::StaticMeshInfo, CollisionMeshLoad> onStaticMeshLoadHandle;
 	
 	struct PhysicsObject
 	{
-		GTSL::Vector4 Velocity, Acceleration, Position;
+		Shape Collider;
+
+		/**
+		 * \brief Pose before the last step, what rendering interpolates from.
+		 */
+		float32 PreviousPosition[3] = { 0, 0, 0 }, PreviousOrientation[4] = { 0, 0, 0, 1 };
+
+		/**
+		 * \brief Broad phase proxy, NULL_NODE until the object's shape is known.
+		 */
+		uint32 Proxy = DynamicAABBTree::NULL_NODE;
+
+		/**
+		 * \brief The object's mesh in meshVertices and meshIndices, empty until it's loaded and for objects that aren't meshes.
+		 */
+		uint32 MeshVertexStart = 0, MeshVertexCount = 0, MeshIndexStart = 0, MeshIndexCount = 0;
 	};
 	GTSL::KeepVector<PhysicsObject, BE::PAR> physicsObjects;
+
+	/**
+	 * \brief Pose, velocities and mass of every object, indexed by handle. Objects are never removed so handles stay dense.
+	 */
+	GTSL::Vector<SolverBody, BE::PAR> bodies;
+	ContactSolver contactSolver;
+
+	/**
+	 * \brief Mesh space positions, as x, y, z, and triangle indices of every loaded mesh, indices count from the mesh's first vertex.
+	 */
+	GTSL::Vector<float32, BE::PAR> meshVertices;
+	GTSL::Vector<uint32, BE::PAR> meshIndices;
+
+	/**
+	 * \brief Triangles of every static mesh object in world space, and the tree over them queries trace.
+	 */
+	GTSL::Vector<float32, BE::PAR> staticVertices;
+	GTSL::Vector<uint32, BE::PAR> staticIndices;
+	TriangleBVH staticGeometry;
+	bool staticGeometryDirty = false;
+
+	/**
+	 * \brief Object every static geometry triangle belongs to.
+	 */
+	GTSL::Vector<uint32, BE::PAR> staticTriangleObjects;
+
+	SceneQueries queries;
+
+	/**
+	 * \brief Shape and pose of every object as queries see them, made when queries run.
+	 */
+	GTSL::Vector<QueryObject, BE::PAR> queryObjects;
+
+	void executeQueries(TaskInfo taskInfo);
+
+	/**
+	 * \brief Rebuilds staticGeometry from the static mesh objects where they are now.
+	 */
+	void buildStaticGeometry();
+
+	[[nodiscard]] static Transform makeTransform(const float32 position[3], const float32 orientation[4]);
+	[[nodiscard]] AABB getAABB(uint32 physicsObject) const;
+
+	/**
+	 * \brief Moves a static or sleeping object's proxy, which the broad phase doesn't update on it's own.
+	 */
+	void updateProxy(uint32 physicsObject);
+
+	/**
+	 * \brief Measures how many pairs the broad phase finds per millisecond for 50000 moving boxes at different densities and logs it.
+	 */
+	void benchmarkBroadPhase();
+
+	/**
+	 * \brief Compares every narrow phase routine against GJK and EPA on random pairs, measures how many pairs per second each one tests and logs it.
+	 */
+	void benchmarkNarrowPhase();
+
+	/**
+	 * \brief Builds a tree over a terrain with boxes on it, traces line of sight checks of a crowd and random rays one by one and in packets,
+	 * compares them to testing every triangle and logs it along with rays per second.
+	 */
+	void benchmarkRayTracing();
+
+	/**
+	 * \brief Queues raycasts, sweeps and overlaps from every thread against boxes, spheres and capsules scattered over a terrain, compares
+	 * them to testing every object and logs it along with queries per second.
+	 */
+	void benchmarkSceneQueries();
 };
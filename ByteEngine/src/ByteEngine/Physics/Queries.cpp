@@ -0,0 +1,197 @@
+#include "Queries.h"
+
+#include <GTSL/Thread.h>
+#include <GTSL/Math/Math.hpp>
+
+#include "ByteEngine/Application/Application.h"
+#include "ByteEngine/Application/ThreadPool.h"
+
+namespace
+{
+	void copyHit(const HitResult& hitResult, const uint32 object, QueryHit& hit)
+	{
+		hit.Object = object; hit.T = hitResult.T;
+		hit.Position[0] = hitResult.HitPosition.X(); hit.Position[1] = hitResult.HitPosition.Y(); hit.Position[2] = hitResult.HitPosition.Z();
+		hit.Normal[0] = hitResult.HitNormal.X(); hit.Normal[1] = hitResult.HitNormal.Y(); hit.Normal[2] = hitResult.HitNormal.Z();
+	}
+
+	void copyHit(const TriangleBVH::Hit& triangleHit, const uint32 object, QueryHit& hit)
+	{
+		hit.Object = object; hit.T = triangleHit.T;
+		for (uint8 i = 0; i < 3; ++i) { hit.Position[i] = triangleHit.Position[i]; hit.Normal[i] = triangleHit.Normal[i]; }
+	}
+}
+
+void SceneQueries::Initialize(const BE::PAR& allocator)
+{
+	threadCount = static_cast<uint8>(GTSL::Math::Min(GTSL::Thread::ThreadCount() + 1u, static_cast<uint32>(MAX_THREADS))); //thread pool's ids and the one after them, the audio thread's
+
+	for (uint8 t = 0; t < threadCount; ++t)
+	{
+		auto& queries = threads[t];
+		queries.Raycasts.Initialize(16, allocator); queries.Sweeps.Initialize(16, allocator); queries.Overlaps.Initialize(16, allocator);
+		queries.RaycastHits.Initialize(16, allocator); queries.SweepHits.Initialize(16, allocator);
+		queries.OverlapRanges.Initialize(16, allocator); queries.OverlapObjects.Initialize(16, allocator);
+	}
+
+	jobs.Initialize(32, allocator);
+}
+
+QueryHandle SceneQueries::QueueRaycast(const Segment& segment)
+{
+	const uint8 thread = GTSL::Thread::ThisTreadID(); BE_ASSERT(thread < threadCount, "Thread can't queue scene queries"); auto& queries = threads[thread];
+	queries.Raycasts.EmplaceBack(segment);
+	return makeHandle(thread, QueryType::RAYCAST, executions, queries.Raycasts.GetLength() - 1);
+}
+
+QueryHandle SceneQueries::QueueSweep(const Segment& segment, const float32 radius)
+{
+	const uint8 thread = GTSL::Thread::ThisTreadID(); BE_ASSERT(thread < threadCount, "Thread can't queue scene queries"); auto& queries = threads[thread];
+	queries.Sweeps.EmplaceBack(Sweep{ segment, radius });
+	return makeHandle(thread, QueryType::SWEEP, executions, queries.Sweeps.GetLength() - 1);
+}
+
+QueryHandle SceneQueries::QueueOverlap(const Shape& shape, const Transform& pose)
+{
+	const uint8 thread = GTSL::Thread::ThisTreadID(); BE_ASSERT(thread < threadCount, "Thread can't queue scene queries"); auto& queries = threads[thread];
+	queries.Overlaps.EmplaceBack(Overlap{ shape, pose });
+	return makeHandle(thread, QueryType::OVERLAP, executions, queries.Overlaps.GetLength() - 1);
+}
+
+uint32 SceneQueries::GetQueuedCount() const
+{
+	uint32 count = 0;
+	for (uint8 t = 0; t < threadCount; ++t) { count += threads[t].Raycasts.GetLength() + threads[t].Sweeps.GetLength() + threads[t].Overlaps.GetLength(); }
+	return count;
+}
+
+const SceneQueries::ThreadQueries& SceneQueries::getResults(const QueryHandle query, uint32& index) const
+{
+	BE_ASSERT((query() >> GENERATION_SHIFT & (GENERATIONS - 1)) == static_cast<uint8>(executions - 1) % GENERATIONS, "Query hasn't been executed yet or it's results were replaced by a later Execute");
+	BE_ASSERT((query() >> THREAD_SHIFT) < threadCount, "Invalid query handle");
+	index = query() & INDEX_MASK;
+	return threads[query() >> THREAD_SHIFT];
+}
+
+const QueryHit& SceneQueries::GetHit(const QueryHandle query) const
+{
+	uint32 index; const auto& queries = getResults(query, index);
+	const auto type = static_cast<QueryType>(query() >> TYPE_SHIFT & 3);
+	BE_ASSERT(type != QueryType::OVERLAP, "Overlap results are read with GetOverlaps");
+	const auto& hits = type == QueryType::RAYCAST ? queries.RaycastHits : queries.SweepHits;
+	BE_ASSERT(index < hits.GetLength(), "Invalid query handle");
+	return hits[index];
+}
+
+GTSL::Range<const uint32*> SceneQueries::GetOverlaps(const QueryHandle query) const
+{
+	uint32 index; const auto& queries = getResults(query, index);
+	BE_ASSERT(static_cast<QueryType>(query() >> TYPE_SHIFT & 3) == QueryType::OVERLAP, "Hit results are read with GetHit");
+	BE_ASSERT(index * 2 + 1 < queries.OverlapRanges.GetLength(), "Invalid query handle");
+	const uint32 first = queries.OverlapRanges[index * 2], last = queries.OverlapRanges[index * 2 + 1];
+	return GTSL::Range<const uint32*>(last - first, queries.OverlapObjects.begin() + first);
+}
+
+void SceneQueries::Execute(const QueryScene& executedScene)
+{
+	scene = &executedScene; jobs.ResizeDown(0);
+
+	for (uint8 t = 0; t < threadCount; ++t)
+	{
+		auto& queries = threads[t];
+		queries.RaycastHits.Resize(queries.Raycasts.GetLength()); queries.SweepHits.Resize(queries.Sweeps.GetLength());
+		queries.OverlapRanges.ResizeDown(0); queries.OverlapObjects.ResizeDown(0);
+
+		for (uint32 first = 0; first < queries.Raycasts.GetLength(); first += RAYCAST_CHUNK) { jobs.EmplaceBack(Job{ t, QueryType::RAYCAST, first, GTSL::Math::Min(queries.Raycasts.GetLength() - first, RAYCAST_CHUNK) }); }
+		for (uint32 first = 0; first < queries.Sweeps.GetLength(); first += SWEEP_CHUNK) { jobs.EmplaceBack(Job{ t, QueryType::SWEEP, first, GTSL::Math::Min(queries.Sweeps.GetLength() - first, SWEEP_CHUNK) }); }
+		if (queries.Overlaps.GetLength()) { jobs.EmplaceBack(Job{ t, QueryType::OVERLAP, 0, queries.Overlaps.GetLength() }); }
+	}
+
+	nextJob.store(0, std::memory_order_relaxed);
+
+	if (jobs.GetLength() > 1)
+	{
+		//executeQueries runs on a pool worker, it only waits for helpers that started while jobs were left
+		helpers.Run<SceneQueries, &SceneQueries::runJobs>(this, GTSL::Math::Min(static_cast<uint32>(BE::Application::Get()->GetThreadPool()->GetNumberOfThreads()), jobs.GetLength() - 1));
+	}
+	else
+	{
+		runJobs();
+	}
+
+	for (uint8 t = 0; t < threadCount; ++t) { threads[t].Raycasts.ResizeDown(0); threads[t].Sweeps.ResizeDown(0); threads[t].Overlaps.ResizeDown(0); }
+	scene = nullptr; ++executions; //handles of the queries just run become readable, older ones stale
+}
+
+void SceneQueries::runJobs()
+{
+	for (uint32 j; (j = nextJob.fetch_add(1, std::memory_order_relaxed)) < jobs.GetLength();)
+	{
+		const Job& job = jobs[j]; auto& queries = threads[job.Thread];
+
+		switch (job.Type)
+		{
+		case QueryType::RAYCAST: executeRaycasts(queries, job.First, job.Count); break;
+		case QueryType::SWEEP: executeSweeps(queries, job.First, job.Count); break;
+		case QueryType::OVERLAP: executeOverlaps(queries); break;
+		}
+	}
+}
+
+void SceneQueries::executeRaycasts(ThreadQueries& queries, const uint32 first, const uint32 count) const
+{
+	const Segment* segments = queries.Raycasts.begin() + first; QueryHit* hits = queries.RaycastHits.begin() + first;
+
+	//static geometry first and in packets, objects' boxes past it's hits are then skipped
+	TriangleBVH::Hit triangleHits[RAYCAST_CHUNK];
+	scene->StaticGeometry->Trace(GTSL::Range<const Segment*>(count, segments), GTSL::Range<TriangleBVH::Hit*>(count, triangleHits));
+
+	for (uint32 i = 0; i < count; ++i)
+	{
+		hits[i] = QueryHit();
+		if (triangleHits[i].Triangle != TriangleBVH::NULL_TRIANGLE) { copyHit(triangleHits[i], scene->StaticTriangleObjects.begin()[triangleHits[i].Triangle], hits[i]); }
+		castAgainstObjects(segments[i], 0.0f, hits[i]);
+	}
+}
+
+void SceneQueries::executeSweeps(ThreadQueries& queries, const uint32 first, const uint32 count) const
+{
+	for (uint32 i = first; i < first + count; ++i)
+	{
+		const Sweep& sweep = queries.Sweeps[i]; QueryHit& hit = queries.SweepHits[i];
+		hit = QueryHit();
+
+		TriangleBVH::Hit triangleHit;
+		if (scene->StaticGeometry->SweepSphere(sweep.Path, sweep.Radius, triangleHit)) { copyHit(triangleHit, scene->StaticTriangleObjects.begin()[triangleHit.Triangle], hit); }
+		castAgainstObjects(sweep.Path, sweep.Radius, hit);
+	}
+}
+
+void SceneQueries::executeOverlaps(ThreadQueries& queries) const
+{
+	for (const auto& overlap : queries.Overlaps)
+	{
+		queries.OverlapRanges.EmplaceBack(queries.OverlapObjects.GetLength());
+
+		scene->Tree->Query(GetShapeAABB(overlap.Collider, overlap.Pose), [&](const uint32 proxy) {
+			const uint32 object = scene->Tree->GetUserData(proxy);
+			ContactManifold manifold;
+			if (CollideConvex(overlap.Collider, overlap.Pose, scene->Objects.begin()[object].Collider, scene->Objects.begin()[object].Pose, manifold)) { queries.OverlapObjects.EmplaceBack(object); }
+			return true;
+		});
+
+		queries.OverlapRanges.EmplaceBack(queries.OverlapObjects.GetLength());
+	}
+}
+
+void SceneQueries::castAgainstObjects(const Segment& segment, const float32 radius, QueryHit& hit) const
+{
+	scene->Tree->RayCast(segment.Start, segment.End, radius, hit.T, [&](const uint32 proxy) {
+		const uint32 object = scene->Tree->GetUserData(proxy);
+		const QueryObject& queryObject = scene->Objects.begin()[object];
+
+		HitResult hitResult;
+		if (!queryObject.InStaticGeometry && CastSphere(segment.Start, segment.End, radius, queryObject.Collider, queryObject.Pose, hitResult) && hitResult.T < hit.T) { copyHit(hitResult, object, hit); }
+		return hit.T;
+	});
+}
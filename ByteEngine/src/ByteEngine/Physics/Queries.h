@@ -1 +1,168 @@
 #pragma once
+
+#include <atomic>
+
+#include <GTSL/Range.h>
+#include <GTSL/Vector.hpp>
+
+#include "BroadPhase.h"
+#include "NarrowPhase.h"
+#include "TriangleBVH.h"
+#include "ByteEngine/Core.h"
+#include "ByteEngine/Handle.hpp"
+#include "ByteEngine/Application/AllocatorReferences.h"
+#include "ByteEngine/Application/HelperGroup.h"
+
+MAKE_HANDLE(uint32, Query);
+
+/**
+ * \brief What a raycast or a sweep hit. Object is the PhysicsObjectHandle value of the object hit, T is how far along the query's segment,
+ * 0 at start and 1 at end, and Normal points back towards where the query came from.
+ */
+struct QueryHit
+{
+	static constexpr uint32 NULL_OBJECT = 0xFFFFFFFF;
+
+	uint32 Object = NULL_OBJECT;
+	float32 T = 1.0f;
+	float32 Position[3] = { 0, 0, 0 }, Normal[3] = { 0, 0, 0 };
+
+	[[nodiscard]] bool WasHit() const { return Object != NULL_OBJECT; }
+};
+
+/**
+ * \brief An object as queries see it, indexed by PhysicsObjectHandle value. Objects whose triangles are in the static geometry are hit through
+ * them by raycasts and sweeps instead of through their shape.
+ */
+struct QueryObject
+{
+	Shape Collider; Transform Pose;
+	bool InStaticGeometry = false;
+};
+
+/**
+ * \brief What queries run against. The tree's proxies' user data index Objects and StaticTriangleObjects has the object of every triangle in StaticGeometry.
+ */
+struct QueryScene
+{
+	const DynamicAABBTree* Tree = nullptr;
+	GTSL::Range<const QueryObject*> Objects;
+	const TriangleBVH* StaticGeometry = nullptr;
+	GTSL::Range<const uint32*> StaticTriangleObjects;
+};
+
+/**
+ * \brief Deferred scene queries. Any task can queue raycasts, sphere sweeps and overlaps, they go to the calling thread's own buffer so
+ * queueing takes no locks and never waits on other threads. Execute runs everything queued at once, grouped by kind and split among the
+ * thread pool, rays are traced against static geometry in SIMD packets. Results are read by the handle queueing returned after the
+ * Execute that follows and stay until the next one. Handles carry the execution they belong to, reading one before it's query
+ * is executed or after a later Execute asserts.
+ */
+class SceneQueries
+{
+public:
+	/**
+	 * \brief Threads that can queue queries, thread ids index the buffers. Engine threads past the thread pool's, like the audio thread, have one too.
+	 */
+	static constexpr uint8 MAX_THREADS = 32;
+
+	void Initialize(const BE::PAR& allocator);
+
+	QueryHandle QueueRaycast(const Segment& segment);
+	QueryHandle QueueSweep(const Segment& segment, float32 radius);
+
+	/**
+	 * \brief Queues a query for the objects shape touches at pose, static geometry is tested by it's objects' shapes.
+	 */
+	QueryHandle QueueOverlap(const Shape& shape, const Transform& pose);
+
+	/**
+	 * \brief Runs every queued query against scene and replaces the results with theirs.
+	 */
+	void Execute(const QueryScene& scene);
+
+	[[nodiscard]] uint32 GetQueuedCount() const;
+
+	[[nodiscard]] const QueryHit& GetHit(QueryHandle query) const;
+
+	/**
+	 * \brief Returns the PhysicsObjectHandle values of the objects an overlap query touched.
+	 */
+	[[nodiscard]] GTSL::Range<const uint32*> GetOverlaps(QueryHandle query) const;
+
+private:
+	enum class QueryType : uint8 { RAYCAST, SWEEP, OVERLAP };
+
+	/**
+	 * \brief Handles are the queueing thread, the query's type, the execution that runs it modulo GENERATIONS and it's index among the thread's
+	 * queries of that type.
+	 */
+	static QueryHandle makeHandle(const uint8 thread, const QueryType type, const uint8 generation, const uint32 index)
+	{
+		return QueryHandle(static_cast<uint32>(thread) << THREAD_SHIFT | static_cast<uint32>(type) << TYPE_SHIFT | static_cast<uint32>(generation % GENERATIONS) << GENERATION_SHIFT | index);
+	}
+
+	static constexpr uint32 GENERATION_SHIFT = 22, TYPE_SHIFT = 25, THREAD_SHIFT = 27, INDEX_MASK = (1u << GENERATION_SHIFT) - 1, GENERATIONS = 8;
+	static_assert(MAX_THREADS <= 1u << (32 - THREAD_SHIFT), "Thread ids don't fit in handles");
+
+	/**
+	 * \brief Executions run so far, queries queued now are run by this one.
+	 */
+	uint8 executions = 0;
+
+	/**
+	 * \brief Queries of a type are executed in chunks of this many, small enough to balance threads and, for rays, to fit their hits on the stack.
+	 */
+	static constexpr uint32 RAYCAST_CHUNK = 256, SWEEP_CHUNK = 64;
+
+	struct Sweep { Segment Path; float32 Radius; };
+	struct Overlap { Shape Collider; Transform Pose; };
+
+	/**
+	 * \brief One thread's queued queries and, after Execute, their results. Cache line aligned so threads queueing at once don't share lines.
+	 */
+	struct alignas(64) ThreadQueries
+	{
+		GTSL::Vector<Segment, BE::PAR> Raycasts;
+		GTSL::Vector<Sweep, BE::PAR> Sweeps;
+		GTSL::Vector<Overlap, BE::PAR> Overlaps;
+
+		GTSL::Vector<QueryHit, BE::PAR> RaycastHits, SweepHits;
+
+		/**
+		 * \brief First and past the last of every overlap's objects in OverlapObjects.
+		 */
+		GTSL::Vector<uint32, BE::PAR> OverlapRanges, OverlapObjects;
+	};
+	ThreadQueries threads[MAX_THREADS];
+	uint8 threadCount = 0;
+
+	/**
+	 * \brief Asserts query belongs to the last Execute and returns it's thread's queries and it's index. Handles GENERATIONS executions old can't be told apart.
+	 */
+	const ThreadQueries& getResults(QueryHandle query, uint32& index) const;
+
+	/**
+	 * \brief Chunk of one thread's queries of one type, executions are split into them. Overlaps aren't split, a thread's overlaps write
+	 * their objects in order.
+	 */
+	struct Job { uint8 Thread; QueryType Type; uint32 First, Count; };
+	GTSL::Vector<Job, BE::PAR> jobs;
+	std::atomic<uint32> nextJob{ 0 };
+	HelperGroup helpers;
+	const QueryScene* scene = nullptr;
+
+	/**
+	 * \brief Runs jobs until none are left, called by every thread taking part in an execution.
+	 */
+	void runJobs();
+
+	void executeRaycasts(ThreadQueries& queries, uint32 first, uint32 count) const;
+	void executeSweeps(ThreadQueries& queries, uint32 first, uint32 count) const;
+	void executeOverlaps(ThreadQueries& queries) const;
+
+	/**
+	 * \brief Casts a sphere of radius, 0 for a ray, against every object's shape along segment, keeping the hit if it's closer than hit.
+	 */
+	void castAgainstObjects(const Segment& segment, float32 radius, QueryHit& hit) const;
+};
@@ -0,0 +1,43 @@
+#include "RigidBody.h"
+
+void RigidBody::SetMass(const float mass, const Shape& shape)
+{
+	if (mass <= 0.0f) { inverseBodyMass = 0.0f; for (auto& e : inverseInertia) { e = 0.0f; } return; }
+
+	inverseBodyMass = 1.0f / mass;
+	float inertia[3];
+
+	switch (shape.Type)
+	{
+	case ShapeType::SPHERE: for (auto& e : inertia) { e = 0.4f * mass * shape.Radius * shape.Radius; } break;
+	case ShapeType::CAPSULE:
+	{
+		//cylinder plus the two hemispheres, mass split by volume
+		const float r = shape.Radius, height = shape.HalfExtents[1] * 2.0f;
+		const float cylinderVolume = 3.14159265f * r * r * height, sphereVolume = 4.0f / 3.0f * 3.14159265f * r * r * r;
+		const float cylinderMass = mass * cylinderVolume / (cylinderVolume + sphereVolume), sphereMass = mass - cylinderMass;
+
+		inertia[1] = cylinderMass * r * r * 0.5f + sphereMass * r * r * 0.4f;
+		inertia[0] = inertia[2] = cylinderMass * (r * r * 0.25f + height * height / 12.0f) + sphereMass * (r * r * 0.4f + height * height * 0.25f + height * r * 0.375f);
+		break;
+	}
+	case ShapeType::BOX:
+	case ShapeType::CONVEX_HULL:
+	{
+		//hulls are approximated by the box around their vertices
+		float halfExtents[3] = { shape.HalfExtents[0], shape.HalfExtents[1], shape.HalfExtents[2] };
+
+		if (shape.Type == ShapeType::CONVEX_HULL) {
+			Transform identity{ { 0, 0, 0 }, { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } } };
+			const AABB aabb = GetShapeAABB(shape, identity);
+			for (uint8 i = 0; i < 3; ++i) { halfExtents[i] = (aabb.Max[i] - aabb.Min[i]) * 0.5f; }
+		}
+
+		const float x = halfExtents[0] * halfExtents[0], y = halfExtents[1] * halfExtents[1], z = halfExtents[2] * halfExtents[2];
+		inertia[0] = mass * (y + z) / 3.0f; inertia[1] = mass * (x + z) / 3.0f; inertia[2] = mass * (x + y) / 3.0f;
+		break;
+	}
+	}
+
+	for (uint8 i = 0; i < 3; ++i) { inverseInertia[i] = inertia[i] > 0.0f ? 1.0f / inertia[i] : 0.0f; }
+}
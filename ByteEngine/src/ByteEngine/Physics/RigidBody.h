@@ -1,12 +1,44 @@
 #pragma once
 
+#include "NarrowPhase.h"
+
+/**
+ * \brief Mass and surface properties of a body.
+ */
 class RigidBody
 {
 	/**
-	 * \brief Specifies the inverse mass of this body.
+	 * \brief Specifies the inverse mass of this body. 0 for static bodies.
 	 */
 	float inverseBodyMass = 1;
 
+	/**
+	 * \brief Inverse of the inertia around the body's axes.
+	 */
+	float inverseInertia[3] = { 1, 1, 1 };
+
+	float friction = 0.5f, restitution = 0.0f;
+
 public:
 	void SetMass(const float _Mass) { inverseBodyMass = 1 / _Mass; }
+
+	/**
+	 * \brief Sets the mass and the inertia of a solid body of that mass shaped like shape. A mass of 0 makes the body static.
+	 */
+	void SetMass(float mass, const Shape& shape);
+
+	/**
+	 * \brief Sets how much the body resists sliding, friction between two bodies is the geometric mean of theirs.
+	 */
+	void SetFriction(const float newFriction) { friction = newFriction; }
+
+	/**
+	 * \brief Sets how much of the impact speed the body bounces back with, 0 to 1. Contacts use the bounciest of the two bodies.
+	 */
+	void SetRestitution(const float newRestitution) { restitution = newRestitution; }
+
+	[[nodiscard]] float GetInverseMass() const { return inverseBodyMass; }
+	[[nodiscard]] const float* GetInverseInertia() const { return inverseInertia; }
+	[[nodiscard]] float GetFriction() const { return friction; }
+	[[nodiscard]] float GetRestitution() const { return restitution; }
 };
@@ -0,0 +1,564 @@
+#include "TriangleBVH.h"
+
+#include <algorithm>
+#include <cmath>
+#include <emmintrin.h>
+
+#include <GTSL/Math/Math.hpp>
+
+#include "PhysicsMath.h"
+
+namespace
+{
+	constexpr float32 FLOAT_MAX = 3.402823466e+38f;
+
+	/**
+	 * \brief Bins centroids are sorted into along each axis to find a split, more bins find better splits but take longer to evaluate.
+	 */
+	constexpr uint32 SAH_BINS = 16;
+
+	/**
+	 * \brief Cost of visiting a node relative to testing a triangle.
+	 */
+	constexpr float32 TRAVERSAL_COST = 1.0f;
+
+	/**
+	 * \brief Deepest a tree can get, binned splits on real meshes stay far from it.
+	 */
+	constexpr uint32 MAX_DEPTH = 64;
+
+	AABB makeEmptyAABB() { return AABB{ { FLOAT_MAX, FLOAT_MAX, FLOAT_MAX }, { -FLOAT_MAX, -FLOAT_MAX, -FLOAT_MAX } }; }
+
+	void addPoint(AABB& aabb, const float32 point[3])
+	{
+		for (uint8 i = 0; i < 3; ++i) { aabb.Min[i] = point[i] < aabb.Min[i] ? point[i] : aabb.Min[i]; aabb.Max[i] = point[i] > aabb.Max[i] ? point[i] : aabb.Max[i]; }
+	}
+
+	/**
+	 * \brief Inverse of direction with zero components replaced by tiny ones of the same sign, so slabs parallel to a ray never produce NaNs.
+	 */
+	Float3 getInverse(const Float3 direction)
+	{
+		auto inverse = [](const float32 d) { return 1.0f / (std::abs(d) > 1e-20f ? d : (d < 0.0f ? -1e-20f : 1e-20f)); };
+		return { inverse(direction.X), inverse(direction.Y), inverse(direction.Z) };
+	}
+
+	bool intersectsBox(const float32 min[3], const float32 max[3], const Float3 origin, const Float3 inverse, const float32 maxT, const float32 inflation)
+	{
+		float32 tNear = 0.0f, tFar = maxT;
+		const float32 o[3] = { origin.X, origin.Y, origin.Z }, inv[3] = { inverse.X, inverse.Y, inverse.Z };
+
+		for (uint8 i = 0; i < 3; ++i) {
+			float32 t0 = (min[i] - inflation - o[i]) * inv[i], t1 = (max[i] + inflation - o[i]) * inv[i];
+			if (t0 > t1) { const float32 t = t0; t0 = t1; t1 = t; }
+			tNear = t0 > tNear ? t0 : tNear; tFar = t1 < tFar ? t1 : tFar;
+		}
+
+		return tNear <= tFar;
+	}
+
+	/**
+	 * \brief Moller-Trumbore ray triangle intersection, t is in units of direction.
+	 */
+	bool intersectTriangle(const Float3 vertex, const Float3 edge1, const Float3 edge2, const Float3 origin, const Float3 direction, const float32 maxT, float32& t)
+	{
+		const Float3 p = Cross(direction, edge2);
+		const float32 determinant = Dot(edge1, p);
+		if (std::abs(determinant) < 1e-20f) { return false; } //parallel to the triangle
+
+		const float32 inverse = 1.0f / determinant;
+		const Float3 s = origin - vertex;
+		const float32 u = Dot(s, p) * inverse;
+		if (u < 0.0f || u > 1.0f) { return false; }
+
+		const Float3 q = Cross(s, edge1);
+		const float32 v = Dot(direction, q) * inverse;
+		if (v < 0.0f || u + v > 1.0f) { return false; }
+
+		t = Dot(edge2, q) * inverse;
+		return t >= 0.0f && t < maxT;
+	}
+
+	/**
+	 * \brief Returns the point of triangle a, b, c closest to point.
+	 */
+	Float3 getClosestPoint(const Float3 point, const Float3 a, const Float3 b, const Float3 c)
+	{
+		const Float3 ab = b - a, ac = c - a, ap = point - a;
+		const float32 d1 = Dot(ab, ap), d2 = Dot(ac, ap);
+		if (d1 <= 0.0f && d2 <= 0.0f) { return a; }
+
+		const Float3 bp = point - b;
+		const float32 d3 = Dot(ab, bp), d4 = Dot(ac, bp);
+		if (d3 >= 0.0f && d4 <= d3) { return b; }
+
+		const float32 vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) { return a + ab * (d1 / (d1 - d3)); }
+
+		const Float3 cp = point - c;
+		const float32 d5 = Dot(ab, cp), d6 = Dot(ac, cp);
+		if (d6 >= 0.0f && d5 <= d6) { return c; }
+
+		const float32 vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) { return a + ac * (d2 / (d2 - d6)); }
+
+		const float32 va = d3 * d6 - d5 * d4;
+		if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f) { return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6))); }
+
+		const float32 denominator = 1.0f / (va + vb + vc);
+		return a + ab * (vb * denominator) + ac * (vc * denominator);
+	}
+
+	/**
+	 * \brief First t at which a sphere of radius centered on origin + direction * t touches the sphere at center.
+	 */
+	bool sweepSphereSphere(const Float3 origin, const Float3 direction, const Float3 center, const float32 radius, float32& t)
+	{
+		const Float3 m = origin - center;
+		const float32 a = Dot(direction, direction), b = Dot(m, direction), c = Dot(m, m) - radius * radius;
+		const float32 discriminant = b * b - a * c;
+		if (discriminant < 0.0f || a <= 0.0f) { return false; }
+
+		t = (-b - std::sqrt(discriminant)) / a;
+		return t >= 0.0f;
+	}
+
+	/**
+	 * \brief First t at which the moving sphere touches the side of the edge from p to q, the ends are covered by the vertices' spheres.
+	 */
+	bool sweepSphereEdge(const Float3 origin, const Float3 direction, const Float3 p, const Float3 q, const float32 radius, float32& t)
+	{
+		const Float3 edge = q - p, m = origin - p;
+		const float32 ee = Dot(edge, edge), md = Dot(m, edge), nd = Dot(direction, edge);
+		const float32 a = ee * Dot(direction, direction) - nd * nd, b = ee * Dot(m, direction) - nd * md, c = ee * (Dot(m, m) - radius * radius) - md * md;
+		if (a <= 1e-20f || c < 0.0f) { return false; } //moving along the edge or starting inside it's infinite cylinder, the ends are hit first
+
+		const float32 discriminant = b * b - a * c;
+		if (discriminant < 0.0f) { return false; }
+
+		t = (-b - std::sqrt(discriminant)) / a;
+		const float32 along = md + t * nd;
+		return t >= 0.0f && along >= 0.0f && along <= ee;
+	}
+
+	/**
+	 * \brief First t in [0, maxT) at which a sphere of radius moving from origin along direction touches triangle a, b, c.
+	 */
+	bool sweepSphereTriangle(const Float3 a, const Float3 b, const Float3 c, const Float3 origin, const Float3 direction, const float32 radius, const float32 maxT, float32& t)
+	{
+		if (LengthSquared(getClosestPoint(origin, a, b, c) - origin) <= radius * radius) { t = 0.0f; return true; }
+
+		float32 first = maxT; bool found = false;
+		auto consider = [&](const float32 candidate) { if (candidate < first) { first = candidate; found = true; } };
+
+		//the sphere's lowest point hitting the inside of the face, only possible while the sphere is farther than radius from the plane
+		Float3 normal = Cross(b - a, c - a);
+		const float32 normalLength = std::sqrt(LengthSquared(normal));
+		if (normalLength > 0.0f)
+		{
+			normal = normal * (1.0f / normalLength);
+			const float32 side = Dot(origin - a, normal) < 0.0f ? -1.0f : 1.0f; //which side of the face the sphere comes from
+			const float32 distance = Dot(origin - a, normal) * side, approach = Dot(direction, normal) * side;
+
+			if (distance > radius && approach < 0.0f)
+			{
+				const float32 tFace = (distance - radius) / -approach;
+				const Float3 point = origin + direction * tFace - normal * (radius * side);
+				if (Dot(Cross(b - a, point - a), normal) >= 0.0f && Dot(Cross(c - b, point - b), normal) >= 0.0f && Dot(Cross(a - c, point - c), normal) >= 0.0f) { consider(tFace); }
+			}
+		}
+
+		float32 tEdge;
+		if (sweepSphereEdge(origin, direction, a, b, radius, tEdge)) { consider(tEdge); }
+		if (sweepSphereEdge(origin, direction, b, c, radius, tEdge)) { consider(tEdge); }
+		if (sweepSphereEdge(origin, direction, c, a, radius, tEdge)) { consider(tEdge); }
+
+		float32 tVertex;
+		if (sweepSphereSphere(origin, direction, a, radius, tVertex)) { consider(tVertex); }
+		if (sweepSphereSphere(origin, direction, b, radius, tVertex)) { consider(tVertex); }
+		if (sweepSphereSphere(origin, direction, c, radius, tVertex)) { consider(tVertex); }
+
+		t = first;
+		return found;
+	}
+
+	__m128 select(const __m128 mask, const __m128 a, const __m128 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+}
+
+void TriangleBVH::Initialize(const uint32 capacity, const BE::PAR& allocator)
+{
+	nodes.Initialize(capacity, allocator); triangles.Initialize(capacity, allocator); triangleIndices.Initialize(capacity, allocator);
+	triangleBounds.Initialize(capacity, allocator); centroids.Initialize(capacity, allocator);
+}
+
+void TriangleBVH::Build(const GTSL::Range<const float32*> vertices, const GTSL::Range<const uint32*> indices)
+{
+	const uint32 triangleCount = static_cast<uint32>(indices.ElementCount() / 3);
+	const float32* positions = vertices.begin(); const uint32* triangleVertices = indices.begin();
+
+	nodes.ResizeDown(0); triangles.ResizeDown(0); triangleIndices.ResizeDown(0); triangleBounds.ResizeDown(0); centroids.ResizeDown(0);
+
+	for (uint32 t = 0; t < triangleCount; ++t)
+	{
+		AABB bounds = makeEmptyAABB();
+		for (uint8 v = 0; v < 3; ++v) { addPoint(bounds, positions + triangleVertices[t * 3 + v] * 3); }
+
+		triangleBounds.EmplaceBack(bounds); triangleIndices.EmplaceBack(t);
+		for (uint8 i = 0; i < 3; ++i) { centroids.EmplaceBack((bounds.Min[i] + bounds.Max[i]) * 0.5f); }
+	}
+
+	if (!triangleCount) { return; }
+
+	nodes.EmplaceBack(Node{ { 0, 0, 0 }, 0, { 0, 0, 0 }, triangleCount });
+
+	//children are appended after their parent, so this visits every node once and leaves siblings next to each other
+	for (uint32 n = 0; n < nodes.GetLength(); ++n) { split(n); }
+
+	for (uint32 t = 0; t < triangleCount; ++t)
+	{
+		const uint32* triangle = triangleVertices + triangleIndices[t] * 3;
+		const float32 *a = positions + triangle[0] * 3, *b = positions + triangle[1] * 3, *c = positions + triangle[2] * 3;
+
+		auto& ordered = triangles.EmplaceBack();
+		for (uint8 i = 0; i < 3; ++i) { ordered.Vertex[i] = a[i]; ordered.Edges[0][i] = b[i] - a[i]; ordered.Edges[1][i] = c[i] - a[i]; }
+	}
+}
+
+void TriangleBVH::split(const uint32 n)
+{
+	const uint32 first = nodes[n].First, count = nodes[n].Count;
+
+	AABB bounds = makeEmptyAABB(), centroidBounds = makeEmptyAABB();
+	for (uint32 i = first; i < first + count; ++i) {
+		bounds = AABB::Union(bounds, triangleBounds[triangleIndices[i]]);
+		addPoint(centroidBounds, &centroids[triangleIndices[i] * 3]);
+	}
+
+	for (uint8 i = 0; i < 3; ++i) { nodes[n].Min[i] = bounds.Min[i]; nodes[n].Max[i] = bounds.Max[i]; }
+
+	if (count == 1) { return; }
+
+	float32 bestCost = FLOAT_MAX; uint8 bestAxis = 0; uint32 bestBin = 0;
+
+	for (uint8 axis = 0; axis < 3; ++axis)
+	{
+		const float32 extent = centroidBounds.Max[axis] - centroidBounds.Min[axis];
+		if (extent <= 0.0f) { continue; }
+
+		AABB bins[SAH_BINS]; uint32 binCounts[SAH_BINS] = { 0 };
+		for (auto& e : bins) { e = makeEmptyAABB(); }
+
+		const float32 scale = SAH_BINS / extent;
+		for (uint32 i = first; i < first + count; ++i) {
+			const uint32 triangle = triangleIndices[i];
+			const uint32 bin = GTSL::Math::Min(static_cast<uint32>((centroids[triangle * 3 + axis] - centroidBounds.Min[axis]) * scale), SAH_BINS - 1);
+			bins[bin] = AABB::Union(bins[bin], triangleBounds[triangle]); ++binCounts[bin];
+		}
+
+		//area and count of everything right of every split, then sweep from the left evaluating each split
+		float32 rightAreas[SAH_BINS]; uint32 rightCounts[SAH_BINS];
+		AABB right = makeEmptyAABB(); uint32 rightCount = 0;
+		for (uint32 b = SAH_BINS - 1; b > 0; --b) {
+			if (binCounts[b]) { right = AABB::Union(right, bins[b]); }
+			rightCount += binCounts[b]; rightAreas[b] = rightCount ? right.GetArea() : 0.0f; rightCounts[b] = rightCount;
+		}
+
+		AABB left = makeEmptyAABB(); uint32 leftCount = 0;
+		for (uint32 b = 1; b < SAH_BINS; ++b) {
+			if (binCounts[b - 1]) { left = AABB::Union(left, bins[b - 1]); }
+			leftCount += binCounts[b - 1];
+			if (!leftCount || !rightCounts[b]) { continue; }
+
+			const float32 cost = left.GetArea() * leftCount + rightAreas[b] * rightCounts[b];
+			if (cost < bestCost) { bestCost = cost; bestAxis = axis; bestBin = b; }
+		}
+	}
+
+	const float32 area = bounds.GetArea();
+	const bool foundSplit = bestCost != FLOAT_MAX;
+	const float32 splitCost = TRAVERSAL_COST + (area > 0.0f ? bestCost / area : 0.0f), leafCost = static_cast<float32>(count);
+	if ((!foundSplit || splitCost >= leafCost) && count <= MAX_LEAF_TRIANGLES) { return; }
+
+	uint32 leftCount = count / 2; //all centroids in the same spot, any split is as good as any other
+
+	if (foundSplit)
+	{
+		const float32 scale = SAH_BINS / (centroidBounds.Max[bestAxis] - centroidBounds.Min[bestAxis]);
+		auto isLeft = [&](const uint32 triangle) { return GTSL::Math::Min(static_cast<uint32>((centroids[triangle * 3 + bestAxis] - centroidBounds.Min[bestAxis]) * scale), SAH_BINS - 1) < bestBin; };
+
+		uint32 i = first, j = first + count;
+		while (i < j) {
+			if (isLeft(triangleIndices[i])) { ++i; }
+			else { --j; const uint32 swap = triangleIndices[i]; triangleIndices[i] = triangleIndices[j]; triangleIndices[j] = swap; }
+		}
+
+		leftCount = i - first;
+	}
+
+	const uint32 children = nodes.GetLength();
+	nodes.EmplaceBack(Node{ { 0, 0, 0 }, first, { 0, 0, 0 }, leftCount });
+	nodes.EmplaceBack(Node{ { 0, 0, 0 }, first + leftCount, { 0, 0, 0 }, count - leftCount });
+	nodes[n].First = children; nodes[n].Count = 0;
+}
+
+template<bool ANY_HIT>
+bool TriangleBVH::traceRay(const Segment& segment, Hit& hit) const
+{
+	hit.T = 1.0f; hit.Triangle = NULL_TRIANGLE;
+	if (!nodes.GetLength()) { return false; }
+
+	const Float3 origin = LoadFloat3(segment.Start), direction = LoadFloat3(segment.End) - origin, inverse = getInverse(direction);
+
+	uint32 stack[MAX_DEPTH * 2]; uint32 stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize)
+	{
+		const Node& node = nodes[stack[--stackSize]];
+		if (!intersectsBox(node.Min, node.Max, origin, inverse, hit.T, 0.0f)) { continue; }
+
+		if (node.Count)
+		{
+			for (uint32 t = node.First; t < node.First + node.Count; ++t)
+			{
+				const Triangle& triangle = triangles[t]; float32 distance;
+				if (!intersectTriangle(LoadFloat3(triangle.Vertex), LoadFloat3(triangle.Edges[0]), LoadFloat3(triangle.Edges[1]), origin, direction, hit.T, distance)) { continue; }
+
+				hit.T = distance; hit.Triangle = t;
+				if constexpr (ANY_HIT) { return true; }
+			}
+
+			continue;
+		}
+
+		//push the far child first so the near one is visited first and shortens the ray for it's sibling
+		const Node &left = nodes[node.First], &right = nodes[node.First + 1];
+		const Float3 between{ right.Min[0] + right.Max[0] - left.Min[0] - left.Max[0], right.Min[1] + right.Max[1] - left.Min[1] - left.Max[1], right.Min[2] + right.Max[2] - left.Min[2] - left.Max[2] };
+		const bool leftFirst = Dot(between, direction) > 0.0f;
+		stack[stackSize++] = node.First + leftFirst; stack[stackSize++] = node.First + !leftFirst;
+	}
+
+	if (hit.Triangle == NULL_TRIANGLE) { return false; }
+
+	const float32 d[3] = { direction.X, direction.Y, direction.Z };
+	fillHit(hit.Triangle, segment.Start, d, hit);
+	return true;
+}
+
+template<bool ANY_HIT>
+void TriangleBVH::tracePacket(const Segment* segments, const uint32* order, const uint32 count, Hit* hits, bool* occluded) const
+{
+	alignas(16) float32 origins[3][PACKET_SIZE], directions[3][PACKET_SIZE], inverses[3][PACKET_SIZE];
+	Float3 packetDirection{ 0, 0, 0 };
+
+	for (uint32 l = 0; l < PACKET_SIZE; ++l)
+	{
+		const Segment& segment = segments[order[l < count ? l : 0]]; //missing lanes repeat the first ray and are masked out
+		const Float3 origin = LoadFloat3(segment.Start), direction = LoadFloat3(segment.End) - origin, inverse = getInverse(direction);
+		origins[0][l] = origin.X; origins[1][l] = origin.Y; origins[2][l] = origin.Z;
+		directions[0][l] = direction.X; directions[1][l] = direction.Y; directions[2][l] = direction.Z;
+		inverses[0][l] = inverse.X; inverses[1][l] = inverse.Y; inverses[2][l] = inverse.Z;
+		packetDirection = packetDirection + direction;
+	}
+
+	__m128 o[3], d[3], inv[3];
+	for (uint8 i = 0; i < 3; ++i) { o[i] = _mm_load_ps(origins[i]); d[i] = _mm_load_ps(directions[i]); inv[i] = _mm_load_ps(inverses[i]); }
+
+	const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), tiny = _mm_set1_ps(1e-20f), signMask = _mm_set1_ps(-0.0f);
+	__m128 tMax = one;
+	uint32 active = (1u << count) - 1;
+	alignas(16) uint32 hitTriangles[PACKET_SIZE] = { NULL_TRIANGLE, NULL_TRIANGLE, NULL_TRIANGLE, NULL_TRIANGLE };
+
+	uint32 stack[MAX_DEPTH * 2]; uint32 stackSize = 0;
+	if (nodes.GetLength()) { stack[stackSize++] = 0; }
+
+	while (stackSize && active)
+	{
+		const Node& node = nodes[stack[--stackSize]];
+
+		__m128 tNear = zero, tFar = tMax;
+		for (uint8 i = 0; i < 3; ++i) {
+			const __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.Min[i]), o[i]), inv[i]), t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.Max[i]), o[i]), inv[i]);
+			tNear = _mm_max_ps(tNear, _mm_min_ps(t0, t1)); tFar = _mm_min_ps(tFar, _mm_max_ps(t0, t1));
+		}
+
+		if (!(_mm_movemask_ps(_mm_cmple_ps(tNear, tFar)) & active)) { continue; }
+
+		if (node.Count)
+		{
+			for (uint32 t = node.First; t < node.First + node.Count; ++t)
+			{
+				const Triangle& triangle = triangles[t];
+				const __m128 e1[3] = { _mm_set1_ps(triangle.Edges[0][0]), _mm_set1_ps(triangle.Edges[0][1]), _mm_set1_ps(triangle.Edges[0][2]) };
+				const __m128 e2[3] = { _mm_set1_ps(triangle.Edges[1][0]), _mm_set1_ps(triangle.Edges[1][1]), _mm_set1_ps(triangle.Edges[1][2]) };
+
+				//Moller-Trumbore for every ray at once
+				const __m128 p[3] = { _mm_sub_ps(_mm_mul_ps(d[1], e2[2]), _mm_mul_ps(d[2], e2[1])), _mm_sub_ps(_mm_mul_ps(d[2], e2[0]), _mm_mul_ps(d[0], e2[2])), _mm_sub_ps(_mm_mul_ps(d[0], e2[1]), _mm_mul_ps(d[1], e2[0])) };
+				const __m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1[0], p[0]), _mm_mul_ps(e1[1], p[1])), _mm_mul_ps(e1[2], p[2]));
+				const __m128 inverse = _mm_div_ps(one, determinant);
+
+				const __m128 s[3] = { _mm_sub_ps(o[0], _mm_set1_ps(triangle.Vertex[0])), _mm_sub_ps(o[1], _mm_set1_ps(triangle.Vertex[1])), _mm_sub_ps(o[2], _mm_set1_ps(triangle.Vertex[2])) };
+				const __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(s[0], p[0]), _mm_mul_ps(s[1], p[1])), _mm_mul_ps(s[2], p[2])), inverse);
+
+				const __m128 q[3] = { _mm_sub_ps(_mm_mul_ps(s[1], e1[2]), _mm_mul_ps(s[2], e1[1])), _mm_sub_ps(_mm_mul_ps(s[2], e1[0]), _mm_mul_ps(s[0], e1[2])), _mm_sub_ps(_mm_mul_ps(s[0], e1[1]), _mm_mul_ps(s[1], e1[0])) };
+				const __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(d[0], q[0]), _mm_mul_ps(d[1], q[1])), _mm_mul_ps(d[2], q[2])), inverse);
+				const __m128 distance = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2[0], q[0]), _mm_mul_ps(e2[1], q[1])), _mm_mul_ps(e2[2], q[2])), inverse);
+
+				__m128 hitMask = _mm_cmpgt_ps(_mm_andnot_ps(signMask, determinant), tiny);
+				hitMask = _mm_and_ps(hitMask, _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmpge_ps(v, zero)));
+				hitMask = _mm_and_ps(hitMask, _mm_cmple_ps(_mm_add_ps(u, v), one));
+				hitMask = _mm_and_ps(hitMask, _mm_and_ps(_mm_cmpge_ps(distance, zero), _mm_cmplt_ps(distance, tMax)));
+
+				const uint32 lanes = _mm_movemask_ps(hitMask) & active;
+				if (!lanes) { continue; }
+
+				if constexpr (ANY_HIT) {
+					active &= ~lanes;
+					if (!active) { break; }
+				} else {
+					tMax = select(hitMask, distance, tMax);
+					for (uint32 l = 0; l < PACKET_SIZE; ++l) { if (lanes & (1u << l)) { hitTriangles[l] = t; } }
+				}
+			}
+
+			continue;
+		}
+
+		const Node &left = nodes[node.First], &right = nodes[node.First + 1];
+		const Float3 between{ right.Min[0] + right.Max[0] - left.Min[0] - left.Max[0], right.Min[1] + right.Max[1] - left.Min[1] - left.Max[1], right.Min[2] + right.Max[2] - left.Min[2] - left.Max[2] };
+		const bool leftFirst = Dot(between, packetDirection) > 0.0f;
+		stack[stackSize++] = node.First + leftFirst; stack[stackSize++] = node.First + !leftFirst;
+	}
+
+	if constexpr (ANY_HIT) {
+		for (uint32 l = 0; l < count; ++l) { occluded[order[l]] = !(active & (1u << l)); }
+	} else {
+		alignas(16) float32 distances[PACKET_SIZE]; _mm_store_ps(distances, tMax);
+		for (uint32 l = 0; l < count; ++l) {
+			Hit& hit = hits[order[l]];
+			hit.T = distances[l]; hit.Triangle = NULL_TRIANGLE;
+			if (hitTriangles[l] == NULL_TRIANGLE) { continue; }
+
+			const float32 direction[3] = { directions[0][l], directions[1][l], directions[2][l] };
+			fillHit(hitTriangles[l], segments[order[l]].Start, direction, hit);
+		}
+	}
+}
+
+bool TriangleBVH::Trace(const Segment& segment, Hit& hit) const { return traceRay<false>(segment, hit); }
+
+bool TriangleBVH::IsOccluded(const Segment& segment) const { Hit hit; return traceRay<true>(segment, hit); }
+
+template<typename F>
+void TriangleBVH::tracePackets(const GTSL::Range<const Segment*> segments, F&& tracePacketFunction) const
+{
+	const uint32 count = static_cast<uint32>(segments.ElementCount());
+	//quantize starts to the tree's bounds, 10 bits per axis
+	float32 min[3] = { 0, 0, 0 }, scale[3] = { 0, 0, 0 };
+	if (nodes.GetLength()) {
+		for (uint8 i = 0; i < 3; ++i) { min[i] = nodes[0].Min[i]; scale[i] = nodes[0].Max[i] > nodes[0].Min[i] ? 1023.0f / (nodes[0].Max[i] - nodes[0].Min[i]) : 0.0f; }
+	}
+
+	auto spread = [](uint32 x) { //inserts two zero bits between every bit of a 10 bit number
+		x &= 0x3FF; x = (x | x << 16) & 0x30000FF; x = (x | x << 8) & 0x300F00F; x = (x | x << 4) & 0x30C30C3; x = (x | x << 2) & 0x9249249;
+		return x;
+	};
+
+	uint64 keys[PACKET_SORT_SIZE]; uint32 order[PACKET_SORT_SIZE];
+
+	for (uint32 first = 0; first < count; first += PACKET_SORT_SIZE)
+	{
+		const uint32 chunk = GTSL::Math::Min(count - first, PACKET_SORT_SIZE);
+
+		//sort by direction octant, then along a morton curve through the starts, so packets are made of rays going the same way from close by
+		for (uint32 i = 0; i < chunk; ++i)
+		{
+			const Segment& segment = segments.begin()[first + i];
+			uint32 octant = 0, morton = 0;
+
+			for (uint8 a = 0; a < 3; ++a) {
+				octant |= (segment.End[a] < segment.Start[a]) << a;
+				const float32 q = (segment.Start[a] - min[a]) * scale[a];
+				morton |= spread(static_cast<uint32>(q < 0.0f ? 0.0f : (q > 1023.0f ? 1023.0f : q))) << a;
+			}
+
+			keys[i] = static_cast<uint64>(octant << 30 | morton) << 32 | (first + i);
+		}
+
+		std::sort(keys, keys + chunk);
+		for (uint32 i = 0; i < chunk; ++i) { order[i] = static_cast<uint32>(keys[i]); }
+
+		for (uint32 i = 0; i < chunk; i += PACKET_SIZE) { tracePacketFunction(order + i, GTSL::Math::Min(chunk - i, PACKET_SIZE)); }
+	}
+}
+
+void TriangleBVH::Trace(const GTSL::Range<const Segment*> segments, const GTSL::Range<Hit*> hits) const
+{
+	tracePackets(segments, [&](const uint32* order, const uint32 count) { tracePacket<false>(segments.begin(), order, count, hits.begin(), nullptr); });
+}
+
+void TriangleBVH::IsOccluded(const GTSL::Range<const Segment*> segments, const GTSL::Range<bool*> occluded) const
+{
+	tracePackets(segments, [&](const uint32* order, const uint32 count) { tracePacket<true>(segments.begin(), order, count, nullptr, occluded.begin()); });
+}
+
+bool TriangleBVH::SweepSphere(const Segment& segment, const float32 radius, Hit& hit) const
+{
+	hit.T = 1.0f; hit.Triangle = NULL_TRIANGLE;
+	if (!nodes.GetLength()) { return false; }
+
+	const Float3 origin = LoadFloat3(segment.Start), direction = LoadFloat3(segment.End) - origin, inverse = getInverse(direction);
+
+	uint32 stack[MAX_DEPTH * 2]; uint32 stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize)
+	{
+		const Node& node = nodes[stack[--stackSize]];
+		if (!intersectsBox(node.Min, node.Max, origin, inverse, hit.T, radius)) { continue; } //boxes grown by the radius contain every triangle the sphere can touch
+
+		if (node.Count)
+		{
+			for (uint32 t = node.First; t < node.First + node.Count; ++t)
+			{
+				const Triangle& triangle = triangles[t]; float32 distance;
+				const Float3 a = LoadFloat3(triangle.Vertex);
+				if (sweepSphereTriangle(a, a + LoadFloat3(triangle.Edges[0]), a + LoadFloat3(triangle.Edges[1]), origin, direction, radius, hit.T, distance)) { hit.T = distance; hit.Triangle = t; }
+			}
+
+			continue;
+		}
+
+		const Node &left = nodes[node.First], &right = nodes[node.First + 1];
+		const Float3 between{ right.Min[0] + right.Max[0] - left.Min[0] - left.Max[0], right.Min[1] + right.Max[1] - left.Min[1] - left.Max[1], right.Min[2] + right.Max[2] - left.Min[2] - left.Max[2] };
+		const bool leftFirst = Dot(between, direction) > 0.0f;
+		stack[stackSize++] = node.First + leftFirst; stack[stackSize++] = node.First + !leftFirst;
+	}
+
+	if (hit.Triangle == NULL_TRIANGLE) { return false; }
+
+	//the touching point is the triangle's point closest to the sphere's center where it stopped
+	const Triangle& triangle = triangles[hit.Triangle];
+	const Float3 a = LoadFloat3(triangle.Vertex), center = origin + direction * hit.T;
+	const Float3 point = getClosestPoint(center, a, a + LoadFloat3(triangle.Edges[0]), a + LoadFloat3(triangle.Edges[1]));
+	Float3 normal = center - point;
+
+	if (LengthSquared(normal) < 1e-12f) { //started with the center on the triangle
+		normal = Cross(LoadFloat3(triangle.Edges[0]), LoadFloat3(triangle.Edges[1]));
+		if (Dot(normal, direction) > 0.0f) { normal = -normal; }
+	}
+
+	StoreFloat3(point, hit.Position); StoreFloat3(normal * (1.0f / std::sqrt(LengthSquared(normal))), hit.Normal);
+	hit.Triangle = triangleIndices[hit.Triangle];
+	return true;
+}
+
+void TriangleBVH::fillHit(const uint32 triangle, const float32 origin[3], const float32 direction[3], Hit& hit) const
+{
+	const Float3 d = LoadFloat3(direction);
+	Float3 normal = Cross(LoadFloat3(triangles[triangle].Edges[0]), LoadFloat3(triangles[triangle].Edges[1]));
+	if (Dot(normal, d) > 0.0f) { normal = -normal; }
+
+	StoreFloat3(LoadFloat3(origin) + d * hit.T, hit.Position); StoreFloat3(normal * (1.0f / std::sqrt(LengthSquared(normal))), hit.Normal);
+	hit.Triangle = triangleIndices[triangle];
+}
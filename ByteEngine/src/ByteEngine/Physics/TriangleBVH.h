@@ -0,0 +1,140 @@
+#pragma once
+
+#include <GTSL/Range.h>
+#include <GTSL/Vector.hpp>
+
+#include "BroadPhase.h"
+#include "ByteEngine/Core.h"
+#include "ByteEngine/Application/AllocatorReferences.h"
+
+/**
+ * \brief Segment traced from Start to End.
+ */
+struct Segment
+{
+	float32 Start[3], End[3];
+};
+
+/**
+ * \brief Bounding volume hierarchy over static triangles, built once with the surface area heuristic and traced by rays and swept spheres.
+ * Nodes are 32 bytes, two to a cache line, and siblings are stored next to each other. Batches of rays are sorted by direction and
+ * start and traced 4 at a time with SSE, a packet goes down a node if any of it's rays hits it so rays cast from close by towards close by
+ * targets, like line of sight checks of a crowd towards a player, share most of their traversal.
+ */
+class TriangleBVH
+{
+public:
+	static constexpr uint32 NULL_TRIANGLE = 0xFFFFFFFF;
+
+	/**
+	 * \brief Triangles a leaf is allowed to have when splitting it wouldn't make it cheaper to trace.
+	 */
+	static constexpr uint32 MAX_LEAF_TRIANGLES = 4;
+
+	static constexpr uint32 PACKET_SIZE = 4;
+
+	/**
+	 * \brief Segments batched queries sort at a time to build coherent packets, bounded so sorting needs no allocations.
+	 */
+	static constexpr uint32 PACKET_SORT_SIZE = 1024;
+
+	/**
+	 * \brief What a segment hit. T is how far along the segment, 0 at Start and 1 at End, and Triangle is it's index in the built indices.
+	 * Normal points back towards where the segment came from, for sweeps it's the direction from the touching point to the sphere's center.
+	 */
+	struct Hit
+	{
+		float32 T = 1.0f; uint32 Triangle = NULL_TRIANGLE;
+		float32 Position[3], Normal[3];
+	};
+
+	void Initialize(uint32 capacity, const BE::PAR& allocator);
+
+	/**
+	 * \brief Replaces the tree with one over the triangles made by every three indices into vertices, which are x, y, z world positions.
+	 */
+	void Build(GTSL::Range<const float32*> vertices, GTSL::Range<const uint32*> indices);
+
+	[[nodiscard]] uint32 GetTriangleCount() const { return triangles.GetLength(); }
+	[[nodiscard]] uint32 GetNodeCount() const { return nodes.GetLength(); }
+
+	/**
+	 * \brief Finds the closest triangle along segment.
+	 */
+	bool Trace(const Segment& segment, Hit& hit) const;
+
+	/**
+	 * \brief Returns whether any triangle is in segment's way, which stops at the first one found.
+	 */
+	[[nodiscard]] bool IsOccluded(const Segment& segment) const;
+
+	/**
+	 * \brief Finds the closest triangle along every segment, hits[i] is segments[i]'s.
+	 */
+	void Trace(GTSL::Range<const Segment*> segments, GTSL::Range<Hit*> hits) const;
+
+	/**
+	 * \brief Sets occluded[i] to whether any triangle is in segments[i]'s way.
+	 */
+	void IsOccluded(GTSL::Range<const Segment*> segments, GTSL::Range<bool*> occluded) const;
+
+	/**
+	 * \brief Finds the first triangle a sphere of radius touches when moved along segment. A sphere starting on a triangle hits it at 0.
+	 */
+	bool SweepSphere(const Segment& segment, float32 radius, Hit& hit) const;
+
+private:
+	/**
+	 * \brief Internal nodes have a Count of 0 and their children at First and First + 1, leaves have triangles First to First + Count.
+	 */
+	struct Node
+	{
+		float32 Min[3]; uint32 First;
+		float32 Max[3]; uint32 Count;
+	};
+	static_assert(sizeof(Node) == 32, "BVH nodes must be 32 bytes.");
+
+	GTSL::Vector<Node, BE::PAR> nodes;
+
+	/**
+	 * \brief Triangles in leaf order, as a vertex and the two edges leaving it, what the ray test uses.
+	 */
+	struct Triangle
+	{
+		float32 Vertex[3], Edges[2][3];
+	};
+	GTSL::Vector<Triangle, BE::PAR> triangles;
+
+	/**
+	 * \brief Index of every triangle in leaf order in the indices it was built from.
+	 */
+	GTSL::Vector<uint32, BE::PAR> triangleIndices;
+
+	/**
+	 * \brief Bounds and centroids of triangles, only used while building.
+	 */
+	GTSL::Vector<AABB, BE::PAR> triangleBounds;
+	GTSL::Vector<float32, BE::PAR> centroids;
+
+	void split(uint32 node);
+
+	/**
+	 * \brief Fills hit's position and normal for the triangle in leaf order hit at hit.T along direction.
+	 */
+	void fillHit(uint32 triangle, const float32 origin[3], const float32 direction[3], Hit& hit) const;
+
+	template<bool ANY_HIT>
+	bool traceRay(const Segment& segment, Hit& hit) const;
+
+	/**
+	 * \brief Traces segments[order[0]] to segments[order[count - 1]] together, count is at most PACKET_SIZE. Results go to the same indices.
+	 */
+	template<bool ANY_HIT>
+	void tracePacket(const Segment* segments, const uint32* order, uint32 count, Hit* hits, bool* occluded) const;
+
+	/**
+	 * \brief Splits segments into packets of nearby segments going the same way and calls tracePacketFunction(order, count) for each.
+	 */
+	template<typename F>
+	void tracePackets(GTSL::Range<const Segment*> segments, F&& tracePacketFunction) const;
+};
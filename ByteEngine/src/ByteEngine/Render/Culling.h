@@ -2,9 +2,9 @@
 
 #include <GTSL/Math/Math.hpp>
 #include <GTSL/Math/Vector3.h>
+#include <GTSL/Math/Matrix4.h>
 
 #include "ByteEngine/Core.h"
-#include "Math/SIMD/float4.h"
 
 struct AABB;
 struct vec4;
@@ -90,8 +90,53 @@ struct vec4;
 //	_mm_store_si128((float4i *)&culling_res_sse, intersection_res_i);
 //}
 
-float32 projectSphere(const GTSL::Vector3 cameraPosition, const GTSL::Vector3 spherePosition, const float32 radius)
+inline float32 projectSphere(const GTSL::Vector3 cameraPosition, const GTSL::Vector3 spherePosition, const float32 radius)
 {
 	//return GTSL::Math::Tangent(radius / GTSL::Math::Length(cameraPosition, spherePosition));
 	return GTSL::Math::Tangent((radius * radius) / GTSL::Math::LengthSquared(spherePosition, cameraPosition));
-}
\ No newline at end of file
+}
+
+/**
+ * \brief Extracts the 6 planes of the frustum described by a projection(* view * model) matrix, in the space the matrix transforms from.
+ * Planes are stored as normal and distance, with normals pointing inwards. The near plane assumes a -w..w depth range, which is conservative for 0..w.
+ */
+inline void ExtractFrustumPlanes(const GTSL::Matrix4& matrix, float32 planes[6][4])
+{
+	for (uint32 p = 0; p < 6; ++p)
+	{
+		const uint32 row = p / 2; const float32 sign = p % 2 ? -1.0f : 1.0f;
+
+		for (uint32 c = 0; c < 4; ++c) { planes[p][c] = matrix(3, c) + sign * matrix(row, c); }
+
+		const float32 length = GTSL::Math::Length(GTSL::Vector3(planes[p][0], planes[p][1], planes[p][2]));
+		for (uint32 c = 0; c < 4; ++c) { planes[p][c] /= length; }
+	}
+}
+
+/**
+ * \brief Extracts the position of the viewer from a rigid (rotation and translation only) view matrix, in the space the matrix transforms from.
+ */
+inline void ExtractViewPosition(const GTSL::Matrix4& matrix, float32* position)
+{
+	for (uint32 c = 0; c < 3; ++c) { position[c] = -(matrix(0, c) * matrix(0, 3) + matrix(1, c) * matrix(1, 3) + matrix(2, c) * matrix(2, 3)); }
+}
+
+inline bool IsSphereInsideFrustum(const float32 planes[6][4], const float32* center, const float32 radius)
+{
+	for (uint32 p = 0; p < 6; ++p) {
+		if (planes[p][0] * center[0] + planes[p][1] * center[1] + planes[p][2] * center[2] + planes[p][3] < -radius) { return false; }
+	}
+
+	return true;
+}
+
+/**
+ * \brief Returns whether every triangle bounded by a normal cone is facing away from the camera.
+ * \param cameraPosition Camera position in the same space as the cone.
+ */
+inline bool IsConeBackfacing(const float32* cameraPosition, const float32* center, const float32 radius, const float32* coneAxis, const float32 coneCutoff)
+{
+	const GTSL::Vector3 toCenter(center[0] - cameraPosition[0], center[1] - cameraPosition[1], center[2] - cameraPosition[2]);
+	const float32 projection = toCenter.X() * coneAxis[0] + toCenter.Y() * coneAxis[1] + toCenter.Z() * coneAxis[2];
+	return projection >= coneCutoff * GTSL::Math::Length(toCenter) + radius;
+}
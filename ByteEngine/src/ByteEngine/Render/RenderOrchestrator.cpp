@@ -10,7 +10,9 @@
 #include "RenderGroup.h"
 #include "ByteEngine/Game/GameInstance.h"
 #include "ByteEngine/Game/Tasks.h"
+#include "ByteEngine/Resources/PipelineCacheResourceManager.h"
 
+#include "Culling.h"
 #include "MaterialSystem.h"
 #include "RenderState.h"
 #include "StaticMeshRenderGroup.h"
@@ -22,6 +24,11 @@ static constexpr GTSL::Vector2 SQUARE_VERTICES[] = { { -0.5f, 0.5f }, { 0.5f, 0.
 //static constexpr GTSL::Vector2 SQUARE_VERTICES[] = { { -1.0f, 1.0f }, { 1.0f, 1.0f }, { 1.0f, -1.0f }, { -1.0f, -1.0f } };
 static constexpr uint16 SQUARE_INDICES[] = { 0, 1, 3, 1, 2, 3 };
 
+/**
+ * \brief Screen space error, in pixels, a static mesh LOD may have before a finer one is selected.
+ */
+static constexpr float32 LOD_PIXEL_ERROR = 1.0f;
+
 void StaticMeshRenderManager::Initialize(const InitializeInfo& initializeInfo)
 {
 	auto* renderSystem = initializeInfo.GameInstance->GetSystem<RenderSystem>("RenderSystem");
@@ -44,6 +51,9 @@ void StaticMeshRenderManager::Initialize(const InitializeInfo& initializeInfo)
 	
 	//TODO: MAKE A CORRECT PATH FOR DECLARING RENDER PASSES
 
+	instanceClusters.Initialize(16, GetPersistentAllocator());
+	visibleClusters.Initialize(256, GetPersistentAllocator());
+
 	auto bufferHandle = materialSystem->CreateBuffer(renderSystem, members);
 	materialSystem->BindBufferToName(bufferHandle, "StaticMeshRenderGroup");
 	renderOrchestrator->AddToRenderPass("SceneRenderPass", "StaticMeshRenderGroup");
@@ -53,7 +63,7 @@ void StaticMeshRenderManager::Initialize(const InitializeInfo& initializeInfo)
 
 void StaticMeshRenderManager::GetSetupAccesses(GTSL::Array<TaskDependency, 16>& dependencies)
 {
-	dependencies.EmplaceBack(TaskDependency{ "StaticMeshRenderGroup", AccessTypes::READ });
+	dependencies.EmplaceBack(TaskDependency{ "StaticMeshRenderGroup", AccessTypes::READ_WRITE }); //requests LOD loads
 }
 
 void StaticMeshRenderManager::Setup(const SetupInfo& info)
@@ -77,6 +87,14 @@ void StaticMeshRenderManager::Setup(const SetupInfo& info)
 	
 	MaterialSystem::BufferIterator bufferIterator;
 	info.MaterialSystem->UpdateIteratorMember(bufferIterator, matrixUniformBufferMemberHandle);
+
+	instanceClusters.ResizeDown(0); visibleClusters.ResizeDown(0);
+
+	float32 cameraPosition[3]; ExtractViewPosition(info.ViewMatrix, cameraPosition);
+
+	//a LOD is good enough when it's error covers less than LOD_PIXEL_ERROR pixels, compared in projectSphere's squared angle terms
+	const float32 pixelAngle = 2.0f / (GTSL::Math::Abs(info.ProjectionMatrix(1, 1)) * info.RenderSystem->GetRenderExtent().Height);
+	const float32 lodThreshold = GTSL::Math::Tangent(pixelAngle * pixelAngle * LOD_PIXEL_ERROR * LOD_PIXEL_ERROR);
 	
 	{
 		uint32 index = 0;
@@ -88,6 +106,31 @@ void StaticMeshRenderManager::Setup(const SetupInfo& info)
 			
 			//*info.MaterialSystem->GetMemberPointer<GTSL::Matrix4>(bufferIterator) = info.ProjectionMatrix * info.ViewMatrix * pos;
 			*info.MaterialSystem->GetMemberPointer<GTSL::Matrix4>(bufferIterator) = pos;
+
+			InstanceClusters clusters; clusters.FirstCluster = visibleClusters.GetLength();
+
+			if (const uint8 lodCount = renderGroup->GetLODCount(index))
+			{
+				const GTSL::Vector3 instancePosition(e.X(), e.Y(), -e.Z());
+				
+				uint8 lod = 0; //coarsest LOD which's error projects under the threshold
+				for (uint8 l = lodCount - 1; l > 0; --l) {
+					if (projectSphere(GTSL::Vector3(cameraPosition[0], cameraPosition[1], cameraPosition[2]), instancePosition, renderGroup->GetLODError(index, l)) <= lodThreshold) { lod = l; break; }
+				}
+
+				renderGroup->RequestLOD(info.GameInstance, index, lod);
+
+				//until the selected LOD streams in draw the closest one available
+				const uint8 loadedLOD = renderGroup->GetClosestLoadedLOD(index, lod);
+
+				if (loadedLOD != 0xFF)
+				{
+					clusters.HasLOD = true; clusters.Mesh = renderGroup->GetLODMesh(index, loadedLOD);
+					cullMeshlets(info, clusters, renderGroup->GetMeshlets(index, loadedLOD), pos);
+				}
+			}
+
+			instanceClusters.EmplaceBack(clusters);
 			info.MaterialSystem->UpdateIteratorMemberIndex(bufferIterator, ++index);
 		}
 	}
@@ -97,6 +140,36 @@ void StaticMeshRenderManager::Setup(const SetupInfo& info)
 	//clear updated meshes
 }
 
+void StaticMeshRenderManager::cullMeshlets(const SetupInfo& info, InstanceClusters& clusters, const GTSL::Range<const Meshlet*> meshlets, const GTSL::Matrix4& modelMatrix)
+{
+	clusters.Clustered = meshlets.ElementCount() != 0;
+
+	if (clusters.Clustered)
+	{
+		const auto modelView = info.ViewMatrix * modelMatrix;
+
+		//planes and camera are brought to object space so meshlet bounds don't have to be transformed
+		float32 planes[6][4]; ExtractFrustumPlanes(info.ProjectionMatrix * modelView, planes);
+
+		float32 cameraPosition[3]; ExtractViewPosition(modelView, cameraPosition);
+
+		for (const auto& meshlet : meshlets)
+		{
+			if (!IsSphereInsideFrustum(planes, meshlet.Center, meshlet.Radius)) { continue; }
+			if (IsConeBackfacing(cameraPosition, meshlet.Center, meshlet.Radius, meshlet.ConeAxis, meshlet.ConeCutoff)) { continue; }
+
+			if (clusters.ClusterCount) //extend the last range when this meshlet continues it
+			{
+				auto& last = visibleClusters[visibleClusters.GetLength() - 1];
+				if (last.FirstIndex + last.IndexCount == meshlet.FirstIndex) { last.IndexCount += meshlet.IndexCount; continue; }
+			}
+
+			visibleClusters.EmplaceBack(ClusterRange{ meshlet.FirstIndex, meshlet.IndexCount });
+			++clusters.ClusterCount;
+		}
+	}
+}
+
 void UIRenderManager::Initialize(const InitializeInfo& initializeInfo)
 {
 	auto* renderSystem = initializeInfo.GameInstance->GetSystem<RenderSystem>("RenderSystem");
@@ -354,6 +427,18 @@ void RenderOrchestrator::Initialize(const InitializeInfo& initializeInfo)
 		onShadersLoadHandle = initializeInfo.GameInstance->StoreDynamicTask("onShadersLoaded", Task<MaterialResourceManager*, GTSL::Array<MaterialResourceManager::ShaderInfo, 8>, GTSL::Range<byte*>, ShaderLoadInfo>::Create<RenderOrchestrator, &RenderOrchestrator::onShadersLoaded>(this), taskDependencies);
 	}
 
+	{
+		const auto taskDependencies = GTSL::Array<TaskDependency, 4>{ { "RenderSystem", AccessTypes::READ_WRITE }, { "RenderOrchestrator", AccessTypes::READ_WRITE } };
+		auto onTextureReloadHandle = initializeInfo.GameInstance->StoreDynamicTask("onTextureReload", Task<Id>::Create<RenderOrchestrator, &RenderOrchestrator::onTextureReload>(this), taskDependencies);
+		initializeInfo.GameInstance->SubscribeToEvent("RenderOrchestrator", TextureResourceManager::GetOnTextureReloadEventHandle(), onTextureReloadHandle);
+	}
+
+	{
+		const auto taskDependencies = GTSL::Array<TaskDependency, 4>{ { "RenderSystem", AccessTypes::READ_WRITE }, { "MaterialSystem", AccessTypes::READ_WRITE }, { "RenderOrchestrator", AccessTypes::READ_WRITE } };
+		auto onMaterialReloadHandle = initializeInfo.GameInstance->StoreDynamicTask("onMaterialReload", Task<Id>::Create<RenderOrchestrator, &RenderOrchestrator::onMaterialReload>(this), taskDependencies);
+		initializeInfo.GameInstance->SubscribeToEvent("RenderOrchestrator", MaterialResourceManager::GetOnMaterialReloadEventHandle(), onMaterialReloadHandle);
+	}
+
 	{
 		GTSL::Array<MaterialSystem::SubSetInfo, 10> subSetInfos;
 
@@ -861,12 +946,16 @@ void RenderOrchestrator::RemoveRenderManager(GameInstance* gameInstance, const I
 }
 
 MaterialInstanceHandle RenderOrchestrator::CreateMaterial(const CreateMaterialInfo& info)
+{
+	loadMaterial(info, materials.Emplace());
+	return info.MaterialName;
+}
+
+void RenderOrchestrator::loadMaterial(const CreateMaterialInfo& info, const uint32 materialIndex)
 {
 	uint32 material_size = 0;
 	info.MaterialResourceManager->GetMaterialSize(info.MaterialName, material_size);
 
-	auto materialIndex = materials.Emplace();
-
 	GTSL::Buffer<BE::PAR> material_buffer; material_buffer.Allocate(material_size, 32, GetPersistentAllocator());
 
 	const auto acts_on = GTSL::Array<TaskDependency, 16>{ { "RenderSystem", AccessTypes::READ_WRITE }, { "MaterialSystem", AccessTypes::READ_WRITE }, { "RenderOrchestrator", AccessTypes::READ_WRITE } };
@@ -879,8 +968,32 @@ MaterialInstanceHandle RenderOrchestrator::CreateMaterial(const CreateMaterialIn
 	material_load_info.UserData = DYNAMIC_TYPE(MaterialLoadInfo, matLoadInfo);
 	material_load_info.OnMaterialLoad = Task<MaterialResourceManager::OnMaterialLoadInfo>::Create<RenderOrchestrator, &RenderOrchestrator::onMaterialLoaded>(this);
 	info.MaterialResourceManager->LoadMaterial(material_load_info);
+}
 
-	return info.MaterialName;
+void RenderOrchestrator::onTextureReload(TaskInfo taskInfo, const Id textureName)
+{
+	auto textureReference = texturesRefTable.TryGet(textureName);
+	if (!textureReference.State()) { return; } //not in use, next load will read the new data
+
+	auto textureLoadInfo = TextureLoadInfo(textureReference.Get(), taskInfo.GameInstance->GetSystem<RenderSystem>("RenderSystem"), RenderAllocation());
+	textureLoadInfo.Reload = true;
+
+	auto* textureResourceManager = BE::Application::Get()->GetResourceManager<TextureResourceManager>("TextureResourceManager");
+	textureResourceManager->LoadTextureInfo(taskInfo.GameInstance, textureName, onTextureInfoLoadHandle, GTSL::MoveRef(textureLoadInfo));
+}
+
+void RenderOrchestrator::onMaterialReload(TaskInfo taskInfo, const Id materialName)
+{
+	auto material = loadedMaterials.TryGet(materialName);
+	if (!material.State()) { return; }
+
+	CreateMaterialInfo createMaterialInfo;
+	createMaterialInfo.MaterialName = materialName;
+	createMaterialInfo.GameInstance = taskInfo.GameInstance;
+	createMaterialInfo.RenderSystem = taskInfo.GameInstance->GetSystem<RenderSystem>("RenderSystem");
+	createMaterialInfo.MaterialResourceManager = BE::Application::Get()->GetResourceManager<MaterialResourceManager>("MaterialResourceManager");
+	createMaterialInfo.TextureResourceManager = BE::Application::Get()->GetResourceManager<TextureResourceManager>("TextureResourceManager");
+	loadMaterial(createMaterialInfo, material.Get());
 }
 
 void RenderOrchestrator::AddAttachment(Id name, uint8 bitDepth, uint8 componentCount, GAL::ComponentType compType, TextureType::value_type type, GTSL::RGBA clearColor)
@@ -1405,10 +1518,14 @@ AccessFlags::value_type RenderOrchestrator::accessFlagsFromStageAndAccessType(Pi
 	return accessFlags;
 }
 
-void RenderOrchestrator::renderScene(GameInstance*, RenderSystem* renderSystem, MaterialSystem* materialSystem, CommandBuffer commandBuffer, Id rp)
-{	
+void RenderOrchestrator::renderScene(GameInstance* gameInstance, RenderSystem* renderSystem, MaterialSystem* materialSystem, CommandBuffer commandBuffer, Id rp)
+{
+	auto* staticMeshRenderManager = gameInstance->GetSystem<StaticMeshRenderManager>("StaticMeshRenderManager");
+	
 	for (auto rg : renderPassesMap.At(rp).RenderGroups)
 	{
+		const bool clustered = rg == Id("StaticMeshRenderGroup");
+
 		auto renderGroupIndexStream = AddIndexStream();
 		BindData(renderSystem, materialSystem, commandBuffer, materialSystem->GetBuffer(rg));
 
@@ -1429,7 +1546,23 @@ void RenderOrchestrator::renderScene(GameInstance*, RenderSystem* renderSystem,
 				for (auto meshHandle : meshes)
 				{
 					UpdateIndexStream(renderGroupIndexStream, commandBuffer, renderSystem, materialSystem, meshHandle.InstanceIndex);
-					renderSystem->RenderMesh(meshHandle.Handle, meshHandle.InstanceCount);
+
+					if (clustered && staticMeshRenderManager->IsClustered(meshHandle.InstanceIndex))
+					{
+						const auto lodMesh = staticMeshRenderManager->GetLODMesh(meshHandle.InstanceIndex);
+						
+						for (auto cluster : staticMeshRenderManager->GetVisibleClusters(meshHandle.InstanceIndex)) {
+							renderSystem->RenderMeshRange(lodMesh, cluster.FirstIndex, cluster.IndexCount, meshHandle.InstanceCount);
+						}
+					}
+					else if (clustered && staticMeshRenderManager->HasLOD(meshHandle.InstanceIndex))
+					{
+						renderSystem->RenderMesh(staticMeshRenderManager->GetLODMesh(meshHandle.InstanceIndex), meshHandle.InstanceCount);
+					}
+					else
+					{
+						renderSystem->RenderMesh(meshHandle.Handle, meshHandle.InstanceCount);
+					}
 				}
 			}
 
@@ -1623,7 +1756,10 @@ void RenderOrchestrator::onMaterialLoaded(TaskInfo taskInfo, MaterialResourceMan
 
 	auto* renderSystem = loadInfo->RenderSystem;
 
-	material.MaterialInstances.Initialize(8, GetPersistentAllocator());
+	//shaders were reloaded, the rest of the material is unchanged
+	const bool reload = loadedMaterials.Find(onMaterialLoadInfo.ResourceName);
+
+	if (!reload) { material.MaterialInstances.Initialize(8, GetPersistentAllocator()); }
 
 	material.RenderGroup = onMaterialLoadInfo.RenderGroup;
 	material.Parameters = onMaterialLoadInfo.Parameters;
@@ -1681,8 +1817,26 @@ void RenderOrchestrator::onMaterialLoaded(TaskInfo taskInfo, MaterialResourceMan
 		}
 
 		createInfo.PipelineLayout = materialSystem->GetSetLayoutPipelineLayout(Id("GlobalData"));
-		createInfo.PipelineCache = renderSystem->GetPipelineCache();
-		material.Pipeline = RasterizationPipeline(createInfo);
+
+		PipelineCacheResourceManager::PipelineKey pipelineKey;
+		for (auto e : shaderInfos) { pipelineKey.Add(e.Type); pipelineKey.Add(e.Blob); }
+		for (auto e : onMaterialLoadInfo.VertexElements) { pipelineKey.Add(e); }
+		pipelineKey.Add(onMaterialLoadInfo.BlendEnable); pipelineKey.Add(onMaterialLoadInfo.CullMode); pipelineKey.Add(onMaterialLoadInfo.DepthTest);
+		pipelineKey.Add(onMaterialLoadInfo.DepthWrite); pipelineKey.Add(onMaterialLoadInfo.StencilTest); pipelineKey.Add(onMaterialLoadInfo.ColorBlendOperation);
+		for (const auto& stencilState : { onMaterialLoadInfo.Front, onMaterialLoadInfo.Back }) {
+			pipelineKey.Add(stencilState.FailOperation); pipelineKey.Add(stencilState.PassOperation); pipelineKey.Add(stencilState.DepthFailOperation);
+			pipelineKey.Add(stencilState.CompareOperation); pipelineKey.Add(stencilState.CompareMask); pipelineKey.Add(stencilState.WriteMask); pipelineKey.Add(stencilState.Reference);
+		}
+		pipelineKey.Add(onMaterialLoadInfo.RenderPass.GetID()); pipelineKey.Add(createInfo.SubPass); pipelineKey.Add(createInfo.AttachmentCount);
+
+		createInfo.PipelineCache = renderSystem->CreatePipelineCache(pipelineKey());
+		material.Pipeline = RasterizationPipeline(createInfo); //a replaced pipeline is not destroyed as frames in flight may still be using it
+		renderSystem->StorePipelineCache(pipelineKey(), createInfo.PipelineCache);
+	}
+
+	if (reload) {
+		GTSL::Delete(loadInfo, GetPersistentAllocator());
+		return;
 	}
 
 	{
@@ -1739,6 +1893,8 @@ void RenderOrchestrator::onMaterialLoaded(TaskInfo taskInfo, MaterialResourceMan
 			{
 				uint32 textureComponentIndex;
 
+				loadInfo->TextureResourceManager->RecordDependency(Id("MaterialResourceManager"), onMaterialLoadInfo.ResourceName, Id(resourceMaterialInstanceParameter.Second.TextureReference));
+
 				auto textureReference = texturesRefTable.TryGet(resourceMaterialInstanceParameter.Second.TextureReference);
 
 				if (!textureReference.State())
@@ -1785,7 +1941,10 @@ void RenderOrchestrator::onMaterialLoaded(TaskInfo taskInfo, MaterialResourceMan
 void RenderOrchestrator::onTextureInfoLoad(TaskInfo taskInfo, TextureResourceManager* resourceManager,
 	TextureResourceManager::TextureInfo textureInfo, TextureLoadInfo loadInfo)
 {
-	loadInfo.TextureHandle = loadInfo.RenderSystem->CreateTexture(textureInfo.Format, textureInfo.Extent, TextureUse::SAMPLE | TextureUse::COLOR_ATTACHMENT, true);
+	TextureUses textureUses = TextureUse::SAMPLE;
+	if (textureInfo.Compression == BlockCompression::NONE) { textureUses |= TextureUse::COLOR_ATTACHMENT; } //block compressed formats can't be rendered to
+	
+	loadInfo.TextureHandle = loadInfo.RenderSystem->CreateTexture(textureInfo.Format, textureInfo.Extent, textureUses, true, textureInfo.Compression);
 
 	auto dataBuffer = loadInfo.RenderSystem->GetTextureRange(loadInfo.TextureHandle);
 
@@ -1801,7 +1960,7 @@ void RenderOrchestrator::onTextureLoad(TaskInfo taskInfo, TextureResourceManager
 
 	materialSystem->WriteSetTexture(loadInfo.RenderSystem, textureSubsetsHandle, loadInfo.TextureHandle, loadInfo.Component);
 	
-	latestLoadedTextures.EmplaceBack(loadInfo.Component);
+	if (!loadInfo.Reload) { latestLoadedTextures.EmplaceBack(loadInfo.Component); }
 }
 
 void RenderOrchestrator::setMaterialInstanceAsLoaded(const PrivateMaterialHandle privateMaterialHandle, const MaterialInstanceHandle materialInstanceHandle)
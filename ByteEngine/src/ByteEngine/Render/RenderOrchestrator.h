@@ -13,6 +13,7 @@
 #include "RenderSystem.h"
 #include "RenderTypes.h"
 #include "ByteEngine/Game/Tasks.h"
+#include "ByteEngine/Resources/MeshOptimization.h"
 
 class RenderOrchestrator;
 class RenderState;
@@ -47,9 +48,41 @@ class StaticMeshRenderManager : public RenderManager
 
 	void Setup(const SetupInfo& info) override;
 
+public:
+	struct ClusterRange { uint32 FirstIndex, IndexCount; };
+
+	/**
+	 * \brief Returns whether an instance was given a LOD this frame, instances without one are drawn with the mesh they were added with.
+	 */
+	bool HasLOD(const uint32 instance) const { return instance < instanceClusters.GetLength() && instanceClusters[instance].HasLOD; }
+
+	/**
+	 * \brief Returns the mesh of the LOD selected for an instance this frame.
+	 */
+	RenderSystem::MeshHandle GetLODMesh(const uint32 instance) const { return instanceClusters[instance].Mesh; }
+
+	/**
+	 * \brief Returns whether an instance was culled per meshlet this frame. Instances whose mesh has no meshlets loaded have to be drawn whole.
+	 */
+	bool IsClustered(const uint32 instance) const { return instance < instanceClusters.GetLength() && instanceClusters[instance].Clustered; }
+
+	/**
+	 * \brief Returns the index ranges of an instance's meshlets that passed frustum and backface cone culling this frame. Consecutive visible meshlets are merged into one range.
+	 */
+	GTSL::Range<const ClusterRange*> GetVisibleClusters(const uint32 instance) const
+	{
+		return GTSL::Range<const ClusterRange*>(instanceClusters[instance].ClusterCount, visibleClusters.begin() + instanceClusters[instance].FirstCluster);
+	}
+
 private:
 	MemberHandle matrixUniformBufferMemberHandle;
 
+	struct InstanceClusters { RenderSystem::MeshHandle Mesh; uint32 FirstCluster = 0, ClusterCount = 0; bool HasLOD = false, Clustered = false; };
+	GTSL::Vector<InstanceClusters, BE::PAR> instanceClusters;
+	GTSL::Vector<ClusterRange, BE::PAR> visibleClusters;
+
+	void cullMeshlets(const SetupInfo& info, InstanceClusters& clusters, GTSL::Range<const Meshlet*> meshlets, const GTSL::Matrix4& modelMatrix);
+
 	SetHandle dataSet;
 };
 
@@ -348,6 +381,21 @@ private:
 	};
 	void onMaterialLoaded(TaskInfo taskInfo, MaterialResourceManager::OnMaterialLoadInfo onMaterialLoadInfo);
 
+	/**
+	 * \brief Loads a material's shaders into materials[materialIndex]. If the material is already loaded only it's pipeline is rebuilt.
+	 */
+	void loadMaterial(const CreateMaterialInfo& info, uint32 materialIndex);
+
+	/**
+	 * \brief Reloads a texture in use after it's source file changed. The new texture is written to the same descriptor slot so materials don't need updating.
+	 */
+	void onTextureReload(TaskInfo taskInfo, Id textureName);
+
+	/**
+	 * \brief Rebuilds a loaded material's pipeline after it's shaders were recompiled.
+	 */
+	void onMaterialReload(TaskInfo taskInfo, Id materialName);
+
 	//struct MaterialInstanceData
 	//{
 	//	
@@ -405,6 +453,10 @@ private:
 		RenderSystem* RenderSystem;
 		RenderAllocation RenderAllocation;
 		RenderSystem::TextureHandle TextureHandle;
+		/**
+		 * \brief Whether the texture replaces one already in use, in which case materials waiting on it have already been notified.
+		 */
+		bool Reload = false;
 	};
 	void onTextureInfoLoad(TaskInfo taskInfo, TextureResourceManager* resourceManager, TextureResourceManager::TextureInfo textureInfo, TextureLoadInfo loadInfo);
 	void onTextureLoad(TaskInfo taskInfo, TextureResourceManager* resourceManager, TextureResourceManager::TextureInfo textureInfo, TextureLoadInfo loadInfo);
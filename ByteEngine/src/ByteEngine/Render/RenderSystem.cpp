@@ -230,20 +230,39 @@ void RenderSystem::InitializeRenderer(const InitializeRendererInfo& initializeRe
 		textureCopyDatas.EmplaceBack(64, GetPersistentAllocator());
 	}
 
-	bool pipelineCacheAvailable;
-	initializeRenderer.PipelineCacheResourceManager->DoesCacheExist(pipelineCacheAvailable);
+	pipelineCacheResourceManager = initializeRenderer.PipelineCacheResourceManager;
+
+	{
+		PipelineCacheResourceManager::DeviceIdentity deviceIdentity;
+
+		//every pipeline cache's data starts with the identity of the device and driver, read it from an empty one
+		PipelineCache::CreateInfo emptyCacheCreateInfo;
+		emptyCacheCreateInfo.RenderDevice = GetRenderDevice();
+		emptyCacheCreateInfo.ExternallySync = true;
+		PipelineCache emptyCache(emptyCacheCreateInfo);
+
+		uint32 emptyCacheSize = 0;
+		emptyCache.GetCacheSize(GetRenderDevice(), emptyCacheSize);
+
+		GTSL::Buffer<BE::TAR> emptyCacheBuffer; emptyCacheBuffer.Allocate(emptyCacheSize, 32, GetTransientAllocator());
+		emptyCache.GetCache(&renderDevice, emptyCacheBuffer.GetBufferInterface());
+		PipelineCacheResourceManager::DeviceIdentity::FromCacheData(GTSL::Range<const byte*>(emptyCacheBuffer.GetLength(), emptyCacheBuffer.GetData()), deviceIdentity);
+
+		emptyCache.Destroy(&renderDevice);
+
+		pipelineCacheResourceManager->Open(deviceIdentity);
+	}
+
+	const uint32 cacheSize = pipelineCacheResourceManager->GetEntrySize(PipelineCacheResourceManager::MERGED_CACHE_KEY);
 
 	pipelineCaches.Initialize(BE::Application::Get()->GetNumberOfThreads(), GetPersistentAllocator());
 	
-	if(pipelineCacheAvailable)
+	if(cacheSize)
 	{
-		uint32 cacheSize = 0;
-		initializeRenderer.PipelineCacheResourceManager->GetCacheSize(cacheSize);
-
 		GTSL::Buffer<BE::TAR> pipelineCacheBuffer;
 		pipelineCacheBuffer.Allocate(cacheSize, 32, GetTransientAllocator());
 
-		initializeRenderer.PipelineCacheResourceManager->GetCache(pipelineCacheBuffer);
+		pipelineCacheResourceManager->ReadEntry(PipelineCacheResourceManager::MERGED_CACHE_KEY, pipelineCacheBuffer);
 		
 		PipelineCache::CreateInfo pipelineCacheCreateInfo;
 		pipelineCacheCreateInfo.RenderDevice = GetRenderDevice();
@@ -280,6 +299,38 @@ void RenderSystem::InitializeRenderer(const InitializeRendererInfo& initializeRe
 
 PipelineCache RenderSystem::GetPipelineCache() const { return pipelineCaches[GTSL::Thread::ThisTreadID()]; }
 
+PipelineCache RenderSystem::CreatePipelineCache(const uint64 key)
+{
+	PipelineCache::CreateInfo pipelineCacheCreateInfo;
+	pipelineCacheCreateInfo.RenderDevice = GetRenderDevice();
+	pipelineCacheCreateInfo.ExternallySync = true; //only used by the thread creating the pipeline
+
+	GTSL::Buffer<BE::TAR> pipelineCacheBuffer;
+
+	if (const auto size = pipelineCacheResourceManager->GetEntrySize(key)) {
+		pipelineCacheBuffer.Allocate(size, 32, GetTransientAllocator());
+		pipelineCacheResourceManager->ReadEntry(key, pipelineCacheBuffer);
+		pipelineCacheCreateInfo.Data = pipelineCacheBuffer;
+	}
+
+	return PipelineCache(pipelineCacheCreateInfo);
+}
+
+void RenderSystem::StorePipelineCache(const uint64 key, PipelineCache pipelineCache)
+{
+	if (!pipelineCacheResourceManager->GetEntrySize(key))
+	{
+		uint32 cacheSize = 0;
+		pipelineCache.GetCacheSize(GetRenderDevice(), cacheSize);
+
+		GTSL::Buffer<BE::TAR> pipelineCacheBuffer; pipelineCacheBuffer.Allocate(cacheSize, 32, GetTransientAllocator());
+		pipelineCache.GetCache(&renderDevice, pipelineCacheBuffer.GetBufferInterface());
+		pipelineCacheResourceManager->WriteEntry(key, GTSL::Range<const byte*>(pipelineCacheBuffer.GetLength(), pipelineCacheBuffer.GetData()));
+	}
+
+	pipelineCache.Destroy(&renderDevice);
+}
+
 RenderSystem::MeshHandle RenderSystem::CreateRayTracedMesh(const CreateRayTracingMeshInfo& info)
 {
 	auto& localMesh = meshes[info.SharedMesh()]; BE_ASSERT(localMesh.MeshAllocation.Data, "!");
@@ -455,6 +506,16 @@ void RenderSystem::RenderMesh(MeshHandle handle, const uint32 instanceCount)
 	graphicsCommandBuffers[GetCurrentFrame()].DrawIndexed(GetRenderDevice(), mesh.IndicesCount, instanceCount);
 }
 
+void RenderSystem::RenderMeshRange(MeshHandle handle, const uint32 firstIndex, const uint32 indexCount, const uint32 instanceCount)
+{
+	auto& mesh = meshes[handle()];
+
+	//range is selected by offsetting the index buffer binding, as DrawIndexed always starts at the first bound index
+	graphicsCommandBuffers[GetCurrentFrame()].BindVertexBuffer(GetRenderDevice(), mesh.Buffer, 0);
+	graphicsCommandBuffers[GetCurrentFrame()].BindIndexBuffer(GetRenderDevice(), mesh.Buffer, GTSL::Math::RoundUpByPowerOf2(mesh.VertexSize * mesh.VertexCount, GetBufferSubDataAlignment()) + firstIndex * mesh.IndexSize, SelectIndexType(mesh.IndexSize));
+	graphicsCommandBuffers[GetCurrentFrame()].DrawIndexed(GetRenderDevice(), indexCount, instanceCount);
+}
+
 void RenderSystem::SetMeshMatrix(const MeshHandle meshHandle, const GTSL::Matrix4& matrix)
 {
 	const auto& mesh = meshes[meshHandle()];
@@ -613,12 +674,10 @@ void RenderSystem::Shutdown(const ShutdownInfo& shutdownInfo)
 
 		if (cacheSize)
 		{
-			auto* pipelineCacheResourceManager = BE::Application::Get()->GetResourceManager<PipelineCacheResourceManager>("PipelineCacheResourceManager");
-			
 			GTSL::Buffer<BE::TAR> pipelineCacheBuffer;
 			pipelineCacheBuffer.Allocate(cacheSize, 32, GetTransientAllocator());
 			pipelineCache.GetCache(&renderDevice, pipelineCacheBuffer.GetBufferInterface());
-			pipelineCacheResourceManager->WriteCache(pipelineCacheBuffer);
+			pipelineCacheResourceManager->WriteEntry(PipelineCacheResourceManager::MERGED_CACHE_KEY, GTSL::Range<const byte*>(pipelineCacheBuffer.GetLength(), pipelineCacheBuffer.GetData()));
 		}
 	}
 }
@@ -862,7 +921,7 @@ void RenderSystem::executeTransfers(TaskInfo taskInfo)
 	//}
 }
 
-RenderSystem::TextureHandle RenderSystem::CreateTexture(GAL::FormatDescriptor formatDescriptor, GTSL::Extent3D extent, TextureUses textureUses, bool updatable)
+RenderSystem::TextureHandle RenderSystem::CreateTexture(GAL::FormatDescriptor formatDescriptor, GTSL::Extent3D extent, TextureUses textureUses, bool updatable, BlockCompression blockCompression)
 {
 	//RenderDevice::FindSupportedImageFormat findFormat;
 	//findFormat.TextureTiling = TextureTiling::OPTIMAL;
@@ -878,7 +937,7 @@ RenderSystem::TextureHandle RenderSystem::CreateTexture(GAL::FormatDescriptor fo
 	textureComponent.Extent = extent;
 	
 	textureComponent.FormatDescriptor = formatDescriptor;
-	auto format = static_cast<TextureFormat>(GAL::FormatToVkFomat(GAL::MakeFormatFromFormatDescriptor(formatDescriptor)));
+	auto format = blockCompression == BlockCompression::NONE ? static_cast<TextureFormat>(GAL::FormatToVkFomat(GAL::MakeFormatFromFormatDescriptor(formatDescriptor))) : ConvertFormat(blockCompression);
 
 	auto textureDimensions = GAL::VulkanDimensionsFromExtent(extent);
 
@@ -902,7 +961,7 @@ RenderSystem::TextureHandle RenderSystem::CreateTexture(GAL::FormatDescriptor fo
 
 	textureComponent.Layout = TextureLayout::UNDEFINED;
 
-	auto textureSize = extent.Width * extent.Height * extent.Depth * formatDescriptor.GetSize();
+	auto textureSize = blockCompression == BlockCompression::NONE ? extent.Width * extent.Height * extent.Depth * formatDescriptor.GetSize() : GetCompressedSize(blockCompression, extent.Width, extent.Height) * extent.Depth;
 	
 	if (updatable && needsStagingBuffer)
 	{
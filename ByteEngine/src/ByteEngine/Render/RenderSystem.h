@@ -198,6 +198,17 @@ public:
 
 	[[nodiscard]] PipelineCache GetPipelineCache() const;
 
+	/**
+	 * \brief Creates a cache for a single pipeline, holding the data stored under key if there is any. Can be called from any thread.
+	 * \param key Hash of everything that affects the compiled pipeline, see PipelineCacheResourceManager::PipelineKey.
+	 */
+	[[nodiscard]] PipelineCache CreatePipelineCache(uint64 key);
+
+	/**
+	 * \brief Stores the data of the pipeline created with pipelineCache under key, if none was stored for it, and destroys the cache.
+	 */
+	void StorePipelineCache(uint64 key, PipelineCache pipelineCache);
+
 	[[nodiscard]] GTSL::Range<const Texture*> GetSwapchainTextures() const { return swapchainTextures; }
 
 	MAKE_HANDLE(uint32, Mesh)
@@ -217,6 +228,11 @@ public:
 	
 	void RenderMesh(MeshHandle handle, const uint32 instanceCount = 1);
 
+	/**
+	 * \brief Draws a contiguous range of a mesh's indices, used to draw only the clusters of a mesh that survived culling.
+	 */
+	void RenderMeshRange(MeshHandle handle, uint32 firstIndex, uint32 indexCount, const uint32 instanceCount = 1);
+
 	byte* GetMeshPointer(MeshHandle sharedMesh) const
 	{
 		const auto& mesh = meshes[sharedMesh()];
@@ -260,7 +276,10 @@ public:
 
 	void SetWindow(GTSL::Window* window) { this->window = window; }
 
-	[[nodiscard]] TextureHandle CreateTexture(GAL::FormatDescriptor formatDescriptor, GTSL::Extent3D extent, TextureUses textureUses, bool updatable);
+	/**
+	 * \brief Creates a texture. If blockCompression is not NONE the texture is created in that block compressed format and formatDescriptor describes the decoded texels.
+	 */
+	[[nodiscard]] TextureHandle CreateTexture(GAL::FormatDescriptor formatDescriptor, GTSL::Extent3D extent, TextureUses textureUses, bool updatable, BlockCompression blockCompression = BlockCompression::NONE);
 	void UpdateTexture(const TextureHandle textureHandle);
 	GTSL::Range<byte*> GetTextureRange(TextureHandle textureHandle) { return GTSL::Range<byte*>(textures[textureHandle()].ScratchAllocation.Size, static_cast<byte*>(textures[textureHandle()].ScratchAllocation.Data)); }
 	GTSL::Range<const byte*> GetTextureRange(TextureHandle textureHandle) const { return GTSL::Range<const byte*>(textures[textureHandle()].ScratchAllocation.Size, static_cast<const byte*>(textures[textureHandle()].ScratchAllocation.Data)); }
@@ -400,6 +419,7 @@ private:
 	LocalMemoryAllocator localMemoryAllocator;
 
 	Vector<PipelineCache> pipelineCaches;
+	class PipelineCacheResourceManager* pipelineCacheResourceManager = nullptr;
 
 	uint32 shaderGroupAlignment = 0, shaderGroupBaseAlignment = 0, shaderGroupHandleSize = 0;
 	uint32 scratchBufferOffsetAlignment = 0;
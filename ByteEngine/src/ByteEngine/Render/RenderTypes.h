@@ -3,6 +3,7 @@
 #include "ByteEngine/Core.h"
 
 #include "ByteEngine/Debug/Assert.h"
+#include "ByteEngine/Resources/TextureCompression.h"
 
 #include <GAL/Vulkan/Vulkan.h>
 #include <GAL/Vulkan/VulkanMemory.h>
@@ -187,6 +188,35 @@ inline TextureFormat ConvertFormat(const GAL::Format format)
 	}
 }
 
+/**
+ * \brief Block compressed formats GAL's format enum doesn't name yet, values are the matching VkFormat enumerants.
+ */
+namespace BlockCompressedFormats
+{
+	inline constexpr auto BC1_RGBA_UNORM = static_cast<TextureFormat>(133); //VK_FORMAT_BC1_RGBA_UNORM_BLOCK
+	inline constexpr auto BC3_UNORM = static_cast<TextureFormat>(137); //VK_FORMAT_BC3_UNORM_BLOCK
+	inline constexpr auto BC5_UNORM = static_cast<TextureFormat>(141); //VK_FORMAT_BC5_UNORM_BLOCK
+	inline constexpr auto BC7_UNORM = static_cast<TextureFormat>(145); //VK_FORMAT_BC7_UNORM_BLOCK
+}
+
+/**
+ * \brief Returns the block compressed texture format for the specified compression.
+ */
+inline TextureFormat ConvertFormat(const BlockCompression blockCompression)
+{
+	if constexpr (API == GAL::RenderAPI::VULKAN)
+	{
+		switch (blockCompression)
+		{
+		case BlockCompression::BC1: return BlockCompressedFormats::BC1_RGBA_UNORM;
+		case BlockCompression::BC3: return BlockCompressedFormats::BC3_UNORM;
+		case BlockCompression::BC5: return BlockCompressedFormats::BC5_UNORM;
+		case BlockCompression::BC7: return BlockCompressedFormats::BC7_UNORM;
+		default: return GAL::VulkanTextureFormat::UNDEFINED;
+		}
+	}
+}
+
 inline uint8 FormatSize(const TextureFormat format)
 {
 	switch (format)
@@ -14,7 +14,8 @@ void StaticMeshRenderGroup::Initialize(const InitializeInfo& initializeInfo)
 {
 	auto render_device = initializeInfo.GameInstance->GetSystem<RenderSystem>("RenderSystem");
 	positions.Initialize(initializeInfo.ScalingFactor, GetPersistentAllocator());
-	meshes.Initialize(32, GetPersistentAllocator());
+	instances.Initialize(32, GetPersistentAllocator());
+	meshlets.Initialize(32, GetPersistentAllocator());
 	addedMeshes.Initialize(2, 16, GetPersistentAllocator());
 
 	{
@@ -26,6 +27,12 @@ void StaticMeshRenderGroup::Initialize(const InitializeInfo& initializeInfo)
 		auto acts_on = GTSL::Array<TaskDependency, 4>{ { "RenderSystem", AccessTypes::READ_WRITE }, { "StaticMeshRenderGroup", AccessTypes::READ_WRITE } };
 		onStaticMeshLoadHandle = initializeInfo.GameInstance->StoreDynamicTask("onStaticMeshLoad", Task<StaticMeshResourceManager*, StaticMeshResourceManager::StaticMeshInfo, MeshLoadInfo>::Create<StaticMeshRenderGroup, &StaticMeshRenderGroup::onStaticMeshLoaded>(this), acts_on);
 	}
+
+	{
+		auto acts_on = GTSL::Array<TaskDependency, 4>{ { "RenderSystem", AccessTypes::READ_WRITE }, { "StaticMeshRenderGroup", AccessTypes::READ_WRITE } };
+		auto onStaticMeshReloadHandle = initializeInfo.GameInstance->StoreDynamicTask("onStaticMeshReload", Task<Id>::Create<StaticMeshRenderGroup, &StaticMeshRenderGroup::onStaticMeshReload>(this), acts_on);
+		initializeInfo.GameInstance->SubscribeToEvent("StaticMeshRenderGroup", StaticMeshResourceManager::GetOnStaticMeshReloadEventHandle(), onStaticMeshReloadHandle);
+	}
 	
 	BE_LOG_MESSAGE("Initialized StaticMeshRenderGroup");
 }
@@ -37,6 +44,8 @@ void StaticMeshRenderGroup::Shutdown(const ShutdownInfo& shutdownInfo)
 StaticMeshHandle StaticMeshRenderGroup::AddStaticMesh(const AddStaticMeshInfo& addStaticMeshInfo)
 {
 	uint32 index = positions.Emplace();
+	meshlets.EmplaceAt(index, 1, GetPersistentAllocator());
+	instances.EmplaceAt(index);
 	resourceNames.EmplaceBack(addStaticMeshInfo.MeshName.GetHash());
 	addStaticMeshInfo.StaticMeshResourceManager->LoadStaticMeshInfo(addStaticMeshInfo.GameInstance, addStaticMeshInfo.MeshName, onStaticMeshInfoLoadHandle, MeshLoadInfo(addStaticMeshInfo.RenderSystem, index, addStaticMeshInfo.Material));
 
@@ -45,31 +54,107 @@ StaticMeshHandle StaticMeshRenderGroup::AddStaticMesh(const AddStaticMeshInfo& a
 	return StaticMeshHandle(index);
 }
 
+void StaticMeshRenderGroup::RequestLOD(GameInstance* gameInstance, const uint32 instance, const uint8 lod)
+{
+	auto& instanceData = instances[instance];
+	auto& lodData = instanceData.LODs[lod];
+	if (lodData.Loading || lodData.Loaded) { return; }
+
+	lodData.Loading = true;
+
+	const auto& lodInfo = instanceData.Info.LODs[lod];
+	MeshLoadInfo meshLoad(instanceData.RenderSystem, instance, instanceData.Material); meshLoad.LOD = lod;
+	meshLoad.MeshHandle = instanceData.RenderSystem->CreateMesh(instanceData.Info.Name, lodInfo.VertexCount, instanceData.Info.VertexSize, lodInfo.IndexCount, lodInfo.IndexSize, instanceData.Material);
+
+	auto meshletBuffer = GTSL::Range<byte*>(instanceData.Info.GetMeshletsSize(lod), reinterpret_cast<byte*>(meshlets[instance].begin() + lodData.FirstMeshlet));
+
+	instanceData.StaticMeshResourceManager->LoadStaticMesh(gameInstance, instanceData.Info, lod, instanceData.RenderSystem->GetBufferSubDataAlignment(),
+		GTSL::Range<byte*>(instanceData.RenderSystem->GetMeshSize(meshLoad.MeshHandle), instanceData.RenderSystem->GetMeshPointer(meshLoad.MeshHandle)), meshletBuffer, onStaticMeshLoadHandle, GTSL::MoveRef(meshLoad));
+}
+
+uint8 StaticMeshRenderGroup::GetClosestLoadedLOD(const uint32 instance, const uint8 lod) const
+{
+	const auto& lods = instances[instance].LODs;
+
+	for (uint8 distance = 0; distance < lods.GetLength(); ++distance)
+	{
+		if (lod >= distance && lods[lod - distance].Loaded) { return lod - distance; }
+		if (lod + distance < lods.GetLength() && lods[lod + distance].Loaded) { return lod + distance; }
+	}
+
+	return 0xFF;
+}
+
+void StaticMeshRenderGroup::reloadInstance(GameInstance* gameInstance, const uint32 instance)
+{
+	auto& instanceData = instances[instance];
+
+	bool loading = !instanceData.LODs.GetLength(); //info is still loading
+	for (const auto& e : instanceData.LODs) { loading = loading || e.Loading; }
+
+	if (loading) { instanceData.ReloadPending = true; return; }
+
+	instanceData.ReloadPending = false;
+	instanceData.LODs.Resize(0);
+	
+	instanceData.StaticMeshResourceManager->LoadStaticMeshInfo(gameInstance, instanceData.Info.Name, onStaticMeshInfoLoadHandle, MeshLoadInfo(instanceData.RenderSystem, instance, instanceData.Material));
+}
+
+void StaticMeshRenderGroup::onStaticMeshReload(TaskInfo taskInfo, const Id meshName)
+{
+	for (uint32 i = 0; i < staticMeshCount; ++i) {
+		if (resourceNames[i] == meshName.GetHash()) { reloadInstance(taskInfo.GameInstance, i); }
+	}
+}
+
 void StaticMeshRenderGroup::onStaticMeshInfoLoaded(TaskInfo taskInfo, StaticMeshResourceManager* staticMeshResourceManager, StaticMeshResourceManager::StaticMeshInfo staticMeshInfo, MeshLoadInfo meshLoad)
 {
-	meshLoad.MeshHandle = meshLoad.RenderSystem->CreateMesh(staticMeshInfo.Name, staticMeshInfo.VertexCount, staticMeshInfo.VertexSize, staticMeshInfo.IndexCount, staticMeshInfo.IndexSize, meshLoad.Material);
+	auto& instanceData = instances[meshLoad.InstanceId];
+	instanceData.Info = staticMeshInfo; instanceData.StaticMeshResourceManager = staticMeshResourceManager;
+	instanceData.RenderSystem = meshLoad.RenderSystem; instanceData.Material = meshLoad.Material;
+
+	uint32 meshletCount = 0;
+	
+	for (uint8 lod = 0; lod < staticMeshInfo.GetLODCount(); ++lod) {
+		LODData lodData; lodData.FirstMeshlet = meshletCount;
+		instanceData.LODs.EmplaceBack(lodData);
+		meshletCount += staticMeshInfo.LODs[lod].MeshletCount;
+	}
+
+	meshlets[meshLoad.InstanceId].Resize(meshletCount); //sized for every LOD up front so loads in flight never see it reallocate
 
-	staticMeshResourceManager->LoadStaticMesh(taskInfo.GameInstance, staticMeshInfo, meshLoad.RenderSystem->GetBufferSubDataAlignment(), GTSL::Range<byte*>(meshLoad.RenderSystem->GetMeshSize(meshLoad.MeshHandle), meshLoad.RenderSystem->GetMeshPointer(meshLoad.MeshHandle)), onStaticMeshLoadHandle, GTSL::MoveRef(meshLoad));
+	RequestLOD(taskInfo.GameInstance, meshLoad.InstanceId, staticMeshInfo.GetLODCount() - 1);
 }
 
 void StaticMeshRenderGroup::onStaticMeshLoaded(TaskInfo taskInfo, StaticMeshResourceManager* staticMeshResourceManager, StaticMeshResourceManager::StaticMeshInfo staticMeshInfo, MeshLoadInfo meshLoadInfo)
 {
 	auto meshHandle = meshLoadInfo.RenderSystem->UpdateMesh(meshLoadInfo.MeshHandle);
+	auto& instanceData = instances[meshLoadInfo.InstanceId];
 
-	if(BE::Application::Get()->GetOption("rayTracing"))
+	if(BE::Application::Get()->GetOption("rayTracing") && !instanceData.Added)
 	{
+		const auto& lodInfo = staticMeshInfo.LODs[meshLoadInfo.LOD];
+		
 		RenderSystem::CreateRayTracingMeshInfo meshInfo;
 		meshInfo.SharedMesh = meshLoadInfo.MeshHandle;
-		meshInfo.VertexCount = staticMeshInfo.VertexCount;
+		meshInfo.VertexCount = lodInfo.VertexCount;
 		meshInfo.VertexSize = staticMeshInfo.VertexSize;
-		meshInfo.IndexCount = staticMeshInfo.IndexCount;
-		meshInfo.IndexSize = staticMeshInfo.IndexSize;
+		meshInfo.IndexCount = lodInfo.IndexCount;
+		meshInfo.IndexSize = lodInfo.IndexSize;
 		GTSL::Matrix3x4 matrix(1.0f);
 		meshInfo.Matrix = &matrix;
 
 		auto meshHandle = meshLoadInfo.RenderSystem->CreateRayTracedMesh(meshInfo);
 	}
-	
-	meshes.EmplaceAt(meshLoadInfo.InstanceId, meshHandle);
-	addedMeshes.EmplaceBack(meshHandle, meshLoadInfo.InstanceId);
-}
\ No newline at end of file
+
+	auto& lodData = instanceData.LODs[meshLoadInfo.LOD];
+	lodData.Mesh = meshHandle; lodData.Loading = false; lodData.Loaded = true;
+
+	if (!instanceData.Added) //instance is registered for rendering with the first LOD that loads, render manager switches between LODs after that
+	{
+		instanceData.Added = true;
+		addedMeshes.EmplaceBack(meshHandle, meshLoadInfo.InstanceId);
+	}
+
+	if (instanceData.ReloadPending) { reloadInstance(taskInfo.GameInstance, meshLoadInfo.InstanceId); }
+}
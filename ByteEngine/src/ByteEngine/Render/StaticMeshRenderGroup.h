@@ -35,6 +35,36 @@ public:
 	void SetPosition(StaticMeshHandle staticMeshHandle, GTSL::Vector3 vector3) { positions[staticMeshHandle()] = vector3; }
 	uint32 GetStaticMesheCount() const { return staticMeshCount; }
 
+	/**
+	 * \brief Returns the number of LODs of an instance's mesh, 0 while the mesh's info hasn't loaded.
+	 */
+	uint8 GetLODCount(const uint32 instance) const { return instances[instance].LODs.GetLength(); }
+
+	/**
+	 * \brief Returns how far, in mesh units, a LOD deviates from the full resolution mesh.
+	 */
+	float32 GetLODError(const uint32 instance, const uint8 lod) const { return instances[instance].Info.LODs[lod].Error; }
+
+	/**
+	 * \brief Starts loading a LOD of an instance if it isn't loaded or being loaded. LODs are only loaded once they are requested, except the coarsest one which is loaded first so the instance shows up quickly.
+	 */
+	void RequestLOD(GameInstance* gameInstance, uint32 instance, uint8 lod);
+
+	/**
+	 * \brief Returns the loaded LOD closest to lod, preferring finer ones, or 0xFF if no LOD of the instance has loaded yet.
+	 */
+	uint8 GetClosestLoadedLOD(uint32 instance, uint8 lod) const;
+	
+	RenderSystem::MeshHandle GetLODMesh(const uint32 instance, const uint8 lod) const { return instances[instance].LODs[lod].Mesh; }
+
+	/**
+	 * \brief Returns the meshlets of one LOD of an instance, in object space. Only valid for loaded LODs.
+	 */
+	GTSL::Range<const Meshlet*> GetMeshlets(const uint32 instance, const uint8 lod) const
+	{
+		return GTSL::Range<const Meshlet*>(instances[instance].Info.LODs[lod].MeshletCount, meshlets[instance].begin() + instances[instance].LODs[lod].FirstMeshlet);
+	}
+
 	auto GetAddedMeshes()
 	{
 		return addedMeshes.GetReference();
@@ -52,7 +82,36 @@ private:
 		RenderSystem::MeshHandle MeshHandle;
 		uint32 InstanceId;
 		MaterialInstanceHandle Material;
+		uint8 LOD = 0;
+	};
+
+	struct LODData
+	{
+		RenderSystem::MeshHandle Mesh;
+		uint32 FirstMeshlet = 0;
+		bool Loading = false, Loaded = false;
+	};
+
+	struct InstanceData
+	{
+		StaticMeshResourceManager::StaticMeshInfo Info;
+		GTSL::Array<LODData, StaticMeshResourceManager::MAX_LODS> LODs;
+		StaticMeshResourceManager* StaticMeshResourceManager = nullptr;
+		RenderSystem* RenderSystem = nullptr;
+		MaterialInstanceHandle Material;
+		bool Added = false;
+		/**
+		 * \brief The instance's mesh was re-imported while some of it's LODs were loading, it's reloaded once they finish so loads in flight don't write to replaced LODs.
+		 */
+		bool ReloadPending = false;
 	};
+
+	/**
+	 * \brief Drops an instance's LODs and loads the mesh's info again. The instance isn't drawn until one of the new LODs loads.
+	 * Meshes of the dropped LODs are not destroyed, as frames in flight may still be drawing them.
+	 */
+	void reloadInstance(GameInstance* gameInstance, uint32 instance);
+	void onStaticMeshReload(TaskInfo taskInfo, Id meshName);
 	
 	void onStaticMeshInfoLoaded(TaskInfo taskInfo, StaticMeshResourceManager* staticMeshResourceManager, StaticMeshResourceManager::StaticMeshInfo staticMeshInfo, MeshLoadInfo meshLoad);
 	void onStaticMeshLoaded(TaskInfo taskInfo, StaticMeshResourceManager* staticMeshResourceManager, StaticMeshResourceManager::StaticMeshInfo staticMeshInfo, MeshLoadInfo meshLoadInfo);
@@ -60,7 +119,11 @@ private:
 	GTSL::Array<GTSL::Id64, 16> resourceNames;
 	uint32 staticMeshCount = 0;
 	GTSL::KeepVector<GTSL::Vector3, BE::PersistentAllocatorReference> positions;
-	GTSL::KeepVector<RenderSystem::MeshHandle, BE::PAR> meshes;
+	GTSL::KeepVector<InstanceData, BE::PAR> instances;
+	/**
+	 * \brief Meshlets of every LOD of an instance, allocated when the instance's info loads and filled as LODs load.
+	 */
+	GTSL::KeepVector<GTSL::Vector<Meshlet, BE::PAR>, BE::PAR> meshlets;
 	GTSL::PagedVector<GTSL::Pair<RenderSystem::MeshHandle, uint32>, BE::PAR> addedMeshes;
 	DynamicTaskHandle<StaticMeshResourceManager*, StaticMeshResourceManager::StaticMeshInfo, MeshLoadInfo> onStaticMeshLoadHandle;
 	DynamicTaskHandle<StaticMeshResourceManager*, StaticMeshResourceManager::StaticMeshInfo, MeshLoadInfo> onStaticMeshInfoLoadHandle;
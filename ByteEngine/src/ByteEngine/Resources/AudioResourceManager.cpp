@@ -2,31 +2,42 @@
 
 #include <GTSL/Buffer.hpp>
 #include <GTSL/Filesystem.h>
+#include <GTSL/Memory.h>
 #include <GTSL/Serialize.h>
 
+#include <GTSL/Math/Math.hpp>
+
 #include "ByteEngine/Debug/Assert.h"
 #include <AAL/AudioCore.h>
 
 #include "ByteEngine/Application/Application.h"
+#include "ByteEngine/Sound/AudioConversion.h"
+#include "ByteEngine/Sound/AudioMixing.h"
 
-AudioResourceManager::AudioResourceManager() : ResourceManager("AudioResourceManager"), audioResourceInfos(8, 0.25, GetPersistentAllocator()), audioBytes(8, GetPersistentAllocator())
+AudioResourceManager::AudioResourceManager() : ResourceManager("AudioResourceManager"), audioResourceInfos(GetPersistentAllocator())
 {
+	audioBytes.Initialize(8, GetPersistentAllocator());
+	audioBytes.SetBudget(AUDIO_CATEGORY, DEFAULT_AUDIO_BUDGET);
+	importCodec = BE::Application::Get()->GetOption(Id("uncompressedAudio"), 0) ? AudioCodec::PCM : AudioCodec::ADPCM;
+
 	GTSL::StaticString<512> query_path, package_path, resources_path, index_path;
 	query_path += BE::Application::Get()->GetPathToApplication(); query_path += "/resources/"; query_path += "*.wav";
 	resources_path += BE::Application::Get()->GetPathToApplication(); resources_path += "/resources/";
 	index_path += BE::Application::Get()->GetPathToApplication(); index_path += "/resources/Audio.beidx";
 	package_path += BE::Application::Get()->GetPathToApplication(); package_path += "/resources/Audio.bepkg";
 
-	indexFile.OpenFile(index_path, GTSL::File::AccessMode::WRITE | GTSL::File::AccessMode::READ);
-	
-	GTSL::Buffer<BE::TAR> file_buffer; file_buffer.Allocate(2048 * 2048, 32, GetTransientAllocator());
-	
-	if(indexFile.ReadFile(file_buffer.GetBufferInterface()))
+	//packages built before sounds were converted to the mix format hold raw samples, and ones built with another codec have to be re encoded, rebuild them
+	auto isInMixFormat = [&]()
 	{
-		GTSL::Extract(audioResourceInfos, file_buffer);
-	}
-	else
+		bool inMixFormat = true;
+		audioResourceInfos.ForEach([&](uint64, const AudioDataSerialize& data) { inMixFormat &= data.SampleRate == MIX_SAMPLE_RATE && data.ChannelCount == MIX_CHANNELS && data.BitDepth == 32 && data.Codec == importCodec; });
+		return inMixFormat;
+	};
+
+	if(!audioResourceInfos.Open(index_path) || !isInMixFormat())
 	{
+		ResourceIndexBuilder<AudioDataSerialize> audioResourceInfosBuilder(8, GetTransientAllocator());
+		
 		GTSL::File packageFile; packageFile.OpenFile(package_path, GTSL::File::AccessMode::WRITE);
 		
 		auto load = [&](const GTSL::FileQuery::QueryResult& queryResult)
@@ -36,68 +47,33 @@ AudioResourceManager::AudioResourceManager() : ResourceManager("AudioResourceMan
 			auto name = queryResult.FileNameWithExtension; name.Drop(name.FindLast('.').Get());
 			const auto hashed_name = GTSL::Id64(name);
 
-			if (!audioResourceInfos.Find(hashed_name))
+			if (!audioResourceInfosBuilder.Find(hashed_name))
 			{
-				GTSL::File query_file;
-				query_file.OpenFile(file_path, GTSL::File::AccessMode::READ);
-
-				GTSL::Buffer<BE::TAR> wavBuffer; wavBuffer.Allocate(query_file.GetFileSize(), 8, GetTransientAllocator());
-				
-				query_file.ReadFile(wavBuffer.GetBufferInterface());
-
+				GTSL::Buffer<BE::TAR> audioBuffer;
 				AudioDataSerialize data;
 
-				uint8 riff[4];                      // RIFF string
-				uint32 overall_size = 0;               // overall size of file in bytes
-				uint8 wave[4];                      // WAVE string
-				uint8 fmt_chunk_marker[4];          // fmt string with trailing null char
-				uint32 length_of_fmt = 0;                 // length of the format data
-				uint16 format_type = 0;                   // format type. 1-PCM, 3- IEEE float, 6 - 8bit A law, 7 - 8bit mu law
-				uint16 channels = 0;                      // no.of channels
-				uint32 sample_rate = 0;                   // sampling rate (blocks per second)
-				uint32 byte_rate = 0;                      // SampleRate * NumChannels * BitsPerSample/8
-				uint16 block_align = 0;                   // NumChannels * BitsPerSample/8
-				uint16 bits_per_sample = 0;               // bits per sample, 8- 8bits, 16- 16 bits etc
-				uint8 data_chunk_header[4];        // DATA string or FLLR string
-				uint32 data_size = 0;                     // NumSamples * NumChannels * BitsPerSample/8 - size of the next chunk that will be read
-
-				wavBuffer.ReadBytes(4, riff);
-				BE_ASSERT(riff[0] == 'R' && riff[1] == 'I' && riff[2] == 'F' && riff[3] == 'F', "No RIFF");
-
-				Extract(overall_size, wavBuffer);
-				wavBuffer.ReadBytes(4, wave); BE_ASSERT(wave[0] == 'W' && wave[1] == 'A' && wave[2] == 'V' && wave[3] == 'E', "No WAVE");
-				wavBuffer.ReadBytes(4, fmt_chunk_marker); BE_ASSERT(fmt_chunk_marker[0] == 'f' && fmt_chunk_marker[1] == 'm' && fmt_chunk_marker[2] == 't' && fmt_chunk_marker[3] == 32, "No fmt");
-				Extract(length_of_fmt, wavBuffer); BE_ASSERT(length_of_fmt == 16, "Unsupported");
-				Extract(format_type, wavBuffer); BE_ASSERT(format_type == 1, "Format is not PCM, unsupported!");
-				Extract(channels, wavBuffer);
-				Extract(sample_rate, wavBuffer);
-				Extract(byte_rate, wavBuffer); //(Sample Rate * BitsPerSample * Channels) / 8.
-				Extract(block_align, wavBuffer);
-				Extract(bits_per_sample, wavBuffer);
-
-				data.ChannelCount = channels;
-				data.SampleRate = sample_rate;
-				data.BitDepth = bits_per_sample;
-
-				wavBuffer.ReadBytes(4, data_chunk_header); BE_ASSERT(data_chunk_header[0] == 'd' && data_chunk_header[1] == 'a' && data_chunk_header[2] == 't' && data_chunk_header[3] == 'a', "No data");
-				Extract(data_size, wavBuffer);
-
-				data.Frames = data_size / channels / (bits_per_sample / 8);
+				const auto samples = importAudio(file_path, data, audioBuffer);
 
 				data.ByteOffset = (uint32)packageFile.GetFileSize();
 
-				packageFile.WriteToFile(GTSL::Range<const byte*>(data_size, wavBuffer.GetData() + wavBuffer.GetReadPosition()));
+				packageFile.WriteToFile(samples);
 
-				audioResourceInfos.Emplace(hashed_name, data);
+				audioResourceInfosBuilder.Emplace(hashed_name, data);
 			}
 		};
 
 		GTSL::FileQuery file_query(query_path);
 		GTSL::ForEach(file_query, load);
 
-		file_buffer.Resize(0);
-		GTSL::Insert(audioResourceInfos, file_buffer);
-		indexFile.WriteToFile(file_buffer);
+		GTSL::Buffer<BE::TAR> file_buffer; file_buffer.Allocate(audioResourceInfosBuilder.GetFileSize(), 32, GetTransientAllocator());
+		audioResourceInfosBuilder.Write(file_buffer);
+
+		{
+			GTSL::File indexFile; indexFile.OpenFile(index_path, GTSL::File::AccessMode::WRITE);
+			indexFile.WriteToFile(file_buffer);
+		}
+
+		audioResourceInfos.Open(index_path);
 	}
 
 	initializePackageFiles(package_path);
@@ -105,4 +81,263 @@ AudioResourceManager::AudioResourceManager() : ResourceManager("AudioResourceMan
 
 AudioResourceManager::~AudioResourceManager()
 {
+	for (auto e : audioStreams) { if (e) { GTSL::Delete(e, GetPersistentAllocator()); } }
+	audioResourceInfos.Flush(GetTransientAllocator());
+}
+
+bool AudioResourceManager::ReloadResource(GameInstance* gameInstance, const utf8* fileName)
+{
+	GTSL::StaticString<256> name;
+	if (!parseFileName(fileName, ".wav", name)) { return false; }
+
+	auto reloadAudio = [](TaskInfo taskInfo, AudioResourceManager* resourceManager, GTSL::StaticString<256> name)
+	{
+		auto filePath = resourceManager->GetResourcePath(name); filePath += ".wav";
+
+		GTSL::Buffer<BE::TAR> audioBuffer;
+		AudioDataSerialize data;
+		const auto samples = resourceManager->importAudio(filePath, data, audioBuffer);
+
+		data.ByteOffset = resourceManager->appendToPackage(samples);
+		resourceManager->audioResourceInfos.Update(Id(name.begin()), data);
+		resourceManager->audioBytes.Invalidate(Id(name.begin())); //sources already playing keep the old samples until they release them
+	};
+
+	//runs within a frame so the transient allocations made while importing stay valid
+	gameInstance->AddDynamicTask("reloadAudio", Task<AudioResourceManager*, GTSL::StaticString<256>>::Create(reloadAudio), {}, "FrameStart", "FrameEnd", this, GTSL::MoveRef(name));
+	return true;
+}
+
+bool AudioResourceManager::getPackageRange(const Id name, uint32& byteOffset, uint32& size)
+{
+	if (!audioResourceInfos.Find(name)) { return false; }
+
+	AudioInfo audioInfo(name, audioResourceInfos.At(name));
+	if (audioInfo.GetAudioSize() > STREAMING_THRESHOLD) { return false; }
+	
+	byteOffset = audioInfo.ByteOffset; size = audioInfo.StoredBytes;
+	return true;
+}
+
+GTSL::Range<const byte*> AudioResourceManager::importAudio(const GTSL::Range<const utf8*> filePath, AudioDataSerialize& data, GTSL::Buffer<BE::TAR>& audioBuffer)
+{
+	GTSL::Buffer<BE::TAR> wavBuffer;
+
+	{
+		GTSL::File query_file;
+		query_file.OpenFile(filePath, GTSL::File::AccessMode::READ);
+		wavBuffer.Allocate(query_file.GetFileSize(), 8, GetTransientAllocator());
+		query_file.ReadFile(wavBuffer.GetBufferInterface());
+	}
+
+	const byte* wav = wavBuffer.GetData(); const uint64 wavSize = wavBuffer.GetLength();
+
+	auto read16 = [&](const uint64 offset) { uint16 value; GTSL::MemCopy(sizeof(uint16), wav + offset, &value); return value; };
+	auto read32 = [&](const uint64 offset) { uint32 value; GTSL::MemCopy(sizeof(uint32), wav + offset, &value); return value; };
+	auto isTag = [&](const uint64 offset, const char* tag) { return wav[offset] == tag[0] && wav[offset + 1] == tag[1] && wav[offset + 2] == tag[2] && wav[offset + 3] == tag[3]; };
+
+	BE_ASSERT(wavSize >= 12 && isTag(0, "RIFF") && isTag(8, "WAVE"), "Not a wav file!");
+
+	uint16 format_type = 0;                   // format type. 1-PCM, 3- IEEE float, 0xFFFE- extensible, format is in the sub format
+	uint16 channels = 0, bits_per_sample = 0;
+	uint32 sample_rate = 0;
+	const byte* samples = nullptr; uint32 data_size = 0;
+
+	//chunks can come in any order and files often carry LIST or fact chunks, only fmt and data are read
+	for (uint64 offset = 12; offset + 8 <= wavSize;)
+	{
+		const uint32 chunkSize = read32(offset + 4); const uint64 chunkData = offset + 8;
+
+		if (isTag(offset, "fmt ")) {
+			format_type = read16(chunkData); channels = read16(chunkData + 2); sample_rate = read32(chunkData + 4); bits_per_sample = read16(chunkData + 14);
+			if (format_type == 0xFFFE && chunkSize >= 40) { format_type = read16(chunkData + 24); } //sub format GUID starts with the format tag
+		}
+		else if (isTag(offset, "data")) {
+			samples = wav + chunkData; data_size = static_cast<uint32>(GTSL::Math::Limit(static_cast<uint64>(chunkSize), wavSize - chunkData)); //unfinished files may claim more data than they hold
+		}
+
+		offset = chunkData + chunkSize + (chunkSize & 1); //chunks are padded to even sizes
+	}
+
+	BE_ASSERT(channels && samples, "No fmt or data");
+	BE_ASSERT((format_type == 1 && (bits_per_sample == 8 || bits_per_sample == 16 || bits_per_sample == 24 || bits_per_sample == 32)) || (format_type == 3 && bits_per_sample == 32), "Unsupported sample format!");
+
+	const uint32 sourceFrames = data_size / channels / (bits_per_sample / 8);
+
+	//convert to the mix format once here so the mixer never does
+	GTSL::Buffer<BE::TAR> floatBuffer; floatBuffer.Allocate(sourceFrames * MIX_FRAME_SIZE, 16, GetTransientAllocator());
+	ConvertToFloat32(samples, format_type == 3 ? SampleFormat::FLOAT : SampleFormat::PCM, static_cast<uint8>(bits_per_sample), static_cast<uint8>(channels), sourceFrames, MIX_CHANNELS, reinterpret_cast<float32*>(floatBuffer.GetData()));
+
+	data.Frames = GetResampledFrameCount(sourceFrames, sample_rate, MIX_SAMPLE_RATE);
+	data.SampleRate = MIX_SAMPLE_RATE;
+	data.ChannelCount = MIX_CHANNELS;
+	data.BitDepth = 32;
+	data.Codec = importCodec;
+
+	if (importCodec == AudioCodec::PCM) {
+		data.StoredBytes = data.Frames * MIX_FRAME_SIZE;
+		audioBuffer.Allocate(data.StoredBytes, 16, GetTransientAllocator());
+		Resample(reinterpret_cast<const float32*>(floatBuffer.GetData()), sourceFrames, MIX_CHANNELS, sample_rate, MIX_SAMPLE_RATE, reinterpret_cast<float32*>(audioBuffer.GetData()), GetTransientAllocator());
+	}
+	else {
+		GTSL::Buffer<BE::TAR> resampledBuffer; resampledBuffer.Allocate(data.Frames * MIX_FRAME_SIZE, 16, GetTransientAllocator());
+		Resample(reinterpret_cast<const float32*>(floatBuffer.GetData()), sourceFrames, MIX_CHANNELS, sample_rate, MIX_SAMPLE_RATE, reinterpret_cast<float32*>(resampledBuffer.GetData()), GetTransientAllocator());
+
+		data.StoredBytes = GetADPCMSize(data.Frames);
+		audioBuffer.Allocate(data.StoredBytes, 16, GetTransientAllocator());
+		EncodeADPCM(reinterpret_cast<const float32*>(resampledBuffer.GetData()), data.Frames, audioBuffer.GetData());
+	}
+
+	return GTSL::Range<const byte*>(data.StoredBytes, audioBuffer.GetData());
+}
+
+void AudioResourceManager::decodeAudio(const AudioCodec codec, const byte* encoded, const uint32 frames, byte* samples)
+{
+	const auto start = BE::Application::Get()->GetClock()->GetCurrentMicroseconds();
+	DecodeADPCM(encoded, frames, reinterpret_cast<float32*>(samples));
+	const float32 microseconds = (BE::Application::Get()->GetClock()->GetCurrentMicroseconds() - start).As<float32, GTSL::Seconds>() * 1000000.0f;
+
+	decodedFrames[static_cast<uint8>(codec)].fetch_add(frames, std::memory_order_relaxed);
+	decodeMicroseconds[static_cast<uint8>(codec)].fetch_add(static_cast<uint64>(microseconds), std::memory_order_relaxed);
+}
+
+void AudioResourceManager::loadAudioData(AudioInfo audioInfo, byte* data)
+{
+	if (audioInfo.Codec == AudioCodec::PCM) { readPackage(audioInfo.ByteOffset, GTSL::Range<byte*>(audioInfo.GetAudioSize(), data)); return; }
+
+	GTSL::Buffer<BE::PAR> encodedBuffer; encodedBuffer.Allocate(audioInfo.StoredBytes, 16, GetPersistentAllocator());
+	readPackage(audioInfo.ByteOffset, GTSL::Range<byte*>(audioInfo.StoredBytes, encodedBuffer.GetData()));
+	decodeAudio(audioInfo.Codec, encodedBuffer.GetData(), audioInfo.Frames, data);
+}
+
+AudioStreamHandle AudioResourceManager::OpenAudioStream(GameInstance* gameInstance, const Id audioName)
+{
+	auto audioInfo = AudioInfo(audioName, audioResourceInfos.At(audioName));
+	
+	auto* audioStream = GTSL::New<AudioStream>(GetPersistentAllocator());
+	audioStream->Name = audioName;
+	audioStream->Codec = audioInfo.Codec;
+	audioStream->ByteOffset = audioInfo.ByteOffset;
+	audioStream->Bytes = audioInfo.GetAudioSize();
+	audioStream->Ring.Allocate(STREAM_CHUNK_SIZE * STREAM_CHUNK_COUNT, 16, GetPersistentAllocator());
+	if (audioInfo.Codec != AudioCodec::PCM) { audioStream->EncodedChunk.Allocate(GetADPCMSize(STREAM_CHUNK_SIZE / MIX_FRAME_SIZE), 16, GetPersistentAllocator()); }
+
+	GTSL::Lock lock(audioStreamsMutex);
+
+	uint32 slot = 0;
+	while (slot < MAX_AUDIO_STREAMS && audioStreams[slot]) { ++slot; }
+	BE_ASSERT(slot < MAX_AUDIO_STREAMS, "Too many audio streams open");
+
+	audioStreams[slot] = audioStream; //handed to the consumer through the command that starts it, which publishes it
+	prefetchStream(gameInstance, audioStream);
+	return AudioStreamHandle(slot);
+}
+
+void AudioResourceManager::CloseAudioStream(const AudioStreamHandle audioStreamHandle)
+{
+	GTSL::Lock lock(audioStreamsMutex);
+
+	AudioStream* audioStream = audioStreams[audioStreamHandle()];
+	audioStreams[audioStreamHandle()] = nullptr;
+
+	bool canDelete;
+	
+	{
+		GTSL::Lock streamLock(audioStream->Mutex);
+		audioStream->Closed = true;
+		canDelete = !audioStream->Loading;
+	}
+
+	if (canDelete) { GTSL::Delete(audioStream, GetPersistentAllocator()); } //else prefetch task will delete it when done
+}
+
+void AudioResourceManager::UpdateStreams(GameInstance* gameInstance)
+{
+	GTSL::Lock lock(audioStreamsMutex);
+
+	for (auto* audioStream : audioStreams)
+	{
+		if (audioStream && audioStream->ProducedChunks.load(std::memory_order_relaxed) - audioStream->ConsumedChunks.load(std::memory_order_acquire) < STREAM_CHUNK_COUNT) {
+			prefetchStream(gameInstance, audioStream);
+		}
+	}
+}
+
+GTSL::Range<const byte*> AudioResourceManager::GetStreamData(const AudioStreamHandle audioStreamHandle) const
+{
+	const AudioStream* audioStream = audioStreams[audioStreamHandle()];
+
+	const uint32 consumedChunks = audioStream->ConsumedChunks.load(std::memory_order_relaxed);
+	if (audioStream->ProducedChunks.load(std::memory_order_acquire) == consumedChunks) { return GTSL::Range<const byte*>(); } //acquire makes the chunk's contents visible
+
+	const uint32 front = consumedChunks % STREAM_CHUNK_COUNT;
+	return GTSL::Range<const byte*>(audioStream->ChunkSizes[front] - audioStream->ReadOffset, audioStream->Ring.GetData() + front * STREAM_CHUNK_SIZE + audioStream->ReadOffset);
+}
+
+void AudioResourceManager::ConsumeStreamData(const AudioStreamHandle audioStreamHandle, const uint32 bytes)
+{
+	AudioStream* audioStream = audioStreams[audioStreamHandle()];
+
+	audioStream->ReadOffset += bytes;
+
+	const uint32 consumedChunks = audioStream->ConsumedChunks.load(std::memory_order_relaxed);
+	if (audioStream->ReadOffset == audioStream->ChunkSizes[consumedChunks % STREAM_CHUNK_COUNT]) {
+		audioStream->ReadOffset = 0;
+		audioStream->ConsumedChunks.store(consumedChunks + 1, std::memory_order_release); //slot goes back to the producer once we are done reading it
+	}
+}
+
+void AudioResourceManager::prefetchStream(GameInstance* gameInstance, AudioStream* audioStream)
+{
+	{
+		GTSL::Lock lock(audioStream->Mutex);
+		if (audioStream->Loading) { return; }
+		audioStream->Loading = true;
+	}
+	
+	auto prefetch = [](TaskInfo taskInfo, AudioResourceManager* resourceManager, AudioStream* audioStream)
+	{
+		const uint32 fileChunks = (audioStream->Bytes + STREAM_CHUNK_SIZE - 1) / STREAM_CHUNK_SIZE;
+		bool closed;
+		
+		while (true)
+		{
+			const uint32 chunk = audioStream->ProducedChunks.load(std::memory_order_relaxed);
+			
+			{
+				GTSL::Lock lock(audioStream->Mutex);
+
+				closed = audioStream->Closed;
+				
+				if (closed || chunk - audioStream->ConsumedChunks.load(std::memory_order_acquire) == STREAM_CHUNK_COUNT) {
+					audioStream->Loading = false;
+					break;
+				}
+			}
+
+			//ring slot is owned by the producer until ProducedChunks is advanced past it
+			const uint32 fileChunk = chunk % fileChunks, slot = chunk % STREAM_CHUNK_COUNT;
+			const uint32 chunkBytes = GTSL::Math::Limit(audioStream->Bytes - fileChunk * STREAM_CHUNK_SIZE, STREAM_CHUNK_SIZE);
+
+			byte* chunkData = audioStream->Ring.GetData() + slot * STREAM_CHUNK_SIZE;
+
+			if (audioStream->Codec == AudioCodec::PCM) {
+				resourceManager->getFile().SetPointer(audioStream->ByteOffset + fileChunk * STREAM_CHUNK_SIZE, GTSL::File::MoveFrom::BEGIN);
+				resourceManager->getFile().ReadFromFile(GTSL::Range<byte*>(chunkBytes, chunkData));
+			}
+			else { //decoded on this task, so decoding never runs on the audio thread
+				const uint32 chunkFrames = chunkBytes / MIX_FRAME_SIZE;
+				resourceManager->getFile().SetPointer(audioStream->ByteOffset + fileChunk * (STREAM_CHUNK_SIZE / MIX_FRAME_SIZE / ADPCM_GROUP_FRAMES) * ADPCM_GROUP_BYTES, GTSL::File::MoveFrom::BEGIN);
+				resourceManager->getFile().ReadFromFile(GTSL::Range<byte*>(GetADPCMSize(chunkFrames), audioStream->EncodedChunk.GetData()));
+				resourceManager->decodeAudio(audioStream->Codec, audioStream->EncodedChunk.GetData(), chunkFrames, chunkData);
+			}
+
+			audioStream->ChunkSizes[slot] = chunkBytes;
+			audioStream->ProducedChunks.store(chunk + 1, std::memory_order_release); //publishes the chunk to the consumer
+		}
+
+		if (closed) { GTSL::Delete(audioStream, resourceManager->GetPersistentAllocator()); }
+	};
+
+	gameInstance->AddDynamicTask("prefetchAudioStream", Task<AudioResourceManager*, AudioStream*>::Create(prefetch), {}, this, GTSL::MoveRef(audioStream));
 }
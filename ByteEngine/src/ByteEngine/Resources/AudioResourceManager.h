@@ -6,19 +6,35 @@
 #include <GTSL/FlatHashMap.h>
 #include <GTSL/Buffer.hpp>
 #include <GTSL/Serialize.h>
+#include <GTSL/Mutex.h>
 
+#include <atomic>
+
+#include "ResourceIndex.h"
 #include "ResourceManager.h"
+#include "ByteEngine/Handle.hpp"
 #include "ByteEngine/Game/GameInstance.h"
+#include "ByteEngine/Sound/AudioCodec.h"
+
+MAKE_HANDLE(uint32, AudioStream)
 
 class AudioResourceManager final : public ResourceManager
 {
 public:
+	/**
+	 * \brief Sounds are converted to the mix format and stored encoded with Codec, SampleRate, ChannelCount and BitDepth describe the decoded samples.
+	 */
 	struct AudioData : Data
 	{
 		uint32 Frames;
 		uint32 SampleRate;
+		/**
+		 * \brief Bytes the sound takes up in the package.
+		 */
+		uint32 StoredBytes;
 		uint8 ChannelCount;
 		uint8 BitDepth;
+		AudioCodec Codec;
 	};
 
 	struct AudioDataSerialize : DataSerialize<AudioData>
@@ -28,8 +44,10 @@ public:
 			INSERT_BODY
 			Insert(insertInfo.Frames, buffer);
 			Insert(insertInfo.SampleRate, buffer);
+			Insert(insertInfo.StoredBytes, buffer);
 			Insert(insertInfo.ChannelCount, buffer);
 			Insert(insertInfo.BitDepth, buffer);
+			Insert(static_cast<uint8>(insertInfo.Codec), buffer);
 		}
 
 		EXTRACT_START(AudioDataSerialize)
@@ -37,8 +55,10 @@ public:
 			EXTRACT_BODY
 			Extract(extractInfo.Frames, buffer);
 			Extract(extractInfo.SampleRate, buffer);
+			Extract(extractInfo.StoredBytes, buffer);
 			Extract(extractInfo.ChannelCount, buffer);
 			Extract(extractInfo.BitDepth, buffer);
+			uint8 codec; Extract(codec, buffer); extractInfo.Codec = static_cast<AudioCodec>(codec);
 		}
 	};
 
@@ -46,29 +66,92 @@ public:
 	{
 		DECL_INFO_CONSTRUCTOR(AudioInfo, Info<AudioDataSerialize>)
 
+		/**
+		 * \brief Returns the size of the decoded sound, which is what it takes up when resident.
+		 */
 		uint32 GetAudioSize()
 		{
 			return Frames * ChannelCount * (BitDepth / 8);
 		}
 	};
 
-	void ReleaseAudioAsset(Id asset)
-	{
-		audioBytes.Remove(asset);
-	}
+	/**
+	 * \brief Removes a reference to an audio asset acquired through LoadAudio. Unreferenced audio stays resident until the audio budget needs the space.
+	 */
+	void ReleaseAudioAsset(Id asset) { audioBytes.Release(asset); }
 	
-	byte* GetAssetPointer(const Id id) { return audioBytes.At(id).GetData(); }
+	byte* GetAssetPointer(const Id id) { return audioBytes.GetData(id); }
 	uint32 GetFrameCount(Id id) const { return audioResourceInfos.At(id).Frames; }
 
+	/**
+	 * \brief Sets the maximum amount of bytes unreferenced audio data can keep resident.
+	 */
+	void SetAudioBudget(const uint64 bytes) { audioBytes.SetBudget(AUDIO_CATEGORY, bytes); }
+	ResidencyCache::Stats GetCacheStats() const { return audioBytes.GetStats(); }
+
+	/**
+	 * \brief Audio assets bigger than this are not loaded whole but streamed through a ring of fixed size chunks.
+	 */
+	static constexpr uint32 STREAMING_THRESHOLD = 1024 * 1024;
+	/**
+	 * \brief Decoded bytes per stream chunk, 8192 frames, which is 4 ADPCM groups.
+	 */
+	static constexpr uint32 STREAM_CHUNK_SIZE = 64 * 1024;
+	static constexpr uint8 STREAM_CHUNK_COUNT = 4;
+	static_assert(STREAM_CHUNK_SIZE / MIX_FRAME_SIZE % ADPCM_GROUP_FRAMES == 0, "Stream chunks must hold whole ADPCM groups so they can be decoded on their own");
+
+	[[nodiscard]] bool IsStreamed(const Id id) const { return AudioInfo(id, audioResourceInfos.At(id)).GetAudioSize() > STREAMING_THRESHOLD; }
+
 	AudioResourceManager();
 
 	~AudioResourceManager();
 
+	bool ReloadResource(GameInstance* gameInstance, const utf8* fileName) override;
+
+	/**
+	 * \brief Streams that can be open at once. The table doesn't grow so the audio thread can read it without locking.
+	 */
+	static constexpr uint32 MAX_AUDIO_STREAMS = 32;
+
+	/**
+	 * \brief Starts streaming an audio asset from the beginning. Chunks are prefetched ahead on background tasks, memory used per stream is constant.
+	 * Streams wrap around to the start of the asset when they reach it's end.
+	 */
+	AudioStreamHandle OpenAudioStream(GameInstance* gameInstance, Id audioName);
+	void CloseAudioStream(AudioStreamHandle audioStreamHandle);
+
+	/**
+	 * \brief Prefetches chunks of the open streams that were consumed since the last call. Must be called regularly from gameplay code, consumers
+	 * only publish what they consumed so reading a stream never locks, allocates or schedules tasks.
+	 */
+	void UpdateStreams(GameInstance* gameInstance);
+
+	/**
+	 * \brief Returns the bytes left to be consumed in the oldest loaded chunk of the stream, or an empty range if no chunk has been loaded yet.
+	 * Lock free, a stream has a single consumer.
+	 */
+	GTSL::Range<const byte*> GetStreamData(AudioStreamHandle audioStreamHandle) const;
+
+	/**
+	 * \brief Marks bytes returned by GetStreamData as consumed. Once a chunk is fully consumed it's slot is handed back to be prefetched by the next UpdateStreams.
+	 */
+	void ConsumeStreamData(AudioStreamHandle audioStreamHandle, uint32 bytes);
+
+	/**
+	 * \brief Returns how many frames were decoded with codec and how long it took, on any thread. A playing voice decodes a second of audio every second,
+	 * so microseconds per decoded second is the cost of a voice.
+	 */
+	void GetDecodeStats(const AudioCodec codec, uint64& frames, uint64& microseconds) const
+	{
+		frames = decodedFrames[static_cast<uint8>(codec)].load(std::memory_order_relaxed); microseconds = decodeMicroseconds[static_cast<uint8>(codec)].load(std::memory_order_relaxed);
+	}
+
 	template<typename... ARGS>
 	void LoadAudioInfo(GameInstance* gameInstance, Id audioName, DynamicTaskHandle<AudioResourceManager*, AudioInfo, ARGS...> dynamicTaskHandle, ARGS&&... args)
 	{
 		auto loadAudioInfo = [](TaskInfo taskInfo, AudioResourceManager* resourceManager, Id audioName, decltype(dynamicTaskHandle) dynamicTaskHandle, ARGS&&... args)
 		{			
+			resourceManager->recordLoad(audioName);
 			auto audioInfoSerialize = resourceManager->audioResourceInfos.At(audioName);
 
 			AudioInfo audioInfo(audioName, audioInfoSerialize);
@@ -79,28 +162,21 @@ public:
 		gameInstance->AddDynamicTask("loadAudioInfo", Task<AudioResourceManager*, Id, decltype(dynamicTaskHandle), ARGS...>::Create(loadAudioInfo), {}, this, GTSL::MoveRef(audioName), GTSL::MoveRef(dynamicTaskHandle), GTSL::ForwardRef<ARGS>(args)...);
 	}
 
-	//Audio data is aligned to 16 bytes
+	/**
+	 * \brief Makes audio data resident, loading it from the package if needed, and adds a reference to it which must be removed with ReleaseAudioAsset.
+	 * Audio data is aligned to 16 bytes.
+	 */
 	template<typename... ARGS>
 	void LoadAudio(GameInstance* gameInstance, AudioInfo audioInfo, DynamicTaskHandle<AudioResourceManager*, AudioInfo, GTSL::Range<const byte*>, ARGS...> dynamicTaskHandle, ARGS&&... args)
 	{
 		auto loadAudio = [](TaskInfo taskInfo, AudioResourceManager* resourceManager, AudioInfo audioInfo, decltype(dynamicTaskHandle) dynamicTaskHandle, ARGS&&... args)
 		{
-			uint32 bytes = audioInfo.GetAudioSize(); const byte* dataPointer = nullptr;
-
-			auto searchResult = resourceManager->audioBytes.TryEmplace(audioInfo.Name);
-			
-			if (searchResult.State())
-			{
-				resourceManager->packageFiles[resourceManager->getThread()].SetPointer(audioInfo.ByteOffset, GTSL::File::MoveFrom::BEGIN);
-				auto& buffer = searchResult.Get();
-				buffer.Allocate(bytes, 16, resourceManager->GetPersistentAllocator()); //allocate on 16 byte alignment to allow data to be loaded for SIMD with alignment
-				resourceManager->packageFiles[resourceManager->getThread()].ReadFile(bytes, buffer.GetBufferInterface());
-				dataPointer = buffer.GetData();
-			}
-			else
-			{
-				dataPointer = searchResult.Get().GetData();
-			}
+			const uint32 bytes = audioInfo.GetAudioSize();
+
+			auto loadData = [&](const GTSL::Range<byte*> data) { resourceManager->loadAudioData(audioInfo, data.begin()); };
+
+			//allocate on 16 byte alignment to allow data to be loaded for SIMD with alignment
+			const byte* dataPointer = resourceManager->audioBytes.Acquire(audioInfo.Name, AUDIO_CATEGORY, bytes, 16, loadData);
 
 			taskInfo.GameInstance->AddStoredDynamicTask(dynamicTaskHandle, GTSL::MoveRef(resourceManager), GTSL::MoveRef(audioInfo), GTSL::Range<const byte*>(bytes, dataPointer), GTSL::ForwardRef<ARGS>(args)...);
 		};
@@ -109,7 +185,82 @@ public:
 	}
 
 private:
-	GTSL::File indexFile;
-	GTSL::FlatHashMap<Id, AudioDataSerialize, BE::PersistentAllocatorReference> audioResourceInfos;
-	GTSL::FlatHashMap<Id, GTSL::Buffer<BE::PAR>, BE::PersistentAllocatorReference> audioBytes;
+	static constexpr uint8 AUDIO_CATEGORY = 0;
+	static constexpr uint64 DEFAULT_AUDIO_BUDGET = 64 * 1024 * 1024;
+	
+	ReloadableResourceIndex<AudioDataSerialize> audioResourceInfos;
+
+	/**
+	 * \brief Streamed audio is not prefetched, it's read a chunk at a time as it plays.
+	 */
+	bool getPackageRange(Id name, uint32& byteOffset, uint32& size) override;
+	ResidencyCache audioBytes;
+
+	struct AudioStream
+	{
+		Id Name;
+		AudioCodec Codec = AudioCodec::PCM;
+		/**
+		 * \brief Bytes is the size of the decoded sound, the ring holds decoded chunks.
+		 */
+		uint32 ByteOffset = 0, Bytes = 0;
+		GTSL::Buffer<BE::PAR> Ring;
+		/**
+		 * \brief Encoded chunk being read, for codecs other than PCM.
+		 */
+		GTSL::Buffer<BE::PAR> EncodedChunk;
+		uint32 ChunkSizes[STREAM_CHUNK_COUNT]{ 0 };
+
+		/**
+		 * \brief Offset into the front chunk. Only touched by the consumer.
+		 */
+		uint32 ReadOffset = 0;
+
+		/**
+		 * \brief Running count of chunks loaded and consumed, the difference is the number of chunks ready to be read. The producer only writes
+		 * ProducedChunks and the consumer only ConsumedChunks, a slot belongs to whoever's count hasn't passed it.
+		 */
+		std::atomic<uint32> ProducedChunks{ 0 }, ConsumedChunks{ 0 };
+
+		/**
+		 * \brief Guards Loading and Closed, which only gameplay code and prefetch tasks touch.
+		 */
+		GTSL::Mutex Mutex;
+		bool Loading = false, Closed = false;
+	};
+
+	/**
+	 * \brief Open streams by handle, null for free slots. Slots are only written by gameplay code, a stream is closed after it's consumer is done with it.
+	 */
+	AudioStream* audioStreams[MAX_AUDIO_STREAMS]{};
+	/**
+	 * \brief Guards opening, closing and prefetching from gameplay code, never taken by consumers.
+	 */
+	GTSL::Mutex audioStreamsMutex;
+
+	std::atomic<uint64> decodedFrames[AUDIO_CODEC_COUNT]{}, decodeMicroseconds[AUDIO_CODEC_COUNT]{};
+
+	/**
+	 * \brief Codec sounds are imported with, ADPCM unless the "uncompressedAudio" option is set.
+	 */
+	AudioCodec importCodec = AudioCodec::ADPCM;
+
+	/**
+	 * \brief Decodes frames frames to the mix format and accounts for the time it took.
+	 */
+	void decodeAudio(AudioCodec codec, const byte* encoded, uint32 frames, byte* samples);
+
+	/**
+	 * \brief Reads and decodes a whole sound into data.
+	 */
+	void loadAudioData(AudioInfo audioInfo, byte* data);
+
+	void prefetchStream(GameInstance* gameInstance, AudioStream* audioStream);
+
+	/**
+	 * \brief Reads a wav file, converts it's samples to the mix format, resampling them if needed, and encodes them with importCodec into audioBuffer.
+	 * Fills data with the format, ByteOffset is left for the caller to set.
+	 * \return Encoded sound, pointing into audioBuffer.
+	 */
+	GTSL::Range<const byte*> importAudio(GTSL::Range<const utf8*> filePath, AudioDataSerialize& data, GTSL::Buffer<BE::TAR>& audioBuffer);
 };
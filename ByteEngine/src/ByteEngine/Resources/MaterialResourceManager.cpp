@@ -2,7 +2,10 @@
 
 #include <GTSL/Buffer.hpp>
 #include <GTSL/DataSizes.h>
+#include <GTSL/Semaphore.h>
 #include <GTSL/Serialize.h>
+#include <GTSL/Vector.hpp>
+
 #include "ByteEngine/Application/Application.h"
 #include "ByteEngine/Game/GameInstance.h"
 #include "ByteEngine/Render/RenderTypes.h"
@@ -13,7 +16,7 @@ static_assert((uint8)GAL::ShaderType::COMPUTE_SHADER == 5, "Enum changed!");
 static constexpr const char* TYPE_TO_EXTENSION[12] = { ".vs", ".tcs", ".tes", ".gs", ".fs", ".cs", ".rgs", ".ahs", ".chs", ".ms", ".is", ".cs" };
 
 MaterialResourceManager::MaterialResourceManager() : ResourceManager("MaterialResourceManager"), rasterMaterialInfos(16, GetPersistentAllocator()),
-rtMaterialInfos(16, GetPersistentAllocator()), rtHandles(16, GetPersistentAllocator())
+rtMaterialInfos(16, GetPersistentAllocator()), rtHandles(16, GetPersistentAllocator()), shaderCache(GetPersistentAllocator())
 {
 	GTSL::Buffer<BE::TAR> rasterFileBuffer; rasterFileBuffer.Allocate((uint32)GTSL::Byte(GTSL::MegaByte(1)), 8, GetTransientAllocator());
 	
@@ -39,58 +42,74 @@ rtMaterialInfos(16, GetPersistentAllocator()), rtHandles(16, GetPersistentAlloca
 		Insert(rasterMaterialInfos, rasterFileBuffer);
 		Insert(rtMaterialInfos, rasterFileBuffer);
 	}
+
+	resources_path.Drop(resources_path.FindLast('/').Get() + 1);
+	resources_path += "ShaderCache.becache";
+	shaderCache.Open(resources_path);
 }
 
 MaterialResourceManager::~MaterialResourceManager()
 {
 }
 
-void MaterialResourceManager::CreateRasterMaterial(const RasterMaterialCreateInfo& materialCreateInfo)
+void MaterialResourceManager::CreateRasterMaterials(const GTSL::Range<const RasterMaterialCreateInfo*> materialCreateInfos)
 {
-	const auto hashed_name = GTSL::Id64(materialCreateInfo.ShaderName);
-	
-	if (!rasterMaterialInfos.Find(hashed_name))
+	GTSL::Vector<ShaderCompileJob*, BE::TAR> jobs(16, GetTransientAllocator());
+	GTSL::Vector<uint32, BE::TAR> shaderJobs(32, GetTransientAllocator());
+	GTSL::Vector<bool, BE::TAR> createMaterial(static_cast<uint32>(materialCreateInfos.ElementCount()), GetTransientAllocator());
+
+	for (uint32 m = 0; m < materialCreateInfos.ElementCount(); ++m)
 	{
-		GTSL::Buffer<BE::TAR> shader_source_buffer; shader_source_buffer.Allocate(GTSL::Byte(GTSL::MegaByte(1)), 8, GetTransientAllocator());
-		GTSL::Buffer<BE::TAR> index_buffer; index_buffer.Allocate(GTSL::Byte(GTSL::MegaByte(1)), 8, GetTransientAllocator());
-		GTSL::Buffer<BE::TAR> shader_buffer; shader_buffer.Allocate(GTSL::Byte(GTSL::MegaByte(1)), 8, GetTransientAllocator());
-		GTSL::Buffer<BE::TAR> shader_error_buffer; shader_error_buffer.Allocate(GTSL::Byte(GTSL::KiloByte(512)), 8, GetTransientAllocator());
-		
-		RasterMaterialDataSerialize materialInfo;
-		
-		GTSL::StaticString<256> resources_path;
-		resources_path += BE::Application::Get()->GetPathToApplication(); resources_path += "/resources/";
+		const auto& materialCreateInfo = materialCreateInfos[m];
+		const auto hashed_name = GTSL::Id64(materialCreateInfo.ShaderName);
 
-		GTSL::File shader;
+		bool create = !rasterMaterialInfos.Find(hashed_name);
+		for (uint32 p = 0; p < m && create; ++p) { create = GTSL::Id64(materialCreateInfos[p].ShaderName) != hashed_name; }
+		createMaterial.EmplaceBack(create);
 
-		materialInfo.ByteOffset = package.GetFileSize();
-		
-		for (uint8 i = 0; i < materialCreateInfo.ShaderTypes.ElementCount(); ++i)
-		{
-			resources_path += materialCreateInfo.ShaderName; resources_path += TYPE_TO_EXTENSION[static_cast<uint8>(materialCreateInfo.ShaderTypes[i])];
+		if (!create) { continue; }
 
-			shader.OpenFile(resources_path, GTSL::File::AccessMode::READ);
-			shader.ReadFile(shader_source_buffer.GetBufferInterface());
+		for (auto shaderType : materialCreateInfo.ShaderTypes) { shaderJobs.EmplaceBack(addShaderCompileJob(materialCreateInfo.ShaderName, shaderType, jobs)); }
+	}
 
-			auto f = GTSL::Range<const utf8*>(shader_source_buffer.GetLength(), reinterpret_cast<const utf8*>(shader_source_buffer.GetData()));
-			const auto comp_res = GAL::CompileShader(f, resources_path, materialCreateInfo.ShaderTypes[i], GAL::ShaderLanguage::GLSL, shader_buffer.GetBufferInterface(), shader_error_buffer.GetBufferInterface());
-			*(shader_error_buffer.GetData() + (shader_error_buffer.GetLength() - 1)) = '\0';
-			if(comp_res == false)
-			{
-				BE_LOG_ERROR(reinterpret_cast<const char*>(shader_error_buffer.GetData()));
-			}
-			BE_ASSERT(comp_res != false, shader_error_buffer.GetData());
+	if (!jobs.GetLength()) { return; }
 
-			materialInfo.ShaderSizes.EmplaceBack(shader_buffer.GetLength());
-			package.WriteToFile(shader_buffer);
-			
-			resources_path.Drop(resources_path.FindLast('/').Get() + 1);
+	runShaderCompileJobs(jobs.GetRange(), true);
 
-			shader_source_buffer.Resize(0);
-			shader_error_buffer.Resize(0);
-			shader_buffer.Resize(0);
+	GTSL::Buffer<BE::TAR> index_buffer; index_buffer.Allocate(GTSL::Byte(GTSL::MegaByte(1)), 8, GetTransientAllocator());
+	GTSL::Buffer<BE::TAR> shader_buffer; shader_buffer.Allocate(GTSL::Byte(GTSL::MegaByte(1)), 8, GetTransientAllocator());
+
+	GTSL::WriteLock lock(mutex);
+
+	uint32 shader = 0;
+
+	for (uint32 m = 0; m < materialCreateInfos.ElementCount(); ++m)
+	{
+		if (!createMaterial[m]) { continue; }
+
+		const auto& materialCreateInfo = materialCreateInfos[m];
+
+		RasterMaterialDataSerialize materialInfo;
+		bool compiled = true;
+		shader_buffer.Resize(0);
+
+		for (uint32 i = 0; i < materialCreateInfo.ShaderTypes.ElementCount(); ++i)
+		{
+			const auto* job = jobs[shaderJobs[shader++]];
+			compiled = compiled && job->Compiled;
+			if (!compiled) { continue; }
+
+			materialInfo.ShaderSizes.EmplaceBack(job->Binary.GetLength());
+			shader_buffer.CopyBytes(job->Binary.GetLength(), job->Binary.GetData());
 		}
 
+		BE_ASSERT(compiled != false, "Failed to compile shaders!");
+		if (!compiled) { continue; }
+
+		materialInfo.ByteOffset = package.GetFileSize();
+		package.SetPointer(materialInfo.ByteOffset, GTSL::File::MoveFrom::BEGIN);
+		package.WriteToFile(shader_buffer);
+
 		materialInfo.VertexElements = materialCreateInfo.VertexFormat;
 		materialInfo.ShaderTypes = materialCreateInfo.ShaderTypes;
 		materialInfo.RenderGroup = GTSL::Id64(materialCreateInfo.RenderGroup);
@@ -108,71 +127,230 @@ void MaterialResourceManager::CreateRasterMaterial(const RasterMaterialCreateInf
 		materialInfo.Front = materialCreateInfo.Front;
 		materialInfo.Back = materialCreateInfo.Back;
 
-		materialInfo.Parameters = materialCreateInfo.Parameters;
-
 		materialInfo.MaterialInstances = materialCreateInfo.MaterialInstances;
 		
-		rasterMaterialInfos.Emplace(hashed_name, materialInfo);
-		index.SetPointer(0, GTSL::File::MoveFrom::BEGIN);
-		Insert(rasterMaterialInfos, index_buffer);
-		Insert(rtMaterialInfos, index_buffer);
-		index.WriteToFile(index_buffer);
+		rasterMaterialInfos.Emplace(GTSL::Id64(materialCreateInfo.ShaderName), materialInfo);
 	}
+
+	writeIndex(index_buffer);
+	freeShaderCompileJobs(jobs.GetRange());
 }
 
-void MaterialResourceManager::CreateRayTraceMaterial(const RayTraceMaterialCreateInfo& materialCreateInfo)
+bool MaterialResourceManager::ReloadResource(GameInstance* gameInstance, const utf8* fileName)
 {
-	const auto hashed_name = GTSL::Id64(materialCreateInfo.ShaderName);
+	GTSL::StaticString<256> name;
 
-	if (!rtMaterialInfos.Find(hashed_name))
+	for (uint8 i = 0; i < static_cast<uint8>(GAL::ShaderType::COMPUTE_SHADER) + 1; ++i)
 	{
-		GTSL::Buffer<BE::TAR> shader_source_buffer; shader_source_buffer.Allocate(GTSL::Byte(GTSL::KiloByte(512)), 8, GetTransientAllocator());
-		GTSL::Buffer<BE::TAR> index_buffer; index_buffer.Allocate(GTSL::Byte(GTSL::KiloByte(512)), 8, GetTransientAllocator());
-		GTSL::Buffer<BE::TAR> shader_buffer; shader_buffer.Allocate(GTSL::Byte(GTSL::KiloByte(512)), 8, GetTransientAllocator());
-		GTSL::Buffer<BE::TAR> shader_error_buffer; shader_error_buffer.Allocate(GTSL::Byte(GTSL::KiloByte(8)), 8, GetTransientAllocator());
+		if (!parseFileName(fileName, TYPE_TO_EXTENSION[i], name)) { continue; }
 
-		RayTraceMaterialInfo materialInfo;
-		
-		GTSL::StaticString<256> resources_path;
-		resources_path += BE::Application::Get()->GetPathToApplication(); resources_path += "/resources/";
+		{
+			GTSL::ReadLock lock(mutex);
+			if (!rasterMaterialInfos.Find(Id(name.begin()))) { return false; } //materials are created by the application, shaders which aren't part of one yet are compiled when it is
+		}
 
-		GTSL::File shader;
+		auto reloadMaterial = [](TaskInfo taskInfo, MaterialResourceManager* resourceManager, GTSL::StaticString<256> name)
+		{
+			GTSL::Buffer<BE::TAR> shaderBuffer; shaderBuffer.Allocate(GTSL::Byte(GTSL::MegaByte(1)), 8, resourceManager->GetTransientAllocator());
+			GTSL::Buffer<BE::TAR> indexBuffer; indexBuffer.Allocate(GTSL::Byte(GTSL::MegaByte(1)), 8, resourceManager->GetTransientAllocator());
+
+			{
+				GTSL::WriteLock lock(resourceManager->mutex);
+				auto& materialInfo = resourceManager->rasterMaterialInfos.At(Id(name.begin()));
 
-		materialInfo.OffsetToBinary = package.GetFileSize();
+				GTSL::Array<uint32, 12> shaderSizes;
+				//keep running with the last shaders that compiled, so a typo doesn't take the material away
+				if (!resourceManager->compileShaders(name, GTSL::Range<const GAL::ShaderType*>(materialInfo.ShaderTypes.GetLength(), materialInfo.ShaderTypes.begin()), shaderSizes, shaderBuffer)) { return; }
 
-		resources_path += materialCreateInfo.ShaderName; resources_path += TYPE_TO_EXTENSION[static_cast<uint8>(materialCreateInfo.Type)];
+				materialInfo.ShaderSizes = shaderSizes;
 
-		shader.OpenFile(resources_path, GTSL::File::AccessMode::READ);
-		shader.ReadFile(shader_source_buffer.GetBufferInterface());
+				materialInfo.ByteOffset = resourceManager->package.GetFileSize();
+				resourceManager->package.SetPointer(materialInfo.ByteOffset, GTSL::File::MoveFrom::BEGIN);
+				resourceManager->package.WriteToFile(shaderBuffer);
 
-		auto f = GTSL::Range<const utf8*>(shader_source_buffer.GetLength(), reinterpret_cast<const utf8*>(shader_source_buffer.GetData()));
-		const auto comp_res = GAL::CompileShader(f, resources_path, materialCreateInfo.Type, GAL::ShaderLanguage::GLSL, shader_buffer.GetBufferInterface(), shader_error_buffer.GetBufferInterface());
-		*(shader_error_buffer.GetData() + (shader_error_buffer.GetLength() - 1)) = '\0';
-		if (comp_res == false)
+				resourceManager->writeIndex(indexBuffer);
+			}
+
+			taskInfo.GameInstance->DispatchEvent("MaterialResourceManager", GetOnMaterialReloadEventHandle(), Id(name.begin()));
+		};
+
+		//runs within a frame so the transient allocations made while compiling stay valid
+		gameInstance->AddDynamicTask("reloadMaterial", Task<MaterialResourceManager*, GTSL::StaticString<256>>::Create(reloadMaterial), {}, "FrameStart", "FrameEnd", this, GTSL::MoveRef(name));
+		return true;
+	}
+
+	return false;
+}
+
+struct MaterialResourceManager::ShaderCompileJob
+{
+	uint64 Key = 0;
+	GAL::ShaderType ShaderType;
+	GTSL::StaticString<256> Path;
+	GTSL::Buffer<BE::PAR> Source, Binary, Errors;
+	bool Compiled = false;
+	/**
+	 * \brief Posted when the job finishes compiling, nullptr if it's binary was taken from the cache.
+	 */
+	GTSL::Semaphore* Done = nullptr;
+};
+
+uint32 MaterialResourceManager::addShaderCompileJob(const GTSL::Range<const utf8*> shaderName, const GAL::ShaderType shaderType, GTSL::Vector<ShaderCompileJob*, BE::TAR>& jobs)
+{
+	auto* job = GTSL::New<ShaderCompileJob>(GetPersistentAllocator());
+	job->ShaderType = shaderType;
+	job->Path += BE::Application::Get()->GetPathToApplication(); job->Path += "/resources/";
+	job->Path += shaderName; job->Path += TYPE_TO_EXTENSION[static_cast<uint8>(shaderType)];
+
+	GTSL::File shader; shader.OpenFile(job->Path, GTSL::File::AccessMode::READ);
+	job->Source.Allocate(static_cast<uint32>(shader.GetFileSize()) + 1, 8, GetPersistentAllocator());
+	shader.ReadFile(job->Source.GetBufferInterface());
+
+	job->Key = ShaderCache::GetKey(GTSL::Range<const byte*>(job->Source.GetLength(), job->Source.GetData()), shaderType);
+
+	for (uint32 i = 0; i < jobs.GetLength(); ++i) {
+		if (jobs[i]->Key == job->Key) { GTSL::Delete(job, GetPersistentAllocator()); return i; } //same source and type requested by another material
+	}
+
+	jobs.EmplaceBack(job);
+	return jobs.GetLength() - 1;
+}
+
+void MaterialResourceManager::runShaderCompileJobs(const GTSL::Range<ShaderCompileJob* const*> jobs, const bool parallel)
+{
+	GTSL::Semaphore done; uint32 compiling = 0;
+
+	auto compile = [](ShaderCompileJob* job)
+	{
+		const auto source = GTSL::Range<const utf8*>(job->Source.GetLength(), reinterpret_cast<const utf8*>(job->Source.GetData()));
+		job->Compiled = GAL::CompileShader(source, job->Path, job->ShaderType, GAL::ShaderLanguage::GLSL, job->Binary.GetBufferInterface(), job->Errors.GetBufferInterface());
+		job->Done->Post();
+	};
+
+	auto* threadPool = BE::Application::Get()->GetThreadPool();
+
+	for (auto* job : jobs)
+	{
+		if (const auto size = shaderCache.GetSize(job->Key))
 		{
-			BE_LOG_ERROR(reinterpret_cast<const char*>(shader_error_buffer.GetData()));
+			job->Binary.Allocate(size, 8, GetPersistentAllocator());
+			shaderCache.Read(job->Key, GTSL::Range<byte*>(size, job->Binary.GetData()));
+			job->Binary.Resize(size);
+			job->Compiled = true;
+			continue;
 		}
-		BE_ASSERT(comp_res != false, shader_error_buffer.GetData());
 
-		materialInfo.ShaderInfo.BinarySize = shader_buffer.GetLength();
-		materialInfo.ShaderInfo.ColorBlendOperation = materialCreateInfo.ColorBlendOperation;
-		materialInfo.ShaderInfo.ShaderType = materialCreateInfo.Type;
-		package.WriteToFile(shader_buffer);
+		job->Binary.Allocate(GTSL::Byte(GTSL::KiloByte(256)), 8, GetPersistentAllocator());
+		job->Errors.Allocate(GTSL::Byte(GTSL::KiloByte(16)), 8, GetPersistentAllocator());
+		job->Done = &done;
+
+		if (parallel) { threadPool->EnqueueTask(GTSL::Delegate<void(ShaderCompileJob*)>::Create(compile), GTSL::MoveRef(job)); } else { compile(job); }
+		++compiling;
+	}
 
-		resources_path.Drop(resources_path.FindLast('/').Get() + 1);
+	for (uint32 i = 0; i < compiling; ++i) { done.Wait(); }
 
-		shader_source_buffer.Resize(0);
-		shader_error_buffer.Resize(0);
-		shader_buffer.Resize(0);
+	for (auto* job : jobs)
+	{
+		if (!job->Done) { continue; }
 
-		rtMaterialInfos.Emplace(hashed_name, materialInfo);
-		index.SetPointer(0, GTSL::File::MoveFrom::BEGIN);
-		Insert(rasterMaterialInfos, index_buffer);
-		Insert(rtMaterialInfos, index_buffer);
-		index.WriteToFile(index_buffer);
+		if (job->Compiled) {
+			shaderCache.Store(job->Key, GTSL::Range<const byte*>(job->Binary.GetLength(), job->Binary.GetData()));
+		} else if (job->Errors.GetLength()) {
+			*(job->Errors.GetData() + (job->Errors.GetLength() - 1)) = '\0';
+			BE_LOG_ERROR(reinterpret_cast<const char*>(job->Errors.GetData()));
+		}
 	}
-	
-	rtHandles.EmplaceBack(hashed_name);
+}
+
+void MaterialResourceManager::freeShaderCompileJobs(const GTSL::Range<ShaderCompileJob* const*> jobs)
+{
+	for (auto* job : jobs) { GTSL::Delete(job, GetPersistentAllocator()); }
+}
+
+bool MaterialResourceManager::compileShaders(const GTSL::Range<const utf8*> shaderName, const GTSL::Range<const GAL::ShaderType*> shaderTypes, GTSL::Array<uint32, 12>& shaderSizes, GTSL::Buffer<BE::TAR>& shaderBuffer)
+{
+	GTSL::Vector<ShaderCompileJob*, BE::TAR> jobs(12, GetTransientAllocator());
+	GTSL::Array<uint32, 12> shaderJobs;
+
+	for (auto shaderType : shaderTypes) { shaderJobs.EmplaceBack(addShaderCompileJob(shaderName, shaderType, jobs)); }
+
+	runShaderCompileJobs(jobs.GetRange(), false); //called from reload tasks, which run on the thread pool
+
+	bool compiled = true;
+	for (auto e : shaderJobs) { compiled = compiled && jobs[e]->Compiled; }
+
+	if (compiled)
+	{
+		for (auto e : shaderJobs) {
+			shaderSizes.EmplaceBack(jobs[e]->Binary.GetLength());
+			shaderBuffer.CopyBytes(jobs[e]->Binary.GetLength(), jobs[e]->Binary.GetData());
+		}
+	}
+
+	freeShaderCompileJobs(jobs.GetRange());
+	return compiled;
+}
+
+void MaterialResourceManager::writeIndex(GTSL::Buffer<BE::TAR>& indexBuffer)
+{
+	index.SetPointer(0, GTSL::File::MoveFrom::BEGIN);
+	Insert(rasterMaterialInfos, indexBuffer);
+	Insert(rtMaterialInfos, indexBuffer);
+	index.WriteToFile(indexBuffer);
+}
+
+void MaterialResourceManager::CreateRayTraceMaterials(const GTSL::Range<const RayTraceMaterialCreateInfo*> materialCreateInfos)
+{
+	static constexpr uint32 NO_JOB = 0xFFFFFFFF;
+
+	GTSL::Vector<ShaderCompileJob*, BE::TAR> jobs(16, GetTransientAllocator());
+	GTSL::Vector<uint32, BE::TAR> materialJobs(static_cast<uint32>(materialCreateInfos.ElementCount()), GetTransientAllocator());
+
+	for (uint32 m = 0; m < materialCreateInfos.ElementCount(); ++m)
+	{
+		const auto hashed_name = GTSL::Id64(materialCreateInfos[m].ShaderName);
+
+		bool create = !rtMaterialInfos.Find(hashed_name);
+		for (uint32 p = 0; p < m && create; ++p) { create = GTSL::Id64(materialCreateInfos[p].ShaderName) != hashed_name; }
+
+		materialJobs.EmplaceBack(create ? addShaderCompileJob(materialCreateInfos[m].ShaderName, materialCreateInfos[m].Type, jobs) : NO_JOB);
+	}
+
+	runShaderCompileJobs(jobs.GetRange(), true);
+
+	GTSL::Buffer<BE::TAR> index_buffer; index_buffer.Allocate(GTSL::Byte(GTSL::KiloByte(512)), 8, GetTransientAllocator());
+
+	GTSL::WriteLock lock(mutex);
+
+	for (uint32 m = 0; m < materialCreateInfos.ElementCount(); ++m)
+	{
+		const auto& materialCreateInfo = materialCreateInfos[m];
+		const auto hashed_name = GTSL::Id64(materialCreateInfo.ShaderName);
+
+		if (materialJobs[m] != NO_JOB)
+		{
+			const auto* job = jobs[materialJobs[m]];
+			BE_ASSERT(job->Compiled != false, "Failed to compile shader!");
+			if (!job->Compiled) { continue; }
+
+			RayTraceMaterialInfo materialInfo;
+			materialInfo.OffsetToBinary = package.GetFileSize();
+			materialInfo.ShaderInfo.BinarySize = job->Binary.GetLength();
+			materialInfo.ShaderInfo.ColorBlendOperation = materialCreateInfo.ColorBlendOperation;
+			materialInfo.ShaderInfo.ShaderType = materialCreateInfo.Type;
+
+			package.SetPointer(materialInfo.OffsetToBinary, GTSL::File::MoveFrom::BEGIN);
+			package.WriteToFile(GTSL::Range<const byte*>(job->Binary.GetLength(), job->Binary.GetData()));
+
+			rtMaterialInfos.Emplace(hashed_name, materialInfo);
+		}
+
+		rtHandles.EmplaceBack(hashed_name);
+	}
+
+	if (jobs.GetLength()) { writeIndex(index_buffer); }
+	freeShaderCompileJobs(jobs.GetRange());
 }
 
 void MaterialResourceManager::GetMaterialSize(const Id name, uint32& size)
@@ -183,6 +361,10 @@ void MaterialResourceManager::GetMaterialSize(const Id name, uint32& size)
 
 void MaterialResourceManager::LoadMaterial(const MaterialLoadInfo& loadInfo)
 {
+	recordLoad(loadInfo.Name); //materials aren't prefetched, but the textures they load are as soon as they are requested
+	
+	GTSL::ReadLock lock(mutex); //a reload may be rewriting the material's shaders
+	
 	auto materialInfo = rasterMaterialInfos.At(loadInfo.Name);
 
 	uint32 mat_size = 0;
@@ -9,6 +9,7 @@
 #include <GTSL/Math/Vector4.h>
 
 #include "ResourceManager.h"
+#include "ShaderCache.h"
 
 #include "ByteEngine/Game/GameInstance.h"
 
@@ -17,6 +18,17 @@ class MaterialResourceManager final : public ResourceManager
 public:
 	MaterialResourceManager();
 	~MaterialResourceManager();
+
+	/**
+	 * \brief Dispatched with a raster material's name after it's shaders have been recompiled from their source files.
+	 */
+	static auto GetOnMaterialReloadEventHandle() { return EventHandle<Id>("OnMaterialReload"); }
+
+	/**
+	 * \brief Recompiles every shader of the raster material named after the changed file. Ray trace shaders are not reloaded.
+	 */
+	bool ReloadResource(GameInstance* gameInstance, const utf8* fileName) override;
+	
 	void GetShaderSize(Id id, uint32* shaderSize);
 
 	enum class ParameterType : uint8
@@ -214,7 +226,13 @@ public:
 
 		GTSL::Array<MaterialInstance, 16> MaterialInstances;
 	};
-	void CreateRasterMaterial(const RasterMaterialCreateInfo& materialCreateInfo);
+	void CreateRasterMaterial(const RasterMaterialCreateInfo& materialCreateInfo) { CreateRasterMaterials(GTSL::Range<const RasterMaterialCreateInfo*>(1, &materialCreateInfo)); }
+
+	/**
+	 * \brief Creates every material which doesn't exist yet. All of their shaders are compiled at once, shaders whose source is in the shader cache
+	 * aren't compiled, identical sources are compiled once and the rest are compiled in parallel on the thread pool.
+	 */
+	void CreateRasterMaterials(GTSL::Range<const RasterMaterialCreateInfo*> materialCreateInfos);
 	
 	struct RayTraceMaterialCreateInfo
 	{
@@ -222,7 +240,12 @@ public:
 		GAL::ShaderType Type;
 		GAL::BlendOperation ColorBlendOperation;
 	};
-	void CreateRayTraceMaterial(const RayTraceMaterialCreateInfo& materialCreateInfo);
+	void CreateRayTraceMaterial(const RayTraceMaterialCreateInfo& materialCreateInfo) { CreateRayTraceMaterials(GTSL::Range<const RayTraceMaterialCreateInfo*>(1, &materialCreateInfo)); }
+
+	/**
+	 * \brief Creates every ray trace material which doesn't exist yet, compiling their shaders like CreateRasterMaterials.
+	 */
+	void CreateRayTraceMaterials(GTSL::Range<const RayTraceMaterialCreateInfo*> materialCreateInfos);
 
 	void GetMaterialSize(const Id name, uint32& size);
 
@@ -374,4 +397,35 @@ private:
 	mutable GTSL::ReadWriteMutex mutex;
 
 	GTSL::Vector<Id, BE::PAR> rtHandles;
+
+	ShaderCache shaderCache;
+
+	/**
+	 * \brief A shader source to compile, or to take from the shader cache. Shaders with the same source and type share a job.
+	 */
+	struct ShaderCompileJob;
+
+	/**
+	 * \brief Reads the source of a shader and returns the index of the job which compiles it, adding one if no job has the same source.
+	 */
+	uint32 addShaderCompileJob(GTSL::Range<const utf8*> shaderName, GAL::ShaderType shaderType, GTSL::Vector<ShaderCompileJob*, BE::TAR>& jobs);
+
+	/**
+	 * \brief Reads cached binaries and compiles the rest of the jobs, storing the results in the shader cache. Errors are logged.
+	 * \param parallel Whether to compile on the thread pool. Tasks running on the pool compile on their own thread, as waiting on jobs queued behind them could deadlock.
+	 */
+	void runShaderCompileJobs(GTSL::Range<ShaderCompileJob* const*> jobs, bool parallel);
+
+	void freeShaderCompileJobs(GTSL::Range<ShaderCompileJob* const*> jobs);
+
+	/**
+	 * \brief Compiles the shaders of a raster material, appending their binaries to shaderBuffer and their sizes to shaderSizes.
+	 * \return False if any shader failed to compile, the error is logged.
+	 */
+	bool compileShaders(GTSL::Range<const utf8*> shaderName, GTSL::Range<const GAL::ShaderType*> shaderTypes, GTSL::Array<uint32, 12>& shaderSizes, GTSL::Buffer<BE::TAR>& shaderBuffer);
+
+	/**
+	 * \brief Serializes every material info into indexBuffer and overwrites the index file with it.
+	 */
+	void writeIndex(GTSL::Buffer<BE::TAR>& indexBuffer);
 };
@@ -0,0 +1,487 @@
+#include "MeshOptimization.h"
+
+#include <cmath>
+#include <algorithm>
+#include <GTSL/Memory.h>
+#include <GTSL/Vector.hpp>
+#include <GTSL/Math/Math.hpp>
+#include <GTSL/Math/Vector3.h>
+
+namespace
+{
+	template<typename T>
+	void fill(GTSL::Vector<T, BE::TAR>& vector, const uint32 length, const T value)
+	{
+		vector.Resize(length);
+		for (uint32 i = 0; i < length; ++i) { vector[i] = value; }
+	}
+
+	const float32* getPosition(const byte* positions, const uint32 positionStride, const uint32 vertex)
+	{
+		return reinterpret_cast<const float32*>(positions + vertex * positionStride);
+	}
+
+	void triangleNormal(const float32* a, const float32* b, const float32* c, float64* normal)
+	{
+		const float64 ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] }, ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+		normal[0] = ab[1] * ac[2] - ab[2] * ac[1]; normal[1] = ab[2] * ac[0] - ab[0] * ac[2]; normal[2] = ab[0] * ac[1] - ab[1] * ac[0];
+	}
+
+	/**
+	 * \brief Sum of squared distances to a set of planes, weighted by the area of the triangles they came from.
+	 */
+	struct Quadric
+	{
+		float64 A00 = 0, A01 = 0, A02 = 0, A11 = 0, A12 = 0, A22 = 0, B0 = 0, B1 = 0, B2 = 0, C = 0, Weight = 0;
+
+		Quadric& operator+=(const Quadric& other)
+		{
+			A00 += other.A00; A01 += other.A01; A02 += other.A02; A11 += other.A11; A12 += other.A12; A22 += other.A22;
+			B0 += other.B0; B1 += other.B1; B2 += other.B2; C += other.C; Weight += other.Weight;
+			return *this;
+		}
+
+		/**
+		 * \brief Returns the weighted mean squared distance from point to the planes.
+		 */
+		float64 Evaluate(const float32* point) const
+		{
+			if (Weight == 0.0) { return 0.0; }
+
+			const float64 x = point[0], y = point[1], z = point[2];
+			const float64 error = A00 * x * x + 2 * A01 * x * y + 2 * A02 * x * z + A11 * y * y + 2 * A12 * y * z + A22 * z * z + 2 * (B0 * x + B1 * y + B2 * z) + C;
+			return GTSL::Math::Max(error, 0.0) / Weight;
+		}
+	};
+}
+
+void OptimizeVertexCache(uint32* indices, const uint32 indexCount, const uint32 vertexCount, const uint32 cacheSize, const BE::TAR& allocator)
+{
+	const uint32 triangleCount = indexCount / 3;
+
+	GTSL::Vector<uint32, BE::TAR> liveTriangles(vertexCount, allocator); fill(liveTriangles, vertexCount, 0u);
+	for (uint32 i = 0; i < indexCount; ++i) { ++liveTriangles[indices[i]]; }
+
+	//vertex to triangle adjacency, triangles of vertex v are adjacency[offsets[v]] to adjacency[offsets[v + 1]]
+	GTSL::Vector<uint32, BE::TAR> offsets(vertexCount + 1, allocator); fill(offsets, vertexCount + 1, 0u);
+	for (uint32 v = 0; v < vertexCount; ++v) { offsets[v + 1] = offsets[v] + liveTriangles[v]; }
+
+	GTSL::Vector<uint32, BE::TAR> adjacency(indexCount, allocator); fill(adjacency, indexCount, 0u);
+	{
+		GTSL::Vector<uint32, BE::TAR> cursors(vertexCount, allocator); fill(cursors, vertexCount, 0u);
+		for (uint32 i = 0; i < indexCount; ++i) { const auto v = indices[i]; adjacency[offsets[v] + cursors[v]++] = i / 3; }
+	}
+
+	GTSL::Vector<uint32, BE::TAR> cacheTimestamps(vertexCount, allocator); fill(cacheTimestamps, vertexCount, 0u);
+	GTSL::Vector<bool, BE::TAR> emitted(triangleCount, allocator); fill(emitted, triangleCount, false);
+	GTSL::Vector<uint32, BE::TAR> deadEnds(indexCount, allocator);
+	GTSL::Vector<uint32, BE::TAR> candidates(64, allocator);
+	GTSL::Vector<uint32, BE::TAR> output(indexCount, allocator);
+
+	uint32 timestamp = cacheSize + 1, cursor = 1;
+	int64 fanningVertex = 0;
+
+	auto skipDeadEnd = [&]() -> int64
+	{
+		while (deadEnds.GetLength()) {
+			const auto vertex = deadEnds[deadEnds.GetLength() - 1]; deadEnds.PopBack();
+			if (liveTriangles[vertex]) { return vertex; }
+		}
+
+		for (; cursor < vertexCount; ++cursor) { if (liveTriangles[cursor]) { return cursor; } }
+
+		return -1;
+	};
+
+	while (fanningVertex >= 0)
+	{
+		candidates.ResizeDown(0);
+
+		for (uint32 a = offsets[static_cast<uint32>(fanningVertex)]; a < offsets[static_cast<uint32>(fanningVertex) + 1]; ++a)
+		{
+			const auto triangle = adjacency[a];
+			if (emitted[triangle]) { continue; }
+
+			for (uint32 i = 0; i < 3; ++i)
+			{
+				const auto vertex = indices[triangle * 3 + i];
+				output.EmplaceBack(vertex); deadEnds.EmplaceBack(vertex); candidates.EmplaceBack(vertex);
+				--liveTriangles[vertex];
+				if (timestamp - cacheTimestamps[vertex] > cacheSize) { cacheTimestamps[vertex] = timestamp++; }
+			}
+
+			emitted[triangle] = true;
+		}
+
+		//pick the candidate that will still be in cache when it's remaining triangles are emitted, favoring the one that entered the cache the earliest
+		int64 best = -1; int64 bestPriority = -1;
+
+		for (uint32 i = 0; i < candidates.GetLength(); ++i)
+		{
+			const auto vertex = candidates[i];
+			if (!liveTriangles[vertex]) { continue; }
+
+			int64 priority = 0;
+			if (timestamp - cacheTimestamps[vertex] + 2 * liveTriangles[vertex] <= cacheSize) { priority = timestamp - cacheTimestamps[vertex]; }
+			if (priority > bestPriority) { bestPriority = priority; best = vertex; }
+		}
+
+		fanningVertex = best != -1 ? best : skipDeadEnd();
+	}
+
+	for (uint32 i = 0; i < indexCount; ++i) { indices[i] = output[i]; }
+}
+
+void OptimizeOverdraw(uint32* indices, const uint32 indexCount, const byte* positions, const uint32 positionStride, const uint32 vertexCount, const uint32 cacheSize, const BE::TAR& allocator)
+{
+	const uint32 triangleCount = indexCount / 3;
+
+	//split at points where all of a triangle's vertices miss the cache, reordering there doesn't cost any cache efficiency
+	GTSL::Vector<uint32, BE::TAR> clusterStarts(64, allocator);
+	{
+		GTSL::Vector<uint32, BE::TAR> cacheTimestamps(vertexCount, allocator); fill(cacheTimestamps, vertexCount, 0u);
+		uint32 timestamp = cacheSize + 1;
+
+		for (uint32 t = 0; t < triangleCount; ++t)
+		{
+			uint32 misses = 0;
+
+			for (uint32 i = 0; i < 3; ++i) {
+				const auto vertex = indices[t * 3 + i];
+				if (timestamp - cacheTimestamps[vertex] > cacheSize) { cacheTimestamps[vertex] = timestamp++; ++misses; }
+			}
+
+			if (t == 0 || misses == 3) { clusterStarts.EmplaceBack(t); }
+		}
+
+		clusterStarts.EmplaceBack(triangleCount);
+	}
+
+	const uint32 clusterCount = clusterStarts.GetLength() - 1;
+	if (clusterCount < 2) { return; }
+
+	float32 meshCentroid[3] = { 0.0f, 0.0f, 0.0f };
+	for (uint32 v = 0; v < vertexCount; ++v) { for (uint32 i = 0; i < 3; ++i) { meshCentroid[i] += getPosition(positions, positionStride, v)[i] / static_cast<float32>(vertexCount); } }
+
+	struct Cluster { uint32 Start, End; float32 SortKey; };
+	GTSL::Vector<Cluster, BE::TAR> clusters(clusterCount, allocator);
+
+	for (uint32 c = 0; c < clusterCount; ++c)
+	{
+		float32 centroid[3] = { 0.0f, 0.0f, 0.0f }, normal[3] = { 0.0f, 0.0f, 0.0f }, area = 0.0f;
+
+		for (uint32 t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t)
+		{
+			const auto* a = getPosition(positions, positionStride, indices[t * 3 + 0]);
+			const auto* b = getPosition(positions, positionStride, indices[t * 3 + 1]);
+			const auto* d = getPosition(positions, positionStride, indices[t * 3 + 2]);
+
+			const float32 ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] }, ad[3] = { d[0] - a[0], d[1] - a[1], d[2] - a[2] };
+			const float32 triangleNormal[3] = { ab[1] * ad[2] - ab[2] * ad[1], ab[2] * ad[0] - ab[0] * ad[2], ab[0] * ad[1] - ab[1] * ad[0] }; //length is twice the area
+			const float32 triangleArea = GTSL::Math::Length(GTSL::Vector3(triangleNormal[0], triangleNormal[1], triangleNormal[2]));
+
+			for (uint32 i = 0; i < 3; ++i) { centroid[i] += (a[i] + b[i] + d[i]) * (triangleArea / 3.0f); normal[i] += triangleNormal[i]; }
+			area += triangleArea;
+		}
+
+		const float32 normalLength = GTSL::Math::Length(GTSL::Vector3(normal[0], normal[1], normal[2]));
+
+		float32 sortKey = 0.0f;
+		for (uint32 i = 0; i < 3; ++i) {
+			const float32 clusterCentroid = area > 0.0f ? centroid[i] / area : centroid[i];
+			sortKey += (clusterCentroid - meshCentroid[i]) * (normalLength > 0.0f ? normal[i] / normalLength : 0.0f);
+		}
+
+		clusters.EmplaceBack(Cluster{ clusterStarts[c], clusterStarts[c + 1], sortKey });
+	}
+
+	std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.SortKey > b.SortKey; });
+
+	GTSL::Vector<uint32, BE::TAR> sortedIndices(indexCount, allocator);
+
+	for (uint32 c = 0; c < clusterCount; ++c) {
+		for (uint32 i = clusters[c].Start * 3; i < clusters[c].End * 3; ++i) { sortedIndices.EmplaceBack(indices[i]); }
+	}
+
+	for (uint32 i = 0; i < indexCount; ++i) { indices[i] = sortedIndices[i]; }
+}
+
+uint32 OptimizeVertexFetch(uint32* remap, uint32* indices, const uint32 indexCount, const uint32 vertexCount)
+{
+	for (uint32 v = 0; v < vertexCount; ++v) { remap[v] = 0xFFFFFFFF; }
+
+	uint32 nextVertex = 0;
+
+	for (uint32 i = 0; i < indexCount; ++i)
+	{
+		auto& newIndex = remap[indices[i]];
+		if (newIndex == 0xFFFFFFFF) { newIndex = nextVertex++; }
+		indices[i] = newIndex;
+	}
+
+	return nextVertex;
+}
+
+float32 CalculateACMR(const uint32* indices, const uint32 indexCount, const uint32 vertexCount, const uint32 cacheSize, const BE::TAR& allocator)
+{
+	if (!indexCount) { return 0.0f; }
+
+	GTSL::Vector<uint32, BE::TAR> cacheTimestamps(vertexCount, allocator); fill(cacheTimestamps, vertexCount, 0u);
+	uint32 timestamp = cacheSize + 1, misses = 0;
+
+	for (uint32 i = 0; i < indexCount; ++i) {
+		if (timestamp - cacheTimestamps[indices[i]] > cacheSize) { cacheTimestamps[indices[i]] = timestamp++; ++misses; }
+	}
+
+	return static_cast<float32>(misses) / static_cast<float32>(indexCount / 3);
+}
+
+uint32 SimplifyMesh(uint32* destination, const uint32* indices, const uint32 indexCount, const byte* positions, const uint32 positionStride, const uint32 vertexCount, const uint32 targetIndexCount, const float32 targetError, float32* resultError, const BE::TAR& allocator)
+{
+	GTSL::Vector<Quadric, BE::TAR> quadrics(vertexCount, allocator); fill(quadrics, vertexCount, Quadric());
+
+	for (uint32 i = 0; i < indexCount; i += 3)
+	{
+		const float32* a = getPosition(positions, positionStride, indices[i]);
+		float64 normal[3]; triangleNormal(a, getPosition(positions, positionStride, indices[i + 1]), getPosition(positions, positionStride, indices[i + 2]), normal);
+
+		const float64 length = GTSL::Math::Length(GTSL::Vector3(static_cast<float32>(normal[0]), static_cast<float32>(normal[1]), static_cast<float32>(normal[2])));
+		if (length == 0.0) { continue; }
+
+		for (auto& c : normal) { c /= length; }
+		const float64 d = -(normal[0] * a[0] + normal[1] * a[1] + normal[2] * a[2]), area = length * 0.5;
+
+		Quadric quadric;
+		quadric.A00 = area * normal[0] * normal[0]; quadric.A01 = area * normal[0] * normal[1]; quadric.A02 = area * normal[0] * normal[2];
+		quadric.A11 = area * normal[1] * normal[1]; quadric.A12 = area * normal[1] * normal[2]; quadric.A22 = area * normal[2] * normal[2];
+		quadric.B0 = area * normal[0] * d; quadric.B1 = area * normal[1] * d; quadric.B2 = area * normal[2] * d;
+		quadric.C = area * d * d; quadric.Weight = area;
+
+		for (uint32 v = 0; v < 3; ++v) { quadrics[indices[i + v]] += quadric; }
+	}
+
+	//an edge with no opposite half edge is on a border, which includes seams where the importer split vertices
+	GTSL::Vector<bool, BE::TAR> locked(vertexCount, allocator); fill(locked, vertexCount, false);
+	{
+		GTSL::Vector<uint64, BE::TAR> halfEdges(indexCount, allocator);
+		for (uint32 i = 0; i < indexCount; ++i) { halfEdges.EmplaceBack(static_cast<uint64>(indices[i]) << 32 | indices[i - i % 3 + (i + 1) % 3]); }
+		std::sort(halfEdges.begin(), halfEdges.end());
+
+		for (const auto halfEdge : halfEdges)
+		{
+			const uint32 from = static_cast<uint32>(halfEdge >> 32), to = static_cast<uint32>(halfEdge);
+			if (!std::binary_search(halfEdges.begin(), halfEdges.end(), static_cast<uint64>(to) << 32 | from)) { locked[from] = true; locked[to] = true; }
+		}
+	}
+
+	for (uint32 i = 0; i < indexCount; ++i) { destination[i] = indices[i]; }
+	uint32 resultIndexCount = indexCount;
+
+	struct Collapse { uint32 From, To; float64 Error; };
+	GTSL::Vector<Collapse, BE::TAR> collapses(indexCount * 2, allocator);
+	GTSL::Vector<uint32, BE::TAR> remap(vertexCount, allocator); remap.Resize(vertexCount);
+	GTSL::Vector<bool, BE::TAR> touched(vertexCount, allocator);
+	GTSL::Vector<uint32, BE::TAR> triangleCounts(vertexCount, allocator), offsets(vertexCount + 1, allocator), adjacency(indexCount, allocator);
+
+	const float64 errorLimit = static_cast<float64>(targetError) * targetError;
+	float64 maxError = 0.0;
+
+	while (resultIndexCount > targetIndexCount)
+	{
+		collapses.ResizeDown(0);
+
+		for (uint32 i = 0; i < resultIndexCount; ++i)
+		{
+			const uint32 a = destination[i], b = destination[i - i % 3 + (i + 1) % 3];
+			Quadric quadric = quadrics[a]; quadric += quadrics[b];
+			if (!locked[a]) { collapses.EmplaceBack(Collapse{ a, b, quadric.Evaluate(getPosition(positions, positionStride, b)) }); }
+			if (!locked[b]) { collapses.EmplaceBack(Collapse{ b, a, quadric.Evaluate(getPosition(positions, positionStride, a)) }); }
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.Error < b.Error; });
+
+		fill(triangleCounts, vertexCount, 0u); fill(offsets, vertexCount + 1, 0u); fill(adjacency, resultIndexCount, 0u);
+		for (uint32 i = 0; i < resultIndexCount; ++i) { ++triangleCounts[destination[i]]; }
+		for (uint32 v = 0; v < vertexCount; ++v) { offsets[v + 1] = offsets[v] + triangleCounts[v]; }
+		fill(triangleCounts, vertexCount, 0u);
+		for (uint32 i = 0; i < resultIndexCount; ++i) { const auto v = destination[i]; adjacency[offsets[v] + triangleCounts[v]++] = i / 3; }
+
+		fill(touched, vertexCount, false);
+		for (uint32 v = 0; v < vertexCount; ++v) { remap[v] = v; }
+
+		//moving a vertex onto another must not turn any of it's remaining triangles around
+		auto flips = [&](const Collapse& collapse)
+		{
+			for (uint32 t = offsets[collapse.From]; t < offsets[collapse.From + 1]; ++t)
+			{
+				const uint32* triangle = destination + adjacency[t] * 3;
+				if (triangle[0] == collapse.To || triangle[1] == collapse.To || triangle[2] == collapse.To) { continue; }
+
+				const float32* before[3]; const float32* after[3];
+				for (uint32 v = 0; v < 3; ++v) {
+					before[v] = getPosition(positions, positionStride, triangle[v]);
+					after[v] = triangle[v] == collapse.From ? getPosition(positions, positionStride, collapse.To) : before[v];
+				}
+
+				float64 normalBefore[3], normalAfter[3];
+				triangleNormal(before[0], before[1], before[2], normalBefore); triangleNormal(after[0], after[1], after[2], normalAfter);
+				if (normalBefore[0] * normalAfter[0] + normalBefore[1] * normalAfter[1] + normalBefore[2] * normalAfter[2] <= 0.0) { return true; }
+			}
+
+			return false;
+		};
+
+		uint32 removedIndices = 0, performedCollapses = 0;
+
+		for (const auto& collapse : collapses)
+		{
+			if (collapse.Error > errorLimit || removedIndices >= resultIndexCount - targetIndexCount) { break; }
+			if (touched[collapse.From] || touched[collapse.To] || flips(collapse)) { continue; }
+
+			remap[collapse.From] = collapse.To; quadrics[collapse.To] += quadrics[collapse.From];
+			maxError = GTSL::Math::Max(maxError, collapse.Error);
+
+			//vertices sharing a triangle with the collapsed one wait for the next pass, so every flip test in this pass sees final positions
+			for (uint32 t = offsets[collapse.From]; t < offsets[collapse.From + 1]; ++t) {
+				for (uint32 v = 0; v < 3; ++v) { touched[destination[adjacency[t] * 3 + v]] = true; }
+			}
+
+			removedIndices += 6; ++performedCollapses; //an interior edge collapse removes two triangles
+		}
+
+		if (!performedCollapses) { break; }
+
+		uint32 writtenIndices = 0;
+
+		for (uint32 i = 0; i < resultIndexCount; i += 3)
+		{
+			const uint32 a = remap[destination[i]], b = remap[destination[i + 1]], c = remap[destination[i + 2]];
+			if (a == b || b == c || c == a) { continue; }
+			destination[writtenIndices++] = a; destination[writtenIndices++] = b; destination[writtenIndices++] = c;
+		}
+
+		resultIndexCount = writtenIndices;
+	}
+
+	*resultError = static_cast<float32>(std::sqrt(maxError));
+
+	return resultIndexCount;
+}
+
+void BuildMeshlets(const uint32* indices, const uint32 indexCount, const byte* positions, const uint32 positionStride, const uint32 vertexCount, GTSL::Vector<Meshlet, BE::TAR>& meshlets, const BE::TAR& allocator)
+{
+	//meshlet + 1 each vertex was last added to, so the set doesn't have to be cleared between meshlets
+	GTSL::Vector<uint32, BE::TAR> vertexMeshlet(vertexCount, allocator); fill(vertexMeshlet, vertexCount, 0u);
+
+	auto computeBounds = [&](Meshlet& meshlet)
+	{
+		float32 min[3] = { 3.4e38f, 3.4e38f, 3.4e38f }, max[3] = { -3.4e38f, -3.4e38f, -3.4e38f }, normalSum[3] = { 0.0f, 0.0f, 0.0f };
+
+		for (uint32 i = meshlet.FirstIndex; i < meshlet.FirstIndex + meshlet.IndexCount; ++i) {
+			const auto* position = getPosition(positions, positionStride, indices[i]);
+			for (uint32 c = 0; c < 3; ++c) { min[c] = GTSL::Math::Limit(min[c], position[c]); max[c] = GTSL::Math::Max(max[c], position[c]); }
+		}
+
+		for (uint32 c = 0; c < 3; ++c) { meshlet.Center[c] = (min[c] + max[c]) * 0.5f; }
+
+		meshlet.Radius = 0.0f;
+		for (uint32 i = meshlet.FirstIndex; i < meshlet.FirstIndex + meshlet.IndexCount; ++i) {
+			const auto* position = getPosition(positions, positionStride, indices[i]);
+			meshlet.Radius = GTSL::Math::Max(meshlet.Radius, GTSL::Math::Length(GTSL::Vector3(position[0] - meshlet.Center[0], position[1] - meshlet.Center[1], position[2] - meshlet.Center[2])));
+		}
+
+		auto triangleNormal = [&](const uint32 firstIndex, float32* normal)
+		{
+			const auto* a = getPosition(positions, positionStride, indices[firstIndex + 0]);
+			const auto* b = getPosition(positions, positionStride, indices[firstIndex + 1]);
+			const auto* d = getPosition(positions, positionStride, indices[firstIndex + 2]);
+
+			const float32 ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] }, ad[3] = { d[0] - a[0], d[1] - a[1], d[2] - a[2] };
+			normal[0] = ab[1] * ad[2] - ab[2] * ad[1]; normal[1] = ab[2] * ad[0] - ab[0] * ad[2]; normal[2] = ab[0] * ad[1] - ab[1] * ad[0];
+
+			const float32 length = GTSL::Math::Length(GTSL::Vector3(normal[0], normal[1], normal[2]));
+			if (length == 0.0f) { return false; } //degenerate triangles don't constrain the cone
+			for (uint32 c = 0; c < 3; ++c) { normal[c] /= length; }
+			return true;
+		};
+
+		for (uint32 i = meshlet.FirstIndex; i < meshlet.FirstIndex + meshlet.IndexCount; i += 3) {
+			float32 normal[3];
+			if (triangleNormal(i, normal)) { for (uint32 c = 0; c < 3; ++c) { normalSum[c] += normal[c]; } }
+		}
+
+		const float32 axisLength = GTSL::Math::Length(GTSL::Vector3(normalSum[0], normalSum[1], normalSum[2]));
+		meshlet.ConeCutoff = 1.0f;
+		for (uint32 c = 0; c < 3; ++c) { meshlet.ConeAxis[c] = axisLength > 0.0f ? normalSum[c] / axisLength : 0.0f; }
+		if (axisLength == 0.0f) { return; }
+
+		float32 minDot = 1.0f;
+
+		for (uint32 i = meshlet.FirstIndex; i < meshlet.FirstIndex + meshlet.IndexCount; i += 3) {
+			float32 normal[3];
+			if (triangleNormal(i, normal)) { minDot = GTSL::Math::Limit(minDot, normal[0] * meshlet.ConeAxis[0] + normal[1] * meshlet.ConeAxis[1] + normal[2] * meshlet.ConeAxis[2]); }
+		}
+
+		//normals spread over more than a hemisphere (with some margin), cone can't cull anything
+		if (minDot > 0.1f) { meshlet.ConeCutoff = std::sqrt(1.0f - minDot * minDot); }
+	};
+
+	Meshlet meshlet{}; uint32 meshletVertices = 0;
+
+	for (uint32 i = 0; i < indexCount; i += 3)
+	{
+		uint32 newVertices = 0;
+		for (uint32 v = 0; v < 3; ++v) { if (vertexMeshlet[indices[i + v]] != meshlets.GetLength() + 1) { ++newVertices; } }
+
+		if (meshletVertices + newVertices > MAX_MESHLET_VERTICES || meshlet.IndexCount / 3 == MAX_MESHLET_TRIANGLES)
+		{
+			computeBounds(meshlet); meshlets.EmplaceBack(meshlet);
+			meshlet = Meshlet{}; meshlet.FirstIndex = i; meshletVertices = 0;
+		}
+
+		for (uint32 v = 0; v < 3; ++v) {
+			auto& vertex = vertexMeshlet[indices[i + v]];
+			if (vertex != meshlets.GetLength() + 1) { vertex = meshlets.GetLength() + 1; ++meshletVertices; }
+		}
+
+		meshlet.IndexCount += 3;
+	}
+
+	if (meshlet.IndexCount) { computeBounds(meshlet); meshlets.EmplaceBack(meshlet); }
+}
+
+uint32 PackSNorm1010102(const float32 x, const float32 y, const float32 z)
+{
+	auto pack = [](const float32 value) -> uint32
+	{
+		const float32 scaled = GTSL::Math::Clamp(value, -1.0f, 1.0f) * 511.0f;
+		return static_cast<uint32>(static_cast<int32>(scaled + (scaled >= 0.0f ? 0.5f : -0.5f))) & 0x3FF;
+	};
+
+	return pack(x) | pack(y) << 10 | pack(z) << 20;
+}
+
+uint16 FloatToHalf(const float32 value)
+{
+	uint32 bits; GTSL::MemCopy(4, &value, &bits);
+
+	const uint32 sign = (bits >> 16) & 0x8000;
+	const int32 exponent = static_cast<int32>((bits >> 23) & 0xFF) - 127 + 15;
+	uint32 mantissa = bits & 0x7FFFFF;
+
+	if (exponent <= 0) //denormal or zero
+	{
+		if (exponent < -10) { return static_cast<uint16>(sign); }
+		mantissa |= 0x800000;
+		const uint32 shift = static_cast<uint32>(14 - exponent);
+		uint32 half = mantissa >> shift;
+		if ((mantissa >> (shift - 1)) & 1) { ++half; }
+		return static_cast<uint16>(sign | half);
+	}
+
+	if (exponent >= 31) { return static_cast<uint16>(sign | 0x7C00); }
+
+	uint32 half = sign | static_cast<uint32>(exponent) << 10 | mantissa >> 13;
+	if (mantissa & 0x1000) { ++half; } //carry into the exponent rounds up correctly
+	return static_cast<uint16>(half);
+}
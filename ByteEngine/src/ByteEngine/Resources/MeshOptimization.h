@@ -0,0 +1,80 @@
+#pragma once
+
+#include <GTSL/Vector.hpp>
+
+#include "ByteEngine/Core.h"
+#include "ByteEngine/Application/AllocatorReferences.h"
+
+/**
+ * \brief Size of the post transform vertex cache meshes are optimized for. Conservative so results hold on most hardware.
+ */
+static constexpr uint32 VERTEX_CACHE_SIZE = 16;
+
+/**
+ * \brief Reorders triangles to improve post transform vertex cache hits using the Tipsify algorithm.
+ * \param indices Triangle list indices, reordered in place.
+ */
+void OptimizeVertexCache(uint32* indices, uint32 indexCount, uint32 vertexCount, uint32 cacheSize, const BE::TAR& allocator);
+
+/**
+ * \brief Reorders clusters of triangles so outward facing ones are drawn first, reducing overdraw. Clusters are split where the vertex cache is flushed so the
+ * cache efficiency achieved by OptimizeVertexCache is kept.
+ * \param positions Vertex positions as 3 floats, separated by positionStride bytes.
+ */
+void OptimizeOverdraw(uint32* indices, uint32 indexCount, const byte* positions, uint32 positionStride, uint32 vertexCount, uint32 cacheSize, const BE::TAR& allocator);
+
+/**
+ * \brief Builds a remap table that places vertices in the order they are first referenced by the index buffer and rewrites the indices with it.
+ * Vertices not referenced by any index are dropped.
+ * \param remap Array of vertexCount entries, remap[oldVertex] is the new vertex index or 0xFFFFFFFF if unused.
+ * \return Number of vertices left after remapping.
+ */
+uint32 OptimizeVertexFetch(uint32* remap, uint32* indices, uint32 indexCount, uint32 vertexCount);
+
+/**
+ * \brief Simulates a FIFO post transform vertex cache of the specified size.
+ * \return Average cache miss ratio, vertex shader invocations per triangle. 3 is the worst case and 0.5 the best achievable on regular grids.
+ */
+float32 CalculateACMR(const uint32* indices, uint32 indexCount, uint32 vertexCount, uint32 cacheSize, const BE::TAR& allocator);
+
+/**
+ * \brief Simplifies a mesh by collapsing edges in order of quadric error until the index count drops to targetIndexCount or no collapse under targetError remains.
+ * Vertices on borders, including attribute seams split by the importer, are never moved so the mesh doesn't tear. Vertices are not modified, destination references the same vertices as indices.
+ * \param destination Array of indexCount entries where the simplified indices are written.
+ * \param targetError Maximum distance, in mesh units, any collapse may move the surface.
+ * \param resultError Distance the surface moved by the most expensive collapse performed.
+ * \return Index count of the simplified mesh.
+ */
+uint32 SimplifyMesh(uint32* destination, const uint32* indices, uint32 indexCount, const byte* positions, uint32 positionStride, uint32 vertexCount, uint32 targetIndexCount, float32 targetError, float32* resultError, const BE::TAR& allocator);
+
+static constexpr uint32 MAX_MESHLET_VERTICES = 64, MAX_MESHLET_TRIANGLES = 124;
+
+/**
+ * \brief Cluster of consecutive triangles in a mesh's index buffer, with bounds for culling it independently of the rest of the mesh.
+ */
+struct Meshlet
+{
+	float32 Center[3]; float32 Radius;
+	/**
+	 * \brief Average direction the cluster's triangles face. Viewed from inside the cone around the opposite direction every triangle is backfacing.
+	 * ConeCutoff is 1 when the triangles' normals spread too much for the cone to ever cull.
+	 */
+	float32 ConeAxis[3]; float32 ConeCutoff;
+	uint32 FirstIndex, IndexCount;
+};
+
+/**
+ * \brief Splits a mesh into meshlets of at most MAX_MESHLET_VERTICES unique vertices and MAX_MESHLET_TRIANGLES triangles, walking triangles in index buffer order
+ * so every meshlet is a contiguous range of indices. Should run after the index buffer is in it's final order.
+ */
+void BuildMeshlets(const uint32* indices, uint32 indexCount, const byte* positions, uint32 positionStride, uint32 vertexCount, GTSL::Vector<Meshlet, BE::TAR>& meshlets, const BE::TAR& allocator);
+
+/**
+ * \brief Packs a unit vector to 10 bit signed normalized components. The 2 highest bits are left as zero.
+ */
+uint32 PackSNorm1010102(float32 x, float32 y, float32 z);
+
+/**
+ * \brief Converts a float to half precision, rounding to nearest. Values out of range become infinity.
+ */
+uint16 FloatToHalf(float32 value);
@@ -1,14 +1,141 @@
 #include "PipelineCacheResourceManager.h"
 
+#include <cstring>
+
+#include <GTSL/Vector.hpp>
+
 #include "ByteEngine/Application/Application.h"
 
-PipelineCacheResourceManager::PipelineCacheResourceManager() : ResourceManager("PipelineCacheResourceManager")
+PipelineCacheResourceManager::PipelineCacheResourceManager() : ResourceManager("PipelineCacheResourceManager"), entries(64, GetPersistentAllocator())
 {
-	GTSL::StaticString<256> resources_path;
-	resources_path += BE::Application::Get()->GetPathToApplication(); resources_path += "/resources/PipelineCache.bepkg";
-	cache.OpenFile(resources_path, (uint8)GTSL::File::AccessMode::READ | (uint8)GTSL::File::AccessMode::WRITE, GTSL::File::OpenMode::LEAVE_CONTENTS);
+	path += BE::Application::Get()->GetPathToApplication(); path += "/resources/PipelineCache.bepkg";
+	cache.OpenFile(path, (uint8)GTSL::File::AccessMode::READ | (uint8)GTSL::File::AccessMode::WRITE, GTSL::File::OpenMode::LEAVE_CONTENTS);
 }
 
 PipelineCacheResourceManager::~PipelineCacheResourceManager()
 {
-}
\ No newline at end of file
+}
+
+bool PipelineCacheResourceManager::DeviceIdentity::FromCacheData(const GTSL::Range<const byte*> data, DeviceIdentity& identity)
+{
+	//VkPipelineCacheHeaderVersionOne: header size, header version, vendor id, device id, pipeline cache uuid
+	if (data.Bytes() < sizeof(uint32) * 4 + 16) { return false; }
+
+	uint32 header[4]; std::memcpy(header, data.begin(), sizeof(header));
+	if (header[1] != 1) { return false; }
+
+	identity.VendorID = header[2]; identity.DeviceID = header[3];
+	std::memcpy(identity.PipelineCacheUUID, data.begin() + sizeof(header), 16);
+	return true;
+}
+
+bool PipelineCacheResourceManager::DeviceIdentity::operator==(const DeviceIdentity& other) const
+{
+	return VendorID == other.VendorID && DeviceID == other.DeviceID && !std::memcmp(PipelineCacheUUID, other.PipelineCacheUUID, 16);
+}
+
+bool PipelineCacheResourceManager::Open(const DeviceIdentity& device)
+{
+	GTSL::Lock lock(mutex);
+
+	const auto fileSize = cache.GetFileSize();
+
+	Header header{};
+	if (fileSize >= sizeof(Header)) {
+		cache.SetPointer(0, GTSL::File::MoveFrom::BEGIN);
+		cache.ReadFromFile(GTSL::Range<byte*>(sizeof(Header), reinterpret_cast<byte*>(&header)));
+	}
+
+	if (header.Magic != MAGIC || header.Version != VERSION) { clear(device); return false; }
+
+	if (!(header.Device == device))
+	{
+		BE_LOG_WARNING("Pipeline cache was created by a different device or driver, discarding it");
+		clear(device); return false;
+	}
+
+	uint64 offset = sizeof(Header), liveBytes = 0;
+
+	while (offset + sizeof(RecordHeader) <= fileSize)
+	{
+		RecordHeader record;
+		cache.SetPointer(offset, GTSL::File::MoveFrom::BEGIN);
+		cache.ReadFromFile(GTSL::Range<byte*>(sizeof(RecordHeader), reinterpret_cast<byte*>(&record)));
+
+		const uint64 dataOffset = offset + sizeof(RecordHeader);
+		if (dataOffset + record.Size > fileSize) { break; } //last write didn't finish
+
+		const auto key = Id(GTSL::Id64(record.Key));
+		if (entries.Find(key)) { liveBytes -= entries.At(key).Size; entries.At(key) = Entry{ static_cast<uint32>(dataOffset), record.Size }; }
+		else { entries.Emplace(key, Entry{ static_cast<uint32>(dataOffset), record.Size }); }
+		liveBytes += record.Size;
+
+		offset = dataOffset + record.Size;
+	}
+
+	endOffset = offset;
+
+	if (offset - sizeof(Header) > liveBytes * 2 + 1024 * 1024) { compact(device); } //mostly replaced entries
+
+	return endOffset > sizeof(Header);
+}
+
+uint32 PipelineCacheResourceManager::GetEntrySize(const uint64 key) const
+{
+	GTSL::Lock lock(mutex);
+	return entries.Find(Id(GTSL::Id64(key))) ? entries.At(Id(GTSL::Id64(key))).Size : 0;
+}
+
+void PipelineCacheResourceManager::WriteEntry(const uint64 key, const GTSL::Range<const byte*> data)
+{
+	GTSL::Lock lock(mutex);
+	writeEntry(key, data);
+}
+
+void PipelineCacheResourceManager::writeEntry(const uint64 key, const GTSL::Range<const byte*> data)
+{
+	const RecordHeader record{ key, static_cast<uint32>(data.Bytes()), 0 };
+	cache.SetPointer(endOffset, GTSL::File::MoveFrom::BEGIN);
+	cache.WriteToFile(GTSL::Range<const byte*>(sizeof(RecordHeader), reinterpret_cast<const byte*>(&record)));
+	cache.WriteToFile(data);
+
+	const Entry entry{ static_cast<uint32>(endOffset + sizeof(RecordHeader)), record.Size };
+	if (entries.Find(Id(GTSL::Id64(key)))) { entries.At(Id(GTSL::Id64(key))) = entry; } else { entries.Emplace(Id(GTSL::Id64(key)), entry); }
+
+	endOffset = entry.ByteOffset + entry.Size;
+}
+
+void PipelineCacheResourceManager::clear(const DeviceIdentity& device)
+{
+	const Header header{ MAGIC, VERSION, device };
+
+	cache.SetPointer(0, GTSL::File::MoveFrom::BEGIN);
+	cache.SetEndOfFile();
+	cache.WriteToFile(GTSL::Range<const byte*>(sizeof(Header), reinterpret_cast<const byte*>(&header)));
+
+	endOffset = sizeof(Header);
+}
+
+void PipelineCacheResourceManager::compact(const DeviceIdentity& device)
+{
+	GTSL::Buffer<BE::TAR> buffer; buffer.Allocate(static_cast<uint32>(endOffset), 16, GetTransientAllocator());
+	GTSL::Vector<RecordHeader, BE::TAR> records(32, GetTransientAllocator());
+
+	GTSL::ForEach(entries, [&](const Entry& entry)
+	{
+		const auto start = buffer.GetLength();
+		cache.SetPointer(entry.ByteOffset - sizeof(RecordHeader), GTSL::File::MoveFrom::BEGIN);
+		cache.ReadFile(sizeof(RecordHeader) + entry.Size, buffer.GetBufferInterface());
+
+		RecordHeader record; std::memcpy(&record, buffer.GetData() + start, sizeof(RecordHeader));
+		records.EmplaceBack(record);
+	});
+
+	clear(device);
+
+	uint32 offset = 0;
+	for (const auto& record : records) {
+		writeEntry(record.Key, GTSL::Range<const byte*>(record.Size, buffer.GetData() + offset + sizeof(RecordHeader)));
+		offset += sizeof(RecordHeader) + record.Size;
+	}
+}
@@ -2,28 +2,133 @@
 
 #include "ResourceManager.h"
 #include <GTSL/File.h>
+#include <GTSL/FlatHashMap.h>
+#include <GTSL/Mutex.h>
 
 #include <GTSL/Buffer.hpp>
 
+/**
+ * \brief Stores pipeline cache data for the device it was created on, keyed by pipeline. Entries are appended as pipelines are created so any thread can add
+ * to the store without merging into a shared blob, a key written again replaces it's previous entry. Data created by another device or driver is
+ * discarded when the store is opened.
+ */
 class PipelineCacheResourceManager : public ResourceManager
 {
 public:
 	PipelineCacheResourceManager();
 	~PipelineCacheResourceManager();
 
-	void DoesCacheExist(bool& doesExist) const { doesExist = cache.GetFileSize(); }
-	void GetCacheSize(uint32& size) const { size = static_cast<uint32>(cache.GetFileSize()); }
-	
-	template<class ALLOCTOR>
-	void GetCache(GTSL::Buffer<ALLOCTOR>& buffer) { cache.ReadFile(cache.GetFileSize(), buffer.GetBufferInterface()); }
-	
-	template<class ALLOCTOR>
-	void WriteCache(GTSL::Buffer<ALLOCTOR>& buffer)
+	/**
+	 * \brief Identifies the device and driver pipeline cache data was created by, the driver rejects data created by any other.
+	 */
+	struct DeviceIdentity
 	{
-		cache.SetPointer(0, GTSL::File::MoveFrom::BEGIN);
-		cache.SetEndOfFile();
-		cache.WriteToFile(buffer.GetBufferInterface());
+		uint32 VendorID = 0, DeviceID = 0;
+		/**
+		 * \brief Changes with the driver version.
+		 */
+		byte PipelineCacheUUID[16]{};
+
+		/**
+		 * \brief Reads the identity from the header every Vulkan pipeline cache blob starts with.
+		 * \return False if data is too short or has an unknown header version.
+		 */
+		static bool FromCacheData(GTSL::Range<const byte*> data, DeviceIdentity& identity);
+
+		bool operator==(const DeviceIdentity& other) const;
+	};
+
+	/**
+	 * \brief Builds the key a pipeline's cache data is stored under. Everything that changes the compiled pipeline has to be added to it.
+	 */
+	class PipelineKey
+	{
+	public:
+		/**
+		 * \brief Adds a value with no padding, like an integer or an enum.
+		 */
+		template<typename T>
+		void Add(const T& value) { Add(GTSL::Range<const byte*>(sizeof(T), reinterpret_cast<const byte*>(&value))); }
+
+		void Add(GTSL::Range<const byte*> data) { for (auto e : data) { hash ^= e; hash *= 0x100000001B3ull; } } //FNV-1a
+
+		uint64 operator()() const { return hash; }
+
+	private:
+		uint64 hash = 0xCBF29CE484222325ull;
+	};
+
+	/**
+	 * \brief Key of the cache merged from every thread's cache at shutdown, which holds the pipelines that have no key of their own.
+	 */
+	static constexpr uint64 MERGED_CACHE_KEY = 0;
+
+	/**
+	 * \brief Loads the entries in the store if they were created by device, otherwise clears the store. Must be called once, before any other function.
+	 * \return Whether there are usable entries.
+	 */
+	bool Open(const DeviceIdentity& device);
+
+	/**
+	 * \return Size of the entry for key, 0 if there is none.
+	 */
+	[[nodiscard]] uint32 GetEntrySize(uint64 key) const;
+
+	/**
+	 * \brief Reads the entry for key into buffer. Can be called from any thread.
+	 */
+	template<class ALLOCATOR>
+	void ReadEntry(const uint64 key, GTSL::Buffer<ALLOCATOR>& buffer)
+	{
+		GTSL::Lock lock(mutex);
+		const auto& entry = entries.At(Id(GTSL::Id64(key)));
+		cache.SetPointer(entry.ByteOffset, GTSL::File::MoveFrom::BEGIN);
+		cache.ReadFile(entry.Size, buffer.GetBufferInterface());
 	}
+
+	/**
+	 * \brief Appends an entry for key. Can be called from any thread.
+	 */
+	void WriteEntry(uint64 key, GTSL::Range<const byte*> data);
+
 private:
+	static constexpr uint32 MAGIC = 'B' | 'E' << 8 | 'P' << 16 | 'C' << 24;
+	static constexpr uint32 VERSION = 1;
+
+	struct Header
+	{
+		uint32 Magic, Version;
+		DeviceIdentity Device;
+	};
+
+	struct RecordHeader
+	{
+		uint64 Key; uint32 Size, Pad;
+	};
+
+	struct Entry
+	{
+		uint32 ByteOffset, Size;
+	};
+
 	GTSL::File cache;
+	GTSL::StaticString<256> path;
+	GTSL::FlatHashMap<Id, Entry, BE::PAR> entries;
+	/**
+	 * \brief End of the last complete record, where the next one is written.
+	 */
+	uint64 endOffset = 0;
+	mutable GTSL::Mutex mutex;
+
+	void writeEntry(uint64 key, GTSL::Range<const byte*> data);
+
+	/**
+	 * \brief Truncates the store to a header for device. Entries already loaded keep their keys and are replaced as they are written again.
+	 */
+	void clear(const DeviceIdentity& device);
+
+	/**
+	 * \brief Rewrites the store with only the latest entry for each key.
+	 */
+	void compact(const DeviceIdentity& device);
 };
@@ -0,0 +1,138 @@
+#include "ResourceIndex.h"
+
+#include <algorithm>
+
+#ifdef BE_PLATFORM_WIN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const GTSL::Range<const utf8*> path)
+{
+	Close();
+
+	GTSL::StaticString<512> terminatedPath(path); //range may not be null terminated
+
+#ifdef BE_PLATFORM_WIN
+	const HANDLE file = CreateFileA(terminatedPath.begin(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) { return false; }
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || !fileSize.QuadPart) { CloseHandle(file); return false; }
+
+	const HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping) { CloseHandle(file); return false; }
+
+	const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!view) { CloseHandle(mapping); CloseHandle(file); return false; }
+
+	fileHandle = file; mappingHandle = mapping;
+	data = static_cast<const byte*>(view); size = static_cast<uint64>(fileSize.QuadPart);
+#else
+	const int file = open(terminatedPath.begin(), O_RDONLY);
+	if (file < 0) { return false; }
+
+	struct stat fileStat;
+	if (fstat(file, &fileStat) || !fileStat.st_size) { close(file); return false; }
+
+	void* view = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file); //mapping keeps it's own reference to the file
+	if (view == MAP_FAILED) { return false; }
+
+	data = static_cast<const byte*>(view); size = static_cast<uint64>(fileStat.st_size);
+#endif
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (!data) { return; }
+
+#ifdef BE_PLATFORM_WIN
+	UnmapViewOfFile(data);
+	CloseHandle(static_cast<HANDLE>(mappingHandle)); CloseHandle(static_cast<HANDLE>(fileHandle));
+	mappingHandle = nullptr; fileHandle = nullptr;
+#else
+	munmap(const_cast<byte*>(data), size);
+#endif
+
+	data = nullptr; size = 0;
+}
+
+void ResourceIndexLayout::Build(const GTSL::Range<const uint64*> keys, const byte* records, const uint32 recordSize, GTSL::Buffer<BE::TAR>& buffer, const BE::TAR& allocator)
+{
+	const uint32 entryCount = static_cast<uint32>(keys.ElementCount());
+
+	Header header;
+	header.Magic = MAGIC; header.Version = VERSION; header.RecordSize = recordSize; header.EntryCount = entryCount;
+	header.BucketCount = GetBucketCount(entryCount); header.SlotCount = GetSlotCount(entryCount);
+	header.SlotsOffset = GetSlotsOffset(entryCount); header.RecordsOffset = GetRecordsOffset(entryCount);
+
+	GTSL::Vector<uint32, BE::TAR> seeds(header.BucketCount, allocator); seeds.Resize(header.BucketCount);
+	GTSL::Vector<Slot, BE::TAR> slots(header.SlotCount, allocator); slots.Resize(header.SlotCount);
+	for (auto& slot : slots) { slot.Key = 0; slot.Record = EMPTY_SLOT; slot.Pad = 0; }
+
+	//hash and displace: buckets are placed largest first, each trying seeds until all of it's keys land on free, distinct slots
+	GTSL::Vector<uint32, BE::TAR> bucketOfKey(entryCount, allocator), order(entryCount, allocator), bucketSizes(header.BucketCount, allocator);
+	bucketSizes.Resize(header.BucketCount); for (auto& e : bucketSizes) { e = 0; }
+
+	for (uint32 k = 0; k < entryCount; ++k)
+	{
+		bucketOfKey.EmplaceBack(static_cast<uint32>(Hash(keys[k], 0) % header.BucketCount));
+		++bucketSizes[bucketOfKey[k]]; order.EmplaceBack(k);
+	}
+
+	std::sort(order.begin(), order.end(), [&](const uint32 a, const uint32 b)
+	{
+		return bucketSizes[bucketOfKey[a]] != bucketSizes[bucketOfKey[b]] ? bucketSizes[bucketOfKey[a]] > bucketSizes[bucketOfKey[b]] : bucketOfKey[a] < bucketOfKey[b];
+	});
+
+	GTSL::Vector<uint32, BE::TAR> bucketSlots(8, allocator);
+
+	for (uint32 first = 0; first < entryCount;)
+	{
+		const uint32 bucket = bucketOfKey[order[first]];
+		uint32 end = first; while (end < entryCount && bucketOfKey[order[end]] == bucket) { ++end; }
+
+		for (uint32 seed = 1;; ++seed)
+		{
+			bucketSlots.ResizeDown(0);
+			bool fits = true;
+
+			for (uint32 i = first; i < end && fits; ++i)
+			{
+				const uint32 slot = static_cast<uint32>(Hash(keys[order[i]], seed) % header.SlotCount);
+				fits = slots[slot].Record == EMPTY_SLOT;
+				for (const auto taken : bucketSlots) { fits &= taken != slot; }
+				bucketSlots.EmplaceBack(slot);
+			}
+
+			if (!fits) { continue; }
+
+			seeds[bucket] = seed;
+			for (uint32 i = first; i < end; ++i) { slots[bucketSlots[i - first]].Key = keys[order[i]]; slots[bucketSlots[i - first]].Record = order[i]; }
+			break;
+		}
+
+		first = end;
+	}
+
+	const byte padding[16] = {};
+	auto pad = [&](const uint32 offset) { buffer.CopyBytes(offset - static_cast<uint32>(buffer.GetLength()), padding); };
+
+	buffer.Resize(0);
+	buffer.CopyBytes(sizeof(Header), reinterpret_cast<const byte*>(&header)); pad(Align(sizeof(Header)));
+	buffer.CopyBytes(header.BucketCount * sizeof(uint32), reinterpret_cast<const byte*>(seeds.begin())); pad(header.SlotsOffset);
+	buffer.CopyBytes(header.SlotCount * sizeof(Slot), reinterpret_cast<const byte*>(slots.begin())); pad(header.RecordsOffset);
+	buffer.CopyBytes(entryCount * recordSize, records);
+}
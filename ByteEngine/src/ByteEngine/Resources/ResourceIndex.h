@@ -0,0 +1,302 @@
+#pragma once
+
+#include <GTSL/Buffer.hpp>
+#include <GTSL/File.h>
+#include <GTSL/Mutex.h>
+#include <GTSL/Range.h>
+#include <GTSL/StaticString.hpp>
+#include <GTSL/Vector.hpp>
+
+#include "ByteEngine/Core.h"
+#include "ByteEngine/Id.h"
+#include "ByteEngine/Application/AllocatorReferences.h"
+#include "ByteEngine/Debug/Assert.h"
+
+/**
+ * \brief Read only view of a file mapped into memory. The file stays mapped until the object is destroyed or another file is opened.
+ */
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	/**
+	 * \return Whether the file exists and could be mapped. Empty files can't be mapped.
+	 */
+	bool Open(const GTSL::Range<const utf8*> path);
+	void Close();
+
+	[[nodiscard]] const byte* GetData() const { return data; }
+	[[nodiscard]] uint64 GetSize() const { return size; }
+
+private:
+	const byte* data = nullptr; uint64 size = 0;
+	void* fileHandle = nullptr; void* mappingHandle = nullptr;
+};
+
+/**
+ * \brief Layout shared by every resource index file. Records are stored with their in memory layout, so the index is only valid for the build that wrote it.
+ *
+ * File contents: Header, Seeds[BucketCount], Slots[SlotCount], records, each section starting at a multiple of 16 bytes.
+ */
+namespace ResourceIndexLayout
+{
+	static constexpr uint32 MAGIC = 'B' | 'E' << 8 | 'I' << 16 | 'X' << 24;
+	static constexpr uint32 VERSION = 1;
+	static constexpr uint32 EMPTY_SLOT = 0xFFFFFFFF;
+
+	struct Header
+	{
+		uint32 Magic, Version, RecordSize, EntryCount, BucketCount, SlotCount, SlotsOffset, RecordsOffset;
+	};
+
+	struct Slot
+	{
+		uint64 Key; uint32 Record, Pad;
+	};
+
+	inline uint32 Align(const uint32 offset) { return (offset + 15) & ~15u; }
+
+	/**
+	 * \brief Mixes a name hash with a seed, seed 0 selects the bucket and a bucket's seed selects the slot for each of it's keys.
+	 */
+	inline uint64 Hash(uint64 key, const uint32 seed)
+	{
+		key += 0x9E3779B97F4A7C15ull * (seed + 1);
+		key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ull;
+		key = (key ^ (key >> 27)) * 0x94D049BB133111EBull;
+		return key ^ (key >> 31);
+	}
+
+	inline uint32 GetBucketCount(const uint32 entryCount) { return entryCount > 4 ? (entryCount + 3) / 4 : 1; } //~4 keys per bucket keeps seed search short while seeds stay small
+	inline uint32 GetSlotCount(const uint32 entryCount) { return entryCount + entryCount / 4 + 1; }
+	inline uint32 GetSlotsOffset(const uint32 entryCount) { return Align(Align(sizeof(Header)) + GetBucketCount(entryCount) * sizeof(uint32)); }
+	inline uint32 GetRecordsOffset(const uint32 entryCount) { return Align(GetSlotsOffset(entryCount) + GetSlotCount(entryCount) * sizeof(Slot)); }
+
+	/**
+	 * \brief Returns the size of an index file holding entryCount records.
+	 */
+	inline uint32 GetFileSize(const uint32 entryCount, const uint32 recordSize) { return GetRecordsOffset(entryCount) + entryCount * recordSize; }
+
+	/**
+	 * \brief Builds the index file for a set of unique keys, records are copied byte for byte.
+	 * \param buffer Buffer with room for GetFileSize() bytes.
+	 * \param records recordSize bytes per key, in the same order as keys.
+	 */
+	void Build(GTSL::Range<const uint64*> keys, const byte* records, uint32 recordSize, GTSL::Buffer<BE::TAR>& buffer, const BE::TAR& allocator);
+
+	/**
+	 * \brief Returns the record stored for key, or nullptr. A hash, one probe and one key compare.
+	 */
+	inline const byte* Find(const byte* file, const uint64 key)
+	{
+		const auto* header = reinterpret_cast<const Header*>(file);
+		if (!header->EntryCount) { return nullptr; }
+
+		const auto* seeds = reinterpret_cast<const uint32*>(file + Align(sizeof(Header)));
+		const auto& slot = reinterpret_cast<const Slot*>(file + header->SlotsOffset)[Hash(key, seeds[Hash(key, 0) % header->BucketCount]) % header->SlotCount];
+
+		if (slot.Record == EMPTY_SLOT || slot.Key != key) { return nullptr; }
+		return file + header->RecordsOffset + slot.Record * header->RecordSize;
+	}
+}
+
+/**
+ * \brief Index of a package's resources, stored as a perfect hash table that is memory mapped and queried in place.
+ * Opening it costs the same regardless of how many resources it holds and lookups never allocate or deserialize.
+ * T is stored with it's in memory layout so it must not own memory, any change to it's size makes Open fail and the package be rebuilt.
+ */
+template<typename T>
+class ResourceIndex
+{
+public:
+	/**
+	 * \return Whether a valid index for T was found and mapped. If false the index has to be rebuilt with ResourceIndexBuilder.
+	 */
+	bool Open(const GTSL::Range<const utf8*> path)
+	{
+		if (!file.Open(path)) { return false; }
+
+		const auto* header = reinterpret_cast<const ResourceIndexLayout::Header*>(file.GetData());
+
+		if (file.GetSize() < sizeof(ResourceIndexLayout::Header) || header->Magic != ResourceIndexLayout::MAGIC || header->Version != ResourceIndexLayout::VERSION || header->RecordSize != sizeof(T)
+			|| file.GetSize() < header->RecordsOffset + static_cast<uint64>(header->EntryCount) * sizeof(T))
+		{
+			file.Close(); return false;
+		}
+
+		return true;
+	}
+
+	void Close() { file.Close(); }
+
+	[[nodiscard]] bool Find(const Id name) const { return ResourceIndexLayout::Find(file.GetData(), name()); }
+
+	[[nodiscard]] const T* TryGet(const Id name) const { return reinterpret_cast<const T*>(ResourceIndexLayout::Find(file.GetData(), name())); }
+
+	[[nodiscard]] const T& At(const Id name) const
+	{
+		const auto* record = TryGet(name);
+		BE_ASSERT(record, "No resource by that name in index!");
+		return *record;
+	}
+
+	[[nodiscard]] uint32 GetLength() const { return reinterpret_cast<const ResourceIndexLayout::Header*>(file.GetData())->EntryCount; }
+
+	/**
+	 * \brief Calls function(uint64 key, const T& record) for every record in the index, in slot order.
+	 */
+	template<typename F>
+	void ForEach(F&& function) const
+	{
+		const auto* header = reinterpret_cast<const ResourceIndexLayout::Header*>(file.GetData());
+		const auto* slots = reinterpret_cast<const ResourceIndexLayout::Slot*>(file.GetData() + header->SlotsOffset);
+
+		for (uint32 i = 0; i < header->SlotCount; ++i) {
+			if (slots[i].Record != ResourceIndexLayout::EMPTY_SLOT) { function(slots[i].Key, *reinterpret_cast<const T*>(file.GetData() + header->RecordsOffset + slots[i].Record * sizeof(T))); }
+		}
+	}
+
+private:
+	MappedFile file;
+};
+
+/**
+ * \brief ResourceIndex that also holds records of resources re-imported while the application runs, which take precedence over the mapped ones.
+ * Re-imported records are written to the index file by Flush so the next run starts from them.
+ */
+template<typename T>
+class ReloadableResourceIndex
+{
+public:
+	ReloadableResourceIndex(const BE::PAR& allocator) : reloadedKeys(4, allocator), reloadedRecords(4, allocator) {}
+
+	bool Open(const GTSL::Range<const utf8*> path) { this->path = GTSL::StaticString<512>(path); return index.Open(path); }
+
+	/**
+	 * \brief Returns a copy of the record for name, as a reload may replace it at any time.
+	 */
+	[[nodiscard]] T At(const Id name) const
+	{
+		GTSL::ReadLock lock(mutex);
+		for (uint32 i = 0; i < reloadedKeys.GetLength(); ++i) { if (reloadedKeys[i] == name()) { return reloadedRecords[i]; } }
+		return index.At(name);
+	}
+
+	[[nodiscard]] bool Find(const Id name) const
+	{
+		GTSL::ReadLock lock(mutex);
+		for (const auto key : reloadedKeys) { if (key == name()) { return true; } }
+		return index.Find(name);
+	}
+
+	/**
+	 * \brief Calls function(uint64 key, const T& record) for every record, re-imported ones included.
+	 */
+	template<typename F>
+	void ForEach(F&& function) const
+	{
+		GTSL::ReadLock lock(mutex);
+		for (uint32 i = 0; i < reloadedKeys.GetLength(); ++i) { function(reloadedKeys[i], reloadedRecords[i]); }
+
+		index.ForEach([&](const uint64 key, const T& record)
+		{
+			for (const auto reloadedKey : reloadedKeys) { if (reloadedKey == key) { return; } }
+			function(key, record);
+		});
+	}
+
+	/**
+	 * \brief Sets the record of a re-imported resource, which may not have been in the index before.
+	 */
+	void Update(const Id name, const T& record)
+	{
+		GTSL::WriteLock lock(mutex);
+		for (uint32 i = 0; i < reloadedKeys.GetLength(); ++i) { if (reloadedKeys[i] == name()) { reloadedRecords[i] = record; return; } }
+		reloadedKeys.EmplaceBack(name()); reloadedRecords.EmplaceBack(record);
+	}
+
+	/**
+	 * \brief Rewrites the index file with the re-imported records merged in, if there are any, and maps the new file.
+	 */
+	void Flush(const BE::TAR& allocator)
+	{
+		GTSL::WriteLock lock(mutex);
+		if (!reloadedKeys.GetLength()) { return; }
+
+		const uint32 capacity = index.GetLength() + reloadedKeys.GetLength();
+		GTSL::Vector<uint64, BE::TAR> keys(capacity, allocator); GTSL::Vector<T, BE::TAR> records(capacity, allocator);
+
+		for (uint32 i = 0; i < reloadedKeys.GetLength(); ++i) { keys.EmplaceBack(reloadedKeys[i]); records.EmplaceBack(reloadedRecords[i]); }
+
+		index.ForEach([&](const uint64 key, const T& record)
+		{
+			for (const auto reloadedKey : reloadedKeys) { if (reloadedKey == key) { return; } }
+			keys.EmplaceBack(key); records.EmplaceBack(record);
+		});
+
+		GTSL::Buffer<BE::TAR> indexFileBuffer; indexFileBuffer.Allocate(ResourceIndexLayout::GetFileSize(keys.GetLength(), sizeof(T)), 16, allocator);
+		ResourceIndexLayout::Build(keys.GetRange(), reinterpret_cast<const byte*>(records.begin()), sizeof(T), indexFileBuffer, allocator);
+
+		index.Close(); //mapped files can't be overwritten on every platform
+
+		{
+			GTSL::File indexFile; indexFile.OpenFile(path, GTSL::File::AccessMode::WRITE);
+			indexFile.WriteToFile(indexFileBuffer);
+		}
+
+		index.Open(path);
+		reloadedKeys.ResizeDown(0); reloadedRecords.ResizeDown(0);
+	}
+
+private:
+	ResourceIndex<T> index;
+	GTSL::StaticString<512> path;
+	GTSL::Vector<uint64, BE::PAR> reloadedKeys;
+	GTSL::Vector<T, BE::PAR> reloadedRecords;
+	mutable GTSL::ReadWriteMutex mutex;
+};
+
+/**
+ * \brief Collects a package's records while it's being built and writes them as a ResourceIndex file.
+ */
+template<typename T>
+class ResourceIndexBuilder
+{
+public:
+	ResourceIndexBuilder(const uint32 capacity, const BE::TAR& allocator) : keys(capacity, allocator), records(capacity, allocator), allocator(allocator) {}
+
+	[[nodiscard]] bool Find(const Id name) const
+	{
+		for (const auto key : keys) { if (key == name()) { return true; } }
+		return false;
+	}
+
+	void Emplace(const Id name, const T& record)
+	{
+		BE_ASSERT(!Find(name), "Resource already in index!");
+		keys.EmplaceBack(name()); records.EmplaceBack(record);
+	}
+
+	/**
+	 * \brief Returns the size of the index file Write will produce.
+	 */
+	[[nodiscard]] uint32 GetFileSize() const { return ResourceIndexLayout::GetFileSize(keys.GetLength(), sizeof(T)); }
+
+	/**
+	 * \param buffer Buffer with room for GetFileSize() bytes, it's previous contents are discarded.
+	 */
+	void Write(GTSL::Buffer<BE::TAR>& buffer) const
+	{
+		ResourceIndexLayout::Build(keys.GetRange(), reinterpret_cast<const byte*>(records.begin()), sizeof(T), buffer, allocator);
+	}
+
+private:
+	GTSL::Vector<uint64, BE::TAR> keys;
+	GTSL::Vector<T, BE::TAR> records;
+	BE::TAR allocator;
+};
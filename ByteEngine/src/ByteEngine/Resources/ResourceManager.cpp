@@ -1,6 +1,18 @@
 #include "ResourceManager.h"
 
+#include <algorithm>
+#include <cstring>
+
+#include <GTSL/Memory.h>
+
+#include "ResourceManifest.h"
 #include "ByteEngine/Application/Application.h"
+#include "ByteEngine/Game/GameInstance.h"
+
+ResourceManager::~ResourceManager()
+{
+	for (uint32 i = 0; i < prefetchSpans.GetLength(); ++i) { if (prefetchSpans[i]) { freePrefetchSpan(i); } }
+}
 
 GTSL::StaticString<512> ResourceManager::GetResourcePath(const GTSL::Range<const utf8*> fileName)
 {
@@ -12,7 +24,206 @@ GTSL::StaticString<512> ResourceManager::GetResourcePath(const GTSL::Range<const
 
 void ResourceManager::initializePackageFiles(GTSL::Range<const utf8*> path)
 {
+	packagePath = GTSL::StaticString<512>(path);
+	
 	for(uint32 i = 0; i < BE::Application::Get()->GetNumberOfThreads(); ++i) {
 		packageFiles[packageFiles.EmplaceBack()].OpenFile(path, GTSL::File::AccessMode::READ);
 	}
 }
+
+void ResourceManager::Prefetch(GameInstance* gameInstance, const GTSL::Range<const Id*> names)
+{
+	struct PackageRange { uint32 ByteOffset, Size; };
+
+	GTSL::Vector<PackageRange, BE::TAR> ranges(static_cast<uint32>(names.ElementCount()), GetTransientAllocator());
+	for (auto e : names) {
+		uint32 byteOffset, size;
+		if (getPackageRange(e, byteOffset, size) && size) { ranges.EmplaceBack(PackageRange{ byteOffset, size }); }
+	}
+
+	std::sort(ranges.begin(), ranges.end(), [](const PackageRange& a, const PackageRange& b) { return a.ByteOffset < b.ByteOffset; });
+
+	auto readSpan = [](TaskInfo taskInfo, ResourceManager* resourceManager, uint32 spanIndex)
+	{
+		PrefetchSpan* span;
+		{
+			GTSL::Lock lock(resourceManager->prefetchMutex);
+			span = resourceManager->prefetchSpans[spanIndex];
+		}
+
+		//span is only freed once loaded, so it can be written to without holding the lock
+		resourceManager->getFile().SetPointer(span->ByteOffset, GTSL::File::MoveFrom::BEGIN);
+		resourceManager->getFile().ReadFromFile(GTSL::Range<byte*>(span->Size, span->Data.GetData()));
+
+		GTSL::Lock lock(resourceManager->prefetchMutex);
+		span->Loaded = true;
+		if (!span->PendingResources) { resourceManager->freePrefetchSpan(spanIndex); } //everything in it was loaded from the package before the read finished
+	};
+
+	GTSL::Lock lock(prefetchMutex);
+
+	uint64 prefetchedBytes = 0;
+
+	for (uint32 i = 0; i < ranges.GetLength();)
+	{
+		const uint32 first = i, spanStart = ranges[i].ByteOffset;
+		uint32 spanEnd = spanStart + ranges[i].Size;
+
+		for (++i; i < ranges.GetLength(); ++i)
+		{
+			const uint32 rangeEnd = ranges[i].ByteOffset + ranges[i].Size, end = rangeEnd > spanEnd ? rangeEnd : spanEnd;
+			if (ranges[i].ByteOffset > spanEnd + MAX_PREFETCH_GAP || end - spanStart > MAX_PREFETCH_READ_SIZE) { break; }
+			spanEnd = end;
+		}
+
+		if (prefetchedBytes + (spanEnd - spanStart) > MAX_PREFETCH_BYTES) { break; } //resources left are loaded from the package as usual
+		prefetchedBytes += spanEnd - spanStart;
+
+		auto* span = GTSL::New<PrefetchSpan>(GetPersistentAllocator());
+		span->ByteOffset = spanStart; span->Size = spanEnd - spanStart;
+		span->Data.Allocate(span->Size, 16, GetPersistentAllocator());
+
+		const uint32 spanIndex = prefetchSpans.GetLength();
+		prefetchSpans.EmplaceBack(span);
+
+		for (uint32 r = first; r < i; ++r)
+		{
+			if (r != first && ranges[r].ByteOffset == ranges[r - 1].ByteOffset) { continue; } //same resource requested twice
+			prefetchedResources.EmplaceBack(PrefetchedResource{ ranges[r].ByteOffset, ranges[r].Size, spanIndex });
+			++span->PendingResources;
+		}
+
+		gameInstance->AddDynamicTask("prefetchPackage", Task<ResourceManager*, uint32>::Create(readSpan), {}, this, GTSL::MoveRef(spanIndex));
+	}
+}
+
+void ResourceManager::readPackage(const uint32 byteOffset, const GTSL::Range<byte*> buffer)
+{
+	if (manifest) { manifest->OnPackageRead(BE::Application::Get()->GetClock()->GetCurrentMicroseconds()); }
+
+	{
+		GTSL::Lock lock(prefetchMutex);
+
+		for (auto& e : prefetchedResources)
+		{
+			if (byteOffset < e.ByteOffset || byteOffset >= e.ByteOffset + e.Size) { continue; }
+
+			auto* span = prefetchSpans[e.Span];
+			const bool resident = span && span->Loaded && byteOffset + buffer.Bytes() <= span->ByteOffset + span->Size;
+			if (resident) { GTSL::MemCopy(buffer.Bytes(), span->Data.GetData() + (byteOffset - span->ByteOffset), buffer.begin()); }
+
+			if (e.BytesRead < e.Size) {
+				e.BytesRead += buffer.Bytes();
+				if (e.BytesRead >= e.Size && !--span->PendingResources && span->Loaded) { freePrefetchSpan(e.Span); }
+			}
+
+			if (resident) { return; }
+			break; //prefetch read hasn't finished, don't wait for it
+		}
+	}
+
+	getFile().SetPointer(byteOffset, GTSL::File::MoveFrom::BEGIN);
+	getFile().ReadFromFile(buffer);
+}
+
+void ResourceManager::recordLoad(const Id name)
+{
+	if (!manifest) { return; }
+
+	if (manifest->IsRecording()) { manifest->Record(Id(GetName()), name); return; }
+
+	GTSL::Vector<ResourceManifest::Entry, BE::TAR> closure(16, GetTransientAllocator());
+	manifest->TakeDependencies(Id(GetName()), name, closure);
+	if (closure.GetLength()) { PrefetchManifestEntries(BE::Application::Get()->GetGameInstance(), closure.GetRange()); }
+}
+
+void ResourceManager::RecordDependency(const Id parentResourceManager, const Id parent, const Id resource)
+{
+	if (manifest && manifest->IsRecording()) { manifest->RecordDependency(parentResourceManager, parent, Id(GetName()), resource); }
+}
+
+void ResourceManager::PrefetchManifestEntries(GameInstance* gameInstance, const GTSL::Range<const ResourceManifest::Entry*> entries)
+{
+	//entries of managers which don't exist anymore are skipped
+	BE::Application::Get()->ForEachResourceManager([&](ResourceManager* resourceManager)
+	{
+		const auto resourceManagerName = Id(resourceManager->GetName());
+		GTSL::Vector<Id, BE::TAR> names(static_cast<uint32>(entries.ElementCount()), resourceManager->GetTransientAllocator());
+
+		for (const auto& e : entries) {
+			if (e.ResourceManager == resourceManagerName()) { names.EmplaceBack(GTSL::Id64(e.Resource)); }
+		}
+
+		if (names.GetLength()) { resourceManager->Prefetch(gameInstance, names.GetRange()); }
+	});
+}
+
+void ResourceManager::freePrefetchSpan(const uint32 span)
+{
+	GTSL::Delete(prefetchSpans[span], GetPersistentAllocator());
+	prefetchSpans[span] = nullptr;
+
+	for (auto e : prefetchSpans) { if (e) { return; } }
+	prefetchSpans.ResizeDown(0); prefetchedResources.ResizeDown(0);
+}
+
+uint32 ResourceManager::appendToPackage(const GTSL::Range<const byte*> data)
+{
+	GTSL::Lock lock(packageWriteMutex);
+
+	GTSL::File package; package.OpenFile(packagePath, GTSL::File::AccessMode::READ | GTSL::File::AccessMode::WRITE);
+	const auto offset = static_cast<uint32>(package.GetFileSize());
+	package.SetPointer(offset, GTSL::File::MoveFrom::BEGIN);
+	package.WriteToFile(data);
+	return offset;
+}
+
+bool ResourceManager::parseFileName(const utf8* fileName, const utf8* extension, GTSL::StaticString<256>& name)
+{
+	const auto fileNameLength = strlen(fileName), extensionLength = strlen(extension);
+	if (fileNameLength <= extensionLength || strcmp(fileName + fileNameLength - extensionLength, extension)) { return false; }
+
+	name = GTSL::StaticString<256>(fileName); name.Drop(static_cast<uint32>(fileNameLength - extensionLength));
+	return true;
+}
+
+void ResourceManager::ResidencyCache::linkEvictable(Entry& entry)
+{
+	const uint8 category = entry.Category;
+
+	if (evictableCounts[category]) { entries.At(evictableTails[category]).NextEvictable = entry.Name.GetHash(); entry.PreviousEvictable = evictableTails[category]; }
+	else { evictableHeads[category] = entry.Name.GetHash(); }
+
+	evictableTails[category] = entry.Name.GetHash(); ++evictableCounts[category];
+	entry.Evictable = true;
+}
+
+void ResourceManager::ResidencyCache::unlinkEvictable(Entry& entry)
+{
+	if (!entry.Evictable) { return; }
+
+	const uint8 category = entry.Category; const GTSL::Id64 name = entry.Name.GetHash();
+
+	if (evictableHeads[category] == name) { evictableHeads[category] = entry.NextEvictable; }
+	else { entries.At(entry.PreviousEvictable).NextEvictable = entry.NextEvictable; }
+
+	if (evictableTails[category] == name) { evictableTails[category] = entry.PreviousEvictable; }
+	else { entries.At(entry.NextEvictable).PreviousEvictable = entry.PreviousEvictable; }
+
+	--evictableCounts[category]; entry.Evictable = false;
+}
+
+void ResourceManager::ResidencyCache::makeRoom(const uint8 category, const uint32 bytes)
+{
+	//everything left may be in use, then the budget is overcommitted
+	while (residentBytes[category] + bytes > budgets[category] && evictableCounts[category]) { evict(entries.At(evictableHeads[category])); }
+}
+
+void ResourceManager::ResidencyCache::evict(Entry& entry)
+{
+	residentBytes[entry.Category] -= entry.Size; stats.ResidentBytes -= entry.Size;
+	++stats.Evictions;
+
+	unlinkEvictable(entry);
+	entries.Remove(entry.Name);
+}
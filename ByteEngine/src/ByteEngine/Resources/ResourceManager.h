@@ -5,7 +5,17 @@
 #include <GTSL/Id.h>
 #include <GTSL/DynamicType.h>
 #include <GTSL/Array.hpp>
+#include <GTSL/Buffer.hpp>
+#include <GTSL/FlatHashMap.h>
+#include <GTSL/Mutex.h>
+#include <GTSL/Vector.hpp>
 
+#include <thread>
+
+#include "ResourceData.h"
+#include "ResourceManifest.h"
+#include "ByteEngine/Id.h"
+#include "ByteEngine/Debug/Assert.h"
 #include "ByteEngine/Game/Tasks.h"
 
 /**
@@ -20,9 +30,42 @@ class ResourceManager : public Object
 public:
 	ResourceManager() = default;
 
-	ResourceManager(const utf8* name) : Object(name) {}
+	ResourceManager(const utf8* name) : Object(name), prefetchSpans(4, GetPersistentAllocator()), prefetchedResources(16, GetPersistentAllocator()) {}
+	virtual ~ResourceManager();
 	
 	GTSL::StaticString<512> GetResourcePath(const GTSL::Range<const utf8*> fileName);
+
+	/**
+	 * \brief Called when a source file in the resources directory changes while the application runs. Managers which import files of that kind re-import
+	 * the resource on a background task, update their index and dispatch an event so systems using the resource can load it again.
+	 * \param fileName Name of the changed file, with extension.
+	 * \return Whether this manager imports the file.
+	 */
+	virtual bool ReloadResource(class GameInstance* gameInstance, const utf8* fileName) { return false; }
+
+	/**
+	 * \brief Sets the manifest resources loaded from now on are recorded in, or prefetched from if it was loaded. nullptr stops both.
+	 */
+	void SetManifest(ResourceManifest* newManifest) { manifest = newManifest; }
+
+	/**
+	 * \brief Reads the package data of resources ahead of their loads. Resources are sorted by package offset and coalesced in large sequential reads
+	 * which run on background tasks, loads which find their data prefetched copy it from memory instead of reading the package.
+	 * Prefetched data is freed once every resource in a read has been fully loaded, or when the manager is destroyed.
+	 * \param names Resources to prefetch, ones not in the package are ignored.
+	 */
+	void Prefetch(class GameInstance* gameInstance, GTSL::Range<const Id*> names);
+
+	/**
+	 * \brief Notes in the manifest being recorded, if any, that parent, a resource of parentResourceManager, loads resource from this manager once it's loaded.
+	 * Next time resource is prefetched as soon as parent is requested.
+	 */
+	void RecordDependency(Id parentResourceManager, Id parent, Id resource);
+
+	/**
+	 * \brief Prefetches manifest entries with the resource managers they belong to.
+	 */
+	static void PrefetchManifestEntries(class GameInstance* gameInstance, GTSL::Range<const ResourceManifest::Entry*> entries);
 	
 	struct ResourceLoadInfo
 	{
@@ -127,10 +170,254 @@ public:
 
 	static constexpr uint8 MAX_THREADS = 32;
 
+	/**
+	 * \brief Keeps loaded resource data resident in memory under a per category byte budget.
+	 * Entries are reference counted, only entries with no references left can be evicted, least recently used ones first.
+	 * Data is loaded on demand by the caller provided loader when an entry is not resident.
+	 */
+	class ResidencyCache
+	{
+	public:
+		static constexpr uint8 MAX_CATEGORIES = 8;
+
+		struct Stats
+		{
+			uint64 Hits = 0, Misses = 0, Evictions = 0;
+			uint64 ResidentBytes = 0;
+		};
+
+		ResidencyCache() = default;
+
+		void Initialize(const uint32 expectedEntries, const BE::PAR& allocator)
+		{
+			entries.Initialize(expectedEntries, allocator); dataAllocator = allocator;
+			for (auto& e : budgets) { e = ~0ull; }
+			for (auto& e : residentBytes) { e = 0; }
+			for (auto& e : evictableCounts) { e = 0; }
+		}
+
+		/**
+		 * \brief Sets the maximum amount of bytes that may stay resident for a category. Entries which are still referenced can overcommit the budget.
+		 */
+		void SetBudget(const uint8 category, const uint64 bytes) { GTSL::WriteLock lock(mutex); budgets[category] = bytes; }
+
+		/**
+		 * \brief Returns a pointer to the data for name and adds a reference to it. If the entry is not resident it is allocated and filled by calling loader(GTSL::Range<byte*>).
+		 * The loader runs without holding the cache's lock, only other threads acquiring the same name wait for it.
+		 * Every Acquire must be matched by a call to Release.
+		 */
+		template<typename L>
+		byte* Acquire(const Id name, const uint8 category, const uint32 bytes, const uint32 alignment, L&& loader)
+		{
+			byte* data; bool load = false;
+
+			{
+				GTSL::WriteLock lock(mutex);
+
+				if (auto result = entries.TryGet(name); result.State()) {
+					++stats.Hits;
+
+					auto& entry = result.Get();
+					unlinkEvictable(entry); entry.IncrementReferences();
+					if (!entry.Loading) { return entry.Data.GetData(); }
+					data = entry.Data.GetData();
+				}
+				else {
+					++stats.Misses;
+
+					makeRoom(category, bytes); //evict before emplacing as eviction may move entries around
+
+					auto& entry = entries.Emplace(name);
+					entry.Name = name; entry.Category = category; entry.Size = bytes; entry.Loading = true;
+					entry.Data.Allocate(bytes, alignment, dataAllocator); entry.Data.Resize(bytes);
+
+					residentBytes[category] += bytes; stats.ResidentBytes += bytes;
+
+					entry.IncrementReferences(); //also keeps it from being evicted while it loads
+					data = entry.Data.GetData(); load = true; //data stays put when the entry moves
+				}
+			}
+
+			if (load) {
+				loader(GTSL::Range<byte*>(bytes, data));
+				GTSL::WriteLock lock(mutex); entries.At(name).Loading = false; //publishes the data
+			}
+			else {
+				while (true) { //another thread is loading it
+					{ GTSL::ReadLock lock(mutex); if (!entries.At(name).Loading) { break; } }
+					std::this_thread::yield();
+				}
+			}
+
+			return data;
+		}
+
+		/**
+		 * \brief Returns data for name only if it is already resident, adding a reference to it, or nullptr otherwise. Doesn't count towards hits and misses.
+		 */
+		byte* TryAcquire(const Id name)
+		{
+			GTSL::WriteLock lock(mutex);
+			auto result = entries.TryGet(name);
+			if (!result.State() || result.Get().Loading) { return nullptr; }
+			auto& entry = result.Get();
+			unlinkEvictable(entry); entry.IncrementReferences();
+			return entry.Data.GetData();
+		}
+
+		/**
+		 * \brief Removes a reference from a resident entry. Entries with no references are kept resident until they are needed to make room for other data.
+		 */
+		void Release(const Id name)
+		{
+			GTSL::WriteLock lock(mutex);
+			auto& entry = entries.At(name);
+			BE_ASSERT(entry.GetReferenceCount() != 0, "Releasing an entry with no references!");
+			if (entry.DecrementReferences()) { return; }
+			if (entry.Stale) { evict(entry); } else { linkEvictable(entry); }
+		}
+
+		/**
+		 * \brief Drops the resident data of name, if any, so the next Acquire loads it again. Data which is still referenced is dropped when it's last reference is released,
+		 * until then Acquire keeps returning it.
+		 */
+		void Invalidate(const Id name)
+		{
+			GTSL::WriteLock lock(mutex);
+			auto result = entries.TryGet(name);
+			if (!result.State()) { return; }
+
+			auto& entry = result.Get();
+			if (entry.GetReferenceCount()) { entry.Stale = true; return; }
+			evict(entry);
+		}
+
+		/**
+		 * \brief Returns the data of an entry which must be resident and referenced by the caller.
+		 */
+		byte* GetData(const Id name) { GTSL::ReadLock lock(mutex); return entries.At(name).Data.GetData(); }
+
+		[[nodiscard]] bool IsResident(const Id name) const { GTSL::ReadLock lock(mutex); return entries.Find(name) && !entries.At(name).Loading; }
+
+		[[nodiscard]] Stats GetStats() const { GTSL::ReadLock lock(mutex); return stats; }
+		[[nodiscard]] uint64 GetResidentBytes(const uint8 category) const { GTSL::ReadLock lock(mutex); return residentBytes[category]; }
+
+	private:
+		struct Entry : ResourceHandle
+		{
+			Id Name;
+			uint8 Category = 0;
+			uint32 Size = 0;
+			bool Stale = false;
+			/**
+			 * \brief Whether the thread that inserted the entry is still filling Data. Loading entries are referenced so they can't be evicted.
+			 */
+			bool Loading = false;
+
+			/**
+			 * \brief Neighbours in it's category's evictable list, only meaningful while Evictable.
+			 */
+			GTSL::Id64 PreviousEvictable, NextEvictable;
+			bool Evictable = false;
+			GTSL::Buffer<BE::PAR> Data;
+		};
+
+		mutable GTSL::ReadWriteMutex mutex;
+		GTSL::FlatHashMap<Id, Entry, BE::PAR> entries;
+		BE::PAR dataAllocator;
+		uint64 budgets[MAX_CATEGORIES];
+		uint64 residentBytes[MAX_CATEGORIES];
+		Stats stats;
+
+		/**
+		 * \brief Unreferenced entries of every category, linked by name as entries move when the map changes. Ordered by when their last reference was
+		 * released, least recently used first, so eviction takes the head instead of searching every entry.
+		 */
+		GTSL::Id64 evictableHeads[MAX_CATEGORIES], evictableTails[MAX_CATEGORIES];
+		uint32 evictableCounts[MAX_CATEGORIES];
+
+		void linkEvictable(Entry& entry);
+		void unlinkEvictable(Entry& entry);
+
+		/**
+		 * \brief Evicts unreferenced entries from category, least recently used first, until bytes fit in it's budget or no more evictable entries are left.
+		 */
+		void makeRoom(uint8 category, uint32 bytes);
+
+		void evict(Entry& entry);
+	};
+
 
 protected:
 	GTSL::File& getFile() { return packageFiles[getThread()]; }
+
+	/**
+	 * \brief Returns where a resource's data, the part of it which is read when it's loaded, lies in the package. Managers which support prefetching override this.
+	 * \return Whether the resource is in the package and can be prefetched.
+	 */
+	virtual bool getPackageRange(Id name, uint32& byteOffset, uint32& size) { return false; }
+
+	/**
+	 * \brief Reads package data at byteOffset into buffer, copying it from prefetched data if it's there.
+	 */
+	void readPackage(uint32 byteOffset, GTSL::Range<byte*> buffer);
+
+	/**
+	 * \brief Adds a resource to the manifest being recorded, if any. Managers call it when a resource is requested.
+	 * If the manifest was loaded instead, prefetches the resources it depends on which weren't prefetched yet.
+	 */
+	void recordLoad(Id name);
+	
 	void initializePackageFiles(GTSL::Range<const utf8*> path);
+
+	/**
+	 * \brief Writes data at the end of the package through it's own file handle, so it can run while other threads read from the package.
+	 * \return Offset data was written at.
+	 */
+	uint32 appendToPackage(GTSL::Range<const byte*> data);
+
+	/**
+	 * \brief Returns whether fileName ends in extension and writes the resource name, the file name without extension, to name.
+	 */
+	static bool parseFileName(const utf8* fileName, const utf8* extension, GTSL::StaticString<256>& name);
 	
 	GTSL::Array<GTSL::File, MAX_THREADS> packageFiles;
+	GTSL::StaticString<512> packagePath;
+	GTSL::Mutex packageWriteMutex;
+
+private:
+	/**
+	 * \brief Maximum distance between two resources in the package for them to be prefetched in the same read, skipped bytes are read and discarded.
+	 */
+	static constexpr uint32 MAX_PREFETCH_GAP = 64 * 1024;
+	static constexpr uint32 MAX_PREFETCH_READ_SIZE = 16 * 1024 * 1024;
+	static constexpr uint64 MAX_PREFETCH_BYTES = 256 * 1024 * 1024;
+
+	ResourceManifest* manifest = nullptr;
+	
+	struct PrefetchSpan
+	{
+		uint32 ByteOffset = 0, Size = 0;
+		/**
+		 * \brief Resources in the span which haven't been loaded yet, the span is freed when it reaches 0 and it's data has been read.
+		 */
+		uint32 PendingResources = 0;
+		bool Loaded = false;
+		GTSL::Buffer<BE::PAR> Data;
+	};
+
+	struct PrefetchedResource
+	{
+		uint32 ByteOffset, Size, Span;
+		/**
+		 * \brief Bytes of the resource loads have read, a resource can be read in more than one call. Once all of it is read it stops holding it's span.
+		 */
+		uint32 BytesRead = 0;
+	};
+
+	GTSL::Mutex prefetchMutex;
+	GTSL::Vector<PrefetchSpan*, BE::PAR> prefetchSpans;
+	GTSL::Vector<PrefetchedResource, BE::PAR> prefetchedResources;
+
+	void freePrefetchSpan(uint32 span);
 };
\ No newline at end of file
@@ -0,0 +1,125 @@
+#include "ResourceManifest.h"
+
+#include <GTSL/Buffer.hpp>
+#include <GTSL/File.h>
+#include <GTSL/Serialize.h>
+
+bool ResourceManifest::Load(const GTSL::Range<const utf8*> path, const BE::TAR& allocator)
+{
+	GTSL::Lock lock(mutex);
+	entries.ResizeDown(0); dependencies.ResizeDown(0);
+
+	GTSL::File file; file.OpenFile(path, GTSL::File::AccessMode::READ);
+	if (file.GetFileSize() < sizeof(uint32) * 3) { return false; } //missing or empty
+
+	GTSL::Buffer<BE::TAR> buffer; buffer.Allocate(static_cast<uint32>(file.GetFileSize()), 8, allocator);
+	file.ReadFile(buffer.GetBufferInterface());
+
+	uint32 magic, version, entryCount;
+	Extract(magic, buffer); Extract(version, buffer); Extract(entryCount, buffer);
+	if (magic != MAGIC || version != VERSION || buffer.GetLength() < sizeof(uint32) * 4 + entryCount * sizeof(uint64) * 2) { return false; }
+
+	for (uint32 i = 0; i < entryCount; ++i) {
+		Entry entry; Extract(entry.ResourceManager, buffer); Extract(entry.Resource, buffer);
+		entries.EmplaceBack(entry);
+	}
+
+	uint32 dependencyCount; Extract(dependencyCount, buffer);
+	if (buffer.GetLength() < sizeof(uint32) * 4 + entryCount * sizeof(uint64) * 2 + dependencyCount * sizeof(uint32) * 2) { entries.ResizeDown(0); return false; }
+
+	for (uint32 i = 0; i < dependencyCount; ++i) {
+		Dependency dependency; Extract(dependency.Parent, buffer); Extract(dependency.Child, buffer);
+		if (dependency.Parent >= entryCount || dependency.Child >= entryCount) { entries.ResizeDown(0); dependencies.ResizeDown(0); return false; }
+		dependencies.EmplaceBack(dependency);
+	}
+
+	return true;
+}
+
+void ResourceManifest::Write(const GTSL::Range<const utf8*> path, const BE::TAR& allocator) const
+{
+	GTSL::Lock lock(mutex);
+
+	GTSL::Buffer<BE::TAR> buffer; buffer.Allocate(sizeof(uint32) * 4 + entries.GetLength() * sizeof(uint64) * 2 + dependencies.GetLength() * sizeof(uint32) * 2, 8, allocator);
+	Insert(MAGIC, buffer); Insert(VERSION, buffer); Insert(entries.GetLength(), buffer);
+	for (const auto& e : entries) { Insert(e.ResourceManager, buffer); Insert(e.Resource, buffer); }
+	Insert(dependencies.GetLength(), buffer);
+	for (const auto& e : dependencies) { Insert(e.Parent, buffer); Insert(e.Child, buffer); }
+
+	GTSL::File file; file.OpenFile(path, GTSL::File::AccessMode::WRITE);
+	file.WriteToFile(buffer);
+}
+
+void ResourceManifest::Record(const Id resourceManager, const Id resource)
+{
+	GTSL::Lock lock(mutex);
+	findOrAdd(resourceManager(), resource());
+}
+
+void ResourceManifest::RecordDependency(const Id parentResourceManager, const Id parent, const Id resourceManager, const Id resource)
+{
+	GTSL::Lock lock(mutex);
+	const uint32 parentEntry = findOrAdd(parentResourceManager(), parent()), childEntry = findOrAdd(resourceManager(), resource());
+	for (const auto& e : dependencies) { if (e.Parent == parentEntry && e.Child == childEntry) { return; } }
+	dependencies.EmplaceBack(Dependency{ parentEntry, childEntry });
+}
+
+void ResourceManifest::TakeRoots(GTSL::Vector<Entry, BE::TAR>& roots)
+{
+	GTSL::Lock lock(mutex);
+
+	for (uint32 i = 0; i < entries.GetLength(); ++i)
+	{
+		if (entries[i].Prefetched) { continue; }
+
+		bool loadedByOther = false;
+		for (const auto& e : dependencies) { if (e.Child == i && e.Parent != i) { loadedByOther = true; break; } }
+		if (loadedByOther) { continue; }
+
+		entries[i].Prefetched = true; roots.EmplaceBack(entries[i]);
+	}
+}
+
+void ResourceManifest::TakeDependencies(const Id resourceManager, const Id resource, GTSL::Vector<Entry, BE::TAR>& closure)
+{
+	GTSL::Lock lock(mutex);
+
+	const uint32 entry = find(resourceManager(), resource());
+	if (entry == NO_ENTRY) { return; }
+
+	entries[entry].Prefetched = true; //it's being loaded now, prefetching it would only waste memory
+
+	GTSL::Vector<uint32, BE::TAR> pending(16, closure.GetAllocator()); pending.EmplaceBack(entry);
+
+	while (pending.GetLength())
+	{
+		const uint32 parent = pending[pending.GetLength() - 1]; pending.ResizeDown(pending.GetLength() - 1);
+
+		for (const auto& e : dependencies)
+		{
+			if (e.Parent != parent || entries[e.Child].Prefetched) { continue; }
+			entries[e.Child].Prefetched = true; closure.EmplaceBack(entries[e.Child]);
+			pending.EmplaceBack(e.Child);
+		}
+	}
+}
+
+void ResourceManifest::OnPackageRead(const GTSL::Microseconds time)
+{
+	GTSL::Lock lock(mutex);
+	lastReadTime = time;
+}
+
+uint32 ResourceManifest::find(const uint64 resourceManager, const uint64 resource) const
+{
+	for (uint32 i = 0; i < entries.GetLength(); ++i) { if (entries[i].ResourceManager == resourceManager && entries[i].Resource == resource) { return i; } }
+	return NO_ENTRY;
+}
+
+uint32 ResourceManifest::findOrAdd(const uint64 resourceManager, const uint64 resource)
+{
+	const uint32 entry = find(resourceManager, resource);
+	if (entry != NO_ENTRY) { return entry; }
+	entries.EmplaceBack(Entry{ resourceManager, resource });
+	return entries.GetLength() - 1;
+}
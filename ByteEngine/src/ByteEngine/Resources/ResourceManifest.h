@@ -0,0 +1,107 @@
+#pragma once
+
+#include <GTSL/Mutex.h>
+#include <GTSL/Range.h>
+#include <GTSL/Time.h>
+#include <GTSL/Vector.hpp>
+
+#include "ByteEngine/Core.h"
+#include "ByteEngine/Id.h"
+#include "ByteEngine/Application/AllocatorReferences.h"
+
+/**
+ * \brief List of the resources a world loaded while it ran and which of them were loaded because another one was, stored next to the world's
+ * resources so the next time it loads they can be prefetched before gameplay code requests them one by one. Resources nothing depends on are
+ * prefetched when the world starts loading, the rest as soon as a resource they depend on is requested.
+ */
+class ResourceManifest
+{
+public:
+	struct Entry
+	{
+		/**
+		 * \brief Name hash of the resource manager that loads the resource.
+		 */
+		uint64 ResourceManager;
+		uint64 Resource;
+		/**
+		 * \brief Whether the resource was already handed out for prefetching, not stored.
+		 */
+		bool Prefetched = false;
+	};
+
+	/**
+	 * \brief Parent loads Child once it's loaded, both are indices into the entries.
+	 */
+	struct Dependency
+	{
+		uint32 Parent, Child;
+	};
+
+	ResourceManifest(const BE::PAR& allocator) : entries(32, allocator), dependencies(32, allocator) {}
+
+	/**
+	 * \return Whether a valid manifest was found at path. On failure the manifest is left empty.
+	 */
+	bool Load(GTSL::Range<const utf8*> path, const BE::TAR& allocator);
+	void Write(GTSL::Range<const utf8*> path, const BE::TAR& allocator) const;
+
+	/**
+	 * \brief Adds a resource to the manifest if it's not already in it. Can be called from any thread.
+	 */
+	void Record(Id resourceManager, Id resource);
+
+	/**
+	 * \brief Notes that parent loads resource once it's loaded, adding both to the manifest if they aren't in it. Can be called from any thread.
+	 */
+	void RecordDependency(Id parentResourceManager, Id parent, Id resourceManager, Id resource);
+
+	/**
+	 * \brief Adds the resources no other resource loads, and which weren't handed out yet, to roots. Can be called from any thread.
+	 */
+	void TakeRoots(GTSL::Vector<Entry, BE::TAR>& roots);
+
+	/**
+	 * \brief Adds every resource resource loads, directly or through other resources, which wasn't handed out yet to closure. Can be called from any thread.
+	 */
+	void TakeDependencies(Id resourceManager, Id resource, GTSL::Vector<Entry, BE::TAR>& closure);
+
+	/**
+	 * \brief Whether the manifest is being recorded, otherwise it was loaded and is used to prefetch.
+	 */
+	void SetRecording(const bool isRecording) { recording = isRecording; }
+	[[nodiscard]] bool IsRecording() const { return recording; }
+
+	/**
+	 * \brief Notes that a resource's package data was read at time. Used to measure how long loading takes.
+	 */
+	void OnPackageRead(GTSL::Microseconds time);
+
+	/**
+	 * \brief Returns the time of the last package read, or 0 if nothing was read since the manifest was loaded.
+	 */
+	[[nodiscard]] GTSL::Microseconds GetLastReadTime() const { return lastReadTime; }
+
+	[[nodiscard]] GTSL::Range<const Entry*> GetEntries() const { return entries.GetRange(); }
+	[[nodiscard]] uint32 GetLength() const { return entries.GetLength(); }
+
+private:
+	static constexpr uint32 MAGIC = 'B' | 'E' << 8 | 'M' << 16 | 'F' << 24;
+	static constexpr uint32 VERSION = 2;
+	static constexpr uint32 NO_ENTRY = 0xFFFFFFFF;
+
+	GTSL::Vector<Entry, BE::PAR> entries;
+	GTSL::Vector<Dependency, BE::PAR> dependencies;
+	bool recording = true;
+	GTSL::Microseconds lastReadTime;
+	mutable GTSL::Mutex mutex;
+
+	/**
+	 * \brief Returns the index of the resource's entry, or NO_ENTRY. Must be called with the mutex locked.
+	 */
+	uint32 find(uint64 resourceManager, uint64 resource) const;
+	/**
+	 * \brief Returns the index of the resource's entry, adding it if it's not in the manifest. Must be called with the mutex locked.
+	 */
+	uint32 findOrAdd(uint64 resourceManager, uint64 resource);
+};
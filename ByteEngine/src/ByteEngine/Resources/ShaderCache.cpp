@@ -0,0 +1,82 @@
+#include "ShaderCache.h"
+
+void ShaderCache::Open(const GTSL::Range<const utf8*> path)
+{
+	GTSL::Lock lock(mutex);
+
+	{
+		GTSL::File existingFile; existingFile.OpenFile(path, GTSL::File::AccessMode::READ);
+
+		Header header{};
+		if (existingFile.GetFileSize() >= sizeof(Header)) { existingFile.ReadFromFile(GTSL::Range<byte*>(sizeof(Header), reinterpret_cast<byte*>(&header))); }
+
+		if (header.Magic != MAGIC || header.Version != VERSION) //new or stale cache, start it over
+		{
+			GTSL::File newFile; newFile.OpenFile(path, GTSL::File::AccessMode::WRITE);
+			header = Header{ MAGIC, VERSION };
+			newFile.WriteToFile(GTSL::Range<const byte*>(sizeof(Header), reinterpret_cast<const byte*>(&header)));
+		}
+	}
+
+	file.OpenFile(path, GTSL::File::AccessMode::READ | GTSL::File::AccessMode::WRITE);
+
+	const auto fileSize = file.GetFileSize();
+	uint64 offset = sizeof(Header);
+
+	while (offset + sizeof(RecordHeader) <= fileSize)
+	{
+		RecordHeader record;
+		file.SetPointer(offset, GTSL::File::MoveFrom::BEGIN);
+		file.ReadFromFile(GTSL::Range<byte*>(sizeof(RecordHeader), reinterpret_cast<byte*>(&record)));
+
+		const uint64 binaryOffset = offset + sizeof(RecordHeader);
+		if (binaryOffset + record.Size > fileSize) { break; } //last write didn't finish
+
+		if (!entries.Find(Id(GTSL::Id64(record.Key)))) { entries.Emplace(Id(GTSL::Id64(record.Key)), Entry{ static_cast<uint32>(binaryOffset), record.Size }); }
+		offset = binaryOffset + record.Size;
+	}
+
+	endOffset = offset; //new records overwrite a record which didn't finish writing
+}
+
+uint64 ShaderCache::GetKey(const GTSL::Range<const byte*> source, const GAL::ShaderType shaderType)
+{
+	uint64 hash = 0xCBF29CE484222325ull; //FNV-1a
+
+	auto hashByte = [&](const byte value) { hash ^= value; hash *= 0x100000001B3ull; };
+
+	for (auto e : source) { hashByte(e); }
+	hashByte(static_cast<byte>(shaderType));
+
+	return hash;
+}
+
+uint32 ShaderCache::GetSize(const uint64 key) const
+{
+	GTSL::Lock lock(mutex);
+	return entries.Find(Id(GTSL::Id64(key))) ? entries.At(Id(GTSL::Id64(key))).Size : 0;
+}
+
+void ShaderCache::Read(const uint64 key, const GTSL::Range<byte*> buffer)
+{
+	GTSL::Lock lock(mutex);
+	const auto& entry = entries.At(Id(GTSL::Id64(key)));
+	file.SetPointer(entry.ByteOffset, GTSL::File::MoveFrom::BEGIN);
+	file.ReadFromFile(GTSL::Range<byte*>(entry.Size, buffer.begin()));
+}
+
+void ShaderCache::Store(const uint64 key, const GTSL::Range<const byte*> binary)
+{
+	GTSL::Lock lock(mutex);
+	if (entries.Find(Id(GTSL::Id64(key)))) { return; }
+
+	const auto offset = endOffset;
+	const RecordHeader record{ key, static_cast<uint32>(binary.Bytes()), 0 };
+
+	file.SetPointer(offset, GTSL::File::MoveFrom::BEGIN);
+	file.WriteToFile(GTSL::Range<const byte*>(sizeof(RecordHeader), reinterpret_cast<const byte*>(&record)));
+	file.WriteToFile(binary);
+
+	entries.Emplace(Id(GTSL::Id64(key)), Entry{ static_cast<uint32>(offset + sizeof(RecordHeader)), record.Size });
+	endOffset = offset + sizeof(RecordHeader) + record.Size;
+}
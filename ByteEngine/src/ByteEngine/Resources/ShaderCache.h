@@ -0,0 +1,76 @@
+#pragma once
+
+#include <GAL/RenderCore.h>
+#include <GTSL/File.h>
+#include <GTSL/FlatHashMap.h>
+#include <GTSL/Mutex.h>
+#include <GTSL/Range.h>
+
+#include "ByteEngine/Core.h"
+#include "ByteEngine/Id.h"
+#include "ByteEngine/Application/AllocatorReferences.h"
+
+/**
+ * \brief Compiled shader binaries keyed by a hash of their source, so shaders whose source didn't change aren't compiled again on the next run.
+ * Binaries are appended to a single file, a shader whose source changes gets a new entry and the one for the old source stays unused.
+ */
+class ShaderCache
+{
+public:
+	ShaderCache(const BE::PAR& allocator) : entries(64, allocator) {}
+
+	/**
+	 * \brief Opens the cache file at path, creating it if it doesn't exist or was written by a different version.
+	 */
+	void Open(GTSL::Range<const utf8*> path);
+
+	/**
+	 * \brief Returns the key of a shader's binary, the same source compiled as the same shader type always gets the same key.
+	 */
+	static uint64 GetKey(GTSL::Range<const byte*> source, GAL::ShaderType shaderType);
+
+	/**
+	 * \return Size of the binary cached for key, 0 if there isn't one.
+	 */
+	[[nodiscard]] uint32 GetSize(uint64 key) const;
+
+	/**
+	 * \brief Reads the binary cached for key into buffer, which must hold GetSize(key) bytes. Can be called from any thread.
+	 */
+	void Read(uint64 key, GTSL::Range<byte*> buffer);
+
+	/**
+	 * \brief Adds a binary to the cache, if there is no binary for key already. Can be called from any thread.
+	 */
+	void Store(uint64 key, GTSL::Range<const byte*> binary);
+
+private:
+	static constexpr uint32 MAGIC = 'B' | 'E' << 8 | 'S' << 16 | 'C' << 24;
+	/**
+	 * \brief Bump when the shader compiler or it's options change, binaries compiled by the previous one are discarded.
+	 */
+	static constexpr uint32 VERSION = 1;
+
+	struct Header
+	{
+		uint32 Magic, Version;
+	};
+
+	struct RecordHeader
+	{
+		uint64 Key; uint32 Size, Pad;
+	};
+
+	struct Entry
+	{
+		uint32 ByteOffset, Size;
+	};
+
+	GTSL::File file;
+	/**
+	 * \brief End of the last complete record, where the next one is written.
+	 */
+	uint64 endOffset = 0;
+	GTSL::FlatHashMap<Id, Entry, BE::PAR> entries;
+	mutable GTSL::Mutex mutex;
+};
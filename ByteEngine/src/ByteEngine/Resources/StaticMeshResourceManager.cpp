@@ -15,11 +15,17 @@
 #include <GTSL/Serialize.h>
 #include <GTSL/Math/Math.hpp>
 
+#include "MeshOptimization.h"
 #include "ByteEngine/Game/GameInstance.h"
 
 using ShaderDataTypeType = GTSL::UnderlyingType<GAL::ShaderDataType>;
 
-StaticMeshResourceManager::StaticMeshResourceManager() : ResourceManager("StaticMeshResourceManager"), meshInfos(4, GetPersistentAllocator())
+/**
+ * \brief Maximum deviation a generated LOD may have from the full resolution mesh, relative to the mesh's bounding radius.
+ */
+static constexpr float32 LOD_MAX_ERROR = 0.1f;
+
+StaticMeshResourceManager::StaticMeshResourceManager() : ResourceManager("StaticMeshResourceManager"), meshInfos(GetPersistentAllocator())
 {
 	GTSL::StaticString<512> query_path, resources_path, index_path;
 	query_path += BE::Application::Get()->GetPathToApplication();
@@ -31,16 +37,10 @@ StaticMeshResourceManager::StaticMeshResourceManager() : ResourceManager("Static
 
 	auto package_path = GetResourcePath(GTSL::ShortString<32>("StaticMesh.bepkg"));
 
-	indexFile.OpenFile(index_path, GTSL::File::AccessMode::WRITE | GTSL::File::AccessMode::READ);
-	
-	if (indexFile.GetFileSize())
-	{
-		GTSL::Buffer<BE::TAR> meshInfosFileBuffer; meshInfosFileBuffer.Allocate(indexFile.GetFileSize(), 16, GetTransientAllocator());
-		indexFile.ReadFile(meshInfosFileBuffer.GetBufferInterface());
-		GTSL::Extract(meshInfos, meshInfosFileBuffer);
-	}
-	else
+	if (!meshInfos.Open(index_path))
 	{
+		ResourceIndexBuilder<StaticMeshDataSerialize> meshInfosBuilder(16, GetTransientAllocator());
+		
 		GTSL::File staticMeshPackage; staticMeshPackage.OpenFile(package_path, GTSL::File::AccessMode::WRITE);
 		
 		auto load = [&](const GTSL::FileQuery::QueryResult& queryResult)
@@ -50,36 +50,33 @@ StaticMeshResourceManager::StaticMeshResourceManager() : ResourceManager("Static
 			auto name = queryResult.FileNameWithExtension; name.Drop(name.FindLast('.').Get());
 			const auto hashed_name = GTSL::Id64(name);
 
-			if (!meshInfos.Find(hashed_name))
+			if (!meshInfosBuilder.Find(hashed_name))
 			{
-				GTSL::Buffer<BE::TAR> meshFileBuffer;
-
-				GTSL::File queryFile;
-				queryFile.OpenFile(file_path, GTSL::File::AccessMode::READ);
-				meshFileBuffer.Allocate(queryFile.GetFileSize(), 32, GetTransientAllocator());
-				queryFile.ReadFile(meshFileBuffer.GetBufferInterface());
-
-				GTSL::Buffer<BE::TAR> meshDataBuffer; meshDataBuffer.Allocate(2048 * 2048, 8, GetTransientAllocator());
-
+				GTSL::Buffer<BE::TAR> meshDataBuffer;
 				StaticMeshDataSerialize meshInfo;
 
-				loadMesh(meshFileBuffer, meshInfo, meshDataBuffer);
+				importMesh(file_path, meshInfo, meshDataBuffer);
 
 				meshInfo.ByteOffset = static_cast<uint32>(staticMeshPackage.GetFileSize());
 
 				staticMeshPackage.WriteToFile(meshDataBuffer.GetBufferInterface());
 
-				meshInfos.Emplace(hashed_name, meshInfo);
+				meshInfosBuilder.Emplace(hashed_name, meshInfo);
 			}
 		};
 
 		GTSL::FileQuery file_query(query_path);
 		GTSL::ForEach(file_query, load);
 
-		GTSL::Buffer<BE::TAR> meshInfosFileBuffer; meshInfosFileBuffer.Allocate(4096, 16, GetTransientAllocator());
-		Insert(meshInfos, meshInfosFileBuffer);
+		GTSL::Buffer<BE::TAR> meshInfosFileBuffer; meshInfosFileBuffer.Allocate(meshInfosBuilder.GetFileSize(), 16, GetTransientAllocator());
+		meshInfosBuilder.Write(meshInfosFileBuffer);
+
+		{
+			GTSL::File indexFile; indexFile.OpenFile(index_path, GTSL::File::AccessMode::WRITE);
+			indexFile.WriteToFile(meshInfosFileBuffer.GetBufferInterface());
+		}
 
-		indexFile.WriteToFile(meshInfosFileBuffer.GetBufferInterface());
+		meshInfos.Open(index_path);
 	}
 
 	initializePackageFiles(package_path);
@@ -87,6 +84,57 @@ StaticMeshResourceManager::StaticMeshResourceManager() : ResourceManager("Static
 
 StaticMeshResourceManager::~StaticMeshResourceManager()
 {
+	meshInfos.Flush(GetTransientAllocator());
+}
+
+bool StaticMeshResourceManager::ReloadResource(GameInstance* gameInstance, const utf8* fileName)
+{
+	GTSL::StaticString<256> name;
+	if (!parseFileName(fileName, ".obj", name)) { return false; }
+
+	auto reloadMesh = [](TaskInfo taskInfo, StaticMeshResourceManager* resourceManager, GTSL::StaticString<256> name)
+	{
+		auto filePath = resourceManager->GetResourcePath(name); filePath += ".obj";
+
+		GTSL::Buffer<BE::TAR> meshDataBuffer;
+		StaticMeshDataSerialize meshInfo;
+		resourceManager->importMesh(filePath, meshInfo, meshDataBuffer);
+
+		meshInfo.ByteOffset = resourceManager->appendToPackage(GTSL::Range<const byte*>(meshDataBuffer.GetLength(), meshDataBuffer.GetData()));
+		resourceManager->meshInfos.Update(Id(name.begin()), meshInfo);
+
+		taskInfo.GameInstance->DispatchEvent("StaticMeshResourceManager", GetOnStaticMeshReloadEventHandle(), Id(name.begin()));
+	};
+
+	//runs within a frame so the transient allocations made while importing stay valid
+	gameInstance->AddDynamicTask("reloadStaticMesh", Task<StaticMeshResourceManager*, GTSL::StaticString<256>>::Create(reloadMesh), {}, "FrameStart", "FrameEnd", this, GTSL::MoveRef(name));
+	return true;
+}
+
+bool StaticMeshResourceManager::getPackageRange(const Id name, uint32& byteOffset, uint32& size)
+{
+	if (!meshInfos.Find(name)) { return false; }
+
+	StaticMeshInfo meshInfo(name, meshInfos.At(name));
+	const uint8 lastLOD = meshInfo.GetLODCount() - 1;
+	
+	byteOffset = meshInfo.ByteOffset; //every LOD, as which ones are loaded depends on the view
+	size = meshInfo.LODs[lastLOD].ByteOffset + meshInfo.GetVerticesSize(lastLOD) + meshInfo.GetIndicesSize(lastLOD) + meshInfo.GetMeshletsSize(lastLOD);
+	return true;
+}
+
+void StaticMeshResourceManager::importMesh(const GTSL::Range<const utf8*> filePath, StaticMeshDataSerialize& meshInfo, GTSL::Buffer<BE::TAR>& meshDataBuffer)
+{
+	GTSL::Buffer<BE::TAR> meshFileBuffer;
+
+	GTSL::File queryFile;
+	queryFile.OpenFile(filePath, GTSL::File::AccessMode::READ);
+	meshFileBuffer.Allocate(queryFile.GetFileSize(), 32, GetTransientAllocator());
+	queryFile.ReadFile(meshFileBuffer.GetBufferInterface());
+
+	meshDataBuffer.Allocate(2048 * 2048, 8, GetTransientAllocator());
+
+	loadMesh(meshFileBuffer, meshInfo, meshDataBuffer);
 }
 
 void StaticMeshResourceManager::loadMesh(const GTSL::Buffer<BE::TAR>& sourceBuffer, StaticMeshDataSerialize& meshInfo, GTSL::Buffer<BE::TAR>& meshDataBuffer)
@@ -99,13 +147,26 @@ void StaticMeshResourceManager::loadMesh(const GTSL::Buffer<BE::TAR>& sourceBuff
 
 	aiMesh* inMesh = ai_scene->mMeshes[0];
 
+	const bool quantize = BE::Application::Get()->GetOption("quantizeMeshes", false);
+
+	enum class Quantization : uint8 { NONE, SNORM_10_10_10_2, HALF2 };
+	
 	struct VertexCopyData {
-		const byte* Array = nullptr; uint8 ElementSize = 0, JumpSize = 0;
+		const byte* Array = nullptr; uint8 ElementSize = 0, JumpSize = 0; Quantization Packing = Quantization::NONE;
 	};
 	
 	GTSL::Array<VertexCopyData, 20> vertexElements;
-	
-	meshInfo.VertexCount = inMesh->mNumVertices;
+
+	auto addDirection = [&](const aiVector3D* array)
+	{
+		if (quantize) {
+			meshInfo.VertexDescriptor.EmplaceBack(GAL::ShaderDataType::INT);
+			vertexElements.EmplaceBack(reinterpret_cast<const byte*>(array), 4, 12, Quantization::SNORM_10_10_10_2);
+		} else {
+			meshInfo.VertexDescriptor.EmplaceBack(GAL::ShaderDataType::FLOAT3);
+			vertexElements.EmplaceBack(reinterpret_cast<const byte*>(array), 12, 12);
+		}
+	};
 	
 	//MESH ALWAYS HAS POSITIONS
 	meshInfo.VertexDescriptor.EmplaceBack(GAL::ShaderDataType::FLOAT3);
@@ -113,23 +174,24 @@ void StaticMeshResourceManager::loadMesh(const GTSL::Buffer<BE::TAR>& sourceBuff
 
 	if(inMesh->HasNormals())
 	{
-		meshInfo.VertexDescriptor.EmplaceBack(GAL::ShaderDataType::FLOAT3);
-		vertexElements.EmplaceBack(reinterpret_cast<const byte*>(inMesh->mNormals), 12, 12);
+		addDirection(inMesh->mNormals);
 	}
 
 	if(inMesh->HasTangentsAndBitangents())
 	{
-		meshInfo.VertexDescriptor.EmplaceBack(GAL::ShaderDataType::FLOAT3);
-		vertexElements.EmplaceBack(reinterpret_cast<const byte*>(inMesh->mTangents), 12, 12);
-		meshInfo.VertexDescriptor.EmplaceBack(GAL::ShaderDataType::FLOAT3);
-		vertexElements.EmplaceBack(reinterpret_cast<const byte*>(inMesh->mBitangents), 12, 12);
+		addDirection(inMesh->mTangents);
+		addDirection(inMesh->mBitangents);
 	}
 
 	for (uint8 tex_coords = 0; tex_coords < static_cast<uint8>(inMesh->GetNumUVChannels()); ++tex_coords)
 	{
-		meshInfo.VertexDescriptor.EmplaceBack(GAL::ShaderDataType::FLOAT2);
-
-		vertexElements.EmplaceBack(reinterpret_cast<const byte*>(inMesh->mTextureCoords[tex_coords]), 8, 12);
+		if (quantize) {
+			meshInfo.VertexDescriptor.EmplaceBack(GAL::ShaderDataType::INT);
+			vertexElements.EmplaceBack(reinterpret_cast<const byte*>(inMesh->mTextureCoords[tex_coords]), 4, 12, Quantization::HALF2);
+		} else {
+			meshInfo.VertexDescriptor.EmplaceBack(GAL::ShaderDataType::FLOAT2);
+			vertexElements.EmplaceBack(reinterpret_cast<const byte*>(inMesh->mTextureCoords[tex_coords]), 8, 12);
+		}
 	}
 
 	for (uint8 colors = 0; colors < static_cast<uint8>(inMesh->GetNumColorChannels()); ++colors)
@@ -139,47 +201,121 @@ void StaticMeshResourceManager::loadMesh(const GTSL::Buffer<BE::TAR>& sourceBuff
 		vertexElements.EmplaceBack(reinterpret_cast<const byte*>(inMesh->mColors[colors]), 16, 16);
 	}
 
-	meshInfo.BoundingBox = GTSL::Vector3(); meshInfo.BoundingRadius = 0.0f;
+	const uint32 indexCount = inMesh->mNumFaces * 3;
 	
-	for(uint64 vertex = 0; vertex < inMesh->mNumVertices; ++vertex)
+	GTSL::Vector<uint32, BE::TAR> sourceIndices(indexCount, GetTransientAllocator());
+	for (uint32 face = 0; face < inMesh->mNumFaces; ++face) {
+		for (uint32 index = 0; index < 3; ++index) { sourceIndices.EmplaceBack(inMesh->mFaces[face].mIndices[index]); }
+	}
+
+	meshInfo.BoundingBox = GTSL::Vector3(); meshInfo.BoundingRadius = 0.0f;
+
+	for (uint32 vertex = 0; vertex < inMesh->mNumVertices; ++vertex)
 	{
 		auto vertexPosition = GTSL::Vector3(inMesh->mVertices[vertex].x, inMesh->mVertices[vertex].y, inMesh->mVertices[vertex].z);
-		
 		meshInfo.BoundingBox = GTSL::Math::Max(meshInfo.BoundingBox, GTSL::Math::Abs(vertexPosition));
-
 		meshInfo.BoundingRadius = GTSL::Math::Max(meshInfo.BoundingRadius, GTSL::Math::Length(vertexPosition));
-		
-		for(auto e : vertexElements) {
-			meshDataBuffer.CopyBytes(e.ElementSize, e.Array + vertex * e.JumpSize);
-		}
 	}
 
-	uint16 indexSize = 0;
-	
-	if((inMesh->mNumFaces * 3) < 0xFFFF)
+	GTSL::Vector<uint32, BE::TAR> indices(indexCount, GetTransientAllocator()); indices.Resize(indexCount);
+	GTSL::Vector<uint32, BE::TAR> remap(inMesh->mNumVertices, GetTransientAllocator()); remap.Resize(inMesh->mNumVertices);
+	GTSL::Vector<uint32, BE::TAR> vertexOrder(inMesh->mNumVertices, GetTransientAllocator());
+	GTSL::Vector<float32, BE::TAR> positions(inMesh->mNumVertices * 3, GetTransientAllocator()); //positions in final vertex order, for building meshlets
+	GTSL::Vector<Meshlet, BE::TAR> meshlets(indexCount / (MAX_MESHLET_TRIANGLES * 3) + 1, GetTransientAllocator());
+
+	//indices are simplified into indices, every LOD gets it's own compacted vertices so they can be loaded independently
+	auto writeLOD = [&](const uint32 lodIndexCount, const float32 error)
 	{
-		indexSize = 2;
+		LOD lod; lod.ByteOffset = static_cast<uint32>(meshDataBuffer.GetLength()); lod.IndexCount = lodIndexCount; lod.Error = error;
+		
+		const float32 originalACMR = CalculateACMR(indices.begin(), lodIndexCount, inMesh->mNumVertices, VERTEX_CACHE_SIZE, GetTransientAllocator());
+
+		OptimizeVertexCache(indices.begin(), lodIndexCount, inMesh->mNumVertices, VERTEX_CACHE_SIZE, GetTransientAllocator());
+		OptimizeOverdraw(indices.begin(), lodIndexCount, reinterpret_cast<const byte*>(inMesh->mVertices), sizeof(aiVector3D), inMesh->mNumVertices, VERTEX_CACHE_SIZE, GetTransientAllocator());
+		lod.VertexCount = OptimizeVertexFetch(remap.begin(), indices.begin(), lodIndexCount, inMesh->mNumVertices);
+
+		BE_LOG_MESSAGE("Optimized mesh LOD ", meshInfo.LODs.GetLength(), ". Triangles: ", lodIndexCount / 3, " Error: ", error, " ACMR: ", originalACMR, " -> ", CalculateACMR(indices.begin(), lodIndexCount, lod.VertexCount, VERTEX_CACHE_SIZE, GetTransientAllocator()));
+
+		vertexOrder.Resize(lod.VertexCount);
+		for (uint32 vertex = 0; vertex < inMesh->mNumVertices; ++vertex) {
+			if (remap[vertex] != 0xFFFFFFFF) { vertexOrder[remap[vertex]] = vertex; }
+		}
+
+		positions.ResizeDown(0);
+		
+		for(uint32 v = 0; v < lod.VertexCount; ++v)
+		{
+			const uint32 vertex = vertexOrder[v];
+
+			positions.EmplaceBack(inMesh->mVertices[vertex].x); positions.EmplaceBack(inMesh->mVertices[vertex].y); positions.EmplaceBack(inMesh->mVertices[vertex].z);
+			
+			for(auto e : vertexElements)
+			{
+				const auto* element = reinterpret_cast<const float32*>(e.Array + vertex * e.JumpSize);
+				
+				switch (e.Packing)
+				{
+				case Quantization::NONE: meshDataBuffer.CopyBytes(e.ElementSize, e.Array + vertex * e.JumpSize); break;
+				case Quantization::SNORM_10_10_10_2:
+				{
+					uint32 packed = PackSNorm1010102(element[0], element[1], element[2]);
+					meshDataBuffer.CopyBytes(4, reinterpret_cast<byte*>(&packed));
+					break;
+				}
+				case Quantization::HALF2:
+				{
+					uint16 packed[2] = { FloatToHalf(element[0]), FloatToHalf(element[1]) };
+					meshDataBuffer.CopyBytes(4, reinterpret_cast<byte*>(packed));
+					break;
+				}
+				}
+			}
+		}
+
+		if(lod.VertexCount <= 0xFFFF) //index size only depends on the range of vertices referenced
+		{
+			lod.IndexSize = 2;
 
-		for (uint32 face = 0; face < inMesh->mNumFaces; ++face) {
-			for (uint32 index = 0; index < 3; ++index) {
-				uint16 idx = static_cast<uint16>(inMesh->mFaces[face].mIndices[index]);
-				meshDataBuffer.CopyBytes(indexSize, reinterpret_cast<byte*>(&idx));
+			for (uint32 index = 0; index < lodIndexCount; ++index) {
+				uint16 idx = static_cast<uint16>(indices[index]);
+				meshDataBuffer.CopyBytes(lod.IndexSize, reinterpret_cast<byte*>(&idx));
 			}
 		}
-	}
-	else
-	{
-		indexSize = 4;
+		else
+		{
+			lod.IndexSize = 4;
 
-		for (uint32 face = 0; face < inMesh->mNumFaces; ++face) {
-			for (uint32 index = 0; index < 3; ++index) {
-				meshDataBuffer.CopyBytes(indexSize, reinterpret_cast<byte*>(inMesh->mFaces[face].mIndices + index));
+			for (uint32 index = 0; index < lodIndexCount; ++index) {
+				meshDataBuffer.CopyBytes(lod.IndexSize, reinterpret_cast<byte*>(&indices[index]));
 			}
 		}
-	}
 
-	meshInfo.IndexCount = inMesh->mNumFaces * 3;
-	meshInfo.IndexSize = indexSize;
+		meshlets.ResizeDown(0);
+		BuildMeshlets(indices.begin(), lodIndexCount, reinterpret_cast<const byte*>(positions.begin()), sizeof(float32) * 3, lod.VertexCount, meshlets, GetTransientAllocator());
+
+		//meshlets are written after the indices so they are loaded with the rest of the LOD, index only keeps the count
+		meshDataBuffer.CopyBytes(meshlets.GetLength() * sizeof(Meshlet), reinterpret_cast<byte*>(meshlets.begin()));
+		lod.MeshletCount = meshlets.GetLength();
+
+		meshInfo.LODs.EmplaceBack(lod);
+	};
+
+	for (uint32 i = 0; i < indexCount; ++i) { indices[i] = sourceIndices[i]; }
+	writeLOD(indexCount, 0.0f);
+
+	//every LOD is simplified from the full resolution mesh, so errors don't accumulate along the chain
+	while (meshInfo.LODs.GetLength() < MAX_LODS)
+	{
+		const uint32 previousIndexCount = meshInfo.LODs[meshInfo.LODs.GetLength() - 1].IndexCount;
+
+		float32 error = 0.0f;
+		const uint32 lodIndexCount = SimplifyMesh(indices.begin(), sourceIndices.begin(), indexCount, reinterpret_cast<const byte*>(inMesh->mVertices), sizeof(aiVector3D), inMesh->mNumVertices,
+			previousIndexCount / 6 * 3, meshInfo.BoundingRadius * LOD_MAX_ERROR, &error, GetTransientAllocator());
+
+		if (lodIndexCount > previousIndexCount * 3 / 4) { break; } //simplification stalled, another LOD wouldn't save enough to be worth it
+
+		writeLOD(lodIndexCount, error);
+	}
 
 	meshInfo.VertexSize = GAL::GraphicsPipeline::GetVertexSize(meshInfo.VertexDescriptor);
-}
\ No newline at end of file
+}
@@ -4,6 +4,8 @@
 #include <GTSL/Buffer.hpp>
 
 #include "ResourceManager.h"
+#include "MeshOptimization.h"
+#include "ResourceIndex.h"
 
 #include <GTSL/Delegate.hpp>
 #include <GTSL/FlatHashMap.h>
@@ -28,31 +30,69 @@ public:
 	StaticMeshResourceManager();
 	~StaticMeshResourceManager();
 
-	struct StaticMeshData : Data
+	/**
+	 * \brief Dispatched with a mesh's name after it has been re-imported from it's source file. Already loaded LODs of it are stale.
+	 */
+	static auto GetOnStaticMeshReloadEventHandle() { return EventHandle<Id>("OnStaticMeshReload"); }
+
+	bool ReloadResource(GameInstance* gameInstance, const utf8* fileName) override;
+
+	/**
+	 * \brief Maximum number of levels of detail a mesh is packaged with, including the full resolution one.
+	 */
+	static constexpr uint8 MAX_LODS = 5;
+
+	/**
+	 * \brief One level of detail of a mesh. Every LOD has it's own vertices, indices and meshlets so only the ones in use need to be loaded.
+	 */
+	struct LOD
 	{
 		/**
-		* \brief Number of vertices the loaded mesh contains.
+		 * \brief Offset of the LOD's data from the mesh's ByteOffset.
+		 */
+		uint32 ByteOffset = 0;
+		
+		/**
+		* \brief Number of vertices the LOD contains.
 		*/
-		uint32 VertexCount;
+		uint32 VertexCount = 0;
 
 		/**
-		 * \brief Number of indeces the loaded mesh contains. Every face can only have three indeces.
+		 * \brief Number of indeces the LOD contains. Every face can only have three indeces.
 		 */
-		uint16 IndexCount;
+		uint32 IndexCount = 0;
 
 		/**
-		 * \brief Size of a single vertex.
+		 * \brief Number of meshlets the LOD is split into. Meshlets are stored in the package after the indices.
 		 */
-		uint16 VertexSize;
+		uint32 MeshletCount = 0;
 
 		/**
 		 * \brief Size of a single index to determine whether to use uint16 or uint32.
 		 */
-		uint8 IndexSize;
+		uint8 IndexSize = 0;
+
+		/**
+		 * \brief Maximum distance, in mesh units, the LOD's surface deviates from the full resolution mesh.
+		 */
+		float32 Error = 0.0f;
+	};
+	
+	struct StaticMeshData : Data
+	{
+		/**
+		 * \brief Size of a single vertex.
+		 */
+		uint16 VertexSize;
 
 		GTSL::Vector3 BoundingBox; float32 BoundingRadius;
 		
 		GTSL::Array<GAL::ShaderDataType, 20> VertexDescriptor;
+
+		/**
+		 * \brief Levels of detail, from full resolution to coarsest.
+		 */
+		GTSL::Array<LOD, MAX_LODS> LODs;
 	};
 	
 	struct StaticMeshDataSerialize : DataSerialize<StaticMeshData>
@@ -61,24 +101,30 @@ public:
 		{
 			INSERT_BODY;
 			Insert(insertInfo.VertexSize, buffer);
-			Insert(insertInfo.VertexCount, buffer);
-			Insert(insertInfo.IndexSize, buffer);
-			Insert(insertInfo.IndexCount, buffer);
 			Insert(insertInfo.BoundingBox, buffer);
 			Insert(insertInfo.BoundingRadius, buffer);
 			Insert(insertInfo.VertexDescriptor, buffer);
+
+			Insert(static_cast<uint8>(insertInfo.LODs.GetLength()), buffer);
+			for (const auto& lod : insertInfo.LODs) {
+				Insert(lod.ByteOffset, buffer); Insert(lod.VertexCount, buffer); Insert(lod.IndexCount, buffer); Insert(lod.MeshletCount, buffer); Insert(lod.IndexSize, buffer); Insert(lod.Error, buffer);
+			}
 		}
 
 		EXTRACT_START(StaticMeshDataSerialize)
 		{
 			EXTRACT_BODY;
 			Extract(extractInfo.VertexSize, buffer);
-			Extract(extractInfo.VertexCount, buffer);
-			Extract(extractInfo.IndexSize, buffer);
-			Extract(extractInfo.IndexCount, buffer);
 			Extract(extractInfo.BoundingBox, buffer);
 			Extract(extractInfo.BoundingRadius, buffer);
 			Extract(extractInfo.VertexDescriptor, buffer);
+
+			uint8 lodCount; Extract(lodCount, buffer);
+			for (uint8 i = 0; i < lodCount; ++i) {
+				LOD lod;
+				Extract(lod.ByteOffset, buffer); Extract(lod.VertexCount, buffer); Extract(lod.IndexCount, buffer); Extract(lod.MeshletCount, buffer); Extract(lod.IndexSize, buffer); Extract(lod.Error, buffer);
+				extractInfo.LODs.EmplaceBack(lod);
+			}
 		}
 	};
 
@@ -86,8 +132,10 @@ public:
 	{
 		DECL_INFO_CONSTRUCTOR(StaticMeshInfo, Info<StaticMeshDataSerialize>);
 
-		uint32 GetVerticesSize() const { return VertexSize * VertexCount; }
-		uint32 GetIndicesSize() const { return IndexSize * IndexCount; }
+		uint8 GetLODCount() const { return static_cast<uint8>(LODs.GetLength()); }
+		uint32 GetVerticesSize(const uint8 lod) const { return VertexSize * LODs[lod].VertexCount; }
+		uint32 GetIndicesSize(const uint8 lod) const { return LODs[lod].IndexSize * LODs[lod].IndexCount; }
+		uint32 GetMeshletsSize(const uint8 lod) const { return sizeof(Meshlet) * LODs[lod].MeshletCount; }
 	};
 
 	template<typename... ARGS>
@@ -95,6 +143,7 @@ public:
 	{
 		auto loadStaticMeshInfo = [](TaskInfo taskInfo, StaticMeshResourceManager* resourceManager, Id meshName, decltype(dynamicTaskHandle) dynamicTaskHandle, ARGS&&... args)
 		{
+			resourceManager->recordLoad(meshName);
 			auto staticMeshInfoSerialize = resourceManager->meshInfos.At(meshName);
 
 			StaticMeshInfo staticMeshInfo(meshName, staticMeshInfoSerialize);
@@ -105,32 +154,47 @@ public:
 		gameInstance->AddDynamicTask("loadstaticMeshInfo", Task<StaticMeshResourceManager*, Id, decltype(dynamicTaskHandle), ARGS...>::Create(loadStaticMeshInfo), {}, this, GTSL::MoveRef(meshName), GTSL::MoveRef(dynamicTaskHandle), GTSL::ForwardRef<ARGS>(args)...);
 	}
 
+	/**
+	 * \brief Loads one LOD's vertices and indices into buffer and it's meshlets into meshletBuffer, which has to be at least GetMeshletsSize(lod) bytes.
+	 */
 	template<typename... ARGS>
-	void LoadStaticMesh(GameInstance* gameInstance, StaticMeshInfo staticMeshInfo, uint32 indicesAlignment, GTSL::Range<byte*> buffer, DynamicTaskHandle<StaticMeshResourceManager*, StaticMeshInfo, ARGS...> dynamicTaskHandle, ARGS&&... args)
+	void LoadStaticMesh(GameInstance* gameInstance, StaticMeshInfo staticMeshInfo, uint8 lod, uint32 indicesAlignment, GTSL::Range<byte*> buffer, GTSL::Range<byte*> meshletBuffer, DynamicTaskHandle<StaticMeshResourceManager*, StaticMeshInfo, ARGS...> dynamicTaskHandle, ARGS&&... args)
 	{
-		auto loadMesh = [](TaskInfo taskInfo, StaticMeshResourceManager* resourceManager, StaticMeshInfo staticMeshInfo, uint32 indicesAlignment, GTSL::Range<byte*> buffer, decltype(dynamicTaskHandle) dynamicTaskHandle, ARGS&&... args)
+		auto loadMesh = [](TaskInfo taskInfo, StaticMeshResourceManager* resourceManager, StaticMeshInfo staticMeshInfo, uint8 lod, uint32 indicesAlignment, GTSL::Range<byte*> buffer, GTSL::Range<byte*> meshletBuffer, decltype(dynamicTaskHandle) dynamicTaskHandle, ARGS&&... args)
 		{
-			auto verticesSize = staticMeshInfo.GetVerticesSize(); auto indicesSize = staticMeshInfo.GetIndicesSize();
+			auto verticesSize = staticMeshInfo.GetVerticesSize(lod); auto indicesSize = staticMeshInfo.GetIndicesSize(lod);
 
 			{
 				byte* vertices = buffer.begin();
 				byte* indices = GTSL::AlignPointer(indicesAlignment, vertices + verticesSize);
 
-				resourceManager->getFile().SetPointer(staticMeshInfo.ByteOffset, GTSL::File::MoveFrom::BEGIN);
-				resourceManager->getFile().ReadFromFile(GTSL::Range<byte*>(verticesSize, vertices));
-				resourceManager->getFile().ReadFromFile(GTSL::Range<byte*>(indicesSize, indices));
+				//vertices, indices and meshlets are stored one after the other
+				const uint32 lodOffset = staticMeshInfo.ByteOffset + staticMeshInfo.LODs[lod].ByteOffset;
+				resourceManager->readPackage(lodOffset, GTSL::Range<byte*>(verticesSize, vertices));
+				resourceManager->readPackage(lodOffset + verticesSize, GTSL::Range<byte*>(indicesSize, indices));
+				resourceManager->readPackage(lodOffset + verticesSize + indicesSize, GTSL::Range<byte*>(staticMeshInfo.GetMeshletsSize(lod), meshletBuffer.begin()));
 			}
 			
 			taskInfo.GameInstance->AddStoredDynamicTask(dynamicTaskHandle, GTSL::MoveRef(resourceManager), GTSL::MoveRef(staticMeshInfo), GTSL::ForwardRef<ARGS>(args)...);
 		};
 
-		gameInstance->AddDynamicTask("loadStaticMesh", Task<StaticMeshResourceManager*, StaticMeshInfo, uint32, GTSL::Range<byte*>, decltype(dynamicTaskHandle), ARGS...>::Create(loadMesh), {}, this, GTSL::MoveRef(staticMeshInfo), GTSL::MoveRef(indicesAlignment), GTSL::MoveRef(buffer), GTSL::MoveRef(dynamicTaskHandle), GTSL::ForwardRef<ARGS>(args)...);
+		gameInstance->AddDynamicTask("loadStaticMesh", Task<StaticMeshResourceManager*, StaticMeshInfo, uint8, uint32, GTSL::Range<byte*>, GTSL::Range<byte*>, decltype(dynamicTaskHandle), ARGS...>::Create(loadMesh), {}, this, GTSL::MoveRef(staticMeshInfo), GTSL::MoveRef(lod), GTSL::MoveRef(indicesAlignment), GTSL::MoveRef(buffer), GTSL::MoveRef(meshletBuffer), GTSL::MoveRef(dynamicTaskHandle), GTSL::ForwardRef<ARGS>(args)...);
 	}
 	
 private:
-	GTSL::File indexFile;
-	
-	GTSL::FlatHashMap<Id, StaticMeshDataSerialize, BE::PersistentAllocatorReference> meshInfos;
+	ReloadableResourceIndex<StaticMeshDataSerialize> meshInfos;
+
+	bool getPackageRange(Id name, uint32& byteOffset, uint32& size) override;
+
+	/**
+	 * \brief Reads a source mesh file and imports it with loadMesh. ByteOffset is left for the caller to set.
+	 */
+	void importMesh(GTSL::Range<const utf8*> filePath, StaticMeshDataSerialize& meshInfo, GTSL::Buffer<BE::TAR>& meshDataBuffer);
 
-	static void loadMesh(const GTSL::Buffer<BE::TAR>& sourceBuffer, StaticMeshDataSerialize& meshInfo, GTSL::Buffer<BE::TAR>& meshDataBuffer);
+	/**
+	 * \brief Imports the first mesh in sourceBuffer and generates up to MAX_LODS levels of detail, each halving the triangle count, by quadric error simplification.
+	 * For every LOD triangles are reordered for vertex cache efficiency and overdraw, vertices are placed in fetch order
+	 * and, if the "quantizeMeshes" option is set, normals, tangents and texture coordinates are packed to 4 bytes each.
+	 */
+	void loadMesh(const GTSL::Buffer<BE::TAR>& sourceBuffer, StaticMeshDataSerialize& meshInfo, GTSL::Buffer<BE::TAR>& meshDataBuffer);
 };
@@ -0,0 +1,246 @@
+#include "TextureCompression.h"
+
+#include <emmintrin.h>
+
+namespace
+{
+	using Block = uint8[16][4];
+
+	void loadBlock(const byte* source, const uint32 width, const uint32 height, const uint32 blockX, const uint32 blockY, Block& block)
+	{
+		for (uint32 y = 0; y < 4; ++y)
+		{
+			const uint32 sourceY = GTSL::Math::Limit(blockY * 4 + y, height - 1);
+
+			for (uint32 x = 0; x < 4; ++x)
+			{
+				const uint32 sourceX = GTSL::Math::Limit(blockX * 4 + x, width - 1);
+				const byte* texel = source + (sourceY * width + sourceX) * 4;
+				for (uint32 c = 0; c < 4; ++c) { block[y * 4 + x][c] = texel[c]; }
+			}
+		}
+	}
+
+	uint16 to565(const int32* color)
+	{
+		return static_cast<uint16>(((color[0] >> 3) << 11) | ((color[1] >> 2) << 5) | (color[2] >> 3));
+	}
+
+	void from565(const uint16 value, int32* color)
+	{
+		const int32 r = (value >> 11) & 31, g = (value >> 5) & 63, b = value & 31;
+		color[0] = (r << 3) | (r >> 2); color[1] = (g << 2) | (g >> 4); color[2] = (b << 3) | (b >> 2);
+	}
+
+	void writeLittleEndian(uint64 value, const uint32 bytes, byte* destination)
+	{
+		for (uint32 i = 0; i < bytes; ++i) { destination[i] = static_cast<byte>(value >> (i * 8)); }
+	}
+
+	void compressBC1(const Block& block, byte* destination)
+	{
+		int32 min[3] = { 255, 255, 255 }, max[3] = { 0, 0, 0 };
+
+		for (const auto& texel : block) {
+			for (uint32 c = 0; c < 3; ++c) { min[c] = GTSL::Math::Limit(min[c], static_cast<int32>(texel[c])); max[c] = GTSL::Math::Max(max[c], static_cast<int32>(texel[c])); }
+		}
+
+		for (uint32 c = 0; c < 3; ++c) { //inset bounding box to reduce error on the interpolated colors
+			const int32 inset = (max[c] - min[c]) >> 4;
+			min[c] += inset; max[c] -= inset;
+		}
+
+		uint16 color0 = to565(max), color1 = to565(min);
+		if (color0 < color1) { const auto t = color0; color0 = color1; color1 = t; }
+
+		uint32 indices = 0;
+
+		if (color0 != color1) //equal endpoints would select 3 color mode, leave every index at 0
+		{
+			int32 palette[4][3];
+			from565(color0, palette[0]); from565(color1, palette[1]);
+
+			for (uint32 c = 0; c < 3; ++c) {
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+
+			for (uint32 i = 0; i < 16; ++i)
+			{
+				uint32 best = 0; int32 bestDistance = 0x7FFFFFFF;
+
+				for (uint32 p = 0; p < 4; ++p)
+				{
+					int32 distance = 0;
+					for (uint32 c = 0; c < 3; ++c) { const int32 d = block[i][c] - palette[p][c]; distance += d * d; }
+					if (distance < bestDistance) { bestDistance = distance; best = p; }
+				}
+
+				indices |= best << (i * 2);
+			}
+		}
+
+		writeLittleEndian(color0, 2, destination);
+		writeLittleEndian(color1, 2, destination + 2);
+		writeLittleEndian(indices, 4, destination + 4);
+	}
+
+	void compressBC4(const Block& block, const uint32 channel, byte* destination)
+	{
+		int32 min = 255, max = 0;
+		for (const auto& texel : block) { min = GTSL::Math::Limit(min, static_cast<int32>(texel[channel])); max = GTSL::Math::Max(max, static_cast<int32>(texel[channel])); }
+
+		int32 palette[8];
+		palette[0] = max; palette[1] = min;
+		for (int32 i = 2; i < 8; ++i) { palette[i] = ((8 - i) * max + (i - 1) * min) / 7; }
+
+		uint64 indices = 0;
+
+		for (uint32 i = 0; i < 16; ++i)
+		{
+			uint64 best = 0; int32 bestDistance = 0x7FFFFFFF;
+
+			for (uint32 p = 0; p < 8; ++p)
+			{
+				const int32 distance = GTSL::Math::Abs(block[i][channel] - palette[p]);
+				if (distance < bestDistance) { bestDistance = distance; best = p; }
+			}
+
+			indices |= best << (i * 3);
+		}
+
+		destination[0] = static_cast<byte>(max); destination[1] = static_cast<byte>(min);
+		writeLittleEndian(indices, 6, destination + 2);
+	}
+
+	/**
+	 * \brief Encodes in BC7 mode 6, one subset with RGBA endpoints and 4 bit indices, which is the best fit for a single pass encoder.
+	 */
+	void compressBC7(const Block& block, byte* destination)
+	{
+		static constexpr int32 WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+		int32 endpoints[2][4] = { { 255, 255, 255, 255 }, { 0, 0, 0, 0 } };
+
+		for (const auto& texel : block) {
+			for (uint32 c = 0; c < 4; ++c) { endpoints[0][c] = GTSL::Math::Limit(endpoints[0][c], static_cast<int32>(texel[c])); endpoints[1][c] = GTSL::Math::Max(endpoints[1][c], static_cast<int32>(texel[c])); }
+		}
+
+		int32 quantized[2][4], pBits[2], palette[16][4];
+
+		for (uint32 e = 0; e < 2; ++e)
+		{
+			pBits[e] = ((endpoints[e][0] & 1) + (endpoints[e][1] & 1) + (endpoints[e][2] & 1) + (endpoints[e][3] & 1)) >= 2;
+			for (uint32 c = 0; c < 4; ++c) { quantized[e][c] = GTSL::Math::Limit((endpoints[e][c] - pBits[e] + 1) >> 1, 127); }
+		}
+
+		for (uint32 p = 0; p < 16; ++p) {
+			for (uint32 c = 0; c < 4; ++c) {
+				const int32 e0 = (quantized[0][c] << 1) | pBits[0], e1 = (quantized[1][c] << 1) | pBits[1];
+				palette[p][c] = ((64 - WEIGHTS[p]) * e0 + WEIGHTS[p] * e1 + 32) >> 6;
+			}
+		}
+
+		uint32 indices[16];
+
+		for (uint32 i = 0; i < 16; ++i)
+		{
+			uint32 best = 0; int32 bestDistance = 0x7FFFFFFF;
+
+			for (uint32 p = 0; p < 16; ++p)
+			{
+				int32 distance = 0;
+				for (uint32 c = 0; c < 4; ++c) { const int32 d = block[i][c] - palette[p][c]; distance += d * d; }
+				if (distance < bestDistance) { bestDistance = distance; best = p; }
+			}
+
+			indices[i] = best;
+		}
+
+		if (indices[0] & 8) //anchor index is stored with it's high bit implied zero, swap endpoints so it fits
+		{
+			for (uint32 c = 0; c < 4; ++c) { const auto t = quantized[0][c]; quantized[0][c] = quantized[1][c]; quantized[1][c] = t; }
+			const auto t = pBits[0]; pBits[0] = pBits[1]; pBits[1] = t;
+			for (auto& index : indices) { index = 15 - index; }
+		}
+
+		uint64 bits[2] = { 0, 0 }; uint32 position = 0;
+
+		auto write = [&](const uint64 value, const uint32 count)
+		{
+			for (uint32 i = 0; i < count; ++i, ++position) { bits[position / 64] |= ((value >> i) & 1) << (position % 64); }
+		};
+
+		write(1 << 6, 7); //mode 6
+		for (uint32 c = 0; c < 4; ++c) { write(quantized[0][c], 7); write(quantized[1][c], 7); }
+		write(pBits[0], 1); write(pBits[1], 1);
+		write(indices[0], 3);
+		for (uint32 i = 1; i < 16; ++i) { write(indices[i], 4); }
+
+		writeLittleEndian(bits[0], 8, destination);
+		writeLittleEndian(bits[1], 8, destination + 8);
+	}
+}
+
+void GenerateMip(const byte* source, const uint32 width, const uint32 height, byte* destination)
+{
+	const uint32 mipWidth = GTSL::Math::Max(width / 2, 1u), mipHeight = GTSL::Math::Max(height / 2, 1u);
+	const __m128i zero = _mm_setzero_si128(), rounding = _mm_set1_epi16(2);
+
+	for (uint32 y = 0; y < mipHeight; ++y)
+	{
+		const byte* row0 = source + GTSL::Math::Limit(y * 2, height - 1) * width * 4;
+		const byte* row1 = source + GTSL::Math::Limit(y * 2 + 1, height - 1) * width * 4;
+		byte* mipRow = destination + y * mipWidth * 4;
+
+		uint32 x = 0;
+
+		for (; x * 2 + 4 <= width && x + 2 <= mipWidth; x += 2) //2 output texels from 4x2 source texels per iteration
+		{
+			const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8));
+			const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8));
+
+			const __m128i low = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero)); //texels 0, 1
+			const __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero)); //texels 2, 3
+
+			const __m128i sum = _mm_unpacklo_epi64(_mm_add_epi16(low, _mm_srli_si128(low, 8)), _mm_add_epi16(high, _mm_srli_si128(high, 8)));
+			const __m128i average = _mm_srli_epi16(_mm_add_epi16(sum, rounding), 2);
+
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(mipRow + x * 4), _mm_packus_epi16(average, zero));
+		}
+
+		for (; x < mipWidth; ++x)
+		{
+			const uint32 x0 = GTSL::Math::Limit(x * 2, width - 1) * 4, x1 = GTSL::Math::Limit(x * 2 + 1, width - 1) * 4;
+
+			for (uint32 c = 0; c < 4; ++c) {
+				mipRow[x * 4 + c] = static_cast<byte>((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+			}
+		}
+	}
+}
+
+void CompressBlocks(const BlockCompression blockCompression, const byte* source, const uint32 width, const uint32 height, const uint32 firstBlockRow, const uint32 blockRowCount, byte* destination)
+{
+	const uint32 blocksX = GetBlockCount(width), blockSize = GetBlockSize(blockCompression);
+
+	Block block;
+
+	for (uint32 blockY = firstBlockRow; blockY < firstBlockRow + blockRowCount; ++blockY)
+	{
+		for (uint32 blockX = 0; blockX < blocksX; ++blockX)
+		{
+			loadBlock(source, width, height, blockX, blockY, block);
+			byte* blockDestination = destination + (blockY * blocksX + blockX) * blockSize;
+
+			switch (blockCompression)
+			{
+			case BlockCompression::BC1: compressBC1(block, blockDestination); break;
+			case BlockCompression::BC3: compressBC4(block, 3, blockDestination); compressBC1(block, blockDestination + 8); break;
+			case BlockCompression::BC5: compressBC4(block, 0, blockDestination); compressBC4(block, 1, blockDestination + 8); break;
+			case BlockCompression::BC7: compressBC7(block, blockDestination); break;
+			default: break;
+			}
+		}
+	}
+}
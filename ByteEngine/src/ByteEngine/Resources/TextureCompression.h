@@ -0,0 +1,64 @@
+#pragma once
+
+#include <GTSL/Math/Math.hpp>
+
+#include "ByteEngine/Core.h"
+
+/**
+ * \brief Block compressed formats textures can be packaged in. All of them encode 4x4 texel blocks.
+ */
+enum class BlockCompression : uint8
+{
+	NONE, BC1, BC3, BC5, BC7
+};
+
+/**
+ * \brief Returns the amount of bytes one 4x4 block takes in the specified format.
+ */
+inline uint32 GetBlockSize(const BlockCompression blockCompression)
+{
+	switch (blockCompression)
+	{
+	case BlockCompression::BC1: return 8;
+	case BlockCompression::BC3: return 16;
+	case BlockCompression::BC5: return 16;
+	case BlockCompression::BC7: return 16;
+	default: return 0;
+	}
+}
+
+inline uint32 GetBlockCount(const uint32 texels) { return (texels + 3) / 4; }
+
+/**
+ * \brief Returns the amount of bytes an image of the specified extent takes when compressed. Partial blocks at the edges take a whole block.
+ */
+inline uint32 GetCompressedSize(const BlockCompression blockCompression, const uint32 width, const uint32 height)
+{
+	return GetBlockCount(width) * GetBlockCount(height) * GetBlockSize(blockCompression);
+}
+
+/**
+ * \brief Returns the number of levels in a full mip chain, down to and including the 1x1 level.
+ */
+inline uint8 GetMipLevelCount(uint32 width, uint32 height)
+{
+	uint8 levels = 1;
+	while (width > 1 || height > 1) { width = GTSL::Math::Max(width / 2, 1u); height = GTSL::Math::Max(height / 2, 1u); ++levels; }
+	return levels;
+}
+
+inline uint32 GetMipDimension(const uint32 dimension, const uint8 mip) { return GTSL::Math::Max(dimension >> mip, 1u); }
+
+/**
+ * \brief Generates the next mip of an RGBA8 image with a 2x2 box filter. Odd dimensions clamp to the last row or column.
+ * \param source Image of width x height texels.
+ * \param destination Image of the next mip's dimensions.
+ */
+void GenerateMip(const byte* source, uint32 width, uint32 height, byte* destination);
+
+/**
+ * \brief Compresses a range of block rows of an RGBA8 image. Rows of blocks are written contiguously, so disjoint ranges can be compressed in parallel.
+ * \param source Image of width x height texels.
+ * \param destination Start of the compressed image, the first block row written is firstBlockRow.
+ */
+void CompressBlocks(BlockCompression blockCompression, const byte* source, uint32 width, uint32 height, uint32 firstBlockRow, uint32 blockRowCount, byte* destination);
@@ -6,14 +6,16 @@
 #include <GTSL/File.h>
 #include <GTSL/Filesystem.h>
 #include <GTSL/Serialize.h>
+#include <GTSL/Semaphore.h>
 
 #include "ByteEngine/Application/Application.h"
+#include "ByteEngine/Application/ThreadPool.h"
 #include "ByteEngine/Debug/Assert.h"
 #include "ByteEngine/Game/GameInstance.h"
 
 #undef Extract
 
-TextureResourceManager::TextureResourceManager() : ResourceManager("TextureResourceManager"), textureInfos(8, 0.25, GetPersistentAllocator())
+TextureResourceManager::TextureResourceManager() : ResourceManager("TextureResourceManager"), textureInfos(GetPersistentAllocator())
 {
 	GTSL::StaticString<512> query_path, resources_path;
 	query_path += BE::Application::Get()->GetPathToApplication();
@@ -23,16 +25,10 @@ TextureResourceManager::TextureResourceManager() : ResourceManager("TextureResou
 	auto index_path = GetResourcePath(GTSL::ShortString<32>("Textures.beidx"));
 	auto package_path = GetResourcePath(GTSL::ShortString<32>("Textures.bepkg"));
 
-	indexFile.OpenFile(index_path, GTSL::File::AccessMode::WRITE | GTSL::File::AccessMode::READ);
-	
-	GTSL::Buffer<BE::TAR> indexFileBuffer; indexFileBuffer.Allocate(2048 * 2048 * 3, 32, GetTransientAllocator());
-
-	if (indexFile.ReadFile(indexFileBuffer.GetBufferInterface()))
-	{
-		GTSL::Extract(textureInfos, indexFileBuffer);
-	}
-	else
+	if (!textureInfos.Open(index_path))
 	{
+		ResourceIndexBuilder<TextureDataSerialize> textureInfosBuilder(8, GetTransientAllocator());
+		
 		GTSL::File packageFile; packageFile.OpenFile(package_path, GTSL::File::AccessMode::WRITE | GTSL::File::AccessMode::READ);
 
 		auto load = [&](const GTSL::FileQuery::QueryResult& queryResult)
@@ -42,43 +38,32 @@ TextureResourceManager::TextureResourceManager() : ResourceManager("TextureResou
 			auto name = queryResult.FileNameWithExtension; name.Drop(name.FindLast('.').Get());
 			const auto hashed_name = GTSL::Id64(name);
 
-			if (!textureInfos.Find(hashed_name))
+			if (!textureInfosBuilder.Find(hashed_name))
 			{
-				GTSL::File query_file;
-				query_file.OpenFile(file_path, GTSL::File::AccessMode::READ); GTSL::Buffer<BE::TAR> textureBuffer; textureBuffer.Allocate(query_file.GetFileSize(), 8, GetTransientAllocator());
-
-				query_file.ReadFile(textureBuffer.GetBufferInterface());
-
-				int32 x, y, channel_count = 0;
-				stbi_info_from_memory(textureBuffer.GetData(), textureBuffer.GetLength(), &x, &y, &channel_count);
-				auto finalChannelCount = GTSL::NextPowerOfTwo(static_cast<uint32>(channel_count));
-				auto* const data = stbi_load_from_memory(textureBuffer.GetData(), textureBuffer.GetLength(), &x, &y, &channel_count, finalChannelCount);
-
 				TextureInfo texture_info;
+				GTSL::Buffer<BE::TAR> textureData;
 
-				texture_info.Format = GAL::FormatDescriptor(GAL::ComponentType::INT, finalChannelCount, 8, GAL::TextureType::COLOR, 0, 1, 2, 3);
+				importTexture(file_path, texture_info, textureData, true);
 
 				texture_info.ByteOffset = static_cast<uint32>(packageFile.GetFileSize());
+				packageFile.WriteToFile(GTSL::Range<const byte*>(textureData.GetLength(), textureData.GetData()));
 
-				const uint32 size = static_cast<uint32>(x) * y * finalChannelCount;
-
-				texture_info.Dimensions = GAL::Dimension::SQUARE;
-				texture_info.Extent = { static_cast<uint16>(x), static_cast<uint16>(y), 1 };
-
-				packageFile.WriteToFile(GTSL::Range<byte*>(size, data));
-
-				textureInfos.Emplace(hashed_name, texture_info);
-
-				stbi_image_free(data);
+				textureInfosBuilder.Emplace(hashed_name, texture_info);
 			}
 		};
 
 		GTSL::FileQuery file_query(query_path);
 		GTSL::ForEach(file_query, load);
 
-		indexFileBuffer.Resize(0);
-		Insert(textureInfos, indexFileBuffer);
-		indexFile.WriteToFile(indexFileBuffer);
+		GTSL::Buffer<BE::TAR> indexFileBuffer; indexFileBuffer.Allocate(textureInfosBuilder.GetFileSize(), 32, GetTransientAllocator());
+		textureInfosBuilder.Write(indexFileBuffer);
+
+		{
+			GTSL::File indexFile; indexFile.OpenFile(index_path, GTSL::File::AccessMode::WRITE);
+			indexFile.WriteToFile(indexFileBuffer);
+		}
+
+		textureInfos.Open(index_path);
 	}
 		
 	initializePackageFiles(package_path);
@@ -86,4 +71,133 @@ TextureResourceManager::TextureResourceManager() : ResourceManager("TextureResou
 
 TextureResourceManager::~TextureResourceManager()
 {
+	textureInfos.Flush(GetTransientAllocator());
+}
+
+bool TextureResourceManager::ReloadResource(GameInstance* gameInstance, const utf8* fileName)
+{
+	GTSL::StaticString<256> name;
+	if (!parseFileName(fileName, ".png", name)) { return false; }
+
+	auto reloadTexture = [](TaskInfo taskInfo, TextureResourceManager* resourceManager, GTSL::StaticString<256> name)
+	{
+		auto filePath = resourceManager->GetResourcePath(name); filePath += ".png";
+
+		TextureInfo textureInfo;
+		GTSL::Buffer<BE::TAR> textureData;
+		resourceManager->importTexture(filePath, textureInfo, textureData, false); //reload tasks run on the thread pool
+
+		textureInfo.ByteOffset = resourceManager->appendToPackage(GTSL::Range<const byte*>(textureData.GetLength(), textureData.GetData()));
+		resourceManager->textureInfos.Update(Id(name.begin()), textureInfo);
+
+		taskInfo.GameInstance->DispatchEvent("TextureResourceManager", GetOnTextureReloadEventHandle(), Id(name.begin()));
+	};
+
+	//runs within a frame so the transient allocations made while importing stay valid
+	gameInstance->AddDynamicTask("reloadTexture", Task<TextureResourceManager*, GTSL::StaticString<256>>::Create(reloadTexture), {}, "FrameStart", "FrameEnd", this, GTSL::MoveRef(name));
+	return true;
+}
+
+bool TextureResourceManager::getPackageRange(const Id name, uint32& byteOffset, uint32& size)
+{
+	if (!textureInfos.Find(name)) { return false; }
+	
+	TextureInfo textureInfo(name, textureInfos.At(name));
+	byteOffset = textureInfo.ByteOffset; size = textureInfo.GetTextureSize(); //only mip 0 is loaded
+	return true;
+}
+
+void TextureResourceManager::importTexture(const GTSL::Range<const utf8*> filePath, TextureInfo& textureInfo, GTSL::Buffer<BE::TAR>& textureData, const bool parallel)
+{
+	GTSL::File query_file;
+	query_file.OpenFile(filePath, GTSL::File::AccessMode::READ); GTSL::Buffer<BE::TAR> textureBuffer; textureBuffer.Allocate(query_file.GetFileSize(), 8, GetTransientAllocator());
+
+	query_file.ReadFile(textureBuffer.GetBufferInterface());
+
+	int32 x, y, channel_count = 0;
+	stbi_info_from_memory(textureBuffer.GetData(), textureBuffer.GetLength(), &x, &y, &channel_count);
+	auto* const data = stbi_load_from_memory(textureBuffer.GetData(), textureBuffer.GetLength(), &x, &y, &channel_count, 4); //encoders always take RGBA8
+
+	textureInfo.Format = GAL::FormatDescriptor(GAL::ComponentType::INT, 4, 8, GAL::TextureType::COLOR, 0, 1, 2, 3);
+	textureInfo.Dimensions = GAL::Dimension::SQUARE;
+	textureInfo.Extent = { static_cast<uint16>(x), static_cast<uint16>(y), 1 };
+	textureInfo.MipLevels = GetMipLevelCount(x, y);
+
+	switch (channel_count)
+	{
+	case 2: //two channel data is stored as RG
+	{
+		for (uint32 i = 0; i < static_cast<uint32>(x * y); ++i) { data[i * 4 + 1] = data[i * 4 + 3]; }
+		textureInfo.Compression = BlockCompression::BC5;
+		break;
+	}
+	case 4: textureInfo.Compression = BlockCompression::BC7; break;
+	default: textureInfo.Compression = BlockCompression::BC1; break;
+	}
+
+	uint32 mipChainSize = 0, packageSize = 0;
+	for (uint8 m = 0; m < textureInfo.MipLevels; ++m) {
+		mipChainSize += GetMipDimension(x, m) * GetMipDimension(y, m) * 4;
+		packageSize += textureInfo.GetMipSize(m);
+	}
+
+	GTSL::Buffer<BE::TAR> mipChain; mipChain.Allocate(mipChainSize, 16, GetTransientAllocator());
+	textureData.Allocate(packageSize, 16, GetTransientAllocator());
+
+	GTSL::MemCopy(x * y * 4, data, mipChain.GetData());
+
+	{
+		byte* mip = mipChain.GetData();
+		
+		for (uint8 m = 1; m < textureInfo.MipLevels; ++m) {
+			byte* nextMip = mip + GetMipDimension(x, m - 1) * GetMipDimension(y, m - 1) * 4;
+			GenerateMip(mip, GetMipDimension(x, m - 1), GetMipDimension(y, m - 1), nextMip);
+			mip = nextMip;
+		}
+	}
+
+	compressMipChain(textureInfo, mipChain.GetData(), textureData.GetData(), parallel);
+	textureData.Resize(packageSize);
+
+	stbi_image_free(data);
+}
+
+void TextureResourceManager::compressMipChain(TextureInfo& textureInfo, const byte* mipChain, byte* destination, const bool parallel)
+{
+	struct CompressionJob
+	{
+		const byte* Source; byte* Destination;
+		uint32 Width, Height, FirstBlockRow, BlockRowCount;
+		BlockCompression Compression;
+		GTSL::Semaphore* Done;
+	};
+
+	GTSL::Semaphore done;
+	GTSL::Vector<CompressionJob, BE::TAR> jobs(32, GetTransientAllocator());
+
+	for (uint8 m = 0; m < textureInfo.MipLevels; ++m)
+	{
+		const auto width = GetMipDimension(textureInfo.Extent.Width, m), height = GetMipDimension(textureInfo.Extent.Height, m);
+		
+		for (uint32 row = 0; row < GetBlockCount(height); row += BLOCK_ROWS_PER_JOB) {
+			jobs.EmplaceBack(CompressionJob{ mipChain, destination + textureInfo.GetMipOffset(m), width, height, row, GTSL::Math::Limit(BLOCK_ROWS_PER_JOB, GetBlockCount(height) - row), textureInfo.Compression, &done });
+		}
+
+		mipChain += width * height * 4;
+	}
+
+	auto compress = [](CompressionJob* job)
+	{
+		CompressBlocks(job->Compression, job->Source, job->Width, job->Height, job->FirstBlockRow, job->BlockRowCount, job->Destination);
+		job->Done->Post();
+	};
+
+	if (!parallel) {
+		for (auto& job : jobs) { compress(&job); }
+		return; //posts are never waited on
+	}
+
+	auto* threadPool = BE::Application::Get()->GetThreadPool();
+	for (auto& job : jobs) { threadPool->EnqueueTask(GTSL::Delegate<void(CompressionJob*)>::Create(compress), &job); }
+	for (uint32 i = 0; i < jobs.GetLength(); ++i) { done.Wait(); }
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "ResourceIndex.h"
 #include "ResourceManager.h"
 
 #include <GTSL/Extent.h>
@@ -8,6 +9,7 @@
 #include <GTSL/File.h>
 #include <GTSL/FlatHashMap.h>
 
+#include "TextureCompression.h"
 #include "ByteEngine/Game/GameInstance.h"
 
 class TextureResourceManager final : public ResourceManager
@@ -15,12 +17,27 @@ class TextureResourceManager final : public ResourceManager
 public:
 	TextureResourceManager();
 	~TextureResourceManager();
+
+	/**
+	 * \brief Dispatched with a texture's name after it has been re-imported from it's source file. Already loaded copies of it are stale.
+	 */
+	static auto GetOnTextureReloadEventHandle() { return EventHandle<Id>("OnTextureReload"); }
+
+	bool ReloadResource(GameInstance* gameInstance, const utf8* fileName) override;
 	
 	struct TextureData : Data
 	{
 		GAL::Dimension Dimensions;
 		GTSL::Extent3D Extent;
 		GAL::FormatDescriptor Format;
+		/**
+		 * \brief Block compression the texture is stored with in the package. If not NONE Format describes the texels before compression.
+		 */
+		BlockCompression Compression = BlockCompression::NONE;
+		/**
+		 * \brief Number of mips stored in the package, starting at ByteOffset with mip 0 and placed one after the other.
+		 */
+		uint8 MipLevels = 1;
 	};
 	
 	struct TextureDataSerialize : DataSerialize<TextureData>
@@ -31,6 +48,8 @@ public:
 			Insert(insertInfo.Dimensions, buffer);
 			Insert(insertInfo.Extent, buffer);
 			Insert(insertInfo.Format, buffer);
+			Insert(insertInfo.Compression, buffer);
+			Insert(insertInfo.MipLevels, buffer);
 		}
 
 		EXTRACT_START(TextureDataSerialize)
@@ -39,6 +58,8 @@ public:
 			Extract(extractInfo.Dimensions, buffer);
 			Extract(extractInfo.Extent, buffer);
 			Extract(extractInfo.Format, buffer);
+			Extract(extractInfo.Compression, buffer);
+			Extract(extractInfo.MipLevels, buffer);
 		}
 	};
 
@@ -46,10 +67,24 @@ public:
 	{
 		DECL_INFO_CONSTRUCTOR(TextureInfo, Info<TextureDataSerialize>)
 		
-		uint32 GetTextureSize()
+		uint32 GetMipSize(const uint8 mip)
+		{
+			const auto width = GetMipDimension(Extent.Width, mip), height = GetMipDimension(Extent.Height, mip);
+			if (Compression != BlockCompression::NONE) { return GetCompressedSize(Compression, width, height) * Extent.Depth; }
+			return Format.GetSize() * width * height * Extent.Depth;
+		}
+
+		uint32 GetMipOffset(const uint8 mip)
 		{
-			return Format.GetSize() * Extent.Width * Extent.Height * Extent.Depth;
+			uint32 offset = 0;
+			for (uint8 i = 0; i < mip; ++i) { offset += GetMipSize(i); }
+			return offset;
 		}
+
+		/**
+		 * \brief Returns the size of mip 0, which is what LoadTexture reads.
+		 */
+		uint32 GetTextureSize() { return GetMipSize(0); }
 	};
 	
 	template<typename... ARGS>
@@ -57,6 +92,7 @@ public:
 	{
 		auto loadTextureInfo = [](TaskInfo taskInfo, TextureResourceManager* resourceManager, Id textureName, decltype(dynamicTaskHandle) dynamicTaskHandle, ARGS&&... args)
 		{
+			resourceManager->recordLoad(textureName);
 			auto textureInfoSerialize = resourceManager->textureInfos.At(textureName);
 
 			TextureInfo textureInfo(textureName, textureInfoSerialize);
@@ -72,8 +108,7 @@ public:
 	{
 		auto loadTexture = [](TaskInfo taskInfo, TextureResourceManager* resourceManager, TextureInfo textureInfo, GTSL::Range<byte*> buffer, decltype(dynamicTaskHandle) dynamicTaskHandle, ARGS&&... args)
 		{
-			resourceManager->packageFiles[resourceManager->getThread()].SetPointer(textureInfo.ByteOffset, GTSL::File::MoveFrom::BEGIN);
-			resourceManager->packageFiles[resourceManager->getThread()].ReadFromFile(GTSL::Range<byte*>(textureInfo.GetTextureSize(), buffer.begin()));
+			resourceManager->readPackage(textureInfo.ByteOffset, GTSL::Range<byte*>(textureInfo.GetTextureSize(), buffer.begin()));
 			
 			taskInfo.GameInstance->AddStoredDynamicTask(dynamicTaskHandle, GTSL::MoveRef(resourceManager), GTSL::MoveRef(textureInfo), GTSL::ForwardRef<ARGS>(args)...);
 		};
@@ -82,6 +117,21 @@ public:
 	}
 
 private:
-	GTSL::File indexFile;
-	GTSL::FlatHashMap<Id, TextureDataSerialize, BE::PersistentAllocatorReference> textureInfos;
+	static constexpr uint32 BLOCK_ROWS_PER_JOB = 16;
+	
+	ReloadableResourceIndex<TextureDataSerialize> textureInfos;
+
+	bool getPackageRange(Id name, uint32& byteOffset, uint32& size) override;
+
+	/**
+	 * \brief Decodes a source image and builds it's block compressed mip chain, ready to be written to the package. ByteOffset is left for the caller to set.
+	 * \param parallel Whether to compress on the thread pool, see compressMipChain.
+	 */
+	void importTexture(GTSL::Range<const utf8*> filePath, TextureInfo& textureInfo, GTSL::Buffer<BE::TAR>& textureData, bool parallel);
+
+	/**
+	 * \brief Compresses every mip of an RGBA8 mip chain, splitting mips in rows of blocks.
+	 * \param parallel Whether to encode the rows in parallel on the thread pool. Tasks running on the pool compress on their own thread, as waiting on jobs queued behind them could deadlock.
+	 */
+	void compressMipChain(TextureInfo& textureInfo, const byte* mipChain, byte* destination, bool parallel);
 };
\ No newline at end of file
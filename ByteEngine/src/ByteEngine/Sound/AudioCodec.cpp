@@ -0,0 +1,134 @@
+#include "AudioCodec.h"
+
+#include <cmath>
+#include <emmintrin.h>
+
+#include <GTSL/Memory.h>
+#include <GTSL/Math/Math.hpp>
+
+namespace
+{
+	constexpr int32 STEPS[89] = {
+		7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+		253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+		3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+	};
+
+	constexpr int32 INDEX_ADJUSTMENTS[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+	constexpr int32 MAX_STEP_INDEX = 88;
+
+	struct ChannelState { int32 Predictor = 0, StepIndex = 0; };
+
+	uint8 encodeSample(ChannelState& state, const int32 sample)
+	{
+		int32 step = STEPS[state.StepIndex], difference = sample - state.Predictor;
+		uint8 nibble = 0;
+		if (difference < 0) { nibble = 8; difference = -difference; }
+
+		//the decoder rebuilds the difference from the nibble, predict what it will get so errors don't accumulate
+		int32 delta = step >> 3;
+		if (difference >= step) { nibble |= 4; difference -= step; delta += step; }
+		step >>= 1;
+		if (difference >= step) { nibble |= 2; difference -= step; delta += step; }
+		step >>= 1;
+		if (difference >= step) { nibble |= 1; delta += step; }
+
+		state.Predictor = GTSL::Math::Clamp(state.Predictor + (nibble & 8 ? -delta : delta), -32768, 32767);
+		state.StepIndex = GTSL::Math::Clamp(state.StepIndex + INDEX_ADJUSTMENTS[nibble & 7], 0, MAX_STEP_INDEX);
+		return nibble;
+	}
+
+	int32 toInt16(const float32 sample) { return GTSL::Math::Clamp(static_cast<int32>(std::lrintf(sample * 32768.0f)), -32768, 32767); }
+
+	void write16(byte* data, const int32 value) { data[0] = static_cast<byte>(value); data[1] = static_cast<byte>(value >> 8); }
+	int32 read16(const byte* data) { return static_cast<int16>(data[0] | data[1] << 8); }
+
+	/**
+	 * \brief Decodes a whole group into ADPCM_GROUP_FRAMES frames.
+	 */
+	void decodeGroup(const byte* group, float32* samples)
+	{
+		__m128i predictor = _mm_setr_epi32(read16(group), read16(group + 4), read16(group + 8), read16(group + 12));
+		__m128i stepIndex = _mm_setr_epi32(read16(group + 2), read16(group + 6), read16(group + 10), read16(group + 14));
+
+		const __m128i one = _mm_set1_epi32(1), two = _mm_set1_epi32(2), three = _mm_set1_epi32(3), four = _mm_set1_epi32(4), eight = _mm_set1_epi32(8);
+		const __m128i maxStepIndex = _mm_set1_epi32(MAX_STEP_INDEX);
+		const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+
+		alignas(16) int32 indices[4];
+
+		//lanes are 0 left and 1 right of the first block, 2 left and 3 right of the second
+		float32* first = samples; float32* second = samples + ADPCM_BLOCK_FRAMES * MIX_CHANNELS;
+		const byte* nibbles = group + 16;
+
+		for (uint32 f = 0; f < ADPCM_BLOCK_FRAMES; ++f)
+		{
+			const uint32 low = nibbles[f * 2], high = nibbles[f * 2 + 1];
+			const __m128i nibble = _mm_setr_epi32(low & 15, low >> 4, high & 15, high >> 4);
+
+			//SSE2 can't gather, the step table is read per lane
+			_mm_store_si128(reinterpret_cast<__m128i*>(indices), stepIndex);
+			const __m128i step = _mm_setr_epi32(STEPS[indices[0]], STEPS[indices[1]], STEPS[indices[2]], STEPS[indices[3]]);
+
+			__m128i delta = _mm_srai_epi32(step, 3);
+			delta = _mm_add_epi32(delta, _mm_and_si128(_mm_cmpeq_epi32(_mm_and_si128(nibble, four), four), step));
+			delta = _mm_add_epi32(delta, _mm_and_si128(_mm_cmpeq_epi32(_mm_and_si128(nibble, two), two), _mm_srai_epi32(step, 1)));
+			delta = _mm_add_epi32(delta, _mm_and_si128(_mm_cmpeq_epi32(_mm_and_si128(nibble, one), one), _mm_srai_epi32(step, 2)));
+
+			const __m128i negative = _mm_cmpeq_epi32(_mm_and_si128(nibble, eight), eight);
+			predictor = _mm_add_epi32(predictor, _mm_sub_epi32(_mm_xor_si128(delta, negative), negative));
+
+			//saturate to 16 bits and sign extend back
+			const __m128i packed = _mm_packs_epi32(predictor, predictor);
+			predictor = _mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16);
+
+			//index moves by -1 for the 3 lower bits under 4 and by 2, 4, 6 or 8 above
+			const __m128i up = _mm_cmpeq_epi32(_mm_and_si128(nibble, four), four);
+			const __m128i adjustment = _mm_or_si128(_mm_and_si128(up, _mm_slli_epi32(_mm_add_epi32(_mm_and_si128(nibble, three), one), 1)), _mm_andnot_si128(up, _mm_set1_epi32(-1)));
+			stepIndex = _mm_add_epi32(stepIndex, adjustment);
+			stepIndex = _mm_max_epi16(_mm_min_epi16(stepIndex, maxStepIndex), _mm_setzero_si128()); //indices stay small, 16 bit comparisons clamp them
+
+			const __m128 result = _mm_mul_ps(_mm_cvtepi32_ps(predictor), scale);
+			_mm_storel_pi(reinterpret_cast<__m64*>(first + f * MIX_CHANNELS), result); _mm_storeh_pi(reinterpret_cast<__m64*>(second + f * MIX_CHANNELS), result);
+		}
+	}
+}
+
+void EncodeADPCM(const float32* samples, const uint32 frames, byte* data)
+{
+	ChannelState states[MIX_CHANNELS];
+	if (frames) { for (uint8 c = 0; c < MIX_CHANNELS; ++c) { states[c].Predictor = toInt16(samples[c]); } } //start on the sound instead of ramping up from silence
+	const uint32 blocks = (frames + ADPCM_GROUP_FRAMES - 1) / ADPCM_GROUP_FRAMES * 2;
+
+	for (uint32 b = 0; b < blocks; ++b)
+	{
+		byte* group = data + b / 2 * ADPCM_GROUP_BYTES;
+		const uint32 lane = b % 2 * MIX_CHANNELS;
+
+		for (uint8 c = 0; c < MIX_CHANNELS; ++c) { write16(group + (lane + c) * 4, states[c].Predictor); write16(group + (lane + c) * 4 + 2, states[c].StepIndex); }
+
+		for (uint32 f = 0; f < ADPCM_BLOCK_FRAMES; ++f)
+		{
+			const uint32 frame = b * ADPCM_BLOCK_FRAMES + f;
+			byte& nibbles = group[16 + f * 2 + b % 2];
+
+			const uint8 left = encodeSample(states[0], frame < frames ? toInt16(samples[frame * MIX_CHANNELS]) : 0);
+			const uint8 right = encodeSample(states[1], frame < frames ? toInt16(samples[frame * MIX_CHANNELS + 1]) : 0);
+			nibbles = static_cast<byte>(left | right << 4);
+		}
+	}
+}
+
+void DecodeADPCM(const byte* data, const uint32 frames, float32* samples)
+{
+	uint32 f = 0;
+
+	for (; f + ADPCM_GROUP_FRAMES <= frames; f += ADPCM_GROUP_FRAMES, data += ADPCM_GROUP_BYTES) { decodeGroup(data, samples + f * MIX_CHANNELS); }
+
+	if (f < frames) { //last group is partial
+		alignas(16) float32 group[ADPCM_GROUP_FRAMES * MIX_CHANNELS];
+		decodeGroup(data, group);
+		GTSL::MemCopy((frames - f) * MIX_FRAME_SIZE, group, samples + f * MIX_CHANNELS);
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "ByteEngine/Core.h"
+
+#include "AudioMixing.h"
+
+/**
+ * \brief Encodings sounds are stored in packages with. Both decode to the mix format.
+ */
+enum class AudioCodec : uint8
+{
+	/**
+	 * \brief Samples in the mix format as they are.
+	 */
+	PCM,
+	/**
+	 * \brief IMA ADPCM, 4 bits per sample, 8 times smaller than the mix format.
+	 */
+	ADPCM
+};
+
+static constexpr uint8 AUDIO_CODEC_COUNT = 2;
+
+/**
+ * \brief ADPCM is stored in groups of 4 independent lanes, so 4 of them decode at once with SSE. A lane holds one channel of a block of ADPCM_BLOCK_FRAMES frames,
+ * a group holds the left and right channels of 2 consecutive blocks. A group starts with every lane's predictor and step index as int16s, then for every
+ * frame of a block lane 0 and 1's nibbles in a byte followed by lane 2 and 3's. Blocks continue their channel's state from the previous block, so
+ * splitting sounds in blocks costs no quality and any group can be decoded on it's own.
+ */
+static constexpr uint32 ADPCM_BLOCK_FRAMES = 1024, ADPCM_GROUP_FRAMES = ADPCM_BLOCK_FRAMES * 2, ADPCM_GROUP_BYTES = 16 + ADPCM_BLOCK_FRAMES * 2;
+
+[[nodiscard]] inline uint32 GetADPCMSize(const uint32 frames) { return (frames + ADPCM_GROUP_FRAMES - 1) / ADPCM_GROUP_FRAMES * ADPCM_GROUP_BYTES; }
+
+/**
+ * \brief Encodes frames frames in the mix format.
+ * \param data Room for GetADPCMSize(frames) bytes. Frames past the end of the last group are encoded as silence.
+ */
+void EncodeADPCM(const float32* samples, uint32 frames, byte* data);
+
+/**
+ * \brief Decodes frames frames to the mix format, starting at the beginning of data's first group.
+ */
+void DecodeADPCM(const byte* data, uint32 frames, float32* samples);
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+
+#include "ByteEngine/Core.h"
+
+/**
+ * \brief Fixed capacity ring for exactly one producer thread and one consumer thread. Push and Pop never lock or allocate, so the audio thread
+ * can use it without waiting on gameplay code.
+ * \tparam CAPACITY Must be a power of two.
+ */
+template<typename T, uint32 CAPACITY>
+class SPSCQueue
+{
+	static_assert((CAPACITY & (CAPACITY - 1)) == 0, "Capacity must be a power of two!");
+public:
+	/**
+	 * \brief Only call from the producer thread.
+	 * \return False if the queue is full, the element is not added.
+	 */
+	bool Push(const T& element)
+	{
+		const uint32 currentTail = tail.load(std::memory_order_relaxed);
+		if (currentTail - head.load(std::memory_order_acquire) == CAPACITY) { return false; }
+
+		elements[currentTail & (CAPACITY - 1)] = element;
+		tail.store(currentTail + 1, std::memory_order_release); //publishes the element to the consumer
+		return true;
+	}
+
+	/**
+	 * \brief Only call from the consumer thread.
+	 * \return False if the queue is empty.
+	 */
+	bool Pop(T& element)
+	{
+		const uint32 currentHead = head.load(std::memory_order_relaxed);
+		if (currentHead == tail.load(std::memory_order_acquire)) { return false; }
+
+		element = elements[currentHead & (CAPACITY - 1)];
+		head.store(currentHead + 1, std::memory_order_release); //hands the slot back to the producer
+		return true;
+	}
+
+private:
+	//indices only ever increase and wrap around on overflow, they are kept on separate cache lines so each thread only writes to it's own
+	alignas(64) std::atomic<uint32> head{ 0 };
+	alignas(64) std::atomic<uint32> tail{ 0 };
+	T elements[CAPACITY];
+};
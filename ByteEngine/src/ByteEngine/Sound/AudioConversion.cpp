@@ -0,0 +1,132 @@
+#include "AudioConversion.h"
+
+#include <cmath>
+#include <emmintrin.h>
+
+#include <GTSL/Memory.h>
+#include <GTSL/Math/Math.hpp>
+
+namespace
+{
+	/**
+	 * \brief Filter taps per phase, half before and half after the output position. Multiple of 4 so every phase is a whole number of SSE loads.
+	 */
+	constexpr uint32 TAPS = 32;
+
+	/**
+	 * \brief Conversions between rates with a large common period, like 44.1 to 47.9 kHz, use the nearest of this many phases.
+	 */
+	constexpr uint32 MAX_PHASES = 1024;
+
+	constexpr float32 PI = 3.14159265358979f;
+
+	uint32 greatestCommonDivisor(uint32 a, uint32 b)
+	{
+		while (b) { const uint32 remainder = a % b; a = b; b = remainder; }
+		return a;
+	}
+
+	float32 loadSample(const byte* sample, const SampleFormat sampleFormat, const uint8 bitDepth)
+	{
+		if (sampleFormat == SampleFormat::FLOAT) { float32 value; GTSL::MemCopy(sizeof(float32), sample, &value); return value; }
+
+		switch (bitDepth)
+		{
+		case 8: return (static_cast<float32>(sample[0]) - 128.0f) / 128.0f; //8 bit wav is unsigned
+		case 16: { int16 value; GTSL::MemCopy(sizeof(int16), sample, &value); return static_cast<float32>(value) / 32768.0f; }
+		case 24: return static_cast<float32>(static_cast<int32>(static_cast<uint32>(sample[0]) << 8 | static_cast<uint32>(sample[1]) << 16 | static_cast<uint32>(sample[2]) << 24) >> 8) / 8388608.0f;
+		case 32: { int32 value; GTSL::MemCopy(sizeof(int32), sample, &value); return static_cast<float32>(value) / 2147483648.0f; }
+		default: return 0.0f;
+		}
+	}
+
+	/**
+	 * \brief Returns the sum of the products of TAPS samples and filter taps. filter must be 16 byte aligned.
+	 */
+	float32 convolve(const float32* samples, const float32* filter)
+	{
+		__m128 sum = _mm_setzero_ps();
+		for (uint32 t = 0; t < TAPS; t += 4) { sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(samples + t), _mm_load_ps(filter + t))); }
+
+		sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+		sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 1, 1, 1)));
+		return _mm_cvtss_f32(sum);
+	}
+}
+
+void ConvertToFloat32(const byte* source, const SampleFormat sampleFormat, const uint8 bitDepth, const uint8 sourceChannels, const uint32 frames, const uint8 outputChannels, float32* output)
+{
+	const uint32 sampleSize = bitDepth / 8;
+
+	for (uint32 f = 0; f < frames; ++f)
+	{
+		for (uint8 c = 0; c < outputChannels; ++c)
+		{
+			const uint8 sourceChannel = sourceChannels == 1 ? 0 : c;
+			output[f * outputChannels + c] = sourceChannel < sourceChannels ? loadSample(source + (f * sourceChannels + sourceChannel) * sampleSize, sampleFormat, bitDepth) : 0.0f;
+		}
+	}
+}
+
+uint32 GetResampledFrameCount(const uint32 frames, const uint32 sourceRate, const uint32 targetRate)
+{
+	if (sourceRate == targetRate) { return frames; }
+
+	const uint32 divisor = greatestCommonDivisor(sourceRate, targetRate);
+	const uint64 upFactor = targetRate / divisor, downFactor = sourceRate / divisor;
+	return static_cast<uint32>((frames * upFactor + downFactor - 1) / downFactor);
+}
+
+void Resample(const float32* source, const uint32 frames, const uint8 channels, const uint32 sourceRate, const uint32 targetRate, float32* output, const BE::TAR& allocator)
+{
+	if (sourceRate == targetRate) { GTSL::MemCopy(frames * channels * sizeof(float32), source, output); return; }
+
+	//output frame n sits at source position n * downFactor / upFactor, the fractional part of that position selects one of upFactor filter phases
+	const uint32 divisor = greatestCommonDivisor(sourceRate, targetRate);
+	const uint32 upFactor = targetRate / divisor, downFactor = sourceRate / divisor;
+	const uint32 phases = GTSL::Math::Limit(upFactor, MAX_PHASES);
+	const uint32 outputFrames = GetResampledFrameCount(frames, sourceRate, targetRate);
+
+	GTSL::Buffer<BE::TAR> filterBuffer; filterBuffer.Allocate(phases * TAPS * sizeof(float32), 16, allocator);
+	auto* filters = reinterpret_cast<float32*>(filterBuffer.GetData());
+
+	{
+		//cutoff in cycles per source sample, a bit below the lowest Nyquist frequency to leave room for the transition band
+		const float32 cutoff = 0.5f * 0.95f * (targetRate < sourceRate ? static_cast<float32>(targetRate) / static_cast<float32>(sourceRate) : 1.0f);
+
+		for (uint32 p = 0; p < phases; ++p)
+		{
+			float32* filter = filters + p * TAPS; float32 sum = 0.0f;
+
+			for (uint32 t = 0; t < TAPS; ++t)
+			{
+				const float32 distance = static_cast<float32>(p) / static_cast<float32>(phases) + static_cast<float32>(TAPS / 2 - 1) - static_cast<float32>(t); //from tap's sample to output position
+				const float32 x = PI * 2.0f * cutoff * distance;
+				const float32 sinc = distance == 0.0f ? 1.0f : std::sin(x) / x;
+				const float32 window = 0.42f + 0.5f * std::cos(2.0f * PI * distance / TAPS) + 0.08f * std::cos(4.0f * PI * distance / TAPS); //Blackman
+				sum += filter[t] = sinc * window;
+			}
+
+			for (uint32 t = 0; t < TAPS; ++t) { filter[t] /= sum; } //unity gain at DC for every phase
+		}
+	}
+
+	//one channel at a time, deinterleaved and padded with silence so taps past either end read zeros
+	GTSL::Buffer<BE::TAR> channelBuffer; channelBuffer.Allocate((frames + TAPS) * sizeof(float32), 16, allocator);
+	auto* channel = reinterpret_cast<float32*>(channelBuffer.GetData());
+
+	for (uint8 c = 0; c < channels; ++c)
+	{
+		for (uint32 i = 0; i < TAPS / 2; ++i) { channel[i] = 0.0f; channel[TAPS / 2 + frames + i] = 0.0f; }
+		for (uint32 f = 0; f < frames; ++f) { channel[TAPS / 2 + f] = source[f * channels + c]; }
+
+		for (uint32 n = 0; n < outputFrames; ++n)
+		{
+			const uint64 position = static_cast<uint64>(n) * downFactor;
+			const uint64 sample = position / upFactor, phase = position % upFactor * phases / upFactor;
+
+			//first tap reads source sample - TAPS / 2 + 1, which is padded index sample + 1
+			output[n * channels + c] = convolve(channel + sample + 1, filters + phase * TAPS);
+		}
+	}
+}
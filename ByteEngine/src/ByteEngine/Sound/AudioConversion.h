@@ -0,0 +1,32 @@
+#pragma once
+
+#include <GTSL/Buffer.hpp>
+
+#include "ByteEngine/Core.h"
+#include "ByteEngine/Application/AllocatorReferences.h"
+
+/**
+ * \brief Sample encodings sounds can be imported from.
+ */
+enum class SampleFormat : uint8
+{
+	PCM, FLOAT
+};
+
+/**
+ * \brief Converts interleaved samples to interleaved float32 with outputChannels channels. PCM can be 8 bit unsigned or 16, 24 or 32 bit signed, float must be 32 bit.
+ * Mono sources are copied to every output channel, sources with more channels than the output keep only their first ones and missing ones are silent.
+ */
+void ConvertToFloat32(const byte* source, SampleFormat sampleFormat, uint8 bitDepth, uint8 sourceChannels, uint32 frames, uint8 outputChannels, float32* output);
+
+/**
+ * \brief Returns the number of frames Resample produces for frames frames.
+ */
+uint32 GetResampledFrameCount(uint32 frames, uint32 sourceRate, uint32 targetRate);
+
+/**
+ * \brief Converts interleaved float32 audio from sourceRate to targetRate with a polyphase windowed sinc filter. The filter's cutoff sits below the lower
+ * of both Nyquist frequencies so downsampling doesn't alias. Dot products are computed 4 taps at a time with SSE.
+ * \param output Room for GetResampledFrameCount() frames.
+ */
+void Resample(const float32* source, uint32 frames, uint8 channels, uint32 sourceRate, uint32 targetRate, float32* output, const BE::TAR& allocator);
@@ -0,0 +1,88 @@
+#include "AudioMixing.h"
+
+#include <emmintrin.h>
+
+namespace
+{
+	/**
+	 * \brief Adds 4 mono frames, panned by their left and right gains, to the 8 interleaved samples at mix.
+	 */
+	void accumulate(const __m128 samples, const __m128 leftGains, const __m128 rightGains, float32* mix)
+	{
+		const __m128 left = _mm_mul_ps(samples, leftGains), right = _mm_mul_ps(samples, rightGains);
+		_mm_storeu_ps(mix, _mm_add_ps(_mm_loadu_ps(mix), _mm_unpacklo_ps(left, right)));
+		_mm_storeu_ps(mix + 4, _mm_add_ps(_mm_loadu_ps(mix + 4), _mm_unpackhi_ps(left, right)));
+	}
+
+}
+
+GainRamp GainRamp::Slice(const uint32 firstFrame, const uint32 frames, const uint32 blockFrames) const
+{
+	const float32 step = (End - Start) / static_cast<float32>(blockFrames);
+	return GainRamp{ Start + step * static_cast<float32>(firstFrame), Start + step * static_cast<float32>(firstFrame + frames) };
+}
+
+void DownmixToMono(const float32* source, const uint32 frames, float32* mono)
+{
+	uint32 f = 0;
+
+	for (; f + 4 <= frames; f += 4)
+	{
+		const __m128 low = _mm_loadu_ps(source + f * MIX_CHANNELS), high = _mm_loadu_ps(source + f * MIX_CHANNELS + 4);
+		const __m128 lefts = _mm_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0)), rights = _mm_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1));
+		_mm_storeu_ps(mono + f, _mm_mul_ps(_mm_add_ps(lefts, rights), _mm_set1_ps(0.5f)));
+	}
+
+	for (; f < frames; ++f) { mono[f] = (source[f * MIX_CHANNELS] + source[f * MIX_CHANNELS + 1]) * 0.5f; }
+}
+
+void MixVoice(const float32* source, const uint32 frames, const GainRamp left, const GainRamp right, float32* mix)
+{
+	if (!frames) { return; }
+
+	const float32 leftStep = (left.End - left.Start) / frames, rightStep = (right.End - right.Start) / frames;
+
+	const __m128 frameOffsets = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+	const __m128 leftIncrement = _mm_set1_ps(leftStep * 4.0f), rightIncrement = _mm_set1_ps(rightStep * 4.0f);
+	__m128 leftGains = _mm_add_ps(_mm_set1_ps(left.Start), _mm_mul_ps(frameOffsets, _mm_set1_ps(leftStep)));
+	__m128 rightGains = _mm_add_ps(_mm_set1_ps(right.Start), _mm_mul_ps(frameOffsets, _mm_set1_ps(rightStep)));
+
+	uint32 f = 0;
+
+	for (; f + 8 <= frames; f += 8)
+	{
+		accumulate(_mm_loadu_ps(source + f), leftGains, rightGains, mix + f * 2);
+		leftGains = _mm_add_ps(leftGains, leftIncrement); rightGains = _mm_add_ps(rightGains, rightIncrement);
+
+		accumulate(_mm_loadu_ps(source + f + 4), leftGains, rightGains, mix + (f + 4) * 2);
+		leftGains = _mm_add_ps(leftGains, leftIncrement); rightGains = _mm_add_ps(rightGains, rightIncrement);
+	}
+
+	for (; f < frames; ++f)
+	{
+		const float32 value = source[f];
+		mix[f * 2] += value * (left.Start + leftStep * static_cast<float32>(f));
+		mix[f * 2 + 1] += value * (right.Start + rightStep * static_cast<float32>(f));
+	}
+}
+
+void ConvertToInt16(const float32* mix, const uint32 samples, int16* destination)
+{
+	const __m128 scale = _mm_set1_ps(32767.0f), minimum = _mm_set1_ps(-1.0f), maximum = _mm_set1_ps(1.0f);
+
+	uint32 s = 0;
+
+	for (; s + 8 <= samples; s += 8)
+	{
+		//clamp before converting, out of range floats convert to INT32_MIN regardless of sign
+		const __m128 low = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(mix + s), minimum), maximum), scale);
+		const __m128 high = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(mix + s + 4), minimum), maximum), scale);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + s), _mm_packs_epi32(_mm_cvtps_epi32(low), _mm_cvtps_epi32(high)));
+	}
+
+	for (; s < samples; ++s) //same rounding as the vector loop so output doesn't depend on buffer length
+	{
+		const __m128 sample = _mm_mul_ss(_mm_min_ss(_mm_max_ss(_mm_set_ss(mix[s]), minimum), maximum), scale);
+		destination[s] = static_cast<int16>(_mm_cvtss_si32(sample));
+	}
+}
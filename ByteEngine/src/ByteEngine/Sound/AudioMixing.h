@@ -0,0 +1,39 @@
+#pragma once
+
+#include "ByteEngine/Core.h"
+
+/**
+ * \brief Format every sound is converted to when imported and voices are mixed in: interleaved stereo float32 at 48 kHz.
+ */
+static constexpr uint32 MIX_SAMPLE_RATE = 48000;
+static constexpr uint8 MIX_CHANNELS = 2;
+static constexpr uint32 MIX_FRAME_SIZE = MIX_CHANNELS * sizeof(float32);
+
+/**
+ * \brief Gain of one output channel of a voice over a mix block, interpolated linearly from Start to End so gain changes don't click.
+ */
+struct GainRamp
+{
+	float32 Start = 0.0f, End = 0.0f;
+
+	/**
+	 * \brief Returns the part of the ramp covering frames [firstFrame, firstFrame + frames) of a block blockFrames long.
+	 */
+	[[nodiscard]] GainRamp Slice(uint32 firstFrame, uint32 frames, uint32 blockFrames) const;
+};
+
+/**
+ * \brief Averages the channels of frames frames in the mix format into mono samples. Processes 4 frames per iteration with SSE2.
+ */
+void DownmixToMono(const float32* source, uint32 frames, float32* mono);
+
+/**
+ * \brief Adds frames mono samples of a voice to an interleaved stereo float mix buffer, panned by a gain ramp per output channel.
+ * Processes 8 frames per iteration with SSE2.
+ */
+void MixVoice(const float32* source, uint32 frames, GainRamp left, GainRamp right, float32* mix);
+
+/**
+ * \brief Converts float samples to 16 bit, saturating samples outside [-1, 1].
+ */
+void ConvertToInt16(const float32* mix, uint32 samples, int16* destination);
@@ -1,5 +1,11 @@
 #include "AudioSystem.h"
 
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <thread>
+#include <xmmintrin.h>
+
 #include <GTSL/Algorithm.h>
 #include <GTSL/DataSizes.h>
 #include <GTSL/Math/Math.hpp>
@@ -21,199 +27,1055 @@ void AudioSystem::Initialize(const InitializeInfo& initializeInfo)
 {
 	AudioDevice::CreateInfo createInfo;
 	audioDevice.Initialize(createInfo);
-	
+
 	mixFormat.BitsPerSample = 16;
-	mixFormat.NumberOfChannels = 2;
-	mixFormat.SamplesPerSecond = 48000;
+	mixFormat.NumberOfChannels = MIX_CHANNELS;
+	mixFormat.SamplesPerSecond = MIX_SAMPLE_RATE;
+
+	audioListeners.Initialize(4, GetPersistentAllocator());
+	audioEmitters.Initialize(32, GetPersistentAllocator());
+	onHoldEmitters.Initialize(16, GetPersistentAllocator());
+	lastRequestedAudios.Initialize(16, GetPersistentAllocator()); loadedAudios.Initialize(16, GetPersistentAllocator());
+	sounds.Initialize(32, GetPersistentAllocator()); buses.Initialize(8, GetPersistentAllocator());
+
+	maxAudioEmitters = BE::Application::Get()->GetOption(Id("maxAudioEmitters"), DEFAULT_MAX_AUDIO_EMITTERS);
+	voices.Initialize(maxAudioEmitters, GetPersistentAllocator()); playingVoices.Initialize(maxAudioEmitters, GetPersistentAllocator());
+	voiceMixes.Initialize(maxAudioEmitters, GetPersistentAllocator()); pendingVoiceEvents.Initialize(maxAudioEmitters * 2, GetPersistentAllocator());
+	for (uint32 i = 0; i < maxAudioEmitters; ++i) { voices.EmplaceBack(); }
+
+	maxMixedVoices = BE::Application::Get()->GetOption(Id("maxAudioVoices"), DEFAULT_MAX_MIXED_VOICES);
+	simulatedFrameStall = BE::Application::Get()->GetOption(Id("simulatedFrameStall"), 0);
+	maxHRTFVoices = BE::Application::Get()->GetOption(Id("maxHRTFVoices"), DEFAULT_MAX_HRTF_VOICES);
+	maxReverbSeconds = BE::Application::Get()->GetOption(Id("maxReverbSeconds"), DEFAULT_MAX_REVERB_SECONDS);
+
+	hrtf.Initialize(MIX_SAMPLE_RATE, GetPersistentAllocator());
+	hrtfConvolvers.Initialize(maxHRTFVoices, GetPersistentAllocator()); freeHRTFSlots.Initialize(maxHRTFVoices, GetPersistentAllocator());
+	for (uint32 i = 0; i < maxHRTFVoices; ++i) { hrtfConvolvers.EmplaceBack(); freeHRTFSlots.EmplaceBack(maxHRTFVoices - 1 - i); }
 
 	onAudioInfoLoadHandle = initializeInfo.GameInstance->StoreDynamicTask("onAudioInfoLoad", Task<AudioResourceManager*, AudioResourceManager::AudioInfo>::Create<AudioSystem, &AudioSystem::onAudioInfoLoad>(this), {});
 	onAudioLoadHandle = initializeInfo.GameInstance->StoreDynamicTask("onAudioLoad", Task<AudioResourceManager*, AudioResourceManager::AudioInfo, GTSL::Range<const byte*>>::Create<AudioSystem, &AudioSystem::onAudioLoad>(this), {});
-	
-	if (audioDevice.IsMixFormatSupported(AAL::StreamShareMode::SHARED, mixFormat))
+	onImpulseResponseInfoLoadHandle = initializeInfo.GameInstance->StoreDynamicTask("onImpulseResponseInfoLoad", Task<AudioResourceManager*, AudioResourceManager::AudioInfo>::Create<AudioSystem, &AudioSystem::onImpulseResponseInfoLoad>(this), {});
+
+	initializeInfo.GameInstance->AddTask("updateAudio", Task<>::Create<AudioSystem, &AudioSystem::update>(this), GTSL::Array<TaskDependency, 1>{ { "AudioSystem", AccessTypes::READ_WRITE } }, "GameplayEnd", "RenderStart");
+
+	auto initializeMixing = [&]()
 	{
-		audioDevice.CreateAudioStream(AAL::StreamShareMode::SHARED, mixFormat);
-		audioDevice.Start();
 		audioBuffer.Allocate(GTSL::Byte(GTSL::MegaByte(1)), mixFormat.GetFrameSize(), GetPersistentAllocator());
-		initializeInfo.GameInstance->AddTask("renderAudio", Task<>::Create<AudioSystem, &AudioSystem::render>(this), GTSL::Array<TaskDependency, 1>{ { "AudioSystem", AccessTypes::READ_WRITE } }, "RenderDo", "RenderEnd");
+		soundMixer.Initialize(MIX_SAMPLE_RATE, GetPersistentAllocator());
+		voiceSamples.Allocate(SoundMixer::BLOCK_FRAMES * sizeof(float32), 16, GetPersistentAllocator());
+		delayedVoiceSamples.Allocate((HRTF::PARTITION_FRAMES + SoundMixer::BLOCK_FRAMES) * sizeof(float32), 16, GetPersistentAllocator());
+		if (BE::Application::Get()->GetOption(Id("voiceStressTest"), 0)) { voiceStressTest(); } //before the audio thread starts mixing
+	};
+
+	if (const uint32 renderSeconds = BE::Application::Get()->GetOption(Id("audioRenderSeconds"), 0))
+	{
+		WavAudioDevice::CreateInfo wavCreateInfo;
+		wavCreateInfo.Path += BE::Application::Get()->GetPathToApplication(); wavCreateInfo.Path += "/AudioRender.wav";
+		wavAudioDevice.Initialize(wavCreateInfo);
 
-		loadedSounds.Initialize(32, GetPersistentAllocator());
+		WavAudioDevice::MixFormat wavMixFormat;
+		wavMixFormat.BitsPerSample = mixFormat.BitsPerSample; wavMixFormat.NumberOfChannels = mixFormat.NumberOfChannels; wavMixFormat.SamplesPerSecond = mixFormat.SamplesPerSecond;
+		wavAudioDevice.CreateAudioStream(WavAudioDevice::StreamShareMode::SHARED, wavMixFormat);
+		wavAudioDevice.Start();
+		initializeMixing();
+
+		offlineRenderFrames = static_cast<uint64>(renderSeconds) * MIX_SAMPLE_RATE;
+		renderingOffline = true;
+		if (BE::Application::Get()->GetOption(Id("audioRenderScene"), 0)) { setUpRenderScene(); }
+		BE_LOG_MESSAGE("Rendering ", renderSeconds, " seconds of audio offline");
+	}
+	else if (audioDevice.IsMixFormatSupported(StreamShareMode::SHARED, mixFormat))
+	{
+		audioDevice.CreateAudioStream(StreamShareMode::SHARED, mixFormat);
+		audioDevice.Start();
+		initializeMixing();
 
 		BE_ASSERT(audioDevice.GetBufferSamplePlacement() == AudioDevice::BufferSamplePlacement::INTERLEAVED, "Unsupported");
+
+		runAudioThread.store(true, std::memory_order_release);
+		audioThread = GTSL::Thread(GetPersistentAllocator(), GTSL::Thread::ThreadCount(), GTSL::Delegate<void(AudioSystem*)>::Create([](AudioSystem* audioSystem) { audioSystem->runAudio(); }), this); //thread pool uses ids below ThreadCount()
+		audioThread.SetPriority(GTSL::Thread::Priority::HIGH);
+		audioThreadStarted = true;
 	}
 	else
 	{
 		BE_LOG_WARNING("Unable to start audio device with requested parameters:\n	Stream share mode: Shared\n	Bits per sample: ", mixFormat.BitsPerSample, "\n	Number of channels: ", mixFormat.NumberOfChannels, "\n	Samples per second: ", mixFormat.SamplesPerSecond);
 	}
+
+	if (BE::Application::Get()->GetOption(Id("reverbBenchmark"), 0)) { benchmarkReverb(); }
 }
 
 void AudioSystem::Shutdown(const ShutdownInfo& shutdownInfo)
 {
+	const bool playedAudio = audioThreadStarted, mixedAudio = isMixing();
+
+	if (audioThreadStarted)
+	{
+		runAudioThread.store(false, std::memory_order_release);
+		audioThread.Join(GetPersistentAllocator());
+		audioThreadStarted = false;
+	}
+
+	if (renderingOffline)
+	{
+		removeScriptedVoices(renderSceneEmitters); //their names aren't sounds, they can't be finished like other voices
+		wavAudioDevice.Stop(); wavAudioDevice.Destroy(); //completes the file's header if the render was cut short
+		renderingOffline = false;
+	}
+
+	if (mixedAudio)
+	{
+		//nothing mixes anymore, finish voices from here so their sounds and streams are released
+		VoiceEvent voiceEvent;
+
+		while (!processCommands()) {
+			while (voiceEvents.Pop(voiceEvent)) { onVoiceFinished(voiceEvent); }
+			for (const auto& e : pendingVoiceEvents) { onVoiceFinished(e); }
+			pendingVoiceEvents.ResizeDown(0);
+		}
+		
+		while (playingVoices.GetLength()) { finishVoice(playingVoices[playingVoices.GetLength() - 1]); }
+
+		while (voiceEvents.Pop(voiceEvent)) { onVoiceFinished(voiceEvent); }
+		for (const auto& e : pendingVoiceEvents) { onVoiceFinished(e); }
+	}
+
+	while (onHoldEmitters.GetLength()) { StopAudio(onHoldEmitters[onHoldEmitters.GetLength() - 1]); }
+	for (uint8 i = 0; i < reverbVolumeCount; ++i) { if (!reverbVolumes[i].Built) { releaseSound(reverbVolumes[i].ImpulseResponse); } }
+
+	{
+		GTSL::Lock lock(loadedAudiosMutex);
+		auto* audioResourceManager = BE::Application::Get()->GetResourceManager<AudioResourceManager>("AudioResourceManager");
+		for (auto e : loadedAudios) { audioResourceManager->ReleaseAudioAsset(e); }
+	}
+
+	if (mixMilliseconds > 0.0f) { BE_LOG_MESSAGE("Mixed ", mixedVoices, " voice blocks at ", static_cast<float32>(mixedVoices) / mixMilliseconds, " voices per millisecond"); }
+
+	{
+		uint64 decodedFrames, decodeMicroseconds;
+		BE::Application::Get()->GetResourceManager<AudioResourceManager>("AudioResourceManager")->GetDecodeStats(AudioCodec::ADPCM, decodedFrames, decodeMicroseconds);
+		if (decodedFrames) { BE_LOG_MESSAGE("Decoded ", decodedFrames / MIX_SAMPLE_RATE, " seconds of ADPCM audio, each playing voice costs ", decodeMicroseconds * MIX_SAMPLE_RATE / decodedFrames, " microseconds of decoding per second"); }
+	}
+
+#ifndef BE_PLATFORM_WIN
+	if (playedAudio)
+	{
+		uint32 underruns; uint64 silentFrames;
+		audioDevice.GetUnderruns(underruns, silentFrames);
+		if (underruns) { BE_LOG_WARNING("Audio device underran ", underruns, " times, ", silentFrames, " frames of silence were played"); }
+		else { BE_LOG_SUCCESS("Audio device never underran"); }
+	}
+#endif
+
 	audioDevice.Stop();
 	audioDevice.Destroy();
 }
 
 AudioListenerHandle AudioSystem::CreateAudioListener()
 {
-	audioListenersLocation.EmplaceBack(); audioListenersOrientation.EmplaceBack();
-	return AudioListenerHandle(audioListeners.EmplaceBack());
+	const uint32 index = audioListeners.GetLength();
+	audioListeners.EmplaceBack();
+	return AudioListenerHandle(index);
 }
 
 AudioEmitterHandle AudioSystem::CreateAudioEmitter()
 {
-	audioEmittersSettings.EmplaceBack();
-	return AudioEmitterHandle(audioEmittersLocation.EmplaceBack());
+	const auto emitter = audioEmitters.Emplace();
+	BE_ASSERT(emitter < maxAudioEmitters, "Too many audio emitters, raise the maxAudioEmitters option");
+	return AudioEmitterHandle(emitter);
+}
+
+void AudioSystem::DestroyAudioEmitter(AudioEmitterHandle audioEmitter)
+{
+	StopAudio(audioEmitter);
+	audioEmitters.Pop(audioEmitter());
 }
 
 void AudioSystem::BindAudio(AudioEmitterHandle audioEmitter, Id audioToPlay)
 {
-	lastRequestedAudios.EmplaceBack(audioToPlay);
-	audioEmittersSettings[audioEmitter()].Name = audioToPlay;
+	StopAudio(audioEmitter); //voice holds a reference to the sound it was bound to
+	audioEmitters[audioEmitter()].Name = audioToPlay;
+
+	//request the sound ahead of playback, once loaded it stays resident in the resource manager's budget so PlayAudio can start it right away
+	auto* audioResourceManager = BE::Application::Get()->GetResourceManager<AudioResourceManager>("AudioResourceManager");
+	if (!audioResourceManager->IsStreamed(audioToPlay) && !getSound(audioToPlay).Loaded) { requestSound(audioToPlay); }
 }
 
 void AudioSystem::PlayAudio(AudioEmitterHandle audioEmitter)
 {
-	if ((!onHoldEmitters.Find(audioEmitter).State())) {
-		auto res = playingEmitters.Find(audioEmitter);
-		
-		if(res.State()) {
-			audioEmittersSettings[audioEmitter()].Samples = 0;
-		}
-		else {
-			onHoldEmitters.EmplaceBack(audioEmitter);
+	auto& emitter = audioEmitters[audioEmitter()];
+	if (emitter.State == VoiceState::ON_HOLD) { return; } //will start once it's sound is loaded
+
+	//a playing emitter is restarted by sending a new voice, the audio thread finishes the old one and reports it so it's sound or stream is released
+	auto* audioResourceManager = BE::Application::Get()->GetResourceManager<AudioResourceManager>("AudioResourceManager");
+
+	if (audioResourceManager->IsStreamed(emitter.Name)) {
+		//streamed sounds start playing right away, silence is output until the first chunk arrives
+		sendPlay(audioEmitter, true, audioResourceManager->OpenAudioStream(BE::Application::Get()->GetGameInstance(), emitter.Name));
+		return;
+	}
+
+	auto& sound = getSound(emitter.Name);
+	++sound.Users;
+
+	if (sound.Loaded) {
+		sendPlay(audioEmitter, false, AudioStreamHandle());
+	}
+	else {
+		emitter.State = VoiceState::ON_HOLD; emitter.VoiceIndex = onHoldEmitters.GetLength();
+		onHoldEmitters.EmplaceBack(audioEmitter);
+		requestSound(emitter.Name); //sound may have been released since it was bound
+	}
+}
+
+void AudioSystem::StopAudio(AudioEmitterHandle audioEmitter)
+{
+	auto& emitter = audioEmitters[audioEmitter()];
+
+	switch (emitter.State)
+	{
+	case VoiceState::STOPPED: return;
+	case VoiceState::ON_HOLD: removeOnHoldEmitter(emitter.VoiceIndex); releaseSound(emitter.Name); break;
+	case VoiceState::PLAYING:
+	{
+		AudioCommand command; command.Type = CommandType::STOP; command.Target = audioEmitter();
+		pushCommand(command);
+		break;
+	}
+	}
+
+	emitter.State = VoiceState::STOPPED;
+}
+
+void AudioSystem::SetPosition(AudioEmitterHandle audioEmitterHandle, const GTSL::Vector3 position)
+{
+	audioEmitters[audioEmitterHandle()].Position = position;
+	AudioCommand command; command.Type = CommandType::SET_EMITTER_POSITION; command.Target = audioEmitterHandle(); command.Position = position;
+	pushCommand(command);
+}
+
+void AudioSystem::SetPosition(AudioListenerHandle audioListenerHandle, const GTSL::Vector3 position)
+{
+	audioListeners[audioListenerHandle()].Position = position;
+	if (audioListenerHandle() == activeAudioListenerHandle()) { SetAudioListener(audioListenerHandle); }
+}
+
+void AudioSystem::SetOrientation(AudioListenerHandle audioListenerHandle, const GTSL::Quaternion orientation)
+{
+	audioListeners[audioListenerHandle()].Orientation = orientation;
+	if (audioListenerHandle() == activeAudioListenerHandle()) { SetAudioListener(audioListenerHandle); }
+}
+
+void AudioSystem::SetVelocity(AudioEmitterHandle audioEmitterHandle, const GTSL::Vector3 velocity)
+{
+	audioEmitters[audioEmitterHandle()].Velocity = velocity;
+	AudioCommand command; command.Type = CommandType::SET_EMITTER_VELOCITY; command.Target = audioEmitterHandle(); command.Velocity = velocity;
+	pushCommand(command);
+}
+
+void AudioSystem::SetVelocity(AudioListenerHandle audioListenerHandle, const GTSL::Vector3 velocity)
+{
+	audioListeners[audioListenerHandle()].Velocity = velocity;
+	if (audioListenerHandle() == activeAudioListenerHandle()) { SetAudioListener(audioListenerHandle); }
+}
+
+void AudioSystem::SetAttenuation(AudioEmitterHandle audioEmitterHandle, const AttenuationSettings& attenuationSettings)
+{
+	audioEmitters[audioEmitterHandle()].Attenuation = attenuationSettings;
+	AudioCommand command; command.Type = CommandType::SET_ATTENUATION; command.Target = audioEmitterHandle(); command.Attenuation = attenuationSettings;
+	pushCommand(command);
+}
+
+void AudioSystem::SetAudioListener(const AudioListenerHandle audioListenerHandle)
+{
+	activeAudioListenerHandle = audioListenerHandle;
+	AudioCommand command; command.Type = CommandType::SET_LISTENER;
+	const auto& audioListener = audioListeners[audioListenerHandle()];
+	command.Position = audioListener.Position; command.Orientation = audioListener.Orientation; command.Velocity = audioListener.Velocity;
+	pushCommand(command);
+}
+
+void AudioSystem::SetLooping(const AudioEmitterHandle audioEmitterHandle, const bool loop)
+{
+	audioEmitters[audioEmitterHandle()].Loop = loop;
+	AudioCommand command; command.Type = CommandType::SET_LOOPING; command.Target = audioEmitterHandle(); command.Loop = loop;
+	pushCommand(command);
+}
+
+void AudioSystem::SetPriority(const AudioEmitterHandle audioEmitterHandle, const uint8 priority)
+{
+	audioEmitters[audioEmitterHandle()].Priority = priority;
+	AudioCommand command; command.Type = CommandType::SET_PRIORITY; command.Target = audioEmitterHandle(); command.Priority = priority;
+	pushCommand(command);
+}
+
+SoundBusHandle AudioSystem::CreateBus(const Id name, const SoundBusHandle output)
+{
+	BE_ASSERT(busCount < SoundMixer::MAX_BUSES, "Too many sound buses");
+
+	const auto bus = SoundBusHandle(busCount++);
+	buses.Emplace(name, bus);
+
+	AudioCommand command; command.Type = CommandType::ADD_BUS; command.Target = bus(); command.Bus = output;
+	pushCommand(command);
+	return bus;
+}
+
+void AudioSystem::SetBusOutput(const SoundBusHandle bus, const SoundBusHandle output)
+{
+	AudioCommand command; command.Type = CommandType::SET_BUS_OUTPUT; command.Target = bus(); command.Bus = output;
+	pushCommand(command);
+}
+
+void AudioSystem::SetBusGain(const SoundBusHandle bus, const float32 gain)
+{
+	AudioCommand command; command.Type = CommandType::SET_BUS_GAIN; command.Target = bus(); command.Gain = gain;
+	pushCommand(command);
+}
+
+void AudioSystem::SetBusEffect(const SoundBusHandle bus, const uint8 slot, const SoundMixer::EffectSettings& effectSettings)
+{
+	BE_ASSERT(slot < SoundMixer::MAX_EFFECTS_PER_BUS, "Effect slot out of range");
+	AudioCommand command; command.Type = CommandType::SET_BUS_EFFECT; command.Target = bus(); command.Slot = slot; command.Effect = effectSettings;
+	pushCommand(command);
+}
+
+void AudioSystem::SetBus(const AudioEmitterHandle audioEmitterHandle, const SoundBusHandle bus)
+{
+	audioEmitters[audioEmitterHandle()].Bus = bus;
+	AudioCommand command; command.Type = CommandType::SET_EMITTER_BUS; command.Target = audioEmitterHandle(); command.Bus = bus;
+	pushCommand(command);
+}
+
+ReverbVolumeHandle AudioSystem::CreateReverbVolume(const ReverbVolume& reverbVolume, const Id impulseResponse)
+{
+	BE_ASSERT(reverbVolumeCount < ConvolutionReverb::MAX_IMPULSE_RESPONSES, "Too many reverb volumes");
+
+	if (!reverb.IsInitialized()) { //audio thread doesn't touch reverb until it's told which bus to reverberate
+		reverb.Initialize(maxReverbSeconds * MIX_SAMPLE_RATE / ConvolutionReverb::PARTITION_FRAMES, GetPersistentAllocator());
+		AudioCommand command; command.Type = CommandType::SET_REVERB_BUS; command.Bus = reverbBus;
+		pushCommand(command);
+	}
+
+	const uint8 index = reverbVolumeCount++;
+	reverbVolumes[index].Volume = reverbVolume; reverbVolumes[index].ImpulseResponse = impulseResponse;
+
+	auto& sound = getSound(impulseResponse);
+	++sound.Users;
+
+	if (sound.Loaded) { buildImpulseResponse(index); }
+	else if (!sound.Requested) {
+		sound.Requested = true;
+		BE::Application::Get()->GetResourceManager<AudioResourceManager>("AudioResourceManager")->LoadAudioInfo(BE::Application::Get()->GetGameInstance(), impulseResponse, onImpulseResponseInfoLoadHandle);
+	}
+
+	return ReverbVolumeHandle(index);
+}
+
+void AudioSystem::SetReverbBus(const SoundBusHandle bus)
+{
+	reverbBus = bus;
+	if (!reverb.IsInitialized()) { return; } //sent when the first volume is created
+
+	AudioCommand command; command.Type = CommandType::SET_REVERB_BUS; command.Bus = bus;
+	pushCommand(command);
+}
+
+void AudioSystem::buildImpulseResponse(const uint8 reverbVolume)
+{
+	auto& volume = reverbVolumes[reverbVolume];
+	auto* audioResourceManager = BE::Application::Get()->GetResourceManager<AudioResourceManager>("AudioResourceManager");
+
+	impulseResponses[reverbVolume].Build(reverb.GetFFT(), reinterpret_cast<const float32*>(audioResourceManager->GetAssetPointer(volume.ImpulseResponse)),
+		audioResourceManager->GetFrameCount(volume.ImpulseResponse), reverb.GetMaxPartitions(), GetPersistentAllocator());
+	volume.Built = true;
+
+	AudioCommand command; command.Type = CommandType::SET_REVERB_VOLUME; command.Target = reverbVolume; command.Reverb = volume.Volume; command.ImpulseResponse = &impulseResponses[reverbVolume];
+	pushCommand(command);
+
+	releaseSound(volume.ImpulseResponse); //spectra are all reverb needs
+}
+
+void AudioSystem::pushCommand(const AudioCommand& command)
+{
+	if (!isMixing()) { return; }
+
+	if (renderingOffline) {
+		//nothing drains the queue until the next update when rendering offline, so apply what's queued here instead of waiting on it
+		while (!commands.Push(command))
+		{
+			processCommands(); flushVoiceEvents();
+			VoiceEvent voiceEvent;
+			while (voiceEvents.Pop(voiceEvent)) { onVoiceFinished(voiceEvent); }
 		}
+
+		return;
 	}
+
+	while (!commands.Push(command)) { std::this_thread::yield(); } //audio thread drains the queue every period
+}
+
+AudioSystem::Sound& AudioSystem::getSound(const Id name)
+{
+	if (!sounds.Find(name)) { sounds.Emplace(name, Sound()); }
+	return sounds.At(name);
+}
+
+void AudioSystem::requestSound(const Id name)
+{
+	auto& sound = getSound(name);
+	if (sound.Requested) { return; }
+	sound.Requested = true;
+	lastRequestedAudios.EmplaceBack(name);
+}
+
+void AudioSystem::releaseSound(const Id name)
+{
+	auto& sound = sounds.At(name);
+	if (!--sound.Users && sound.Loaded) {
+		BE::Application::Get()->GetResourceManager<AudioResourceManager>("AudioResourceManager")->ReleaseAudioAsset(name);
+		sound.Loaded = false;
+	}
+}
+
+void AudioSystem::sendPlay(AudioEmitterHandle audioEmitter, const bool streamed, const AudioStreamHandle stream)
+{
+	auto& emitter = audioEmitters[audioEmitter()];
+	auto* audioResourceManager = BE::Application::Get()->GetResourceManager<AudioResourceManager>("AudioResourceManager");
+
+	emitter.State = VoiceState::PLAYING; emitter.Generation = nextGeneration++;
+
+	AudioCommand command; command.Type = CommandType::PLAY; command.Target = audioEmitter();
+	command.Generation = emitter.Generation; command.Name = emitter.Name;
+	command.Frames = audioResourceManager->GetFrameCount(emitter.Name);
+	command.Streamed = streamed; command.Stream = stream;
+	if (!streamed) { command.Data = audioResourceManager->GetAssetPointer(emitter.Name); } //stays valid while the voice holds a user of the sound
+	command.Position = emitter.Position; command.Velocity = emitter.Velocity; command.Attenuation = emitter.Attenuation; command.Loop = emitter.Loop; command.Priority = emitter.Priority; command.Bus = emitter.Bus;
+
+	if (!isMixing()) { //no voice will ever report back, release right away
+		VoiceEvent voiceEvent; voiceEvent.Emitter = audioEmitter; voiceEvent.Generation = command.Generation; voiceEvent.Name = command.Name; voiceEvent.Streamed = streamed; voiceEvent.Stream = stream;
+		onVoiceFinished(voiceEvent);
+		return;
+	}
+
+	pushCommand(command);
+}
+
+void AudioSystem::removeOnHoldEmitter(const uint32 index)
+{
+	const auto last = onHoldEmitters[onHoldEmitters.GetLength() - 1];
+	onHoldEmitters[index] = last; audioEmitters[last()].VoiceIndex = index;
+	onHoldEmitters.ResizeDown(onHoldEmitters.GetLength() - 1);
+}
+
+void AudioSystem::onSoundLoaded(const Id name)
+{
+	auto& sound = getSound(name);
+	sound.Requested = false;
+
+	//we only hold one reference per sound, and only while some emitter plays it. Unreferenced sounds stay resident in the resource manager's budget
+	if (sound.Loaded || !sound.Users) {
+		BE::Application::Get()->GetResourceManager<AudioResourceManager>("AudioResourceManager")->ReleaseAudioAsset(name);
+		return;
+	}
+
+	sound.Loaded = true;
+
+	for (uint32 i = 0; i < onHoldEmitters.GetLength();)
+	{
+		const auto emitter = onHoldEmitters[i];
+		if (audioEmitters[emitter()].Name == name) { removeOnHoldEmitter(i); sendPlay(emitter, false, AudioStreamHandle()); } //swap removal brings an unvisited emitter to i
+		else { ++i; }
+	}
+
+	for (uint8 i = 0; i < reverbVolumeCount; ++i) { if (!reverbVolumes[i].Built && reverbVolumes[i].ImpulseResponse == name) { buildImpulseResponse(i); } }
+}
+
+void AudioSystem::onVoiceFinished(const VoiceEvent& voiceEvent)
+{
+	if (voiceEvent.Streamed) { BE::Application::Get()->GetResourceManager<AudioResourceManager>("AudioResourceManager")->CloseAudioStream(voiceEvent.Stream); }
+	else { releaseSound(voiceEvent.Name); }
+
+	//generations are unique, a match means the emitter is still the one that played the voice and nothing restarted it since
+	auto& emitter = audioEmitters[voiceEvent.Emitter()];
+	if (emitter.State == VoiceState::PLAYING && emitter.Generation == voiceEvent.Generation) { emitter.State = VoiceState::STOPPED; }
 }
 
 void AudioSystem::requestAudioStreams()
 {
 	auto* audioResourceManager = BE::Application::Get()->GetResourceManager<AudioResourceManager>("AudioResourceManager");
 
-	for(uint8 i = 0; i < lastRequestedAudios.GetLength(); ++i)
+	for(uint32 i = 0; i < lastRequestedAudios.GetLength(); ++i)
 	{
 		audioResourceManager->LoadAudioInfo(BE::Application::Get()->GetGameInstance(), lastRequestedAudios[i], onAudioInfoLoadHandle);
 	}
 
-	lastRequestedAudios.Resize(0);
+	lastRequestedAudios.ResizeDown(0);
 }
 
-void AudioSystem::render(TaskInfo)
+void AudioSystem::update(TaskInfo taskInfo)
 {
 	requestAudioStreams();
+	BE::Application::Get()->GetResourceManager<AudioResourceManager>("AudioResourceManager")->UpdateStreams(taskInfo.GameInstance); //audio thread only reports what it consumed
 
 	{
-		GTSL::Array<uint32, 16> emittersToRemove;
-		for (uint32 i = 0; i < onHoldEmitters.GetLength(); ++i) {
-			if (loadedSounds.Find(audioEmittersSettings[onHoldEmitters[i]()].Name).State()) {
-				emittersToRemove.EmplaceBack(i);
-			}
+		GTSL::Lock lock(loadedAudiosMutex);
+		for (auto e : loadedAudios) { onSoundLoaded(e); }
+		loadedAudios.ResizeDown(0);
+	}
+
+	if (renderingOffline && !renderOfflineDone) { renderOffline(); }
+
+	VoiceEvent voiceEvent;
+	while (voiceEvents.Pop(voiceEvent)) { onVoiceFinished(voiceEvent); }
+
+	if (simulatedFrameStall && ++updateCount % SIMULATED_STALL_INTERVAL == 0) { std::this_thread::sleep_for(std::chrono::milliseconds(simulatedFrameStall)); }
+}
+
+void AudioSystem::onAudioInfoLoad(TaskInfo taskInfo, AudioResourceManager* audioResourceManager, AudioResourceManager::AudioInfo audioInfo)
+{
+	if (audioInfo.GetAudioSize() > AudioResourceManager::STREAMING_THRESHOLD) { return; } //streamed sounds are never made resident, emitters open streams when played
+	audioResourceManager->LoadAudio(taskInfo.GameInstance, audioInfo, onAudioLoadHandle);
+}
+
+void AudioSystem::onImpulseResponseInfoLoad(TaskInfo taskInfo, AudioResourceManager* audioResourceManager, AudioResourceManager::AudioInfo audioInfo)
+{
+	audioResourceManager->LoadAudio(taskInfo.GameInstance, audioInfo, onAudioLoadHandle);
+}
+
+void AudioSystem::onAudioLoad(TaskInfo taskInfo, AudioResourceManager* audioResourceManager, AudioResourceManager::AudioInfo audioInfo, GTSL::Range<const byte*> buffer)
+{
+	GTSL::Lock lock(loadedAudiosMutex);
+	loadedAudios.EmplaceBack(audioInfo.Name);
+}
+
+void AudioSystem::runAudio()
+{
+	_mm_setcsr(_mm_getcsr() | 0x8040); //flush denormals to zero, decaying filter state would otherwise slow mixing down
+
+	while (runAudioThread.load(std::memory_order_acquire))
+	{
+		const auto wakeTime = std::chrono::steady_clock::now() + std::chrono::microseconds(MIX_PERIOD_MICROSECONDS);
+
+		processCommands();
+
+		uint32 availableFrames = 0;
+		audioDevice.GetAvailableBufferFrames(availableFrames);
+
+		if (availableFrames)
+		{
+			mix(availableFrames);
+			audioDevice.PushAudioData([&](const uint32 size, void* to) { GTSL::MemCopy(size, audioBuffer.GetData(), to); }, availableFrames);
 		}
+
+		flushVoiceEvents();
+
+		std::this_thread::sleep_until(wakeTime);
+	}
+}
+
+AudioSystem::Voice& AudioSystem::getVoice(const uint32 emitter)
+{
+	BE_ASSERT(emitter < voices.GetLength(), "Emitter out of range");
+	return voices[emitter];
+}
+
+bool AudioSystem::processCommands()
+{
+	AudioCommand command;
+
+	//every playing voice and every command can add at most one event, so stopping at maxAudioEmitters keeps pendingVoiceEvents within twice that
+	while (true)
+	{
+		if (pendingVoiceEvents.GetLength() >= maxAudioEmitters) { return false; }
+		if (!commands.Pop(command)) { return true; }
 		
-		for (auto e : emittersToRemove) {
-			playingEmitters.EmplaceBack(onHoldEmitters[e]);
-			onHoldEmitters.Pop(e);
+
+		switch (command.Type)
+		{
+		case CommandType::PLAY:
+		{
+			auto& voice = getVoice(command.Target);
+			if (voice.Playing) { finishVoice(command.Target); } //restart
+
+			voice.Name = command.Name; voice.Data = command.Data; voice.Frames = command.Frames; voice.Samples = 0;
+			voice.Streamed = command.Streamed; voice.Stream = command.Stream; voice.Generation = command.Generation;
+			voice.Position = command.Position; voice.Velocity = command.Velocity; voice.Attenuation = command.Attenuation; voice.Loop = command.Loop; voice.Priority = command.Priority; voice.Bus = command.Bus;
+			voice.Rate = 1.0f; voice.Fraction = 0.0f;
+			voice.LeftGain = 0.0f; voice.RightGain = 0.0f; voice.HRTFGain = 0.0f; //fade in
+
+			voice.Playing = true; voice.VoiceIndex = playingVoices.GetLength();
+			playingVoices.EmplaceBack(command.Target);
+			break;
+		}
+		case CommandType::STOP: if (getVoice(command.Target).Playing) { finishVoice(command.Target); } break;
+		case CommandType::SET_EMITTER_POSITION: getVoice(command.Target).Position = command.Position; break;
+		case CommandType::SET_EMITTER_VELOCITY: getVoice(command.Target).Velocity = command.Velocity; break;
+		case CommandType::SET_ATTENUATION: getVoice(command.Target).Attenuation = command.Attenuation; break;
+		case CommandType::SET_LOOPING: getVoice(command.Target).Loop = command.Loop; break;
+		case CommandType::SET_PRIORITY: getVoice(command.Target).Priority = command.Priority; break;
+		case CommandType::SET_EMITTER_BUS: getVoice(command.Target).Bus = command.Bus; break;
+		case CommandType::SET_LISTENER: listener.Position = command.Position; listener.Orientation = command.Orientation; listener.Velocity = command.Velocity; break;
+		case CommandType::ADD_BUS: soundMixer.AddBus(SoundBusHandle(command.Target), command.Bus); break;
+		case CommandType::SET_BUS_OUTPUT: soundMixer.SetOutput(SoundBusHandle(command.Target), command.Bus); break;
+		case CommandType::SET_BUS_GAIN: soundMixer.SetGain(SoundBusHandle(command.Target), command.Gain); break;
+		case CommandType::SET_BUS_EFFECT: soundMixer.SetEffect(SoundBusHandle(command.Target), command.Slot, command.Effect); break;
+		case CommandType::SET_REVERB_VOLUME:
+			reverbVolumeShapes[command.Target] = command.Reverb; reverb.SetImpulseResponse(static_cast<uint8>(command.Target), command.ImpulseResponse);
+			readyReverbVolumes |= 1 << command.Target;
+			break;
+		case CommandType::SET_REVERB_BUS:
+			for (uint8 b = 0; b < SoundMixer::MAX_BUSES; ++b) { soundMixer.SetReverb(SoundBusHandle(b), nullptr); }
+			soundMixer.SetReverb(command.Bus, &reverb);
+			break;
 		}
 	}
-	
-	GTSL::Array<uint32, 16> emittersToStop;
-	
+}
+
+void AudioSystem::finishVoice(const uint32 emitter)
+{
+	auto& voice = voices[emitter];
+
+	const auto last = playingVoices[playingVoices.GetLength() - 1];
+	playingVoices[voice.VoiceIndex] = last; voices[last].VoiceIndex = voice.VoiceIndex;
+	playingVoices.ResizeDown(playingVoices.GetLength() - 1);
+
+	voice.Playing = false;
+	releaseHRTFSlot(voice);
+
+	VoiceEvent voiceEvent; voiceEvent.Emitter = AudioEmitterHandle(emitter); voiceEvent.Generation = voice.Generation;
+	voiceEvent.Name = voice.Name; voiceEvent.Streamed = voice.Streamed; voiceEvent.Stream = voice.Stream;
+	BE_ASSERT(pendingVoiceEvents.GetLength() < maxAudioEmitters * 2, "Pending voice events outgrew their storage");
+	pendingVoiceEvents.EmplaceBack(voiceEvent);
+}
+
+void AudioSystem::flushVoiceEvents()
+{
+	uint32 sent = 0;
+	while (sent < pendingVoiceEvents.GetLength() && voiceEvents.Push(pendingVoiceEvents[sent])) { ++sent; }
+
+	//keep the ones that didn't fit in order for the next period
+	for (uint32 i = sent; i < pendingVoiceEvents.GetLength(); ++i) { pendingVoiceEvents[i - sent] = pendingVoiceEvents[i]; }
+	pendingVoiceEvents.ResizeDown(pendingVoiceEvents.GetLength() - sent);
+}
+
+void AudioSystem::releaseHRTFSlot(Voice& voice)
+{
+	if (voice.HRTFSlot == NO_HRTF_SLOT) { return; }
+	freeHRTFSlots.EmplaceBack(voice.HRTFSlot); voice.HRTFSlot = NO_HRTF_SLOT;
+}
+
+void AudioSystem::updateReverbWeights()
+{
+	float32 weights[ConvolutionReverb::MAX_IMPULSE_RESPONSES]; float32 totalWeight = 0.0f;
+
+	for (uint8 i = 0; i < ConvolutionReverb::MAX_IMPULSE_RESPONSES; ++i)
+	{
+		weights[i] = readyReverbVolumes & 1 << i ? reverbVolumeShapes[i].GetWeight(listener.Position) : 0.0f;
+		totalWeight += weights[i];
+	}
+
+	const float32 normalization = 1.0f / GTSL::Math::Max(totalWeight, 1.0f);
+	for (uint8 i = 0; i < ConvolutionReverb::MAX_IMPULSE_RESPONSES; ++i) { reverb.SetWeight(i, weights[i] * normalization * reverbVolumeShapes[i].WetGain); }
+}
+
+bool AudioSystem::renderVoice(Voice& voice, AudioResourceManager* audioResourceManager, const uint32 frames, float32* mono)
+{
+	uint32 renderedFrames = 0;
+
+	auto silenceRest = [&] { if (mono) { GTSL::SetMemory((frames - renderedFrames) * sizeof(float32), mono + renderedFrames, 0); } };
+
+	if (voice.Rate == 1.0f && voice.Fraction == 0.0f)
+	{
+		while (renderedFrames < frames)
+		{
+			const byte* source; uint32 sourceFrames;
+
+			if (voice.Streamed) {
+				auto streamData = audioResourceManager->GetStreamData(voice.Stream);
+				if (!streamData.Bytes()) { silenceRest(); return false; } //stream starved, rest of this voice's output is silence
+				source = streamData.begin(); sourceFrames = streamData.Bytes() / MIX_FRAME_SIZE;
+			}
+			else {
+				source = voice.Data + voice.Samples * MIX_FRAME_SIZE; sourceFrames = voice.Frames - voice.Samples;
+			}
+
+			auto blockFrames = GTSL::Math::Limit(sourceFrames, frames - renderedFrames);
+			blockFrames = GTSL::Math::Limit(blockFrames, voice.Frames - voice.Samples);
+
+			if (mono) { DownmixToMono(reinterpret_cast<const float32*>(source), blockFrames, mono + renderedFrames); }
+			if (voice.Streamed) { audioResourceManager->ConsumeStreamData(voice.Stream, blockFrames * MIX_FRAME_SIZE); } //virtual streamed voices still consume data so the stream keeps up
+			renderedFrames += blockFrames;
+
+			if ((voice.Samples += blockFrames) == voice.Frames)
+			{
+				if (!voice.Loop) { silenceRest(); return true; }
+				voice.Samples = 0; //streams wrap around on their own
+			}
+		}
+
+		return false;
+	}
+
+	//Doppler shifted resident voice, read between frames with linear interpolation
+	const auto* data = reinterpret_cast<const float32*>(voice.Data);
+
+	for (; renderedFrames < frames; ++renderedFrames)
+	{
+		if (mono) {
+			const uint32 next = voice.Samples + 1 < voice.Frames ? voice.Samples + 1 : (voice.Loop ? 0 : voice.Samples);
+			const float32 current = (data[voice.Samples * MIX_CHANNELS] + data[voice.Samples * MIX_CHANNELS + 1]) * 0.5f;
+			const float32 following = (data[next * MIX_CHANNELS] + data[next * MIX_CHANNELS + 1]) * 0.5f;
+			mono[renderedFrames] = current + (following - current) * voice.Fraction;
+		}
+
+		voice.Fraction += voice.Rate;
+		const auto advance = static_cast<uint32>(voice.Fraction);
+		voice.Fraction -= static_cast<float32>(advance); voice.Samples += advance;
+
+		if (voice.Samples >= voice.Frames)
+		{
+			if (!voice.Loop) { ++renderedFrames; silenceRest(); return true; }
+			voice.Samples %= voice.Frames;
+		}
+	}
+
+	return false;
+}
+
+void AudioSystem::mix(const uint32 frames)
+{
 	auto* audioResourceManager = BE::Application::Get()->GetResourceManager<AudioResourceManager>("AudioResourceManager");
-	
-	uint32 availableAudioFrames = 0;
-	audioDevice.GetAvailableBufferFrames(availableAudioFrames);
-	
-	auto* buffer = audioBuffer.GetData();
 
-	GTSL::SetMemory(availableAudioFrames * mixFormat.GetFrameSize(), audioBuffer.GetData(), 0);
+	const auto mixStart = BE::Application::Get()->GetClock()->GetCurrentMicroseconds();
+
+	if (readyReverbVolumes) { updateReverbWeights(); }
+
+	voiceMixes.ResizeDown(0);
 
 	{
-		GTSL::Vector3 listenerPosition = GetPosition(activeAudioListenerHandle);
-		GTSL::Quaternion listenerRotation = GetOrientation(activeAudioListenerHandle);
-		GTSL::Vector3 listenerRightVector = listenerRotation * GTSL::Math::Right;
+		GTSL::Vector3 listenerRightVector = listener.Orientation * GTSL::Math::Right;
 
-		for (uint32 pe = 0; pe < playingEmitters.GetLength(); ++pe)
+		for (auto playingVoice : playingVoices)
 		{
-			GTSL::Vector3 emitterPosition = GetPosition(playingEmitters[pe]);
+			const auto& voice = voices[playingVoice];
 
-			auto soundDirection = GTSL::Math::DotProduct(GTSL::Math::Normalized(emitterPosition - listenerPosition), listenerRightVector);
+			const float32 distance = GTSL::Math::Length(voice.Position, listener.Position);
+			float32 soundDirection = 0.0f, rate = 1.0f;
+
+			if (distance > 0.0f) { //an emitter at the listener is centered and not shifted
+				const GTSL::Vector3 direction = GTSL::Math::Normalized(voice.Position - listener.Position);
+				soundDirection = GTSL::Math::DotProduct(direction, listenerRightVector);
+				if (!voice.Streamed) { rate = GetDopplerFactor(direction, listener.Velocity, voice.Velocity); }
+			}
 
 			auto reMap = GTSL::Math::MapToRange(soundDirection, -1.0f, 1.0f, 0.0f, 1.0f);
-			
+
 			auto leftPercentange = GTSL::Math::InvertRange(reMap, 1.0);
 			auto rightPercentage = reMap;
-			
-			{
-				auto distanceFactor = GTSL::Math::Length(emitterPosition, listenerPosition);
-				distanceFactor = GTSL::Math::Clamp(-(distanceFactor / 1500) + 1, 0.0f, 1.0f);
-				//auto inDistFact = GTSL::Math::InvertRange(distanceFactor, 1.0f);
-				leftPercentange *= distanceFactor; rightPercentage *= distanceFactor;
-			}
-			
-			auto& emmitter = audioEmittersSettings[playingEmitters[pe]()];
-			auto playedSamples = emmitter.Samples;
-			
-			byte* audio = audioResourceManager->GetAssetPointer(emmitter.Name);
-			
-			auto audioFrames = audioResourceManager->GetFrameCount(emmitter.Name);
-			auto remainingFrames = audioFrames - playedSamples;
-			auto clampedFrames = GTSL::Math::Limit(availableAudioFrames, remainingFrames);
-			
-			for (uint32 s = 0; s < clampedFrames; ++s) //left channel
-			{
-				getIntertwinedSample<int16>(buffer, availableAudioFrames, s, AudioDevice::LEFT_CHANNEL) += getSample<int16>(audio, audioFrames, s + playedSamples, 0) * leftPercentange;
-			}
 
-			for (uint32 s = 0; s < clampedFrames; ++s) //right channel
-			{
-				getIntertwinedSample<int16>(buffer, availableAudioFrames, s, AudioDevice::RIGHT_CHANNEL) += getSample<int16>(audio, audioFrames, s + playedSamples, 0) * rightPercentage;
-			}
+			const float32 attenuation = GetAttenuation(voice.Attenuation, distance);
+			leftPercentange *= attenuation; rightPercentage *= attenuation;
 
-			if ((emmitter.Samples += clampedFrames) == audioFrames)
-			{
-				if (!GetLooping(playingEmitters[pe])) {
-					emittersToStop.EmplaceBack(pe);
+			voiceMixes.EmplaceBack(VoiceMix{ playingVoice, voice.Priority, leftPercentange, rightPercentage, attenuation, distance, soundDirection, rate, false });
+		}
+	}
+
+	//only the most important voices are mixed, the rest are virtualized
+	const uint32 mixedVoiceCount = GTSL::Math::Limit(voiceMixes.GetLength(), maxMixedVoices);
+
+	if (mixedVoiceCount < voiceMixes.GetLength()) {
+		std::nth_element(voiceMixes.begin(), voiceMixes.begin() + mixedVoiceCount, voiceMixes.end(), [](const VoiceMix& a, const VoiceMix& b)
+		{
+			return a.Priority != b.Priority ? a.Priority > b.Priority : a.GetAudibility() > b.GetAudibility();
+		});
+	}
+
+	//closest mixed voices are rendered through the HRTF, the rest fall back to panning
+	const uint32 hrtfVoiceCount = GTSL::Math::Limit(mixedVoiceCount, maxHRTFVoices);
+
+	if (hrtfVoiceCount < mixedVoiceCount) {
+		std::nth_element(voiceMixes.begin(), voiceMixes.begin() + hrtfVoiceCount, voiceMixes.begin() + mixedVoiceCount, [](const VoiceMix& a, const VoiceMix& b) { return a.Distance < b.Distance; });
+	}
+
+	for (uint32 v = 0; v < voiceMixes.GetLength(); ++v)
+	{
+		auto& voiceMix = voiceMixes[v];
+		auto& voice = voices[voiceMix.Voice];
+		voice.Rate = voiceMix.Rate;
+
+		if (v < hrtfVoiceCount && voice.HRTFSlot == NO_HRTF_SLOT && freeHRTFSlots.GetLength()) {
+			voice.HRTFSlot = freeHRTFSlots[freeHRTFSlots.GetLength() - 1]; freeHRTFSlots.ResizeDown(freeHRTFSlots.GetLength() - 1);
+			hrtfConvolvers[voice.HRTFSlot].Reset(); voice.HRTFGain = 0.0f;
+		}
+
+		//voices leaving the HRTF still hold their slot this period, so a voice entering it may have to wait for the next one
+		voiceMix.HRTF = v < hrtfVoiceCount && voice.HRTFSlot != NO_HRTF_SLOT;
+	}
+
+	//buses hold one block, the period is mixed block by block with every voice's gain ramp sliced across them
+	for (uint32 blockStart = 0; blockStart < frames; blockStart += SoundMixer::BLOCK_FRAMES)
+	{
+		const uint32 blockFrames = GTSL::Math::Limit(SoundMixer::BLOCK_FRAMES, frames - blockStart);
+
+		soundMixer.BeginBlock(blockFrames);
+
+		for (uint32 v = 0; v < voiceMixes.GetLength(); ++v)
+		{
+			const auto& voiceMix = voiceMixes[v];
+			auto& voice = voices[voiceMix.Voice];
+			if (!voice.Playing) { continue; } //finished in an earlier block
+
+			bool finished;
+
+			if (v < mixedVoiceCount) {
+				auto* mono = reinterpret_cast<float32*>(voiceSamples.GetData());
+				auto* busSamples = soundMixer.GetBusSamples(voice.Bus);
+				finished = renderVoice(voice, audioResourceManager, blockFrames, mono);
+
+				auto* delayed = reinterpret_cast<float32*>(delayedVoiceSamples.GetData());
+				GTSL::MemCopy(sizeof(voice.PannedHistory), voice.PannedHistory, delayed); GTSL::MemCopy(blockFrames * sizeof(float32), mono, delayed + HRTF::PARTITION_FRAMES);
+				GTSL::MemCopy(sizeof(voice.PannedHistory), delayed + blockFrames, voice.PannedHistory);
+
+				//switching between panning and the HRTF crossfades them over the period, the HRTF's overlap-add lags a partition behind so while
+				//the voice holds a slot the panned path is delayed as much, otherwise the two would comb filter
+				const GainRamp leftRamp{ voice.LeftGain, voiceMix.HRTF ? 0.0f : voiceMix.LeftGain }, rightRamp{ voice.RightGain, voiceMix.HRTF ? 0.0f : voiceMix.RightGain };
+				if (leftRamp.Start != 0.0f || leftRamp.End != 0.0f || rightRamp.Start != 0.0f || rightRamp.End != 0.0f) {
+					MixVoice(voice.HRTFSlot != NO_HRTF_SLOT ? delayed : mono, blockFrames, leftRamp.Slice(blockStart, blockFrames, frames), rightRamp.Slice(blockStart, blockFrames, frames), busSamples);
 				}
-				else {
-					emmitter.Samples = 0;
+
+				if (voice.HRTFSlot != NO_HRTF_SLOT) {
+					const GainRamp hrtfRamp{ voice.HRTFGain, voiceMix.HRTF ? voiceMix.Gain : 0.0f };
+					hrtfConvolvers[voice.HRTFSlot].Process(hrtf, mono, blockFrames, hrtfRamp.Slice(blockStart, blockFrames, frames), HRTF::GetDirection(voiceMix.Rightness), busSamples);
 				}
 			}
+			else {
+				finished = renderVoice(voice, audioResourceManager, blockFrames, nullptr);
+			}
+
+			if (finished) { finishVoice(voiceMix.Voice); } //voiceMixes holds emitter indices, so removing from playingVoices doesn't disturb it
 		}
+
+		ConvertToInt16(soundMixer.Process(), blockFrames * MIX_CHANNELS, reinterpret_cast<int16*>(audioBuffer.GetData()) + blockStart * MIX_CHANNELS);
 	}
 
+	for (uint32 v = 0; v < voiceMixes.GetLength(); ++v)
 	{
-		auto audioDataCopyFunction = [&](uint32 size, void* to)
-		{
-			GTSL::MemCopy(size, audioBuffer.GetData(), to);
-		};
-		
-		audioDevice.PushAudioData(audioDataCopyFunction, availableAudioFrames);
+		const auto& voiceMix = voiceMixes[v];
+		auto& voice = voices[voiceMix.Voice];
+
+		if (v < mixedVoiceCount && voiceMix.HRTF) { voice.LeftGain = 0.0f; voice.RightGain = 0.0f; voice.HRTFGain = voiceMix.Gain; }
+		else if (v < mixedVoiceCount) { voice.LeftGain = voiceMix.LeftGain; voice.RightGain = voiceMix.RightGain; voice.HRTFGain = 0.0f; }
+		else { voice.LeftGain = 0.0f; voice.RightGain = 0.0f; voice.HRTFGain = 0.0f; } //fade in when mixed again
+
+		if (voice.HRTFGain == 0.0f) { releaseHRTFSlot(voice); } //faded out of the HRTF this period
 	}
-	
-	for (uint32 i = 0; i < emittersToStop.GetLength(); ++i)
+
+	mixedVoices += mixedVoiceCount;
+	lastMixedVoices.store(mixedVoiceCount, std::memory_order_relaxed); lastVirtualVoices.store(voiceMixes.GetLength() - mixedVoiceCount, std::memory_order_relaxed);
+
+	mixMilliseconds += (BE::Application::Get()->GetClock()->GetCurrentMicroseconds() - mixStart).As<float32, GTSL::Seconds>() * 1000.0f;
+}
+
+void AudioSystem::renderOffline()
+{
+	processCommands();
+
+	//the whole render is mixed as fast as possible in fixed blocks, the virtual clock only advances by blocks so the output doesn't depend on timing
+	offlineRenderStart = BE::Application::Get()->GetClock()->GetCurrentMicroseconds();
+	const float32 previousMixMilliseconds = mixMilliseconds;
+
+	for (uint64 frame = 0; frame < offlineRenderFrames; frame += SoundMixer::BLOCK_FRAMES)
+	{
+		if (renderSceneEmitters.GetLength()) { advanceRenderScene(frame); }
+
+		const uint32 frames = static_cast<uint32>(GTSL::Math::Limit(static_cast<uint64>(SoundMixer::BLOCK_FRAMES), offlineRenderFrames - frame));
+		mix(frames);
+		wavAudioDevice.PushAudioData([&](const uint32 size, void* to) { GTSL::MemCopy(size, audioBuffer.GetData(), to); }, frames);
+
+		flushVoiceEvents(); VoiceEvent voiceEvent; //voices finishing mid render are released as they would be between updates
+		while (voiceEvents.Pop(voiceEvent)) { onVoiceFinished(voiceEvent); }
+	}
+
+	wavAudioDevice.Stop();
+	removeScriptedVoices(renderSceneEmitters);
+
+	const float32 renderedSeconds = static_cast<float32>(offlineRenderFrames) / static_cast<float32>(MIX_SAMPLE_RATE);
+	const float32 seconds = (BE::Application::Get()->GetClock()->GetCurrentMicroseconds() - offlineRenderStart).As<float32, GTSL::Seconds>();
+	BE_LOG_MESSAGE("Rendered ", renderedSeconds, " seconds of audio in ", seconds, " seconds, ", renderedSeconds / seconds, " seconds of audio per second, ",
+		renderedSeconds / GTSL::Math::Max((mixMilliseconds - previousMixMilliseconds) / 1000.0f, 0.000001f), " per second spent mixing. Hash: ", wavAudioDevice.GetHash());
+
+	const uint32 expectedHash = BE::Application::Get()->GetOption(Id("audioRenderHash"), 0);
+
+	if (expectedHash && expectedHash != wavAudioDevice.GetHash())
 	{
-		removePlayingEmitter(i);
+		BE_LOG_ERROR("Offline render doesn't match, expected hash ", expectedHash, " but got ", wavAudioDevice.GetHash());
+		BE::Application::Get()->Close(BE::Application::CloseMode::ERROR, GTSL::StaticString<64>("Offline audio render mismatch"));
 	}
+	else
+	{
+		if (expectedHash) { BE_LOG_SUCCESS("Offline render matches expected hash"); }
+		BE::Application::Get()->Close(BE::Application::CloseMode::OK, GTSL::StaticString<64>("Offline audio render finished"));
+	}
+
+	renderOfflineDone = true;
 }
 
-void AudioSystem::onAudioInfoLoad(TaskInfo taskInfo, AudioResourceManager* audioResourceManager, AudioResourceManager::AudioInfo audioInfo)
+void AudioSystem::benchmarkReverb()
 {
-	audioResourceManager->LoadAudio(taskInfo.GameInstance, audioInfo, onAudioLoadHandle);
+	constexpr uint32 IMPULSE_RESPONSE_FRAMES = MIX_SAMPLE_RATE * 10, RENDER_FRAMES = MIX_SAMPLE_RATE * 60;
+	constexpr uint32 PARTITIONS = (IMPULSE_RESPONSE_FRAMES + ConvolutionReverb::PARTITION_FRAMES - 1) / ConvolutionReverb::PARTITION_FRAMES;
+
+	uint32 seed = 1;
+	auto noise = [&seed]() { seed = seed * 1664525u + 1013904223u; return static_cast<float32>(seed >> 8) / 8388608.0f - 1.0f; };
+
+	GTSL::Buffer<BE::PAR> samplesBuffer; samplesBuffer.Allocate(IMPULSE_RESPONSE_FRAMES * MIX_CHANNELS * sizeof(float32), 16, GetPersistentAllocator());
+	auto* samples = reinterpret_cast<float32*>(samplesBuffer.GetData());
+
+	//exponentially decaying noise, a 3 second reverberation time
+	for (uint32 f = 0; f < IMPULSE_RESPONSE_FRAMES; ++f)
+	{
+		const float32 decay = std::exp(-6.9f * static_cast<float32>(f) / static_cast<float32>(MIX_SAMPLE_RATE * 3));
+		samples[f * MIX_CHANNELS] = noise() * decay; samples[f * MIX_CHANNELS + 1] = noise() * decay;
+	}
+
+	ConvolutionReverb benchmarkReverb; benchmarkReverb.Initialize(PARTITIONS, GetPersistentAllocator());
+	ConvolutionReverb::ImpulseResponse impulseResponse; impulseResponse.Build(benchmarkReverb.GetFFT(), samples, IMPULSE_RESPONSE_FRAMES, PARTITIONS, GetPersistentAllocator());
+	benchmarkReverb.SetImpulseResponse(0, &impulseResponse); benchmarkReverb.SetWeight(0, 1.0f);
+
+	float32 block[SoundMixer::BLOCK_FRAMES * MIX_CHANNELS];
+	for (auto& e : block) { e = noise() * 0.5f; }
+
+	const auto start = BE::Application::Get()->GetClock()->GetCurrentMicroseconds();
+
+	for (uint32 f = 0; f < RENDER_FRAMES; f += SoundMixer::BLOCK_FRAMES)
+	{
+		GTSL::MemCopy(sizeof(block), block, samples); //reverb adds to it's input
+		benchmarkReverb.Process(samples, SoundMixer::BLOCK_FRAMES);
+	}
+
+	const float32 seconds = (BE::Application::Get()->GetClock()->GetCurrentMicroseconds() - start).As<float32, GTSL::Seconds>();
+	BE_LOG_MESSAGE("Convolution reverb rendered 60 seconds through a 10 second impulse response in ", seconds, " seconds, real time factor ", seconds / 60.0f);
 }
 
-void AudioSystem::onAudioLoad(TaskInfo taskInfo, AudioResourceManager*, AudioResourceManager::AudioInfo audioInfo, GTSL::Range<const byte*> buffer)
+void AudioSystem::voiceStressTest()
 {
-	loadedSounds.EmplaceBack(audioInfo.Name);
-	GTSL::Array<uint32, 16> toDelete;
-	
-	for(uint32 i = 0; i < onHoldEmitters.GetLength(); ++i)
+	constexpr uint32 BLOCKS = 200, TONE_FRAMES = MIX_SAMPLE_RATE;
+	BE_ASSERT(VOICE_STRESS_TEST_EMITTERS <= maxAudioEmitters, "Voice stress test needs more emitters than maxAudioEmitters allows");
+
+	uint32 seed = 1;
+	auto random = [&seed]() { seed = seed * 1664525u + 1013904223u; return static_cast<float32>(seed >> 8) / 16777216.0f; };
+
+	GTSL::Buffer<BE::PAR> toneBuffer; toneBuffer.Allocate(TONE_FRAMES * MIX_FRAME_SIZE, 16, GetPersistentAllocator());
+	auto* tone = reinterpret_cast<float32*>(toneBuffer.GetData());
+	for (uint32 f = 0; f < TONE_FRAMES; ++f) { tone[f * MIX_CHANNELS] = tone[f * MIX_CHANNELS + 1] = std::sin(6.2831853f * 440.0f * static_cast<float32>(f) / static_cast<float32>(MIX_SAMPLE_RATE)) * 0.25f; }
+
+	GTSL::Vector<AudioEmitterHandle, BE::PAR> stressEmitters; stressEmitters.Initialize(VOICE_STRESS_TEST_EMITTERS, GetPersistentAllocator());
+
+	for (uint32 i = 0; i < VOICE_STRESS_TEST_EMITTERS; ++i)
 	{
-		if(audioEmittersSettings[onHoldEmitters[i]()].Name == audioInfo.Name)
-		{
-			toDelete.EmplaceBack(i);
-			playingEmitters.EmplaceBack(onHoldEmitters[i]);
-			//audioEmittersSettings[onHoldEmitters[i]()].PrivateSoundHandle = soundHandle;
+		const GTSL::Vector3 position((random() - 0.5f) * 200.0f, (random() - 0.5f) * 20.0f, (random() - 0.5f) * 200.0f);
+		const auto priority = static_cast<uint8>(random() * 4.0f); const auto startFrame = static_cast<uint32>(random() * (TONE_FRAMES - 1));
+		stressEmitters.EmplaceBack(addScriptedVoice(toneBuffer.GetData(), TONE_FRAMES, startFrame, position, priority));
+	}
+
+	const uint64 previousMixedVoices = mixedVoices; const float32 previousMixMilliseconds = mixMilliseconds;
+	uint64 mixed = 0, virtualized = 0; float32 totalMilliseconds = 0.0f, worstMilliseconds = 0.0f;
+
+	for (uint32 b = 0; b < BLOCKS; ++b)
+	{
+		const auto start = BE::Application::Get()->GetClock()->GetCurrentMicroseconds();
+		mix(SoundMixer::BLOCK_FRAMES);
+		const float32 milliseconds = (BE::Application::Get()->GetClock()->GetCurrentMicroseconds() - start).As<float32, GTSL::Seconds>() * 1000.0f;
+
+		uint32 blockMixed, blockVirtualized; GetVoiceCounts(blockMixed, blockVirtualized);
+		mixed += blockMixed; virtualized += blockVirtualized;
+		totalMilliseconds += milliseconds; worstMilliseconds = milliseconds > worstMilliseconds ? milliseconds : worstMilliseconds;
+	}
+
+	const float32 blockMilliseconds = static_cast<float32>(SoundMixer::BLOCK_FRAMES) * 1000.0f / static_cast<float32>(MIX_SAMPLE_RATE);
+	BE_LOG_MESSAGE("Voice stress test: ", VOICE_STRESS_TEST_EMITTERS, " emitters, ", mixed / BLOCKS, " voices mixed and ", virtualized / BLOCKS, " virtualized per block, mixing a ", blockMilliseconds,
+		" ms block took ", totalMilliseconds / static_cast<float32>(BLOCKS), " ms on average and ", worstMilliseconds, " ms at worst");
+
+	removeScriptedVoices(stressEmitters);
+	mixedVoices = previousMixedVoices; mixMilliseconds = previousMixMilliseconds; //don't skew the stats logged on shutdown
+}
+
+AudioEmitterHandle AudioSystem::addScriptedVoice(const byte* data, const uint32 frames, const uint32 startFrame, const GTSL::Vector3 position, const uint8 priority)
+{
+	const auto emitter = CreateAudioEmitter();
+
+	auto& voice = voices[emitter()];
+	voice.Name = Id("scriptedVoice"); voice.Data = data; voice.Frames = frames; voice.Samples = startFrame;
+	voice.Position = position; voice.Loop = true; voice.Priority = priority;
+
+	voice.Playing = true; voice.VoiceIndex = playingVoices.GetLength();
+	playingVoices.EmplaceBack(emitter());
+	return emitter;
+}
+
+void AudioSystem::removeScriptedVoices(GTSL::Vector<AudioEmitterHandle, BE::PAR>& emitters)
+{
+	for (auto e : emitters)
+	{
+		auto& voice = voices[e()];
+		
+		if (voice.Playing) { //removed without an event, gameplay code never knew about them
+			const auto last = playingVoices[playingVoices.GetLength() - 1];
+			playingVoices[voice.VoiceIndex] = last; voices[last].VoiceIndex = voice.VoiceIndex;
+			playingVoices.ResizeDown(playingVoices.GetLength() - 1);
+		}
+
+		releaseHRTFSlot(voice);
+		voice = Voice();
+		DestroyAudioEmitter(e);
+	}
+
+	emitters.ResizeDown(0);
+}
+
+void AudioSystem::setUpRenderScene()
+{
+	constexpr uint32 TONES = 8, SOUND_FRAMES = MIX_SAMPLE_RATE;
+
+	uint32 seed = 1;
+	auto random = [&seed]() { seed = seed * 1664525u + 1013904223u; return static_cast<float32>(seed >> 8) / 16777216.0f; };
+
+	//a second of each of TONES tones of harmonics of 110 Hz and one of noise, every sound loops seamlessly
+	renderSceneSamples.Allocate((TONES + 1) * SOUND_FRAMES * MIX_FRAME_SIZE, 16, GetPersistentAllocator());
+	auto* samples = reinterpret_cast<float32*>(renderSceneSamples.GetData());
+	
+	for (uint32 t = 0; t < TONES; ++t) {
+		for (uint32 f = 0; f < SOUND_FRAMES; ++f) {
+			const float32 sample = std::sin(6.2831853f * 110.0f * static_cast<float32>(t + 1) * static_cast<float32>(f) / static_cast<float32>(MIX_SAMPLE_RATE)) * 0.2f;
+			samples[(t * SOUND_FRAMES + f) * MIX_CHANNELS] = sample; samples[(t * SOUND_FRAMES + f) * MIX_CHANNELS + 1] = sample;
 		}
 	}
 
-	for (auto e : toDelete) { onHoldEmitters.Pop(e); }
+	for (uint32 f = 0; f < SOUND_FRAMES; ++f) { samples[(TONES * SOUND_FRAMES + f) * MIX_CHANNELS] = (random() - 0.5f) * 0.2f; samples[(TONES * SOUND_FRAMES + f) * MIX_CHANNELS + 1] = (random() - 0.5f) * 0.2f; }
+
+	renderSceneEmitters.Initialize(RENDER_SCENE_EMITTERS, GetPersistentAllocator());
+
+	//the first emitter is the noise, it orbits the listener, the rest are tones scattered around, more than are mixed at once
+	renderSceneEmitters.EmplaceBack(addScriptedVoice(renderSceneSamples.GetData() + TONES * SOUND_FRAMES * MIX_FRAME_SIZE, SOUND_FRAMES, 0, GTSL::Vector3(), 255));
+	
+	for (uint32 i = 1; i < RENDER_SCENE_EMITTERS; ++i)
+	{
+		const GTSL::Vector3 position((random() - 0.5f) * 60.0f, (random() - 0.5f) * 6.0f, (random() - 0.5f) * 60.0f);
+		renderSceneEmitters.EmplaceBack(addScriptedVoice(renderSceneSamples.GetData() + (i % TONES) * SOUND_FRAMES * MIX_FRAME_SIZE, SOUND_FRAMES, static_cast<uint32>(random() * (SOUND_FRAMES - 1)), position, static_cast<uint8>(random() * 4.0f)));
+	}
+}
+
+void AudioSystem::advanceRenderScene(const uint64 frame)
+{
+	const float32 seconds = static_cast<float32>(frame) / static_cast<float32>(MIX_SAMPLE_RATE);
+
+	//listener turns around slowly so voices pan across, the orbiting noise moves fast enough to be Doppler shifted and to cross in and out of the HRTF
+	listener.Position = GTSL::Vector3(); listener.Velocity = GTSL::Vector3();
+	listener.Orientation = GTSL::Quaternion(GTSL::AxisAngle(0.f, 1.0f, 0.f, seconds * 0.5f));
 
+	constexpr float32 ORBIT_RADIUS = 8.0f, ORBIT_SPEED = 1.5f;
+	auto& noise = voices[renderSceneEmitters[0]()];
+	noise.Position = GTSL::Vector3(std::cos(seconds * ORBIT_SPEED) * ORBIT_RADIUS, 0.0f, std::sin(seconds * ORBIT_SPEED) * ORBIT_RADIUS + ORBIT_RADIUS * 1.5f);
+	noise.Velocity = GTSL::Vector3(-std::sin(seconds * ORBIT_SPEED) * ORBIT_RADIUS * ORBIT_SPEED, 0.0f, std::cos(seconds * ORBIT_SPEED) * ORBIT_RADIUS * ORBIT_SPEED);
 }
@@ -1,111 +1,549 @@
 #pragma once
 
+#include <atomic>
+
 #include "ByteEngine/Handle.hpp"
 
 #include "ByteEngine/Game/System.h"
+#ifdef BE_PLATFORM_WIN
 #include <AAL/Platform/Windows/WindowsAudioDevice.h>
+#else
+#include "NullAudioDevice.h"
+#endif
+#include "WavAudioDevice.h"
 #include <GTSL/Array.hpp>
 #include <GTSL/Buffer.hpp>
+#include <GTSL/FlatHashMap.h>
+#include <GTSL/KeepVector.h>
 #include <GTSL/Math/Quaternion.h>
+#include <GTSL/Mutex.h>
+#include <GTSL/Thread.h>
+#include <GTSL/Vector.hpp>
+
+#include "AudioCommandQueue.h"
+#include "AudioMixing.h"
+#include "ConvolutionReverb.h"
+#include "ReverbVolume.h"
+#include "SoundListener.h"
+#include "SoundMixer.h"
+#include "Spatialization.h"
 
 #include "ByteEngine/Id.h"
 #include "ByteEngine/Game/Tasks.h"
 #include "ByteEngine/Resources/AudioResourceManager.h"
 
-class Sound;
-
 MAKE_HANDLE(uint32, AudioListener)
 MAKE_HANDLE(uint32, AudioEmitter)
+MAKE_HANDLE(uint8, ReverbVolume)
 
+/**
+ * \brief Mixes audio on it's own thread, which wakes every device period regardless of the frame rate so frame hitches don't cause dropouts.
+ * Gameplay code talks to the audio thread through a lock free command queue, everything the public interface returns is gameplay side state.
+ */
 class AudioSystem : public System
 {
 public:
 	AudioSystem();
 	~AudioSystem();
-	
+
 	void Initialize(const InitializeInfo& initializeInfo) override;
 	void Shutdown(const ShutdownInfo& shutdownInfo) override;
 
 	AudioListenerHandle CreateAudioListener();
 	AudioEmitterHandle CreateAudioEmitter();
+	void DestroyAudioEmitter(AudioEmitterHandle audioEmitter);
 
 	void BindAudio(AudioEmitterHandle audioEmitter, Id audioToPlay);
+	/**
+	 * \brief Starts playing the emitter's sound from the beginning, or restarts it if it's already playing. Sounds which aren't resident start once loaded.
+	 */
 	void PlayAudio(AudioEmitterHandle audioEmitter);
-	
-	void SetPosition(AudioEmitterHandle audioEmitterHandle, const GTSL::Vector3 position) { audioEmittersLocation[audioEmitterHandle()] = position; }
-	void SetPosition(AudioListenerHandle audioListenerHandle, const GTSL::Vector3 position) { audioListenersLocation[audioListenerHandle()] = position; }
-	
-	GTSL::Vector3 GetPosition(const AudioListenerHandle audioListenerHandle) const { return audioListenersLocation[audioListenerHandle()]; }
-	GTSL::Vector3 GetPosition(const AudioEmitterHandle audioEmitterHandle) const { return audioEmittersLocation[audioEmitterHandle()]; }
-	
-	void SetOrientation(AudioListenerHandle audioListenerHandle, const GTSL::Quaternion orientation) { audioListenersOrientation[audioListenerHandle()] = orientation; }
-	GTSL::Quaternion GetOrientation(AudioListenerHandle audioListenerHandle) const { return audioListenersOrientation[audioListenerHandle()]; }
-	
-	void SetAudioListener(const AudioListenerHandle audioListenerHandle) { activeAudioListenerHandle = audioListenerHandle; }
-
-	void SetLooping(const AudioEmitterHandle audioEmitterHandle, bool loop) { audioEmittersSettings[audioEmitterHandle()].Loop = loop; }
-	bool GetLooping(const AudioEmitterHandle audioEmitterHandle) { return audioEmittersSettings[audioEmitterHandle()].Loop; }
+	void StopAudio(AudioEmitterHandle audioEmitter);
+
+	void SetPosition(AudioEmitterHandle audioEmitterHandle, GTSL::Vector3 position);
+	void SetPosition(AudioListenerHandle audioListenerHandle, GTSL::Vector3 position);
+
+	GTSL::Vector3 GetPosition(const AudioListenerHandle audioListenerHandle) const { return audioListeners[audioListenerHandle()].Position; }
+	GTSL::Vector3 GetPosition(const AudioEmitterHandle audioEmitterHandle) const { return audioEmitters[audioEmitterHandle()].Position; }
+
+	void SetOrientation(AudioListenerHandle audioListenerHandle, GTSL::Quaternion orientation);
+	GTSL::Quaternion GetOrientation(AudioListenerHandle audioListenerHandle) const { return audioListeners[audioListenerHandle()].Orientation; }
+
+	/**
+	 * \brief Velocities shift the pitch of resident sounds by the Doppler effect. Streamed sounds always play at their recorded pitch.
+	 */
+	void SetVelocity(AudioEmitterHandle audioEmitterHandle, GTSL::Vector3 velocity);
+	void SetVelocity(AudioListenerHandle audioListenerHandle, GTSL::Vector3 velocity);
+
+	void SetAttenuation(AudioEmitterHandle audioEmitterHandle, const AttenuationSettings& attenuationSettings);
+
+	void SetAudioListener(AudioListenerHandle audioListenerHandle);
+
+	void SetLooping(AudioEmitterHandle audioEmitterHandle, bool loop);
+	bool GetLooping(const AudioEmitterHandle audioEmitterHandle) { return audioEmitters[audioEmitterHandle()].Loop; }
+
+	/**
+	 * \brief When more voices play than can be mixed the ones with the lowest priority, and then the quietest, are virtualized. Virtual voices keep
+	 * advancing but aren't mixed, so they resume in the right place when they become audible again.
+	 *
+	 * Of the mixed voices the closest ones, up to the "maxHRTFVoices" option, are rendered through the HRTF and the rest are panned.
+	 */
+	void SetPriority(AudioEmitterHandle audioEmitterHandle, uint8 priority);
+
+	/**
+	 * \brief Returns the number of voices mixed in the last block and the number of voices virtualized.
+	 */
+	void GetVoiceCounts(uint32& mixed, uint32& virtualized) const { mixed = lastMixedVoices.load(std::memory_order_relaxed); virtualized = lastVirtualVoices.load(std::memory_order_relaxed); }
+
+	/**
+	 * \brief Creates a mixing bus feeding output. Emitters play into the master bus until they are assigned one.
+	 */
+	SoundBusHandle CreateBus(Id name, SoundBusHandle output = SoundMixer::GetMasterBus());
+	SoundBusHandle GetBus(const Id name) { return buses.At(name); }
+
+	/**
+	 * \brief Routes bus into output, routings that would form a cycle are ignored.
+	 */
+	void SetBusOutput(SoundBusHandle bus, SoundBusHandle output);
+	void SetBusGain(SoundBusHandle bus, float32 gain);
+	void SetBusEffect(SoundBusHandle bus, uint8 slot, const SoundMixer::EffectSettings& effectSettings);
+
+	void SetBus(AudioEmitterHandle audioEmitterHandle, SoundBusHandle bus);
+
+	/**
+	 * \brief Adds a reverb volume, whose impulse response is blended into the reverb bus by how far inside the volume the listener is. Impulse responses
+	 * are sounds, always loaded whole regardless of their length, and are cut to the "maxReverbSeconds" option. Volumes last until shutdown.
+	 */
+	ReverbVolumeHandle CreateReverbVolume(const ReverbVolume& reverbVolume, Id impulseResponse);
+
+	/**
+	 * \brief Sets the bus reverb volumes reverberate, the master bus by default.
+	 */
+	void SetReverbBus(SoundBusHandle bus);
 
 private:
+#ifdef BE_PLATFORM_WIN
 	using AudioDevice = AAL::WindowsAudioDevice;
+	using StreamShareMode = AAL::StreamShareMode;
+#else
+	using AudioDevice = NullAudioDevice;
+	using StreamShareMode = NullAudioDevice::StreamShareMode;
+#endif
 
 	static constexpr uint8 WAV_RIGHT_CHANNEL = 0, WAV_LEFT_CHANNEL = 1;
-	
+
+	/**
+	 * \brief Voices mixed per block when the "maxAudioVoices" option isn't set.
+	 */
+	static constexpr uint32 DEFAULT_MAX_MIXED_VOICES = 64;
+
+	/**
+	 * \brief Voices rendered through the HRTF when the "maxHRTFVoices" option isn't set. Convolution costs about as much as panning 20 voices.
+	 */
+	static constexpr uint32 DEFAULT_MAX_HRTF_VOICES = 8;
+
+	/**
+	 * \brief Longest impulse response when the "maxReverbSeconds" option isn't set. Reverb keeps a history of input spectra as long as this.
+	 */
+	static constexpr uint32 DEFAULT_MAX_REVERB_SECONDS = 10;
+
+	/**
+	 * \brief Emitters that can exist at once when the "maxAudioEmitters" option isn't set. Voice storage is sized for this up front so the audio thread never allocates.
+	 */
+	static constexpr uint32 DEFAULT_MAX_AUDIO_EMITTERS = 8192;
+
+	/**
+	 * \brief How often the audio thread wakes up to mix. Must be shorter than the device's buffer.
+	 */
+	static constexpr uint32 MIX_PERIOD_MICROSECONDS = 5000;
+
 	AudioDevice audioDevice;
 	AudioDevice::MixFormat mixFormat;
 
-	GTSL::Array<uint8, 8> audioListeners;
-	GTSL::Array<GTSL::Vector3, 8> audioListenersLocation;
-	GTSL::Array<GTSL::Quaternion, 8> audioListenersOrientation;
-	
-	GTSL::Array<GTSL::Vector3, 8> audioEmittersLocation;
+	/**
+	 * \brief Set through the "audioRenderSeconds" option, renders that many seconds to AudioRender.wav next to the executable instead of playing them
+	 * and closes the application. There's no audio thread, the first update sends it's commands and mixes the whole render in SoundMixer::BLOCK_FRAMES
+	 * blocks as fast as possible, so a render only depends on what the game did before it and is bit exact between runs. If the "audioRenderHash"
+	 * option is set the render's hash is checked against it and the application closes with an error when they differ.
+	 * The golden hash CI checks is the one of the built-in scene, rendered with "audioRenderScene=1" and "audioRenderSeconds=30" in settings.ini
+	 * and no game commands. To regenerate it after an intended change to the mixer run once without "audioRenderHash" and copy the logged hash.
+	 */
+	bool renderingOffline = false, renderOfflineDone = false;
+	WavAudioDevice wavAudioDevice;
+	uint64 offlineRenderFrames = 0;
+	GTSL::Microseconds offlineRenderStart;
+
+	/**
+	 * \brief Mixes the whole render to the file and closes the application.
+	 */
+	void renderOffline();
 
-	MAKE_HANDLE(uint32, PrivateSound);
-	
-	struct AudioEmitterSettings
+	/**
+	 * \brief Set through the "audioRenderScene" option, RENDER_SCENE_EMITTERS looping procedural voices, more than are mixed at once, around a
+	 * listener that turns, with a noise voice orbiting it fast enough to be Doppler shifted. Doesn't depend on any asset so it's hash can be checked anywhere.
+	 */
+	void setUpRenderScene();
+	/**
+	 * \brief Moves the scene's listener and orbiting voice to where they are at frame, only depends on frame so the render is deterministic.
+	 */
+	void advanceRenderScene(uint64 frame);
+	GTSL::Buffer<BE::PAR> renderSceneSamples;
+	GTSL::Vector<AudioEmitterHandle, BE::PAR> renderSceneEmitters;
+	static constexpr uint32 RENDER_SCENE_EMITTERS = 96;
+
+	enum class VoiceState : uint8
+	{
+		STOPPED, ON_HOLD, PLAYING
+	};
+
+	enum class CommandType : uint8
+	{
+		PLAY, STOP, SET_EMITTER_POSITION, SET_EMITTER_VELOCITY, SET_ATTENUATION, SET_LOOPING, SET_PRIORITY, SET_EMITTER_BUS, SET_LISTENER, ADD_BUS, SET_BUS_OUTPUT, SET_BUS_GAIN, SET_BUS_EFFECT, SET_REVERB_VOLUME, SET_REVERB_BUS
+	};
+
+	/**
+	 * \brief Sent from gameplay code to the audio thread. Target is an emitter for emitter commands and a bus for bus commands.
+	 */
+	struct AudioCommand
 	{
+		CommandType Type = CommandType::STOP;
+
+		uint32 Target = 0;
+
+		/**
+		 * \brief PLAY: voice being started, reported back when it finishes so gameplay code can release it's sound.
+		 */
+		uint32 Generation = 0;
+		Id Name;
+		const byte* Data = nullptr; uint32 Frames = 0;
+		bool Streamed = false;
+		AudioStreamHandle Stream;
+
+		GTSL::Vector3 Position, Velocity;
+		GTSL::Quaternion Orientation;
+		AttenuationSettings Attenuation;
 		bool Loop = false;
-		//PrivateSoundHandle PrivateSoundHandle;
+		uint8 Priority = 0;
+
+		/**
+		 * \brief Bus an emitter plays into, or the output of a bus.
+		 */
+		SoundBusHandle Bus = SoundMixer::GetMasterBus();
+		float32 Gain = 1.0f;
+		uint8 Slot = 0;
+		SoundMixer::EffectSettings Effect;
+
+		ReverbVolume Reverb;
+		const ConvolutionReverb::ImpulseResponse* ImpulseResponse = nullptr;
+	};
+
+	/**
+	 * \brief Sent from the audio thread to gameplay code when a voice stops playing, for any reason.
+	 */
+	struct VoiceEvent
+	{
+		AudioEmitterHandle Emitter;
+		uint32 Generation = 0;
 		Id Name;
-		uint32 Samples = 0;
+		bool Streamed = false;
+		AudioStreamHandle Stream;
 	};
-	GTSL::Array<AudioEmitterSettings, 8> audioEmittersSettings;
-	
-	GTSL::Array<AudioEmitterHandle, 8> playingEmitters;
 
-	GTSL::Array<Id, 8> lastRequestedAudios;
+	/**
+	 * \brief Gameplay code is the only producer, commands are only pushed from the public interface and the update task.
+	 */
+	SPSCQueue<AudioCommand, 1024> commands;
+	SPSCQueue<VoiceEvent, 256> voiceEvents;
 
-	GTSL::Array<AudioEmitterHandle, 8> onHoldEmitters;
-	
-	GTSL::Buffer<BE::PAR> audioBuffer;
-	DynamicTaskHandle<AudioResourceManager*, AudioResourceManager::AudioInfo> onAudioInfoLoadHandle;
-	DynamicTaskHandle<AudioResourceManager*, AudioResourceManager::AudioInfo, GTSL::Range<const byte*>> onAudioLoadHandle;
+	//gameplay side, only touched by the public interface and the update task
 
+	GTSL::Vector<SoundListener, BE::PAR> audioListeners;
 	AudioListenerHandle activeAudioListenerHandle;
 
-	GTSL::Vector<Id, BE::PAR> loadedSounds;
+	struct AudioEmitter
+	{
+		bool Loop = false;
+		Id Name;
+		GTSL::Vector3 Position, Velocity;
+		AttenuationSettings Attenuation;
+		uint8 Priority = 0;
+		SoundBusHandle Bus = SoundMixer::GetMasterBus();
+
+		VoiceState State = VoiceState::STOPPED;
+		/**
+		 * \brief Voice last sent to the audio thread for this emitter, events of older voices don't change the emitter's state.
+		 */
+		uint32 Generation = 0;
+		/**
+		 * \brief Index of the emitter in onHoldEmitters while it's ON_HOLD.
+		 */
+		uint32 VoiceIndex = 0;
+	};
+	GTSL::KeepVector<AudioEmitter, BE::PAR> audioEmitters;
+
+	/**
+	 * \brief Emitters waiting for their sound to be loaded.
+	 */
+	GTSL::Vector<AudioEmitterHandle, BE::PAR> onHoldEmitters;
 
-	template<typename T>
-	auto getSample(byte* buffer, const uint32 availableSamples, const uint32 sample, const uint32 channel) -> T&
+	GTSL::Vector<Id, BE::PAR> lastRequestedAudios;
+
+	struct Sound
 	{
-		return *reinterpret_cast<T*>(buffer + (channel * availableSamples * mixFormat.GetFrameSize()) + (sample * mixFormat.GetFrameSize()));
+		/**
+		 * \brief Whether this system holds a reference to the sound in the AudioResourceManager. A reference is only kept while some emitter is playing or waiting to play it.
+		 */
+		bool Loaded = false;
+		bool Requested = false;
+		/**
+		 * \brief Voices playing or waiting to play the sound, without counting streamed ones.
+		 */
+		uint32 Users = 0;
 	};
+	GTSL::FlatHashMap<Id, Sound, BE::PAR> sounds;
+
+	/**
+	 * \brief Sounds loaded by resource tasks, which can run at any time, waiting to be handled by the update task.
+	 */
+	GTSL::Vector<Id, BE::PAR> loadedAudios;
+	GTSL::Mutex loadedAudiosMutex;
+
+	uint32 nextGeneration = 1;
+
+	GTSL::FlatHashMap<Id, SoundBusHandle, BE::PAR> buses;
+	uint8 busCount = 1; //master is always there
 
-	template<typename T>
-	auto getIntertwinedSample(byte* buffer, const uint32 availableSamples, const uint32 sample, const uint32 channel) -> T&
+	struct ReverbVolumeData
 	{
-		return *(reinterpret_cast<T*>(buffer) + sample * 2 + channel);
+		ReverbVolume Volume;
+		Id ImpulseResponse;
+		/**
+		 * \brief Whether the impulse response was transformed and handed to the audio thread, until then the volume holds a user of it's sound.
+		 */
+		bool Built = false;
 	};
-	
+	ReverbVolumeData reverbVolumes[ConvolutionReverb::MAX_IMPULSE_RESPONSES];
+	uint8 reverbVolumeCount = 0;
+	ConvolutionReverb::ImpulseResponse impulseResponses[ConvolutionReverb::MAX_IMPULSE_RESPONSES];
+	SoundBusHandle reverbBus = SoundMixer::GetMasterBus();
+	uint32 maxReverbSeconds = DEFAULT_MAX_REVERB_SECONDS;
+
+	/**
+	 * \brief Whether the audio thread is running.
+	 */
+	bool audioThreadStarted = false;
+
+	/**
+	 * \brief Whether anything consumes commands, either the audio thread or offline rendering. If not commands are dropped.
+	 */
+	[[nodiscard]] bool isMixing() const { return audioThreadStarted || renderingOffline; }
+
+	/**
+	 * \brief Milliseconds the update task stalls every SIMULATED_STALL_INTERVAL updates, set through the "simulatedFrameStall" option to measure
+	 * the audio thread's resilience to frame hitches.
+	 */
+	uint32 simulatedFrameStall = 0, updateCount = 0;
+	static constexpr uint32 SIMULATED_STALL_INTERVAL = 64;
+
+	DynamicTaskHandle<AudioResourceManager*, AudioResourceManager::AudioInfo> onAudioInfoLoadHandle;
+	DynamicTaskHandle<AudioResourceManager*, AudioResourceManager::AudioInfo, GTSL::Range<const byte*>> onAudioLoadHandle;
+	DynamicTaskHandle<AudioResourceManager*, AudioResourceManager::AudioInfo> onImpulseResponseInfoLoadHandle;
+
+	void update(TaskInfo);
 	void requestAudioStreams();
-	void render(TaskInfo);
 
-	void removePlayingEmitter(uint32 i)
-	{
-		audioEmittersSettings[playingEmitters[i]()].Samples = 0;
-		playingEmitters.Pop(i);
-	}
-	
+	/**
+	 * \brief Pushes a command for the audio thread, waiting for room if the queue is full. When rendering offline a full queue is applied right away instead.
+	 */
+	void pushCommand(const AudioCommand& command);
+
+	Sound& getSound(Id name);
+	void requestSound(Id name);
+	void releaseSound(Id name);
+
+	/**
+	 * \brief Sends the emitter's sound to the audio thread as a new voice.
+	 */
+	void sendPlay(AudioEmitterHandle audioEmitter, bool streamed, AudioStreamHandle stream);
+	void onSoundLoaded(Id name);
+	void onVoiceFinished(const VoiceEvent& voiceEvent);
+	void removeOnHoldEmitter(uint32 index);
+	void buildImpulseResponse(uint8 reverbVolume);
+
 	void onAudioInfoLoad(TaskInfo taskInfo, AudioResourceManager*, AudioResourceManager::AudioInfo audioInfo);
 	void onAudioLoad(TaskInfo taskInfo, AudioResourceManager*, AudioResourceManager::AudioInfo audioInfo, GTSL::Range<const byte*> buffer);
+	/**
+	 * \brief Loads impulse responses whole, they are never streamed.
+	 */
+	void onImpulseResponseInfoLoad(TaskInfo taskInfo, AudioResourceManager*, AudioResourceManager::AudioInfo audioInfo);
+
+	/**
+	 * \brief Set through the "reverbBenchmark" option, renders a 10 second impulse response over 60 seconds of noise offline and logs the real time factor.
+	 */
+	void benchmarkReverb();
+
+	/**
+	 * \brief Set through the "voiceStressTest" option, mixes VOICE_STRESS_TEST_EMITTERS looping emitters scattered around the listener and logs
+	 * how many of them were really mixed and how long each block took, so virtualization is exercised at a realistic scale.
+	 */
+	void voiceStressTest();
+	static constexpr uint32 VOICE_STRESS_TEST_EMITTERS = 5000;
+
+	/**
+	 * \brief Plays a looping voice straight from data, starting at startFrame. Voices are made directly so tests don't depend on any asset and never report back to gameplay code.
+	 */
+	AudioEmitterHandle addScriptedVoice(const byte* data, uint32 frames, uint32 startFrame, GTSL::Vector3 position, uint8 priority);
+	/**
+	 * \brief Stops and destroys emitters made by addScriptedVoice without sending events, and empties emitters.
+	 */
+	void removeScriptedVoices(GTSL::Vector<AudioEmitterHandle, BE::PAR>& emitters);
+
+	//audio thread side, only touched by the audio thread while it runs
+
+	GTSL::Thread audioThread;
+	std::atomic<bool> runAudioThread{ false };
+
+	static constexpr uint32 NO_HRTF_SLOT = 0xFFFFFFFF;
+
+	struct Voice
+	{
+		Id Name;
+		/**
+		 * \brief Resident sound data, null for streamed voices.
+		 */
+		const byte* Data = nullptr;
+		uint32 Frames = 0, Samples = 0;
+		bool Streamed = false;
+		AudioStreamHandle Stream;
+		uint32 Generation = 0;
+
+		GTSL::Vector3 Position, Velocity;
+		AttenuationSettings Attenuation;
+		bool Loop = false;
+		uint8 Priority = 0;
+		SoundBusHandle Bus = SoundMixer::GetMasterBus();
+
+		/**
+		 * \brief Frames the voice advances per output frame, and how far between Samples and the next frame it is. Only resident voices are Doppler shifted.
+		 */
+		float32 Rate = 1.0f, Fraction = 0.0f;
+
+		bool Playing = false;
+		/**
+		 * \brief Index of the voice in playingVoices while it's playing. Lets voices start and stop in constant time.
+		 */
+		uint32 VoiceIndex = 0;
+
+		/**
+		 * \brief Gains the voice was last mixed with, the next block ramps from them to the new ones.
+		 */
+		float32 LeftGain = 0.0f, RightGain = 0.0f;
+
+		/**
+		 * \brief HRTF convolver the voice is rendered through, NO_HRTF_SLOT if it's panned, and the gain it was last rendered with.
+		 */
+		uint32 HRTFSlot = NO_HRTF_SLOT; float32 HRTFGain = 0.0f;
+
+		/**
+		 * \brief Last HRTF::PARTITION_FRAMES mono frames the voice rendered, lets the panned path be delayed as much as the HRTF's when the voice switches between them.
+		 */
+		float32 PannedHistory[HRTF::PARTITION_FRAMES]{};
+	};
+
+	/**
+	 * \brief Voices indexed by emitter handle, one per possible emitter.
+	 */
+	GTSL::Vector<Voice, BE::PAR> voices;
+	uint32 maxAudioEmitters = DEFAULT_MAX_AUDIO_EMITTERS;
+	GTSL::Vector<uint32, BE::PAR> playingVoices;
+
+	/**
+	 * \brief Events that didn't fit in voiceEvents, sent on the next period. Holds up to twice maxAudioEmitters, see processCommands.
+	 */
+	GTSL::Vector<VoiceEvent, BE::PAR> pendingVoiceEvents;
+
+	struct VoiceMix
+	{
+		uint32 Voice; uint8 Priority; float32 LeftGain, RightGain;
+		/**
+		 * \brief Distance attenuation, distance to the listener, dot product of the direction to the voice with the listener's right vector and Doppler factor.
+		 */
+		float32 Gain, Distance, Rightness, Rate;
+		bool HRTF;
+		float32 GetAudibility() const { return LeftGain > RightGain ? LeftGain : RightGain; }
+	};
+	GTSL::Vector<VoiceMix, BE::PAR> voiceMixes;
+
+	SoundListener listener;
+
+	HRTF hrtf;
+	/**
+	 * \brief One convolver per voice that can be rendered through the HRTF, allocated up front so the audio thread never allocates.
+	 */
+	GTSL::Vector<HRTFConvolver, BE::PAR> hrtfConvolvers;
+	GTSL::Vector<uint32, BE::PAR> freeHRTFSlots;
+	uint32 maxHRTFVoices = DEFAULT_MAX_HRTF_VOICES;
+
+	/**
+	 * \brief Initialized by the first reverb volume, from the gameplay side before the audio thread is told about it.
+	 */
+	ConvolutionReverb reverb;
+	ReverbVolume reverbVolumeShapes[ConvolutionReverb::MAX_IMPULSE_RESPONSES];
+	/**
+	 * \brief Bit per reverb volume whose impulse response the audio thread has.
+	 */
+	uint8 readyReverbVolumes = 0;
+
+	/**
+	 * \brief Mono samples of the voice being mixed, rendered once and then panned or convolved.
+	 */
+	GTSL::Buffer<BE::PAR> voiceSamples;
+	/**
+	 * \brief A voice's PannedHistory followed by it's block, the panned path reads from the start of it while crossfading with the HRTF.
+	 */
+	GTSL::Buffer<BE::PAR> delayedVoiceSamples;
+
+	GTSL::Buffer<BE::PAR> audioBuffer;
+	/**
+	 * \brief Voices are mixed into it's buses a block at a time, the master bus is then converted to the device format in audioBuffer.
+	 */
+	SoundMixer soundMixer;
+
+	uint32 maxMixedVoices = DEFAULT_MAX_MIXED_VOICES;
+	std::atomic<uint32> lastMixedVoices{ 0 }, lastVirtualVoices{ 0 };
+
+	/**
+	 * \brief Voices mixed and time spent mixing them, to report mixing cost.
+	 */
+	uint64 mixedVoices = 0; float32 mixMilliseconds = 0.0f;
+
+	void runAudio();
+	/**
+	 * \brief Applies queued commands. Stops early and returns false while too many voice events are pending, so pendingVoiceEvents never has to grow.
+	 */
+	bool processCommands();
+	/**
+	 * \brief Mixes frames frames into audioBuffer.
+	 */
+	void mix(uint32 frames);
+
+	/**
+	 * \brief Advances a playing voice by frames, writing it's samples downmixed to mono into mono unless it's nullptr. Frames past the end of the sound are silent.
+	 * \return Whether the voice reached the end of it's sound and has to stop.
+	 */
+	bool renderVoice(Voice& voice, AudioResourceManager* audioResourceManager, uint32 frames, float32* mono);
+	void releaseHRTFSlot(Voice& voice);
+
+	/**
+	 * \brief Weighs reverb volumes by the listener's position. Overlapping volumes share the blend, weights never add up to more than 1.
+	 */
+	void updateReverbWeights();
+
+	Voice& getVoice(uint32 emitter);
+
+	/**
+	 * \brief Stops a playing voice and reports it to gameplay code.
+	 */
+	void finishVoice(uint32 emitter);
+	void flushVoiceEvents();
 };
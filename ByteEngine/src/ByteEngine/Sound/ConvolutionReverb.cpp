@@ -0,0 +1,114 @@
+#include "ConvolutionReverb.h"
+
+#include <GTSL/Memory.h>
+#include <GTSL/Math/Math.hpp>
+
+namespace
+{
+	/**
+	 * \brief Most a weight changes per partition, fades take about 100 milliseconds.
+	 */
+	constexpr float32 WEIGHT_STEP = static_cast<float32>(ConvolutionReverb::PARTITION_FRAMES) / (0.1f * static_cast<float32>(MIX_SAMPLE_RATE));
+}
+
+void ConvolutionReverb::ImpulseResponse::Build(const FFT& fft, const float32* samples, const uint32 frames, const uint32 maxPartitions, const BE::PAR& allocator)
+{
+	partitions = GTSL::Math::Limit((frames + PARTITION_FRAMES - 1) / PARTITION_FRAMES, maxPartitions);
+
+	spectraBuffer.Allocate(partitions * FFT_SIZE * 2 * sizeof(float32), 16, allocator);
+	spectra = reinterpret_cast<float32*>(spectraBuffer.GetData());
+
+	for (uint32 p = 0; p < partitions; ++p)
+	{
+		float32* real = spectra + p * FFT_SIZE * 2; float32* imaginary = real + FFT_SIZE;
+
+		//transforms are linear, so transforming left + i * right gives left's spectrum + i * right's spectrum
+		for (uint32 i = 0; i < FFT_SIZE; ++i)
+		{
+			const uint32 frame = p * PARTITION_FRAMES + i;
+			const bool inside = i < PARTITION_FRAMES && frame < frames;
+			real[i] = inside ? samples[frame * MIX_CHANNELS] : 0.0f; imaginary[i] = inside ? samples[frame * MIX_CHANNELS + 1] : 0.0f;
+		}
+
+		fft.Forward(real, imaginary);
+
+		for (uint32 i = 0; i < FFT_SIZE * 2; ++i) { real[i] /= static_cast<float32>(FFT_SIZE); } //fold the inverse transform's scale in
+	}
+}
+
+void ConvolutionReverb::Initialize(const uint32 maxPartitions, const BE::PAR& allocator)
+{
+	this->maxPartitions = maxPartitions;
+
+	fft.Initialize(FFT_SIZE, allocator);
+
+	historyBuffer.Allocate(maxPartitions * FFT_SIZE * 2 * sizeof(float32), 16, allocator);
+	history = reinterpret_cast<float32*>(historyBuffer.GetData());
+	GTSL::SetMemory(maxPartitions * FFT_SIZE * 2 * sizeof(float32), history, 0);
+
+	GTSL::SetMemory(sizeof(input), input, 0); GTSL::SetMemory(sizeof(output), output, 0); GTSL::SetMemory(sizeof(tail), tail, 0);
+}
+
+void ConvolutionReverb::Process(float32* samples, const uint32 frames)
+{
+	for (uint32 f = 0; f < frames;)
+	{
+		const uint32 length = GTSL::Math::Limit(PARTITION_FRAMES - filled, frames - f);
+
+		for (uint32 i = 0; i < length; ++i)
+		{
+			float32* frame = samples + (f + i) * MIX_CHANNELS;
+			input[filled + i] = (frame[0] + frame[1]) * 0.5f;
+			frame[0] += output[(filled + i) * MIX_CHANNELS]; frame[1] += output[(filled + i) * MIX_CHANNELS + 1];
+		}
+
+		filled += length; f += length;
+
+		if (filled == PARTITION_FRAMES) { processPartition(); filled = 0; }
+	}
+}
+
+void ConvolutionReverb::processPartition()
+{
+	newest = (newest + 1) % maxPartitions;
+	float32* spectrum = history + newest * FFT_SIZE * 2;
+
+	for (uint32 i = 0; i < FFT_SIZE; ++i) { spectrum[i] = i < PARTITION_FRAMES ? input[i] : 0.0f; spectrum[FFT_SIZE + i] = 0.0f; }
+	fft.Forward(spectrum, spectrum + FFT_SIZE);
+
+	bool blended = false;
+
+	for (uint8 r = 0; r < MAX_IMPULSE_RESPONSES; ++r)
+	{
+		weights[r] = GTSL::Math::Clamp(targetWeights[r], weights[r] - WEIGHT_STEP, weights[r] + WEIGHT_STEP);
+
+		const auto* impulseResponse = impulseResponses[r];
+		if (!impulseResponse || weights[r] == 0.0f) { continue; }
+
+		GTSL::SetMemory(sizeof(accumulation), accumulation, 0);
+
+		//partition p of the response is applied to the input from p partitions ago
+		for (uint32 p = 0; p < impulseResponse->GetPartitions(); ++p)
+		{
+			const float32* past = history + (newest + maxPartitions - p) % maxPartitions * FFT_SIZE * 2;
+			const float32* response = impulseResponse->GetSpectrum(p);
+			MultiplyAccumulateSpectra(past, past + FFT_SIZE, response, response + FFT_SIZE, FFT_SIZE, accumulation, accumulation + FFT_SIZE);
+		}
+
+		const float32 weight = weights[r];
+		if (blended) { for (uint32 i = 0; i < FFT_SIZE * 2; ++i) { blend[i] += accumulation[i] * weight; } }
+		else { for (uint32 i = 0; i < FFT_SIZE * 2; ++i) { blend[i] = accumulation[i] * weight; } }
+		blended = true;
+	}
+
+	//nothing blended, only what's left of the previous partitions' reverberation plays
+	if (!blended) { GTSL::SetMemory(sizeof(blend), blend, 0); }
+	else { fft.Inverse(blend, blend + FFT_SIZE); }
+
+	//left is the real part and right the imaginary part
+	for (uint32 i = 0; i < PARTITION_FRAMES; ++i)
+	{
+		output[i * MIX_CHANNELS] = blend[i] + tail[i * MIX_CHANNELS]; output[i * MIX_CHANNELS + 1] = blend[FFT_SIZE + i] + tail[i * MIX_CHANNELS + 1];
+		tail[i * MIX_CHANNELS] = blend[PARTITION_FRAMES + i]; tail[i * MIX_CHANNELS + 1] = blend[FFT_SIZE + PARTITION_FRAMES + i];
+	}
+}
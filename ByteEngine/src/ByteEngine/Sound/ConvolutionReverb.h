@@ -0,0 +1,88 @@
+#pragma once
+
+#include <GTSL/Buffer.hpp>
+
+#include "ByteEngine/Core.h"
+#include "ByteEngine/Application/AllocatorReferences.h"
+
+#include "AudioMixing.h"
+#include "FFT.h"
+
+/**
+ * \brief Reverberates a bus by convolving it with a blend of impulse responses, with uniformly partitioned overlap add convolution.
+ * The bus is summed to mono, convolved with stereo impulse responses and the result is added to it, delayed by PARTITION_FRAMES frames.
+ *
+ * Every partition of input is transformed once into a history of spectra shared by all impulse responses. Each response is multiplied and
+ * accumulated against the history, weighted, and a single inverse transform produces the blend of all of them. Cost grows with the length of
+ * the responses being blended, a response with a weight of 0 costs nothing.
+ */
+class ConvolutionReverb
+{
+public:
+	static constexpr uint32 PARTITION_FRAMES = 256, FFT_SIZE = PARTITION_FRAMES * 2;
+	static constexpr uint8 MAX_IMPULSE_RESPONSES = 8;
+
+	/**
+	 * \brief Spectra of the partitions of a stereo impulse response in the mix format, left channel in the real part and right in the imaginary part.
+	 */
+	class ImpulseResponse
+	{
+	public:
+		/**
+		 * \brief Transforms the response, can run on any thread. Responses longer than maxPartitions partitions are truncated.
+		 */
+		void Build(const FFT& fft, const float32* samples, uint32 frames, uint32 maxPartitions, const BE::PAR& allocator);
+
+		[[nodiscard]] uint32 GetPartitions() const { return partitions; }
+		[[nodiscard]] const float32* GetSpectrum(const uint32 partition) const { return spectra + partition * FFT_SIZE * 2; }
+
+	private:
+		GTSL::Buffer<BE::PAR> spectraBuffer;
+		float32* spectra = nullptr;
+		uint32 partitions = 0;
+	};
+
+	/**
+	 * \brief Allocates the history for responses up to maxPartitions partitions long.
+	 */
+	void Initialize(uint32 maxPartitions, const BE::PAR& allocator);
+
+	[[nodiscard]] bool IsInitialized() const { return maxPartitions != 0; }
+	[[nodiscard]] uint32 GetMaxPartitions() const { return maxPartitions; }
+	[[nodiscard]] const FFT& GetFFT() const { return fft; }
+
+	void SetImpulseResponse(uint8 index, const ImpulseResponse* impulseResponse) { impulseResponses[index] = impulseResponse; }
+
+	/**
+	 * \brief Sets the gain a response is blended in with. Weights move towards the set value over about 100 milliseconds.
+	 */
+	void SetWeight(const uint8 index, const float32 weight) { targetWeights[index] = weight; }
+
+	/**
+	 * \brief Adds the reverberation of frames interleaved stereo frames to them.
+	 */
+	void Process(float32* samples, uint32 frames);
+
+private:
+	FFT fft;
+
+	GTSL::Buffer<BE::PAR> historyBuffer;
+	/**
+	 * \brief Spectra of the last maxPartitions input partitions, real parts followed by imaginary parts. newest is the last one transformed.
+	 */
+	float32* history = nullptr;
+	uint32 maxPartitions = 0, newest = 0;
+
+	float32 input[PARTITION_FRAMES], output[PARTITION_FRAMES * MIX_CHANNELS], tail[PARTITION_FRAMES * MIX_CHANNELS];
+	uint32 filled = 0;
+
+	/**
+	 * \brief Blend of every response, and the accumulation of the response being processed.
+	 */
+	float32 blend[FFT_SIZE * 2], accumulation[FFT_SIZE * 2];
+
+	const ImpulseResponse* impulseResponses[MAX_IMPULSE_RESPONSES]{};
+	float32 weights[MAX_IMPULSE_RESPONSES]{}, targetWeights[MAX_IMPULSE_RESPONSES]{};
+
+	void processPartition();
+};
@@ -0,0 +1,135 @@
+#include "FFT.h"
+
+#include <cmath>
+#include <emmintrin.h>
+
+namespace
+{
+	constexpr float64 PI = 3.14159265358979323846;
+}
+
+void FFT::Initialize(const uint32 size, const BE::PAR& allocator)
+{
+	this->size = size;
+	log2Size = 0; while ((1u << log2Size) < size) { ++log2Size; }
+
+	uint32 twiddleCount = 0;
+	for (uint32 quarter = log2Size % 2 ? 2 : 1; quarter * 4 <= size; quarter *= 4) { twiddleCount += quarter * 6; }
+
+	tables.Allocate(twiddleCount * sizeof(float32) + size * sizeof(uint32), 16, allocator);
+	twiddles = reinterpret_cast<float32*>(tables.GetData()); bitReversal = reinterpret_cast<uint32*>(twiddles + twiddleCount);
+
+	float32* stageTwiddles = twiddles;
+
+	for (uint32 quarter = log2Size % 2 ? 2 : 1; quarter * 4 <= size; quarter *= 4)
+	{
+		for (uint32 k = 0; k < quarter; ++k)
+		{
+			for (uint32 power = 1; power <= 3; ++power)
+			{
+				const float64 angle = -2.0 * PI * static_cast<float64>(k * power) / static_cast<float64>(quarter * 4);
+				stageTwiddles[(power - 1) * 2 * quarter + k] = static_cast<float32>(std::cos(angle)); stageTwiddles[((power - 1) * 2 + 1) * quarter + k] = static_cast<float32>(std::sin(angle));
+			}
+		}
+
+		stageTwiddles += quarter * 6;
+	}
+
+	for (uint32 i = 0; i < size; ++i)
+	{
+		uint32 reversed = 0;
+		for (uint32 b = 0; b < log2Size; ++b) { reversed |= (i >> b & 1) << (log2Size - 1 - b); }
+		bitReversal[i] = reversed;
+	}
+}
+
+void FFT::Forward(float32* real, float32* imaginary) const
+{
+	for (uint32 i = 0; i < size; ++i)
+	{
+		const uint32 j = bitReversal[i];
+		if (i < j) { const float32 r = real[i], m = imaginary[i]; real[i] = real[j]; imaginary[i] = imaginary[j]; real[j] = r; imaginary[j] = m; }
+	}
+
+	uint32 quarter = 1;
+
+	if (log2Size % 2)
+	{
+		for (uint32 i = 0; i < size; i += 2)
+		{
+			const float32 r = real[i + 1], m = imaginary[i + 1];
+			real[i + 1] = real[i] - r; imaginary[i + 1] = imaginary[i] - m;
+			real[i] += r; imaginary[i] += m;
+		}
+
+		quarter = 2;
+	}
+
+	//input is in bit reversed order, so the 4 blocks are in the order 0 2 1 3 of a radix 4 decimation in time. With W = e^(-2 pi i k / 4q):
+	//X0 = (x0 + W^2 x1) + (W x2 + W^3 x3), X2 = (x0 + W^2 x1) - (W x2 + W^3 x3), X1 = (x0 - W^2 x1) - i (W x2 - W^3 x3), X3 = (x0 - W^2 x1) + i (W x2 - W^3 x3)
+	for (const float32* stageTwiddles = twiddles; quarter * 4 <= size; stageTwiddles += quarter * 6, quarter *= 4)
+	{
+		const float32* w1r = stageTwiddles; const float32* w1i = w1r + quarter; const float32* w2r = w1i + quarter; const float32* w2i = w2r + quarter;
+		const float32* w3r = w2i + quarter; const float32* w3i = w3r + quarter;
+
+		for (uint32 start = 0; start < size; start += quarter * 4)
+		{
+			float32* r0 = real + start; float32* r1 = r0 + quarter; float32* r2 = r1 + quarter; float32* r3 = r2 + quarter;
+			float32* i0 = imaginary + start; float32* i1 = i0 + quarter; float32* i2 = i1 + quarter; float32* i3 = i2 + quarter;
+
+			uint32 k = 0;
+
+			for (; k + 4 <= quarter; k += 4) //first stages are too short for vectors
+			{
+				const __m128 x1r = _mm_loadu_ps(r1 + k), x1i = _mm_loadu_ps(i1 + k), x2r = _mm_loadu_ps(r2 + k), x2i = _mm_loadu_ps(i2 + k);
+				const __m128 x3r = _mm_loadu_ps(r3 + k), x3i = _mm_loadu_ps(i3 + k);
+				const __m128 c1r = _mm_loadu_ps(w1r + k), c1i = _mm_loadu_ps(w1i + k), c2r = _mm_loadu_ps(w2r + k), c2i = _mm_loadu_ps(w2i + k);
+				const __m128 c3r = _mm_loadu_ps(w3r + k), c3i = _mm_loadu_ps(w3i + k);
+
+				const __m128 tr = _mm_sub_ps(_mm_mul_ps(x1r, c2r), _mm_mul_ps(x1i, c2i)), ti = _mm_add_ps(_mm_mul_ps(x1r, c2i), _mm_mul_ps(x1i, c2r));
+				const __m128 ar = _mm_sub_ps(_mm_mul_ps(x2r, c1r), _mm_mul_ps(x2i, c1i)), ai = _mm_add_ps(_mm_mul_ps(x2r, c1i), _mm_mul_ps(x2i, c1r));
+				const __m128 br = _mm_sub_ps(_mm_mul_ps(x3r, c3r), _mm_mul_ps(x3i, c3i)), bi = _mm_add_ps(_mm_mul_ps(x3r, c3i), _mm_mul_ps(x3i, c3r));
+
+				const __m128 x0r = _mm_loadu_ps(r0 + k), x0i = _mm_loadu_ps(i0 + k);
+				const __m128 s0r = _mm_add_ps(x0r, tr), s0i = _mm_add_ps(x0i, ti), s1r = _mm_sub_ps(x0r, tr), s1i = _mm_sub_ps(x0i, ti);
+				const __m128 pr = _mm_add_ps(ar, br), pi = _mm_add_ps(ai, bi), dr = _mm_sub_ps(ar, br), di = _mm_sub_ps(ai, bi);
+
+				_mm_storeu_ps(r0 + k, _mm_add_ps(s0r, pr)); _mm_storeu_ps(i0 + k, _mm_add_ps(s0i, pi));
+				_mm_storeu_ps(r2 + k, _mm_sub_ps(s0r, pr)); _mm_storeu_ps(i2 + k, _mm_sub_ps(s0i, pi));
+				_mm_storeu_ps(r1 + k, _mm_add_ps(s1r, di)); _mm_storeu_ps(i1 + k, _mm_sub_ps(s1i, dr));
+				_mm_storeu_ps(r3 + k, _mm_sub_ps(s1r, di)); _mm_storeu_ps(i3 + k, _mm_add_ps(s1i, dr));
+			}
+
+			for (; k < quarter; ++k)
+			{
+				const float32 tr = r1[k] * w2r[k] - i1[k] * w2i[k], ti = r1[k] * w2i[k] + i1[k] * w2r[k];
+				const float32 ar = r2[k] * w1r[k] - i2[k] * w1i[k], ai = r2[k] * w1i[k] + i2[k] * w1r[k];
+				const float32 br = r3[k] * w3r[k] - i3[k] * w3i[k], bi = r3[k] * w3i[k] + i3[k] * w3r[k];
+
+				const float32 s0r = r0[k] + tr, s0i = i0[k] + ti, s1r = r0[k] - tr, s1i = i0[k] - ti;
+				const float32 pr = ar + br, pi = ai + bi, dr = ar - br, di = ai - bi;
+
+				r0[k] = s0r + pr; i0[k] = s0i + pi; r2[k] = s0r - pr; i2[k] = s0i - pi;
+				r1[k] = s1r + di; i1[k] = s1i - dr; r3[k] = s1r - di; i3[k] = s1i + dr;
+			}
+		}
+	}
+}
+
+void MultiplyAccumulateSpectra(const float32* aReal, const float32* aImaginary, const float32* bReal, const float32* bImaginary, const uint32 length, float32* real, float32* imaginary)
+{
+	uint32 i = 0;
+
+	for (; i + 4 <= length; i += 4)
+	{
+		const __m128 ar = _mm_loadu_ps(aReal + i), ai = _mm_loadu_ps(aImaginary + i), br = _mm_loadu_ps(bReal + i), bi = _mm_loadu_ps(bImaginary + i);
+		_mm_storeu_ps(real + i, _mm_add_ps(_mm_loadu_ps(real + i), _mm_sub_ps(_mm_mul_ps(ar, br), _mm_mul_ps(ai, bi))));
+		_mm_storeu_ps(imaginary + i, _mm_add_ps(_mm_loadu_ps(imaginary + i), _mm_add_ps(_mm_mul_ps(ar, bi), _mm_mul_ps(ai, br))));
+	}
+
+	for (; i < length; ++i)
+	{
+		real[i] += aReal[i] * bReal[i] - aImaginary[i] * bImaginary[i];
+		imaginary[i] += aReal[i] * bImaginary[i] + aImaginary[i] * bReal[i];
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <GTSL/Buffer.hpp>
+
+#include "ByteEngine/Core.h"
+#include "ByteEngine/Application/AllocatorReferences.h"
+
+/**
+ * \brief Complex fast Fourier transform of a fixed power of two size. Values are stored split, real and imaginary parts in separate arrays,
+ * so butterflies work on 4 values at a time with SSE without shuffling.
+ *
+ * Stages are radix 4, which does two radix 2 stages in one pass over the data with 3 instead of 4 complex multiplies per 4 values.
+ * Sizes with an odd power of two start with one radix 2 stage.
+ */
+class FFT
+{
+public:
+	void Initialize(uint32 size, const BE::PAR& allocator);
+
+	[[nodiscard]] uint32 GetSize() const { return size; }
+
+	/**
+	 * \brief Transforms size values in place.
+	 */
+	void Forward(float32* real, float32* imaginary) const;
+
+	/**
+	 * \brief Inverse transforms size values in place, without dividing by size. Done as a forward transform with the real and imaginary parts swapped.
+	 */
+	void Inverse(float32* real, float32* imaginary) const { Forward(imaginary, real); }
+
+private:
+	uint32 size = 0, log2Size = 0;
+
+	GTSL::Buffer<BE::PAR> tables;
+	/**
+	 * \brief Twiddle factors of every radix 4 stage stored one after the other. A stage combining 4 blocks of length q stores 6 arrays of q values,
+	 * the real and imaginary parts of W^k, W^2k and W^3k with W = e^(-2 pi i / 4q).
+	 */
+	float32* twiddles = nullptr;
+	uint32* bitReversal = nullptr;
+};
+
+/**
+ * \brief Adds the element wise product of two split complex spectra of length values to an accumulator.
+ */
+void MultiplyAccumulateSpectra(const float32* aReal, const float32* aImaginary, const float32* bReal, const float32* bImaginary, uint32 length, float32* real, float32* imaginary);
@@ -0,0 +1,33 @@
+#include "NullAudioDevice.h"
+
+#include <GTSL/Math/Math.hpp>
+
+void NullAudioDevice::CreateAudioStream(StreamShareMode, const MixFormat& mixFormat)
+{
+	frameSize = mixFormat.GetFrameSize();
+	samplesPerSecond = mixFormat.SamplesPerSecond;
+	bufferFrames = GTSL::Math::Limit(samplesPerSecond * BUFFER_MILLISECONDS / 1000, MAX_BUFFER_BYTES / frameSize);
+}
+
+void NullAudioDevice::Start()
+{
+	writtenFrames = 0;
+	running = true;
+}
+
+void NullAudioDevice::GetAvailableBufferFrames(uint32& availableFrames)
+{
+	if (!running) { availableFrames = 0; return; }
+	if (!writtenFrames) { availableFrames = bufferFrames; return; }
+
+	const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+	const uint64 playedFrames = static_cast<uint64>(elapsed) * samplesPerSecond / 1000000;
+
+	if (playedFrames > writtenFrames) { //buffer ran dry, the device played silence until now
+		++underruns;
+		underrunFrames += playedFrames - writtenFrames;
+		writtenFrames = playedFrames;
+	}
+
+	availableFrames = bufferFrames - static_cast<uint32>(GTSL::Math::Limit(writtenFrames - playedFrames, static_cast<uint64>(bufferFrames)));
+}
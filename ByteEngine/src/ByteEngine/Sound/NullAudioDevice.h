@@ -0,0 +1,77 @@
+#pragma once
+
+#include <chrono>
+
+#include "ByteEngine/Core.h"
+
+/**
+ * \brief Audio device that outputs nothing, used where there is no audio backend such as Linux build machines.
+ * Pushed frames are consumed in real time at the stream's sample rate, so the mixer has to keep it fed like real hardware.
+ * Every time the buffer runs dry an underrun is counted, which makes mixing stalls measurable without speakers.
+ */
+class NullAudioDevice
+{
+public:
+	enum class StreamShareMode : uint8 { SHARED, EXCLUSIVE };
+	enum class BufferSamplePlacement : uint8 { INTERLEAVED, PLANAR };
+
+	struct CreateInfo {};
+
+	struct MixFormat
+	{
+		uint16 BitsPerSample = 16, NumberOfChannels = 2;
+		uint32 SamplesPerSecond = 48000;
+
+		[[nodiscard]] uint32 GetFrameSize() const { return BitsPerSample / 8 * NumberOfChannels; }
+	};
+
+	void Initialize(const CreateInfo&) {}
+	[[nodiscard]] bool IsMixFormatSupported(StreamShareMode, const MixFormat& mixFormat) const { return mixFormat.BitsPerSample == 16 && mixFormat.NumberOfChannels && mixFormat.SamplesPerSecond; }
+	void CreateAudioStream(StreamShareMode, const MixFormat& mixFormat);
+	[[nodiscard]] BufferSamplePlacement GetBufferSamplePlacement() const { return BufferSamplePlacement::INTERLEAVED; }
+
+	void Start();
+	void Stop() { running = false; }
+	void Destroy() {}
+
+	/**
+	 * \brief Returns how many frames can be pushed without overwriting frames that haven't been played yet.
+	 */
+	void GetAvailableBufferFrames(uint32& availableFrames);
+
+	/**
+	 * \param copyFunction Callable as copyFunction(uint32 bytes, void* to), it's handed a buffer with room for frames frames to write to.
+	 */
+	template<typename F>
+	void PushAudioData(F&& copyFunction, const uint32 frames)
+	{
+		if (!writtenFrames) { startTime = std::chrono::steady_clock::now(); } //playback starts with the first pushed frame
+		copyFunction(frames * frameSize, sink);
+		writtenFrames += frames;
+	}
+
+	/**
+	 * \brief Returns the number of times the buffer ran dry and how many frames of silence were played because of it.
+	 */
+	void GetUnderruns(uint32& underrunCount, uint64& silentFrames) const { underrunCount = underruns; silentFrames = underrunFrames; }
+
+private:
+	static constexpr uint32 BUFFER_MILLISECONDS = 40;
+	static constexpr uint32 MAX_BUFFER_BYTES = 32768;
+
+	uint32 frameSize = 4, bufferFrames = 0, samplesPerSecond = 48000;
+	bool running = false;
+	std::chrono::steady_clock::time_point startTime;
+
+	/**
+	 * \brief Frames the device would have played so far if it never ran dry.
+	 */
+	uint64 writtenFrames = 0;
+
+	uint32 underruns = 0; uint64 underrunFrames = 0;
+
+	/**
+	 * \brief Pushed frames are written here and discarded.
+	 */
+	alignas(16) byte sink[MAX_BUFFER_BYTES];
+};
@@ -1,15 +1,42 @@
 #pragma once
 
-#include "Utility/Shapes/Box.h"
+#include <GTSL/Math/Math.hpp>
+#include <GTSL/Math/Vector3.h>
 
-#include "Math/Vector3.h"
+#include "ByteEngine/Core.h"
+#include "Utility/Shapes/BoxWithFalloff.h"
 
+/**
+ * \brief Region of the world sounds reverberate in. Listeners inside the box hear the volume's impulse response fully, it fades out linearly
+ * over the box's falloff distance outside it.
+ */
 class ReverbVolume
 {
+public:
+	/**
+	 * \brief Center of the box, which is axis aligned.
+	 */
+	GTSL::Vector3 Position;
+
 	/**
 	 * \brief Defines the space this reverb volume takes up.
 	 */
-	Box extent;
+	BoxWithFalloff Extent;
+
+	/**
+	 * \brief Gain of the reverberated signal when the volume is fully applied.
+	 */
+	float32 WetGain = 0.5f;
+
+	[[nodiscard]] float32 GetWeight(const GTSL::Vector3 point) const
+	{
+		//distance from point to the box, 0 inside it
+		const float32 x = GTSL::Math::Max(GTSL::Math::Abs(point.X() - Position.X()) - Extent.GetWidth() / 2, 0.0f);
+		const float32 y = GTSL::Math::Max(GTSL::Math::Abs(point.Y() - Position.Y()) - Extent.GetHeight() / 2, 0.0f);
+		const float32 z = GTSL::Math::Max(GTSL::Math::Abs(point.Z() - Position.Z()) - Extent.GetDepth() / 2, 0.0f);
+		const float32 distance = GTSL::Math::Length(GTSL::Vector3(x, y, z));
 
-	void (*decayFunction)(float&, const Vector3&) = nullptr;
+		if (distance == 0.0f) { return 1.0f; }
+		return Extent.falloffDistance > 0.0f ? GTSL::Math::Max(1.0f - distance / Extent.falloffDistance, 0.0f) : 0.0f;
+	}
 };
@@ -1,9 +1,18 @@
 #pragma once
 
+#include <GTSL/Math/Quaternion.h>
+#include <GTSL/Math/Vector3.h>
+
 /**
  * \brief Describes a sound listener, which represents a point in space from which to capture 3D sound in a game world.
  */
 class SoundListener
 {
 public:
+	GTSL::Vector3 Position;
+	GTSL::Quaternion Orientation;
+	/**
+	 * \brief World units per second the listener moves at, shifts the pitch of emitters it moves towards or away from.
+	 */
+	GTSL::Vector3 Velocity;
 };
@@ -0,0 +1,218 @@
+#include "SoundMixer.h"
+
+#include "ConvolutionReverb.h"
+
+#include <cmath>
+#include <emmintrin.h>
+
+#include <GTSL/Memory.h>
+
+namespace
+{
+	constexpr float32 PI = 3.14159265358979f;
+
+	/**
+	 * \brief Scales frames of interleaved stereo source by a gain ramp and adds them to destination, or overwrites it when accumulate is false.
+	 * Processes 2 frames per iteration with SSE.
+	 */
+	void addScaled(const float32* source, const uint32 frames, const GainRamp gain, float32* destination, const bool accumulate)
+	{
+		if (!frames) { return; }
+
+		const float32 step = (gain.End - gain.Start) / static_cast<float32>(frames);
+
+		//lanes hold left and right of two consecutive frames, which share a gain
+		const __m128 increment = _mm_set1_ps(step * 2.0f);
+		__m128 gains = _mm_set_ps(gain.Start + step, gain.Start + step, gain.Start, gain.Start);
+
+		uint32 f = 0;
+
+		for (; f + 2 <= frames; f += 2)
+		{
+			const __m128 scaled = _mm_mul_ps(_mm_loadu_ps(source + f * MIX_CHANNELS), gains);
+			_mm_storeu_ps(destination + f * MIX_CHANNELS, accumulate ? _mm_add_ps(_mm_loadu_ps(destination + f * MIX_CHANNELS), scaled) : scaled);
+			gains = _mm_add_ps(gains, increment);
+		}
+
+		for (; f < frames; ++f)
+		{
+			const float32 frameGain = gain.Start + step * static_cast<float32>(f);
+
+			for (uint8 c = 0; c < MIX_CHANNELS; ++c)
+			{
+				const float32 scaled = source[f * MIX_CHANNELS + c] * frameGain;
+				destination[f * MIX_CHANNELS + c] = accumulate ? destination[f * MIX_CHANNELS + c] + scaled : scaled;
+			}
+		}
+	}
+}
+
+void SoundMixer::Initialize(const uint32 sampleRate, const BE::PAR& allocator)
+{
+	this->sampleRate = sampleRate;
+
+	busBuffer.Allocate(MAX_BUSES * BLOCK_FRAMES * MIX_FRAME_SIZE, 16, allocator);
+	busSamples = reinterpret_cast<float32*>(busBuffer.GetData());
+
+	buses[GetMasterBus()()].Active = true; buses[GetMasterBus()()].Output = GetMasterBus();
+	sortBuses();
+}
+
+void SoundMixer::AddBus(const SoundBusHandle bus, const SoundBusHandle output)
+{
+	auto& newBus = buses[bus()];
+	if (newBus.Active || !buses[output()].Active) { return; }
+
+	newBus = Bus();
+	newBus.Active = true; newBus.Output = output;
+	sortBuses();
+}
+
+void SoundMixer::SetOutput(const SoundBusHandle bus, const SoundBusHandle output)
+{
+	if (bus == GetMasterBus() || !buses[output()].Active || feeds(bus, output)) { return; }
+
+	buses[bus()].Output = output;
+	sortBuses();
+}
+
+void SoundMixer::SetEffect(const SoundBusHandle bus, const uint8 slot, const EffectSettings& settings)
+{
+	auto& effect = buses[bus()].Effects[slot];
+
+	if (effect.Type != settings.Type) { effect = Effect(); effect.Type = settings.Type; }
+
+	if (settings.Type == EffectType::COMPRESSOR)
+	{
+		const float32 rate = static_cast<float32>(sampleRate);
+		effect.Threshold = std::pow(10.0f, settings.ThresholdDecibels / 20.0f);
+		effect.Slope = 1.0f / settings.Ratio - 1.0f;
+		effect.AttackCoefficient = std::exp(-1.0f / (settings.AttackMilliseconds * 0.001f * rate));
+		effect.ReleaseCoefficient = std::exp(-1.0f / (settings.ReleaseMilliseconds * 0.001f * rate));
+		return;
+	}
+
+	//RBJ audio EQ cookbook, coefficients are divided by a0
+	const float32 w0 = 2.0f * PI * settings.Frequency / static_cast<float32>(sampleRate);
+	const float32 cosW0 = std::cos(w0), alpha = std::sin(w0) / (2.0f * settings.Q);
+	const float32 a = std::pow(10.0f, settings.GainDecibels / 40.0f), shelfAlpha = 2.0f * std::sqrt(a) * alpha;
+
+	float32 b0 = 1.0f, b1 = 0.0f, b2 = 0.0f, a0 = 1.0f, a1 = 0.0f, a2 = 0.0f;
+
+	switch (settings.Type)
+	{
+	case EffectType::NONE: case EffectType::COMPRESSOR: break;
+	case EffectType::LOW_PASS:
+		b0 = (1.0f - cosW0) / 2.0f; b1 = 1.0f - cosW0; b2 = b0;
+		a0 = 1.0f + alpha; a1 = -2.0f * cosW0; a2 = 1.0f - alpha; break;
+	case EffectType::HIGH_PASS:
+		b0 = (1.0f + cosW0) / 2.0f; b1 = -(1.0f + cosW0); b2 = b0;
+		a0 = 1.0f + alpha; a1 = -2.0f * cosW0; a2 = 1.0f - alpha; break;
+	case EffectType::PEAK:
+		b0 = 1.0f + alpha * a; b1 = -2.0f * cosW0; b2 = 1.0f - alpha * a;
+		a0 = 1.0f + alpha / a; a1 = -2.0f * cosW0; a2 = 1.0f - alpha / a; break;
+	case EffectType::LOW_SHELF:
+		b0 = a * ((a + 1.0f) - (a - 1.0f) * cosW0 + shelfAlpha); b1 = 2.0f * a * ((a - 1.0f) - (a + 1.0f) * cosW0); b2 = a * ((a + 1.0f) - (a - 1.0f) * cosW0 - shelfAlpha);
+		a0 = (a + 1.0f) + (a - 1.0f) * cosW0 + shelfAlpha; a1 = -2.0f * ((a - 1.0f) + (a + 1.0f) * cosW0); a2 = (a + 1.0f) + (a - 1.0f) * cosW0 - shelfAlpha; break;
+	case EffectType::HIGH_SHELF:
+		b0 = a * ((a + 1.0f) + (a - 1.0f) * cosW0 + shelfAlpha); b1 = -2.0f * a * ((a - 1.0f) + (a + 1.0f) * cosW0); b2 = a * ((a + 1.0f) + (a - 1.0f) * cosW0 - shelfAlpha);
+		a0 = (a + 1.0f) - (a - 1.0f) * cosW0 + shelfAlpha; a1 = 2.0f * ((a - 1.0f) - (a + 1.0f) * cosW0); a2 = (a + 1.0f) - (a - 1.0f) * cosW0 - shelfAlpha; break;
+	}
+
+	effect.B0 = b0 / a0; effect.B1 = b1 / a0; effect.B2 = b2 / a0; effect.A1 = a1 / a0; effect.A2 = a2 / a0;
+}
+
+void SoundMixer::BeginBlock(const uint32 frames)
+{
+	blockFrames = frames;
+	for (uint8 i = 0; i < orderLength; ++i) { GTSL::SetMemory(frames * MIX_FRAME_SIZE, GetBusSamples(order[i]), 0); }
+}
+
+const float32* SoundMixer::Process()
+{
+	for (uint8 i = 0; i < orderLength; ++i)
+	{
+		auto& bus = buses[order[i]()];
+		float32* samples = GetBusSamples(order[i]);
+
+		for (auto& e : bus.Effects) { if (e.Type != EffectType::NONE) { processEffect(e, samples); } }
+		if (bus.Reverb) { bus.Reverb->Process(samples, blockFrames); }
+
+		//master is last and is scaled in place, every other bus is added into it's output which hasn't been processed yet
+		const GainRamp gain{ bus.Gain, bus.TargetGain };
+		if (order[i] == GetMasterBus()) { addScaled(samples, blockFrames, gain, samples, false); }
+		else { addScaled(samples, blockFrames, gain, GetBusSamples(bus.Output), true); }
+		bus.Gain = bus.TargetGain;
+	}
+
+	return GetBusSamples(GetMasterBus());
+}
+
+bool SoundMixer::feeds(const SoundBusHandle bus, const SoundBusHandle output) const
+{
+	for (auto b = output; ; b = buses[b()].Output)
+	{
+		if (b == bus) { return true; }
+		if (b == GetMasterBus()) { return false; }
+	}
+}
+
+void SoundMixer::sortBuses()
+{
+	uint8 depths[MAX_BUSES];
+	orderLength = 0;
+
+	for (uint8 b = 0; b < MAX_BUSES; ++b)
+	{
+		if (!buses[b].Active) { continue; }
+
+		uint8 depth = 0;
+		for (auto o = SoundBusHandle(b); o != GetMasterBus(); o = buses[o()].Output) { ++depth; }
+
+		//insertion sort by decreasing distance to master, a bus is always deeper than it's output
+		uint8 i = orderLength++;
+		for (; i > 0 && depths[i - 1] < depth; --i) { order[i] = order[i - 1]; depths[i] = depths[i - 1]; }
+		order[i] = SoundBusHandle(b); depths[i] = depth;
+	}
+}
+
+void SoundMixer::processEffect(Effect& effect, float32* samples) const
+{
+	if (effect.Type == EffectType::COMPRESSOR)
+	{
+		//stereo linked peak envelope, so the image doesn't shift when one side is compressed
+		float32 envelope = effect.Envelope;
+
+		for (uint32 f = 0; f < blockFrames; ++f)
+		{
+			const float32 level = std::fmax(std::fabs(samples[f * MIX_CHANNELS]), std::fabs(samples[f * MIX_CHANNELS + 1]));
+			const float32 coefficient = level > envelope ? effect.AttackCoefficient : effect.ReleaseCoefficient;
+			envelope = coefficient * envelope + (1.0f - coefficient) * level;
+
+			if (envelope > effect.Threshold)
+			{
+				const float32 gain = std::pow(envelope / effect.Threshold, effect.Slope);
+				samples[f * MIX_CHANNELS] *= gain; samples[f * MIX_CHANNELS + 1] *= gain;
+			}
+		}
+
+		effect.Envelope = envelope;
+		return;
+	}
+
+	for (uint8 c = 0; c < MIX_CHANNELS; ++c)
+	{
+		float32 s1 = effect.State[c][0], s2 = effect.State[c][1];
+
+		for (uint32 f = 0; f < blockFrames; ++f)
+		{
+			float32& sample = samples[f * MIX_CHANNELS + c];
+			const float32 x = sample, y = effect.B0 * x + s1;
+			s1 = effect.B1 * x - effect.A1 * y + s2;
+			s2 = effect.B2 * x - effect.A2 * y;
+			sample = y;
+		}
+
+		effect.State[c][0] = s1; effect.State[c][1] = s2;
+	}
+}
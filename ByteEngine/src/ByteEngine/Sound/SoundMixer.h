@@ -1,127 +1,139 @@
 #pragma once
 
-#include <GTSL/Id.h>
-
-#include "SoundPlayer.h"
-#include <GTSL/Vector.hpp>
-#include <GTSL/Pair.h>
-#include <GTSL/Array.hpp>
+#include <GTSL/Buffer.hpp>
 
+#include "ByteEngine/Core.h"
+#include "ByteEngine/Handle.hpp"
 #include "ByteEngine/Application/AllocatorReferences.h"
 
-class AudioBuffer;
-
-class SoundMixerChannelEffect
-{
-	/**
-	* \brief Defines the effect's name. Used to refer to it.
-	*/
-	GTSL::Id64 effectName;
+#include "AudioMixing.h"
 
-	/**
-	 * \brief Determines the effects intensity when used in a channel.
-	 */
-	float effectIntensity = 0.0f;
+MAKE_HANDLE(uint8, SoundBus)
 
-public:
-	virtual ~SoundMixerChannelEffect();
-
-	virtual void Process(const AudioBuffer& _AudioBuffer) = 0;
-};
+class ConvolutionReverb;
 
 /**
- * \brief Structure to specify the details of the deletion of an audio channel effect.\n
- * Like the fade out time, or the fade out function.
+ * \brief Graph of mixing buses. Voices are mixed into a bus, every bus runs it's effect chain, applies it's gain and is added into it's output bus,
+ * down to the master bus. Buses are processed a whole block at a time in topological order, so a bus is complete before it's output reads it.
+ *
+ * All memory is allocated by Initialize, adding buses or changing effects never allocates so everything can be driven from the audio thread.
+ * Effects are plain data dispatched once per block, there are no per sample virtual calls.
  */
-struct SoundMixerChannelEffectRemoveParameters
+class SoundMixer
 {
+public:
+	static constexpr uint8 MAX_BUSES = 64;
+	static constexpr uint8 MAX_EFFECTS_PER_BUS = 8;
+
 	/**
-	 * \brief Determines the time it takes for this effect to be faded out.\n
-	 * If KillTime is 0 the effect will be deleted immediately.
+	 * \brief Frames processed per block, voices and buses are processed in blocks of at most this many frames.
 	 */
-	float FadeOutTime = 0.0f;
+	static constexpr uint32 BLOCK_FRAMES = 512;
+
+	enum class EffectType : uint8
+	{
+		NONE, LOW_PASS, HIGH_PASS, PEAK, LOW_SHELF, HIGH_SHELF, COMPRESSOR
+	};
 
 	/**
-	 * \brief Pointer to the function to be used for fading out the effect. If any fading out is applied at all.
+	 * \brief Settings of an effect slot. Filters are RBJ biquads, an equalizer is a chain of PEAK and shelf slots.
 	 */
-	void (*FadeFunction)() = nullptr;
-};
-
-class SoundMixer
-{
-	class SoundMixerChannel
+	struct EffectSettings
 	{
-		friend class SoundMixer;
+		EffectType Type = EffectType::NONE;
 
 		/**
-		 * \brief Defines the type for a Pair holding a bool to determine whether the sound is virtualized, and a Player* to know which Player to grab the data from.
+		 * \brief Filters: cutoff, center or corner frequency in hertz, quality factor and boost or cut in decibels. Gain is only used by PEAK and shelves.
 		 */
-		using PlayingSounds = GTSL::Pair<bool, SoundPlayer*>;
-
+		float32 Frequency = 1000.0f, Q = 0.7071f, GainDecibels = 0.0f;
 
 		/**
-		 * \brief Determines how strong this channel sounds.
+		 * \brief Compressor: level above which gain is reduced, input to output ratio above it, and envelope times.
 		 */
-		float mixVolume = 0.0f;
+		float32 ThresholdDecibels = -12.0f, Ratio = 4.0f, AttackMilliseconds = 10.0f, ReleaseMilliseconds = 100.0f;
+	};
 
-		/**
-		 * \brief Defines the channel's name. Used to refer to it from the mixer.
-		 */
-		GTSL::Id64 channelName;
+	void Initialize(uint32 sampleRate, const BE::PAR& allocator);
 
-		/**
-		 * \brief Holds an array of sounds which are to be played.
-		 */
-		GTSL::Vector<PlayingSounds, BE::PersistentAllocatorReference> playingSounds;
+	static SoundBusHandle GetMasterBus() { return SoundBusHandle(0); }
 
-		/**
-		 * \brief Holds the collection of effects this channel has. Every channel can have a maximum of 10 simultaneous effects running on it.
-		 */
-		GTSL::Array<SoundMixerChannelEffect*, 10> effects;
+	/**
+	 * \brief Activates bus, which must not be in use, feeding output.
+	 */
+	void AddBus(SoundBusHandle bus, SoundBusHandle output);
 
-	public:
-		~SoundMixerChannel()
-		{
-			for (auto& e : effects)
-			{
-				delete e;
-			}
-		}
+	/**
+	 * \brief Routes bus into output. Routings that would form a cycle are ignored.
+	 */
+	void SetOutput(SoundBusHandle bus, SoundBusHandle output);
+
+	/**
+	 * \brief Linear gain applied to the bus after it's effects. Changes are ramped over the next block.
+	 */
+	void SetGain(SoundBusHandle bus, const float32 gain) { buses[bus()].TargetGain = gain; }
 
-		void SetMixVolume(const float _MixVolume) { mixVolume = _MixVolume; }
+	/**
+	 * \brief Sets an effect slot, slots run in order and NONE slots are skipped. Filter and envelope state is reset when the type changes.
+	 */
+	void SetEffect(SoundBusHandle bus, uint8 slot, const EffectSettings& settings);
+
+	/**
+	 * \brief Reverberates bus with reverb after it's effects, or stops reverberating it if reverb is nullptr.
+	 */
+	void SetReverb(SoundBusHandle bus, ConvolutionReverb* reverb) { buses[bus()].Reverb = reverb; }
+
+	/**
+	 * \brief Clears every bus for a block of frames frames, at most BLOCK_FRAMES.
+	 */
+	void BeginBlock(uint32 frames);
+
+	/**
+	 * \brief Interleaved stereo samples of the bus for the current block, voices are added into it.
+	 */
+	[[nodiscard]] float32* GetBusSamples(SoundBusHandle bus) { return busSamples + bus() * BLOCK_FRAMES * MIX_CHANNELS; }
+
+	/**
+	 * \brief Runs every bus and returns the master bus's samples for the block.
+	 */
+	const float32* Process();
+
+private:
+	struct Effect
+	{
+		EffectType Type = EffectType::NONE;
 
 		/**
-		 * \brief Adds and effect to the channel.
-		 * \tparam _T Class of effect
-		 * \return Effect* to the newly created effect. Could be used to set parameters.
+		 * \brief Normalized biquad coefficients and transposed direct form II state per channel.
 		 */
-		template <class _T>
-		SoundMixerChannelEffect* AddEffect()
-		{
-			SoundMixerChannelEffect* new_effect = new _T();
-			effects.PushBack(new_effect);
-			return new_effect;
-		}
-
-		void RemoveEffect(const SoundMixerChannelEffectRemoveParameters& _ERP);
+		float32 B0 = 1.0f, B1 = 0.0f, B2 = 0.0f, A1 = 0.0f, A2 = 0.0f;
+		float32 State[MIX_CHANNELS][2]{};
+
+		float32 Threshold = 1.0f, Slope = 0.0f, AttackCoefficient = 0.0f, ReleaseCoefficient = 0.0f, Envelope = 0.0f;
 	};
 
+	struct Bus
+	{
+		bool Active = false;
+		SoundBusHandle Output;
+		float32 Gain = 1.0f, TargetGain = 1.0f;
+		Effect Effects[MAX_EFFECTS_PER_BUS];
+		ConvolutionReverb* Reverb = nullptr;
+	};
+
+	Bus buses[MAX_BUSES];
+
 	/**
-	 * \brief Stores every channel available.
+	 * \brief Active buses ordered so every bus comes before the one it outputs to, master is last.
 	 */
-	//HashMap<SoundMixerChannel> channels;
+	SoundBusHandle order[MAX_BUSES];
+	uint8 orderLength = 0;
 
-public:
-	void OnUpdate();
+	GTSL::Buffer<BE::PAR> busBuffer;
+	float32* busSamples = nullptr;
 
-	void RegisterNewChannel(const SoundMixerChannel& _Channel)
-	{
-		//channels.TryEmplace;
-		//channels.Get(0).effects;
-	}
+	uint32 sampleRate = MIX_SAMPLE_RATE, blockFrames = 0;
 
-	SoundMixerChannel& GetChannel(const GTSL::Id64& _Id)
-	{
-		//return channels.Get(_Id.GetID());
-	}
+	[[nodiscard]] bool feeds(SoundBusHandle bus, SoundBusHandle output) const;
+	void sortBuses();
+	void processEffect(Effect& effect, float32* samples) const;
 };
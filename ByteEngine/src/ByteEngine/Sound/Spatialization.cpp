@@ -0,0 +1,197 @@
+#include "Spatialization.h"
+
+#include <cmath>
+
+#include <GTSL/Memory.h>
+#include <GTSL/Math/Math.hpp>
+
+namespace
+{
+	constexpr float64 PI = 3.14159265358979323846;
+
+	constexpr float64 HEAD_RADIUS = 0.0875;
+
+	/**
+	 * \brief Taps to either side of the fractional delay's center.
+	 */
+	constexpr int32 DELAY_HALF_TAPS = 4;
+
+	/**
+	 * \brief Impulse response of one ear of a spherical head to a source at angle radians from the ear's axis.
+	 */
+	void generateResponse(const float64 angle, const float64 sampleRate, float32* response, const uint32 length)
+	{
+		//head shadow, a one pole one zero filter which boosts highs towards the ear and cuts them behind it
+		constexpr float64 MINIMUM_ALPHA = 0.1, MINIMUM_ANGLE = PI * 5.0 / 6.0;
+		const float64 alpha = (1.0 + MINIMUM_ALPHA / 2.0) + (1.0 - MINIMUM_ALPHA / 2.0) * std::cos(angle / MINIMUM_ANGLE * PI);
+		const float64 beta = 2.0 * SPEED_OF_SOUND / HEAD_RADIUS, k = 2.0 * sampleRate; //bilinear transform
+
+		const float64 b0 = alpha * k + beta, b1 = beta - alpha * k, a0 = k + beta, a1 = beta - k;
+
+		//arrival time relative to the head's center, offset so the earliest arrival is at DELAY_HALF_TAPS
+		const float64 arrival = angle < PI / 2.0 ? -std::cos(angle) : angle - PI / 2.0;
+		const float64 delay = (arrival + 1.0) * HEAD_RADIUS / SPEED_OF_SOUND * sampleRate + DELAY_HALF_TAPS;
+
+		float64 previousInput = 0.0, previousOutput = 0.0;
+
+		for (uint32 n = 0; n < length; ++n)
+		{
+			//Hann windowed sinc, a fractional delay
+			const float64 x = static_cast<float64>(n) - delay;
+			float64 input = 0.0;
+			if (std::abs(x) < DELAY_HALF_TAPS) { input = (x == 0.0 ? 1.0 : std::sin(PI * x) / (PI * x)) * (0.5 + 0.5 * std::cos(PI * x / DELAY_HALF_TAPS)); }
+
+			const float64 output = (b0 * input + b1 * previousInput - a1 * previousOutput) / a0;
+			previousInput = input; previousOutput = output;
+
+			//fade out the end so truncating the response doesn't ring
+			const uint32 fadeLength = length / 8;
+			response[n] = static_cast<float32>(n < length - fadeLength ? output : output * static_cast<float64>(length - n) / static_cast<float64>(fadeLength));
+		}
+	}
+}
+
+float32 GetAttenuation(const AttenuationSettings& attenuationSettings, const float32 distance)
+{
+	const float32 minimum = std::fmax(attenuationSettings.MinDistance, 0.0001f), maximum = std::fmax(attenuationSettings.MaxDistance, minimum);
+	const float32 clampedDistance = GTSL::Math::Clamp(distance, minimum, maximum);
+
+	switch (attenuationSettings.Model)
+	{
+	case RolloffModel::INVERSE: return minimum / (minimum + attenuationSettings.RolloffFactor * (clampedDistance - minimum));
+	case RolloffModel::LINEAR: return maximum == minimum ? 1.0f : std::fmax(1.0f - attenuationSettings.RolloffFactor * (clampedDistance - minimum) / (maximum - minimum), 0.0f);
+	case RolloffModel::EXPONENTIAL: return std::pow(clampedDistance / minimum, -attenuationSettings.RolloffFactor);
+	}
+
+	return 1.0f;
+}
+
+float32 GetDopplerFactor(const GTSL::Vector3 direction, const GTSL::Vector3 listenerVelocity, const GTSL::Vector3 emitterVelocity)
+{
+	//positive when the listener moves towards the emitter and when the emitter moves away from the listener
+	const float32 listenerSpeed = GTSL::Math::DotProduct(listenerVelocity, direction), emitterSpeed = GTSL::Math::DotProduct(emitterVelocity, direction);
+	const float32 factor = (SPEED_OF_SOUND + listenerSpeed) / std::fmax(SPEED_OF_SOUND + emitterSpeed, SPEED_OF_SOUND * 0.01f);
+	return GTSL::Math::Clamp(factor, 0.5f, 2.0f);
+}
+
+void HRTF::Initialize(const uint32 sampleRate, const BE::PAR& allocator)
+{
+	fft.Initialize(FFT_SIZE, allocator);
+
+	spectraBuffer.Allocate(DIRECTIONS * PARTITIONS * FFT_SIZE * 2 * sizeof(float32), 16, allocator);
+	spectra = reinterpret_cast<float32*>(spectraBuffer.GetData());
+
+	constexpr uint32 RESPONSE_LENGTH = PARTITIONS * PARTITION_FRAMES;
+	float32 left[RESPONSE_LENGTH], right[RESPONSE_LENGTH];
+
+	for (uint32 d = 0; d < DIRECTIONS; ++d)
+	{
+		const float64 rightAngle = PI * static_cast<float64>(d) / static_cast<float64>(DIRECTIONS - 1); //0 is a source at the right ear
+		generateResponse(PI - rightAngle, sampleRate, left, RESPONSE_LENGTH); generateResponse(rightAngle, sampleRate, right, RESPONSE_LENGTH);
+
+		for (uint32 p = 0; p < PARTITIONS; ++p)
+		{
+			//transforms are linear, so transforming left + i * right gives left's spectrum + i * right's spectrum
+			auto* real = spectra + (d * PARTITIONS + p) * FFT_SIZE * 2; auto* imaginary = real + FFT_SIZE;
+
+			for (uint32 i = 0; i < FFT_SIZE; ++i)
+			{
+				real[i] = i < PARTITION_FRAMES ? left[p * PARTITION_FRAMES + i] : 0.0f;
+				imaginary[i] = i < PARTITION_FRAMES ? right[p * PARTITION_FRAMES + i] : 0.0f;
+			}
+
+			fft.Forward(real, imaginary);
+
+			for (uint32 i = 0; i < FFT_SIZE * 2; ++i) { real[i] /= static_cast<float32>(FFT_SIZE); } //fold the inverse transform's scale in
+		}
+	}
+}
+
+uint32 HRTF::GetDirection(const float32 rightness)
+{
+	const float32 angle = std::acos(GTSL::Math::Clamp(rightness, -1.0f, 1.0f));
+	return static_cast<uint32>(angle / static_cast<float32>(PI) * static_cast<float32>(DIRECTIONS - 1) + 0.5f);
+}
+
+void HRTFConvolver::Reset()
+{
+	GTSL::SetMemory(sizeof(input), input, 0); GTSL::SetMemory(sizeof(output), output, 0); GTSL::SetMemory(sizeof(tail), tail, 0);
+	GTSL::SetMemory(sizeof(spectra), spectra, 0);
+	filled = 0; history = 0; fresh = true;
+}
+
+void HRTFConvolver::Process(const HRTF& hrtf, const float32* source, const uint32 frames, const GainRamp gain, const uint32 direction, float32* mix)
+{
+	if (fresh) { this->direction = direction; fresh = false; }
+	nextDirection = direction;
+
+	const float32 step = frames ? (gain.End - gain.Start) / static_cast<float32>(frames) : 0.0f;
+
+	for (uint32 f = 0; f < frames;)
+	{
+		const uint32 length = GTSL::Math::Limit(HRTF::PARTITION_FRAMES - filled, frames - f);
+
+		for (uint32 i = 0; i < length; ++i)
+		{
+			input[filled + i] = source[f + i] * (gain.Start + step * static_cast<float32>(f + i));
+			mix[(f + i) * MIX_CHANNELS] += output[(filled + i) * MIX_CHANNELS]; mix[(f + i) * MIX_CHANNELS + 1] += output[(filled + i) * MIX_CHANNELS + 1];
+		}
+
+		filled += length; f += length;
+
+		if (filled == HRTF::PARTITION_FRAMES) { processPartition(hrtf); filled = 0; }
+	}
+}
+
+void HRTFConvolver::processPartition(const HRTF& hrtf)
+{
+	constexpr uint32 SIZE = HRTF::FFT_SIZE, FRAMES = HRTF::PARTITION_FRAMES;
+
+	history = (history + 1) % HRTF::PARTITIONS;
+	float32* spectrum = spectra[history];
+
+	for (uint32 i = 0; i < SIZE; ++i) { spectrum[i] = i < FRAMES ? input[i] : 0.0f; spectrum[SIZE + i] = 0.0f; }
+	hrtf.GetFFT().Forward(spectrum, spectrum + SIZE);
+
+	float32* result = work[0];
+	convolve(hrtf, direction, result);
+	hrtf.GetFFT().Inverse(result, result + SIZE);
+
+	if (nextDirection != direction)
+	{
+		float32* next = work[1];
+		convolve(hrtf, nextDirection, next);
+		hrtf.GetFFT().Inverse(next, next + SIZE);
+
+		//the history is shared, so the new response's output is already complete and only the partition's output needs blending
+		for (uint32 i = 0; i < FRAMES; ++i)
+		{
+			const float32 t = (static_cast<float32>(i) + 0.5f) / static_cast<float32>(FRAMES);
+			result[i] += (next[i] - result[i]) * t; result[SIZE + i] += (next[SIZE + i] - result[SIZE + i]) * t;
+			result[FRAMES + i] = next[FRAMES + i]; result[SIZE + FRAMES + i] = next[SIZE + FRAMES + i];
+		}
+
+		direction = nextDirection;
+	}
+
+	//left ear is the real part and right ear the imaginary part
+	for (uint32 i = 0; i < FRAMES; ++i)
+	{
+		output[i * MIX_CHANNELS] = result[i] + tail[i * MIX_CHANNELS]; output[i * MIX_CHANNELS + 1] = result[SIZE + i] + tail[i * MIX_CHANNELS + 1];
+		tail[i * MIX_CHANNELS] = result[FRAMES + i]; tail[i * MIX_CHANNELS + 1] = result[SIZE + FRAMES + i];
+	}
+}
+
+void HRTFConvolver::convolve(const HRTF& hrtf, const uint32 direction, float32* result) const
+{
+	constexpr uint32 SIZE = HRTF::FFT_SIZE;
+
+	GTSL::SetMemory(SIZE * 2 * sizeof(float32), result, 0);
+
+	for (uint32 p = 0; p < HRTF::PARTITIONS; ++p)
+	{
+		const float32* spectrum = spectra[(history + HRTF::PARTITIONS - p) % HRTF::PARTITIONS];
+		const float32* response = hrtf.GetSpectrum(direction, p);
+		MultiplyAccumulateSpectra(spectrum, spectrum + SIZE, response, response + SIZE, SIZE, result, result + SIZE);
+	}
+}
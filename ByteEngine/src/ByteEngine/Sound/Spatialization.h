@@ -0,0 +1,113 @@
+#pragma once
+
+#include <GTSL/Buffer.hpp>
+#include <GTSL/Math/Vector3.h>
+
+#include "ByteEngine/Core.h"
+#include "ByteEngine/Application/AllocatorReferences.h"
+
+#include "AudioMixing.h"
+#include "FFT.h"
+
+/**
+ * \brief World units per second sound travels at, used for Doppler shifts. World units are meters.
+ */
+static constexpr float32 SPEED_OF_SOUND = 343.0f;
+
+enum class RolloffModel : uint8
+{
+	/**
+	 * \brief MinDistance / (MinDistance + RolloffFactor * (distance - MinDistance)), physically based.
+	 */
+	INVERSE,
+	/**
+	 * \brief 1 - RolloffFactor * (distance - MinDistance) / (MaxDistance - MinDistance), reaches silence at MaxDistance when RolloffFactor is 1.
+	 */
+	LINEAR,
+	/**
+	 * \brief (distance / MinDistance) ^ -RolloffFactor.
+	 */
+	EXPONENTIAL
+};
+
+/**
+ * \brief How an emitter's gain falls off with distance to the listener. Distances are clamped to [MinDistance, MaxDistance], so emitters closer than
+ * MinDistance play at full gain and gain stops changing past MaxDistance.
+ */
+struct AttenuationSettings
+{
+	RolloffModel Model = RolloffModel::LINEAR;
+	float32 MinDistance = 1.0f, MaxDistance = 1500.0f, RolloffFactor = 1.0f;
+};
+
+float32 GetAttenuation(const AttenuationSettings& attenuationSettings, float32 distance);
+
+/**
+ * \brief Returns the factor the emitter's playback rate is multiplied by, clamped to [0.5, 2].
+ * \param direction Normalized direction from the listener to the emitter.
+ */
+float32 GetDopplerFactor(GTSL::Vector3 direction, GTSL::Vector3 listenerVelocity, GTSL::Vector3 emitterVelocity);
+
+/**
+ * \brief Head related transfer functions of a spherical head (Brown and Duda's model): a head shadow filter and an interaural delay per ear.
+ * A spherical head only depends on the angle between the source and the ears' axis, so the table holds DIRECTIONS angles from right to left.
+ * Responses are stored as the spectra of PARTITIONS partitions of PARTITION_FRAMES frames, left ear in the real part and right ear in the
+ * imaginary part, so one inverse transform yields both ears.
+ */
+class HRTF
+{
+public:
+	static constexpr uint32 PARTITION_FRAMES = 64, PARTITIONS = 2, DIRECTIONS = 37;
+	static constexpr uint32 FFT_SIZE = PARTITION_FRAMES * 2;
+
+	void Initialize(uint32 sampleRate, const BE::PAR& allocator);
+
+	/**
+	 * \brief Returns the table entry for a source in a direction whose dot product with the listener's right vector is rightness.
+	 */
+	[[nodiscard]] static uint32 GetDirection(float32 rightness);
+
+	[[nodiscard]] const float32* GetSpectrum(const uint32 direction, const uint32 partition) const { return spectra + (direction * PARTITIONS + partition) * FFT_SIZE * 2; }
+
+	[[nodiscard]] const FFT& GetFFT() const { return fft; }
+
+private:
+	FFT fft;
+	GTSL::Buffer<BE::PAR> spectraBuffer;
+	float32* spectra = nullptr;
+};
+
+/**
+ * \brief State of one voice rendered through the HRTF, with uniformly partitioned overlap add convolution. Output is delayed by
+ * HRTF::PARTITION_FRAMES frames. Direction changes crossfade the outputs of the old and new responses over a partition.
+ */
+class HRTFConvolver
+{
+public:
+	void Reset();
+
+	/**
+	 * \brief Convolves frames mono samples, scaled by gain, with the response for direction and adds the stereo result to mix.
+	 */
+	void Process(const HRTF& hrtf, const float32* source, uint32 frames, GainRamp gain, uint32 direction, float32* mix);
+
+private:
+	float32 input[HRTF::PARTITION_FRAMES], output[HRTF::PARTITION_FRAMES * MIX_CHANNELS], tail[HRTF::PARTITION_FRAMES * MIX_CHANNELS];
+
+	/**
+	 * \brief Spectra of the last PARTITIONS input partitions, real parts followed by imaginary parts. history is the newest one.
+	 */
+	float32 spectra[HRTF::PARTITIONS][HRTF::FFT_SIZE * 2];
+	uint32 history = 0;
+
+	float32 work[2][HRTF::FFT_SIZE * 2];
+
+	uint32 filled = 0, direction = 0, nextDirection = 0;
+	/**
+	 * \brief Whether nothing was processed since the last reset, the first direction is taken without crossfading.
+	 */
+	bool fresh = true;
+
+	void processPartition(const HRTF& hrtf);
+	void convolve(const HRTF& hrtf, uint32 direction, float32* result) const;
+};
@@ -0,0 +1,52 @@
+#include "WavAudioDevice.h"
+
+void WavAudioDevice::CreateAudioStream(StreamShareMode, const MixFormat& mixFormat)
+{
+	frameSize = mixFormat.GetFrameSize();
+	samplesPerSecond = mixFormat.SamplesPerSecond;
+	channels = mixFormat.NumberOfChannels;
+	bufferFrames = MAX_BUFFER_BYTES / frameSize;
+}
+
+void WavAudioDevice::Start()
+{
+	file.OpenFile(path, static_cast<uint8>(GTSL::File::AccessMode::WRITE), GTSL::File::OpenMode::CLEAR);
+	writeHeader(0);
+
+	writtenFrames = 0; hash = 2166136261u;
+	running = true;
+}
+
+void WavAudioDevice::Stop()
+{
+	if (!running) { return; }
+	running = false;
+
+	file.SetPointer(0, GTSL::File::MoveFrom::BEGIN);
+	writeHeader(static_cast<uint32>(writtenFrames * frameSize));
+}
+
+void WavAudioDevice::write(const uint32 frames)
+{
+	const uint32 bytes = frames * frameSize;
+
+	for (uint32 i = 0; i < bytes; ++i) { hash = (hash ^ sink[i]) * 16777619u; }
+
+	file.WriteToFile(GTSL::Range<const byte*>(bytes, sink));
+	writtenFrames += frames;
+}
+
+void WavAudioDevice::writeHeader(const uint32 dataBytes)
+{
+	byte header[HEADER_BYTES]; uint32 offset = 0;
+
+	auto writeTag = [&](const char* tag) { for (uint32 i = 0; i < 4; ++i) { header[offset++] = static_cast<byte>(tag[i]); } };
+	auto writeInteger = [&](const uint32 value, const uint32 size) { for (uint32 i = 0; i < size; ++i) { header[offset++] = static_cast<byte>(value >> i * 8); } }; //little endian
+
+	writeTag("RIFF"); writeInteger(HEADER_BYTES - 8 + dataBytes, 4); writeTag("WAVE");
+	writeTag("fmt "); writeInteger(16, 4); writeInteger(1, 2); writeInteger(channels, 2); //PCM
+	writeInteger(samplesPerSecond, 4); writeInteger(samplesPerSecond * frameSize, 4); writeInteger(frameSize, 2); writeInteger(frameSize / channels * 8, 2);
+	writeTag("data"); writeInteger(dataBytes, 4);
+
+	file.WriteToFile(GTSL::Range<const byte*>(HEADER_BYTES, header));
+}
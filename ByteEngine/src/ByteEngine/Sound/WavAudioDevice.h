@@ -0,0 +1,86 @@
+#pragma once
+
+#include <GTSL/File.h>
+#include <GTSL/StaticString.hpp>
+
+#include "ByteEngine/Core.h"
+
+/**
+ * \brief Audio device that writes everything pushed to it to a 16 bit PCM WAV file, for rendering audio offline.
+ * It has the same interface as the other devices but no playback clock, it accepts a full buffer every time it's asked,
+ * so it can be fed as fast as audio can be mixed. Time is whatever the rendered frames add up to.
+ */
+class WavAudioDevice
+{
+public:
+	enum class StreamShareMode : uint8 { SHARED, EXCLUSIVE };
+	enum class BufferSamplePlacement : uint8 { INTERLEAVED, PLANAR };
+
+	struct CreateInfo
+	{
+		GTSL::StaticString<260> Path;
+	};
+
+	struct MixFormat
+	{
+		uint16 BitsPerSample = 16, NumberOfChannels = 2;
+		uint32 SamplesPerSecond = 48000;
+
+		[[nodiscard]] uint32 GetFrameSize() const { return BitsPerSample / 8 * NumberOfChannels; }
+	};
+
+	void Initialize(const CreateInfo& createInfo) { path = createInfo.Path; }
+	[[nodiscard]] bool IsMixFormatSupported(StreamShareMode, const MixFormat& mixFormat) const { return mixFormat.BitsPerSample == 16 && mixFormat.NumberOfChannels && mixFormat.SamplesPerSecond; }
+	void CreateAudioStream(StreamShareMode, const MixFormat& mixFormat);
+	[[nodiscard]] BufferSamplePlacement GetBufferSamplePlacement() const { return BufferSamplePlacement::INTERLEAVED; }
+
+	/**
+	 * \brief Creates the file, with a header whose sizes are filled in by Stop.
+	 */
+	void Start();
+	void Stop();
+	void Destroy() {}
+
+	void GetAvailableBufferFrames(uint32& availableFrames) const { availableFrames = running ? bufferFrames : 0; }
+
+	/**
+	 * \param copyFunction Callable as copyFunction(uint32 bytes, void* to), it's handed a buffer with room for frames frames to write to.
+	 */
+	template<typename F>
+	void PushAudioData(F&& copyFunction, const uint32 frames)
+	{
+		copyFunction(frames * frameSize, sink);
+		write(frames);
+	}
+
+	void GetUnderruns(uint32& underrunCount, uint64& silentFrames) const { underrunCount = 0; silentFrames = 0; } //nothing plays, nothing can run dry
+
+	[[nodiscard]] uint64 GetWrittenFrames() const { return writtenFrames; }
+
+	/**
+	 * \brief Returns the 32 bit FNV-1a hash of every sample written so far, two renders are bit exact when their hashes match.
+	 */
+	[[nodiscard]] uint32 GetHash() const { return hash; }
+
+private:
+	static constexpr uint32 MAX_BUFFER_BYTES = 32768;
+	static constexpr uint32 HEADER_BYTES = 44;
+
+	GTSL::StaticString<260> path;
+	GTSL::File file;
+
+	uint32 frameSize = 4, bufferFrames = 0, samplesPerSecond = 48000;
+	uint16 channels = 2;
+	bool running = false;
+
+	uint64 writtenFrames = 0;
+	uint32 hash = 2166136261u;
+
+	/**
+	 * \brief Pushed frames are written here before going to the file.
+	 */
+	alignas(16) byte sink[MAX_BUFFER_BYTES];
+
+	void write(uint32 frames);
+	void writeHeader(uint32 dataBytes);
+};
@@ -7,6 +7,8 @@
 class MenuWorld : public World
 {
 public:
+	MenuWorld() : World("MenuWorld") {}
+	
 	void InitializeWorld(const InitializeInfo& initializeInfo) override
 	{
 		World::InitializeWorld(initializeInfo);
@@ -17,6 +19,7 @@ public:
 	void DestroyWorld(const DestroyInfo& destroyInfo) override
 	{
 		//destroyInfo.GameInstance->DestroyComponentCollection(testComponentCollectionReference);
+		World::DestroyWorld(destroyInfo);
 	}
 private:
 	